@@ -30,6 +30,7 @@ SamplerState sam;
 //!PASS 1
 //!STYLE PS
 //!IN INPUT
+//!HALO 2
 
 
 float weight(float x) {
@@ -13,6 +13,7 @@ SamplerState sam;
 //!PASS 1
 //!STYLE PS
 //!IN INPUT
+//!HALO 1
 
 float4 Pass1(float2 pos) {
 	return INPUT.SampleLevel(sam, pos, 0);
@@ -15,6 +15,7 @@ SamplerState sam;
 //!PASS 1
 //!STYLE PS
 //!IN INPUT
+//!HALO 2
 
 #define B 0
 #define C 0.5
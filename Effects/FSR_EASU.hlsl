@@ -15,6 +15,7 @@ SamplerState sam;
 
 //!PASS 1
 //!IN INPUT
+//!HALO 2
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
@@ -21,6 +21,7 @@ SamplerState sam;
 
 //!PASS 1
 //!IN INPUT
+//!HALO 1
 //!BLOCK_SIZE 16
 //!NUM_THREADS 64
 
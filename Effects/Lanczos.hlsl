@@ -22,6 +22,7 @@ SamplerState sam;
 //!PASS 1
 //!STYLE PS
 //!IN INPUT
+//!HALO 3
 
 #define FIX(c) max(abs(c), 1e-5)
 #define PI 3.14159265359
@@ -50,7 +50,8 @@ namespace Magpie {
 			DisableEffectCache = 0x400,
 			DisableVSync = 0x800,
 			WarningsAreErrors = 0x1000,
-			ShowFPS = 0x2000
+			ShowFPS = 0x2000,
+			MatchSourceFrameRate = 0x4000
 		}
 
 		private readonly MagWindowParams magWindowParams = new();
@@ -153,7 +154,8 @@ namespace Magpie {
 							(Settings.Default.SimulateExclusiveFullscreen ? (uint)FlagMasks.SimulateExclusiveFullscreen : 0) |
 							(Settings.Default.DebugWarningsAreErrors ? (uint)FlagMasks.WarningsAreErrors : 0) |
 							(Settings.Default.VSync ? 0 : (uint)FlagMasks.DisableVSync) |
-							(Settings.Default.ShowFPS ? (uint)FlagMasks.ShowFPS : 0);
+							(Settings.Default.ShowFPS ? (uint)FlagMasks.ShowFPS : 0) |
+							(Settings.Default.MatchSourceFrameRate ? (uint)FlagMasks.MatchSourceFrameRate : 0);
 
 						bool customCropping = Settings.Default.CustomCropping;
 
@@ -175,6 +177,9 @@ namespace Magpie {
 						CloseEvent?.Invoke(msg);
 					}
 				}
+
+				// 等待 Runtime 的后台线程退出并保存缓存索引
+				NativeMethods.Uninitialize();
 			});
 
 			magThread.SetApartmentState(ApartmentState.MTA);
@@ -150,6 +150,9 @@ namespace Magpie {
 			int logMaxArchiveFiles
 		);
 
+		[DllImport("MagpieRT", CallingConvention = CallingConvention.StdCall)]
+		public static extern void Uninitialize();
+
 		[DllImport("MagpieRT", CallingConvention = CallingConvention.StdCall)]
 		public static extern void SetLogLevel(uint logLevel);
 
@@ -96,6 +96,15 @@ namespace Magpie.Properties {
             }
         }
         
+        /// <summary>
+        ///   查找类似 The selected effects need more video memory than the configured budget. 的本地化字符串。
+        /// </summary>
+        public static string Msg_Error_GPU_Memory_Budget {
+            get {
+                return ResourceManager.GetString("Msg_Error_GPU_Memory_Budget", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   查找类似 Failed to initialize Runtime. 的本地化字符串。
         /// </summary>
@@ -789,6 +798,15 @@ namespace Magpie.Properties {
             }
         }
         
+        /// <summary>
+        ///   查找类似 Limit Frame Rate to Source Window 的本地化字符串。
+        /// </summary>
+        public static string UI_Options_Scale_Match_Source_Frame_Rate {
+            get {
+                return ResourceManager.GetString("UI_Options_Scale_Match_Source_Frame_Rate", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   查找类似 Multiple Monitors 的本地化字符串。
         /// </summary>
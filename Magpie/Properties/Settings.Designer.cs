@@ -466,5 +466,17 @@ namespace Magpie.Properties {
                 this["ShowFPS"] = value;
             }
         }
+        
+        [global::System.Configuration.UserScopedSettingAttribute()]
+        [global::System.Diagnostics.DebuggerNonUserCodeAttribute()]
+        [global::System.Configuration.DefaultSettingValueAttribute("False")]
+        public bool MatchSourceFrameRate {
+            get {
+                return ((bool)(this["MatchSourceFrameRate"]));
+            }
+            set {
+                this["MatchSourceFrameRate"] = value;
+            }
+        }
     }
 }
@@ -82,10 +82,13 @@ namespace Magpie {
 
 					JsonNode name = model["name"] ?? throw new Exception("未找到 name 字段");
 					JsonNode effects = model["effects"] ?? throw new Exception("未找到 effects 字段");
+					// 可选，渲染用时超出预算时依次使用的备选效果链
+					JsonNode? fallbacks = model["fallbacks"];
 
 					return new ScaleModel {
 						Name = name.GetValue<string>(),
-						Effects = effects.ToJsonString()
+						Effects = fallbacks == null ? effects.ToJsonString()
+							: $"{{\"effects\":{effects.ToJsonString()},\"fallbacks\":{fallbacks.ToJsonString()}}}"
 					};
 				}).ToArray();
 
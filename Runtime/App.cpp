@@ -1,29 +1,21 @@
 #include "pch.h"
 #include "App.h"
 #include "Utils.h"
-#include "GraphicsCaptureFrameSource.h"
-#include "GDIFrameSource.h"
-#include "DwmSharedSurfaceFrameSource.h"
-#include "DesktopDuplicationFrameSource.h"
-#include "ExclModeHack.h"
-#include "Renderer.h"
-#include "DeviceResources.h"
-#include "GPUTimer.h"
 #include "Logger.h"
-#include "CursorManager.h"
-#include "Config.h"
-#include "StrUtils.h"
-#include "WindowsMessages.h"
+#include "GraphicsDevice.h"
+#include "EffectCacheManager.h"
 
 
-static constexpr const wchar_t* HOST_WINDOW_CLASS_NAME = L"Window_Magpie_967EB565-6F73-4E94-AE53-00CC42592A22";
-static constexpr const wchar_t* DDF_WINDOW_CLASS_NAME = L"Window_Magpie_C322D752-C866-4630-91F5-32CB242A8930";
-static constexpr const wchar_t* HOST_WINDOW_TITLE = L"Magpie_Host";
+thread_local ScalingSession* App::_currentSession = nullptr;
 
 
 App::App() {}
 
 App::~App() {
+	if (_hRenderThread) {
+		CloseHandle(_hRenderThread);
+	}
+
 	winrt::uninit_apartment();
 }
 
@@ -35,13 +27,25 @@ bool App::Initialize(HINSTANCE hInst) {
 	// 初始化 COM
 	winrt::init_apartment(winrt::apartment_type::multi_threaded);
 
-	_RegisterWndClasses();
+	_renderEvent.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
+	if (!_renderEvent) {
+		Logger::Get().Win32Error("CreateEvent 失败");
+		return false;
+	}
+
+	ScalingSession::RegisterWndClasses(_hInst);
 
 	Logger::Get().Info("App 初始化成功");
 	return true;
 }
 
-bool App::Run(
+void App::Uninitialize() {
+	EffectCacheManager::Get().Shutdown();
+
+	Logger::Get().Info("App 已清理");
+}
+
+const char* App::Run(
 	HWND hwndSrc,
 	const std::string& effectsJson,
 	UINT captureMode,
@@ -52,404 +56,256 @@ bool App::Run(
 	const RECT& cropBorders,
 	UINT flags
 ) {
-	_hwndSrc = hwndSrc;
-	_config.reset(new Config());
-	_config->Initialize(cursorZoomFactor, cursorInterpolationMode, adapterIdx, multiMonitorUsage, cropBorders, flags);
-	
-	SetErrorMsg(ErrorMessages::GENERIC);
-
-	// 模拟独占全屏
-	// 必须在主窗口创建前，否则 SHQueryUserNotificationState 可能返回 QUNS_BUSY 而不是 QUNS_RUNNING_D3D_FULL_SCREEN
-	ExclModeHack exclMode;
-
-	if (!_CreateHostWnd()) {
-		Logger::Get().Critical("创建主窗口失败");
-		_OnQuit();
-		return false;
-	}
-
-	_deviceResources.reset(new DeviceResources());
-	if (!_deviceResources->Initialize()) {
-		Logger::Get().Critical("初始化 DeviceResources 失败");
-		Quit();
-		_RunMessageLoop();
-		return false;
-	}
-	
-	if (!_InitFrameSource(captureMode)) {
-		Logger::Get().Critical("_InitFrameSource 失败");
-		Quit();
-		_RunMessageLoop();
-		return false;
-	}
+	{
+		std::scoped_lock lk(_sessionsLock);
 
-	_renderer.reset(new Renderer());
-	if (!_renderer->Initialize(effectsJson)) {
-		Logger::Get().Critical("初始化 Renderer 失败");
-		Quit();
-		_RunMessageLoop();
-		return false;
+		if (std::find(_srcWnds.begin(), _srcWnds.end(), hwndSrc) != _srcWnds.end()) {
+			Logger::Get().Error("源窗口已被缩放");
+			return ErrorMessages::GENERIC;
+		}
+		_srcWnds.push_back(hwndSrc);
 	}
 
-	_cursorManager.reset(new CursorManager());
-	if (!_cursorManager->Initialize()) {
-		Logger::Get().Critical("初始化 CursorManager 失败");
-		Quit();
-		_RunMessageLoop();
-		return false;
+	std::unique_ptr<ScalingSession> session = std::make_unique<ScalingSession>();
+	bool success;
+	{
+		// 此线程成为会话的 UI 线程
+		SessionScope scope(session.get());
+		success = session->Run(hwndSrc, effectsJson, captureMode, cursorZoomFactor,
+			cursorInterpolationMode, adapterIdx, multiMonitorUsage, cropBorders, flags);
 	}
 
-	if (_config->IsDisableDirectFlip() && !_config->IsBreakpointMode()) {
-		// 在此处创建的 DDF 窗口不会立刻显示
-		if (!_DisableDirectFlip()) {
-			Logger::Get().Error("_DisableDirectFlip 失败");
-		}
+	{
+		std::scoped_lock lk(_sessionsLock);
+		_srcWnds.erase(std::find(_srcWnds.begin(), _srcWnds.end(), hwndSrc));
 	}
 
-	ShowWindow(_hwndHost, SW_NORMAL);
-
-	_RunMessageLoop();
-
-	return true;
+	return success ? nullptr : session->GetErrorMsg();
 }
 
-void App::_RunMessageLoop() {
-	Logger::Get().Info("开始接收窗口消息");
-
-	while (true) {
-		MSG msg;
-		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
-			if (msg.message == WM_QUIT) {
-				_OnQuit();
-				return;
-			}
-
-			TranslateMessage(&msg);
-			DispatchMessage(&msg);
-		}
-
-		_renderer->Render();
-
-		// 第二帧（等待时或完成后）显示 DDF 窗口
-		// 如果在 Run 中创建会有短暂的灰屏
-		// 选择第二帧的原因：当 GetFrameCount() 返回 1 时第一帧可能处于等待状态而没有渲染，见 Renderer::Render()
-		if (_renderer->GetGPUTimer().GetFrameCount() == 2 && _hwndDDF) {
-			ShowWindow(_hwndDDF, SW_NORMAL);
-
-			if (!SetWindowPos(_hwndDDF, _hwndHost, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOMOVE | SWP_NOREDRAW)) {
-				Logger::Get().Win32Error("SetWindowPos 失败");
-			}
-		}
-	}
+bool App::EstimateGPUMemory(
+	const std::string& effectsJson,
+	UINT flags,
+	SIZE inputSize,
+	SIZE hostSize,
+	std::vector<std::string>& effectNames,
+	std::vector<uint64_t>& effectBytes
+) {
+	// 编译效果需要会话的配置，因此使用一个不开始缩放的会话
+	ScalingSession session;
+	SessionScope scope(&session);
+	return session.EstimateGPUMemory(effectsJson, flags, inputSize, hostSize, effectNames, effectBytes);
 }
 
-winrt::com_ptr<IWICImagingFactory2> App::GetWICImageFactory() {
-	static winrt::com_ptr<IWICImagingFactory2> wicImgFactory;
-
-	if (wicImgFactory == nullptr) {
-		HRESULT hr = CoCreateInstance(
-			CLSID_WICImagingFactory,
-			NULL,
-			CLSCTX_INPROC_SERVER,
-			IID_PPV_ARGS(wicImgFactory.put())
-		);
-
-		if (FAILED(hr)) {
-			Logger::Get().ComError("创建 WICImagingFactory 失败", hr);
-			return nullptr;
-		}
+std::shared_ptr<GraphicsDevice> App::GetSharedDevice(int adapterIdx) {
+	std::shared_ptr<GraphicsDevice> device;
+	{
+		std::scoped_lock lk(_sessionsLock);
+		device = _sharedDevice.lock();
 	}
 
-	return wicImgFactory;
-}
+	if (!device || device->GetAdapterIdx() != adapterIdx || !device->IsValid()) {
+		return nullptr;
+	}
 
-UINT App::RegisterWndProcHandler(std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)> handler) {
-	UINT id = _nextWndProcHandlerID++;
-	return _wndProcHandlers.emplace(id, handler).second ? id : 0;
+	return device;
 }
 
-void App::UnregisterWndProcHandler(UINT id) {
-	_wndProcHandlers.erase(id);
+void App::SetSharedDevice(const std::shared_ptr<GraphicsDevice>& device) {
+	// 几乎同时开始的缩放可能各自创建了设备，之后的缩放共享最后设置的
+	std::scoped_lock lk(_sessionsLock);
+	_sharedDevice = device;
 }
 
-
-LRESULT DDFWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-	if (msg == WM_DESTROY) {
-		return 0;
+bool App::AddSession(ScalingSession& session) {
+	// 由 RemoveSession 关闭
+	HANDLE hRemovedEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	if (!hRemovedEvent) {
+		Logger::Get().Win32Error("CreateEvent 失败");
+		return false;
 	}
 
-	return DefWindowProc(hWnd, msg, wParam, lParam);
-}
+	std::scoped_lock lk(_sessionsLock);
 
-// 注册窗口类
-void App::_RegisterWndClasses() const {
-	WNDCLASSEX wcex = {};
-	wcex.cbSize = sizeof(WNDCLASSEX);
-	wcex.lpfnWndProc = _HostWndProcStatic;
-	wcex.hInstance = _hInst;
-	wcex.hCursor = LoadCursor(NULL, IDC_ARROW);
-	wcex.lpszClassName = HOST_WINDOW_CLASS_NAME;
-
-	if (!RegisterClassEx(&wcex)) {
-		// 忽略此错误，因为可能是重复注册产生的错误
-		Logger::Get().Win32Error("注册主窗口类失败");
-	} else {
-		Logger::Get().Info("已注册主窗口类");
-	}
+	if (!_isRenderThreadRunning) {
+		if (_hRenderThread) {
+			// 上一个渲染线程已没有会话可渲染，正在退出
+			WaitForSingleObject(_hRenderThread, INFINITE);
+			CloseHandle(_hRenderThread);
+		}
 
-	wcex.lpfnWndProc = DDFWndProc;
-	wcex.hbrBackground = (HBRUSH)GetStockObject(GRAY_BRUSH);
-	wcex.lpszClassName = DDF_WINDOW_CLASS_NAME;
+		_hRenderThread = CreateThread(nullptr, 0, _RenderThreadProc, nullptr, 0, nullptr);
+		if (!_hRenderThread) {
+			Logger::Get().Win32Error("创建渲染线程失败");
+			CloseHandle(hRemovedEvent);
+			return false;
+		}
 
-	if (!RegisterClassEx(&wcex)) {
-		Logger::Get().Win32Error("注册 DDF 窗口类失败");
-	} else {
-		Logger::Get().Info("已注册 DDF 窗口类");
+		_isRenderThreadRunning = true;
 	}
-}
 
-static BOOL CALLBACK MonitorEnumProc(HMONITOR, HDC, LPRECT monitorRect, LPARAM data) {
-	RECT* params = (RECT*)data;
+	_sessions.push_back({ &session, hRemovedEvent });
+	_sessionCount.store(_sessions.size(), std::memory_order_relaxed);
 
-	if (Utils::CheckOverlap(params[0], *monitorRect)) {
-		UnionRect(&params[1], monitorRect, &params[1]);
-	}
-	
-	return TRUE;
+	WakeRenderThread();
+	return true;
 }
 
-static bool CalcHostWndRect(HWND hWnd, UINT multiMonitorMode, RECT& result) {
-	switch (multiMonitorMode) {
-	case 0:
-	{
-		// 使用距离源窗口最近的显示器
-		HMONITOR hMonitor = MonitorFromWindow(hWnd, MONITOR_DEFAULTTONEAREST);
-		if (!hMonitor) {
-			Logger::Get().Win32Error("MonitorFromWindow 失败");
-			return false;
-		}
+void App::RemoveSession(ScalingSession& session) {
+	Utils::ScopedHandle removedEvent;
 
-		MONITORINFO mi{};
-		mi.cbSize = sizeof(mi);
-		if (!GetMonitorInfo(hMonitor, &mi)) {
-			Logger::Get().Win32Error("GetMonitorInfo 失败");
-			return false;
-		}
-		result = mi.rcMonitor;
-
-		break;
-	}
-	case 1:
 	{
-		// 使用源窗口跨越的所有显示器
+		std::scoped_lock lk(_sessionsLock);
 
-		// [0] 存储源窗口坐标，[1] 存储计算结果
-		RECT params[2]{};
-
-		if (!Utils::GetWindowFrameRect(hWnd, params[0])) {
-			Logger::Get().Error("GetWindowFrameRect 失败");
-			return false;
-		}
-		
-		if (!EnumDisplayMonitors(NULL, NULL, MonitorEnumProc, (LPARAM)&params)) {
-			Logger::Get().Win32Error("EnumDisplayMonitors 失败");
-			return false;
-		}
-		
-		result = params[1];
-		if (result.right - result.left <= 0 || result.bottom - result.top <= 0) {
-			Logger::Get().Error("计算主窗口坐标失败");
-			return false;
+		auto it = std::find_if(_sessions.begin(), _sessions.end(),
+			[&](const _SessionEntry& entry) { return entry.session == &session; });
+		if (it == _sessions.end() || it->isRemoving) {
+			return;
 		}
 
-		break;
+		it->isRemoving = true;
+		removedEvent.reset(it->hRemovedEvent);
+		_sessionCount.store(_sessions.size() - 1, std::memory_order_relaxed);
 	}
-	case 2:
-	{
-		// 使用所有显示器（Virtual Screen）
-		int vsWidth = GetSystemMetrics(SM_CXVIRTUALSCREEN);
-		int vsHeight = GetSystemMetrics(SM_CYVIRTUALSCREEN);
-		int vsX = GetSystemMetrics(SM_XVIRTUALSCREEN);
-		int vsY = GetSystemMetrics(SM_YVIRTUALSCREEN);
-		result = { vsX, vsY, vsX + vsWidth, vsY + vsHeight };
-
-		break;
-	}
-	default:
-		return false;
-	}
-	
-	return true;
-}
 
-// 创建主窗口
-bool App::_CreateHostWnd() {
-	if (FindWindow(HOST_WINDOW_CLASS_NAME, nullptr)) {
-		Logger::Get().Error("已存在主窗口");
-		return false;
-	}
+	WakeRenderThread();
 
-	if (!CalcHostWndRect(_hwndSrc, _config->GetMultiMonitorUsage(), _hostWndRect)) {
-		Logger::Get().Error("CalcHostWndRect 失败");
-		return false;
-	}
-
-	_hwndHost = CreateWindowEx(
-		(_config->IsBreakpointMode() ? 0 : WS_EX_TOPMOST) | WS_EX_NOACTIVATE | WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOOLWINDOW,
-		HOST_WINDOW_CLASS_NAME,
-		HOST_WINDOW_TITLE,
-		WS_POPUP,
-		_hostWndRect.left,
-		_hostWndRect.top,
-		_hostWndRect.right - _hostWndRect.left,
-		_hostWndRect.bottom - _hostWndRect.top,
-		NULL,
-		NULL,
-		_hInst,
-		NULL
-	);
-	if (!_hwndHost) {
-		Logger::Get().Win32Error("创建主窗口失败");
-		return false;
+	// 渲染线程可能向主窗口发送消息（如修改窗口样式），等待时需处理这些消息以免死锁
+	HANDLE hRemovedEvent = removedEvent.get();
+	while (MsgWaitForMultipleObjects(1, &hRemovedEvent, FALSE, INFINITE, QS_SENDMESSAGE) == WAIT_OBJECT_0 + 1) {
+		MSG msg;
+		PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE);
 	}
+}
 
-	Logger::Get().Info(fmt::format("主窗口尺寸：{}x{}",
-		_hostWndRect.right - _hostWndRect.left, _hostWndRect.bottom - _hostWndRect.top));
+DWORD WINAPI App::_RenderThreadProc(LPVOID) {
+	winrt::init_apartment(winrt::apartment_type::multi_threaded);
 
-	// 设置窗口不透明
-	// 不完全透明时可关闭 DirectFlip
-	if (!SetLayeredWindowAttributes(_hwndHost, 0, _config->IsDisableDirectFlip() ? 254 : 255, LWA_ALPHA)) {
-		Logger::Get().Win32Error("SetLayeredWindowAttributes 失败");
-	}
+	Get()._RenderLoop();
 
-	Logger::Get().Info("已创建主窗口");
-	return true;
+	winrt::uninit_apartment();
+	return 0;
 }
 
-bool App::_InitFrameSource(int captureMode) {
-	switch (captureMode) {
-	case 0:
-		_frameSource.reset(new GraphicsCaptureFrameSource());
-		break;
-	case 1:
-		_frameSource.reset(new DesktopDuplicationFrameSource());
-		break;
-	case 2:
-		_frameSource.reset(new GDIFrameSource());
-		break;
-	case 3:
-		_frameSource.reset(new DwmSharedSurfaceFrameSource());
-		break;
-	default:
-		Logger::Get().Critical("未知的捕获模式");
-		return false;
+void App::_RenderLoop() {
+	Logger::Get().Info("渲染线程已启动");
+
+	// 使用高精度计时器，否则帧率限制受系统计时器精度（通常为 15.6ms）影响
+	Utils::ScopedHandle hTimer(CreateWaitableTimerEx(nullptr, nullptr,
+		CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS));
+	if (!hTimer) {
+		// Win10 v1803 之前不支持 CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+		hTimer.reset(CreateWaitableTimerEx(nullptr, nullptr, 0, TIMER_ALL_ACCESS));
+		if (!hTimer) {
+			Logger::Get().Win32Error("CreateWaitableTimerEx 失败");
+		}
 	}
 
-	Logger::Get().Info(StrUtils::Concat("当前捕获模式：", _frameSource->GetName()));
+	std::vector<ScalingSession*> sessions;
+	while (true) {
+		{
+			std::scoped_lock lk(_sessionsLock);
+
+			// 移除正在移除的会话，上一轮已结束，此时不会访问它们
+			for (auto it = _sessions.begin(); it != _sessions.end();) {
+				if (it->isRemoving) {
+					SetEvent(it->hRemovedEvent);
+					it = _sessions.erase(it);
+				} else {
+					++it;
+				}
+			}
 
-	if (!_frameSource->Initialize()) {
-		Logger::Get().Critical("初始化 FrameSource 失败");
-		return false;
-	}
+			if (_sessions.empty()) {
+				_isRenderThreadRunning = false;
+				break;
+			}
 
-	const RECT& frameRect = _frameSource->GetSrcFrameRect();
-	Logger::Get().Info(fmt::format("源窗口尺寸：{}x{}",
-		frameRect.right - frameRect.left, frameRect.bottom - frameRect.top));
+			sessions.clear();
+			for (const _SessionEntry& entry : _sessions) {
+				sessions.push_back(entry.session);
+			}
+		}
 
-	return true;
-}
+		// 轮流渲染每个会话，渲染一个会话时持有其设备上下文的锁
+		for (ScalingSession* session : sessions) {
+			SessionScope scope(session);
+			std::scoped_lock lk(session->GetDeviceResources().GetDevice().GetContextLock());
+			session->RenderFrame();
+		}
 
-bool App::_DisableDirectFlip() {
-	// 没有显式关闭 DirectFlip 的方法
-	// 将全屏窗口设为稍微透明，以灰色全屏窗口为背景
-	_hwndDDF = CreateWindowEx(
-		WS_EX_NOACTIVATE | WS_EX_LAYERED | WS_EX_TRANSPARENT,
-		DDF_WINDOW_CLASS_NAME,
-		NULL,
-		WS_POPUP,
-		_hostWndRect.left,
-		_hostWndRect.top,
-		_hostWndRect.right - _hostWndRect.left,
-		_hostWndRect.bottom - _hostWndRect.top,
-		NULL,
-		NULL,
-		_hInst,
-		NULL
-	);
-
-	if (!_hwndDDF) {
-		Logger::Get().Win32Error("创建 DDF 窗口失败");
-		return false;
+		_WaitForRenderEvents(sessions, hTimer.get());
 	}
 
-	// 设置窗口不透明
-	if (!SetLayeredWindowAttributes(_hwndDDF, 0, 255, LWA_ALPHA)) {
-		Logger::Get().Win32Error("SetLayeredWindowAttributes 失败");
-	}
+	Logger::Get().Info("渲染线程已退出");
+}
 
-	if (_frameSource->IsScreenCapture()) {
-		const RTL_OSVERSIONINFOW& version = Utils::GetOSVersion();
-		if (Utils::CompareVersion(version.dwMajorVersion, version.dwMinorVersion, version.dwBuildNumber, 10, 0, 19041) >= 0) {
-			// 使 DDF 窗口无法被捕获到
-			if (!SetWindowDisplayAffinity(_hwndDDF, WDA_EXCLUDEFROMCAPTURE)) {
-				Logger::Get().Win32Error("SetWindowDisplayAffinity 失败");
+void App::_WaitForRenderEvents(const std::vector<ScalingSession*>& sessions, HANDLE hTimer) {
+	const FrameScheduler::TimePoint now = FrameScheduler::Clock::now();
+
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	DWORD count = 0;
+	handles[count++] = _renderEvent.get();
+
+	// 最早需要渲染的会话决定唤醒时间
+	FrameScheduler::TimePoint wakeTime = FrameScheduler::TimePoint::max();
+	for (ScalingSession* session : sessions) {
+		HANDLE hNewFrameEvent = NULL;
+		wakeTime = std::min(wakeTime, session->GetWakeTime(now, hNewFrameEvent));
+
+		if (hNewFrameEvent) {
+			// 保留一个位置给计时器，会话过多时无法等待的改为轮询
+			if (count < MAXIMUM_WAIT_OBJECTS - 1) {
+				handles[count++] = hNewFrameEvent;
+			} else {
+				wakeTime = std::min(wakeTime, now + std::chrono::milliseconds(1));
 			}
 		}
 	}
 
-	Logger::Get().Info("已创建 DDF 主窗口");
-	return true;
-}
-
-LRESULT App::_HostWndProcStatic(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-	return Get()._HostWndProc(hWnd, msg, wParam, lParam);
-}
-
+	if (wakeTime <= now) {
+		// 不必睡眠，由 Renderer::Render 中对交换链的等待控制帧率
+		return;
+	}
 
-LRESULT App::_HostWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
-	// 以反向调用回调
-	for (auto it = _wndProcHandlers.rbegin(); it != _wndProcHandlers.rend(); ++it) {
-		const auto& result = it->second(hWnd, message, wParam, lParam);
-		if (result.has_value()) {
-			return result.value();
+	DWORD timeout = INFINITE;
+	if (hTimer && wakeTime != FrameScheduler::TimePoint::max()) {
+		// 负值表示相对时间，单位为 100ns
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10'000'000>>>(
+			wakeTime - now).count();
+		if (SetWaitableTimer(hTimer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+			handles[count++] = hTimer;
+		} else {
+			Logger::Get().Win32Error("SetWaitableTimer 失败");
+			hTimer = NULL;
 		}
 	}
-
-	if (message == WindowsMessages::WM_DESTORYHOST) {
-		Logger::Get().Info("收到 MAGPIE_WM_DESTORYHOST 消息，即将销毁主窗口");
-		Quit();
-		return 0;
+	if (!hTimer && wakeTime != FrameScheduler::TimePoint::max()) {
+		timeout = (DWORD)std::chrono::ceil<std::chrono::milliseconds>(wakeTime - now).count();
 	}
 
-	switch (message) {
-	case WM_DESTROY:
-		// 有两个退出路径：
-		// 1. 前台窗口发生改变
-		// 2. 收到_WM_DESTORYMAG 消息
-		PostQuitMessage(0);
-		return 0;
+	if (WaitForMultipleObjects(count, handles, FALSE, timeout) == WAIT_FAILED) {
+		Logger::Get().Win32Error("WaitForMultipleObjects 失败");
 	}
-
-	return DefWindowProc(hWnd, message, wParam, lParam);
 }
 
-void App::_OnQuit() {
-	// 释放资源
-	_cursorManager = nullptr;
-	_renderer = nullptr;
-	_frameSource = nullptr;
-	_deviceResources = nullptr;
-	_config = nullptr;
+winrt::com_ptr<IWICImagingFactory2> App::GetWICImageFactory() {
+	static winrt::com_ptr<IWICImagingFactory2> wicImgFactory;
 
-	_nextWndProcHandlerID = 1;
-	_wndProcHandlers.clear();
-}
+	if (wicImgFactory == nullptr) {
+		HRESULT hr = CoCreateInstance(
+			CLSID_WICImagingFactory,
+			NULL,
+			CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(wicImgFactory.put())
+		);
 
-void App::Quit() {
-	if (_hwndDDF) {
-		DestroyWindow(_hwndDDF);
-	}
-	if (_hwndHost) {
-		DestroyWindow(_hwndHost);
+		if (FAILED(hr)) {
+			Logger::Get().ComError("创建 WICImagingFactory 失败", hr);
+			return nullptr;
+		}
 	}
+
+	return wicImgFactory;
 }
@@ -1,16 +1,20 @@
 #pragma once
 #include "pch.h"
-#include <unordered_map>
-#include "ErrorMessages.h"
+#include "Utils.h"
+#include "ScalingSession.h"
 
 
 class DeviceResources;
+class GraphicsDevice;
 class Renderer;
 class FrameSourceBase;
 class CursorManager;
 class Config;
 
 
+// 管理所有缩放会话共享的资源：D3D 设备和渲染线程
+// 每次调用 Run 缩放一个窗口，可以在多个线程中同时调用以同时缩放多个窗口
+// 返回会话中对象的函数使用当前线程所属的会话，见 SessionScope
 class App {
 public:
 	~App();
@@ -22,7 +26,11 @@ public:
 
 	bool Initialize(HINSTANCE hInst);
 
-	bool Run(
+	// 停止后台线程并写回缓存索引，应在所有缩放结束后、卸载 DLL 前调用
+	void Uninitialize();
+
+	// 在调用线程中缩放 hwndSrc，缩放结束后返回。成功时返回 nullptr，否则返回错误消息
+	const char* Run(
 		HWND hwndSrc,
 		const std::string& effectsJson,
 		UINT captureMode,
@@ -34,98 +42,160 @@ public:
 		UINT flags
 	);
 
-	void Quit();
+	// 不开始缩放，只估计 effectsJson 中第一条效果链占用的显存，见 ScalingSession::EstimateGPUMemory
+	// 可以在任何线程中调用
+	bool EstimateGPUMemory(
+		const std::string& effectsJson,
+		UINT flags,
+		SIZE inputSize,
+		SIZE hostSize,
+		std::vector<std::string>& effectNames,
+		std::vector<uint64_t>& effectBytes
+	);
+
+	// 将当前线程所属的会话设为 session，离开作用域时还原
+	// 会话的 UI 线程和渲染线程已自动设置，在其他线程中执行属于会话的工作时需使用它
+	class SessionScope {
+	public:
+		explicit SessionScope(ScalingSession* session) noexcept : _prevSession(_currentSession) {
+			_currentSession = session;
+		}
+
+		SessionScope(const SessionScope&) = delete;
+		SessionScope(SessionScope&&) = delete;
+
+		~SessionScope() {
+			_currentSession = _prevSession;
+		}
+
+	private:
+		ScalingSession* _prevSession;
+	};
+
+	ScalingSession& GetSession() noexcept {
+		return *_currentSession;
+	}
+
+	// 可以在任何线程中调用
+	void Quit() {
+		_currentSession->Quit();
+	}
 
 	HINSTANCE GetHInstance() const noexcept {
 		return _hInst;
 	}
 
 	HWND GetHwndSrc() const noexcept {
-		return _hwndSrc;
+		return _currentSession->GetHwndSrc();
 	}
 
 	HWND GetHwndHost() const noexcept {
-		return _hwndHost;
+		return _currentSession->GetHwndHost();
 	}
 
 	const RECT& GetHostWndRect() const noexcept {
-		return _hostWndRect;
+		return _currentSession->GetHostWndRect();
 	}
 
 	DeviceResources& GetDeviceResources() noexcept {
-		return *_deviceResources;
+		return _currentSession->GetDeviceResources();
 	}
 
 	Renderer& GetRenderer() noexcept {
-		return *_renderer;
+		return _currentSession->GetRenderer();
 	}
 
 	FrameSourceBase& GetFrameSource() noexcept {
-		return *_frameSource;
+		return _currentSession->GetFrameSource();
 	}
 
 	CursorManager& GetCursorManager() noexcept {
-		return *_cursorManager;
+		return _currentSession->GetCursorManager();
 	}
 
 	Config& GetConfig() noexcept {
-		return *_config;
-	}
-
-	const char* GetErrorMsg() const noexcept {
-		return _errorMsg;
+		return _currentSession->GetConfig();
 	}
 
 	void SetErrorMsg(const char* errorMsg) noexcept {
-		_errorMsg = errorMsg;
+		_currentSession->SetErrorMsg(errorMsg);
 	}
 
 	winrt::com_ptr<IWICImagingFactory2> GetWICImageFactory();
 
 	// 注册消息回调，回调函数如果不阻断消息应返回空
-	UINT RegisterWndProcHandler(std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)> handler);
-	void UnregisterWndProcHandler(UINT id);
+	// 回调在 UI 线程中执行，需要修改渲染状态时应使用 PostToRenderThread
+	UINT RegisterWndProcHandler(std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)> handler) {
+		return _currentSession->RegisterWndProcHandler(std::move(handler));
+	}
 
-private:
-	App();
+	void UnregisterWndProcHandler(UINT id) {
+		_currentSession->UnregisterWndProcHandler(id);
+	}
+
+	// 只能在 UI 线程中调用
+	// 命令在渲染线程中下一帧开始前执行，同一帧之前发送的命令按顺序一起生效
+	void PostToRenderThread(std::function<void()> command) {
+		_currentSession->PostToRenderThread(std::move(command));
+	}
 
-	void _RunMessageLoop();
+	// 返回使用 adapterIdx 的可用设备，它可能正被其他会话使用或被 WarmSession 保留，没有时返回空
+	std::shared_ptr<GraphicsDevice> GetSharedDevice(int adapterIdx);
 
-	void _RegisterWndClasses() const;
+	// 之后开始的会话将共享 device
+	void SetSharedDevice(const std::shared_ptr<GraphicsDevice>& device);
 
-	// 创建主窗口
-	bool _CreateHostWnd();
+	// 会话初始化完成后调用，渲染线程开始和其他会话轮流渲染它。第一个会话启动渲染线程
+	bool AddSession(ScalingSession& session);
 
-	bool _InitFrameSource(int captureMode);
+	// 返回后渲染线程不再访问 session，只能在会话的 UI 线程中调用，可以多次调用
+	// 最后一个会话被移除后渲染线程退出
+	void RemoveSession(ScalingSession& session);
 
-	bool _DisableDirectFlip();
+	// 正在渲染的会话数量
+	size_t GetSessionCount() const noexcept {
+		return _sessionCount.load(std::memory_order_relaxed);
+	}
+
+	// 可以在任何线程中调用
+	void WakeRenderThread() noexcept {
+		SetEvent(_renderEvent.get());
+	}
+
+private:
+	App();
 
-	static LRESULT CALLBACK _HostWndProcStatic(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+	static DWORD WINAPI _RenderThreadProc(LPVOID lpThreadParameter);
 
-	LRESULT _HostWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+	void _RenderLoop();
 
-	void _OnQuit();
+	// 睡眠直到有新命令、任一会话有新帧或到达调度器给出的时间
+	void _WaitForRenderEvents(const std::vector<ScalingSession*>& sessions, HANDLE hTimer);
 
-	const char* _errorMsg = ErrorMessages::GENERIC;
+	static thread_local ScalingSession* _currentSession;
 
 	HINSTANCE _hInst = NULL;
-	HWND _hwndSrc = NULL;
-	HWND _hwndHost = NULL;
 
-	// 关闭 DirectFlip 时的背景全屏窗口
-	HWND _hwndDDF = NULL;
+	// 最近创建的设备，不持有所有权
+	std::weak_ptr<GraphicsDevice> _sharedDevice;
 
-	RECT _hostWndRect{};
+	struct _SessionEntry {
+		ScalingSession* session = nullptr;
+		// 渲染线程移除会话后触发
+		HANDLE hRemovedEvent = NULL;
+		bool isRemoving = false;
+	};
 
-	bool _windowResizingDisabled = false;
-	bool _roundCornerDisabled = false;
+	// 保护以下成员和 _sharedDevice
+	Utils::CSMutex _sessionsLock;
+	std::vector<_SessionEntry> _sessions;
+	// 正在缩放的源窗口，同一个窗口只能被缩放一次
+	std::vector<HWND> _srcWnds;
+	HANDLE _hRenderThread = NULL;
+	bool _isRenderThreadRunning = false;
 
-	std::unique_ptr<DeviceResources> _deviceResources;
-	std::unique_ptr<Renderer> _renderer;
-	std::unique_ptr<FrameSourceBase> _frameSource;
-	std::unique_ptr<CursorManager> _cursorManager;
-	std::unique_ptr<Config> _config;
+	std::atomic<size_t> _sessionCount = 0;
 
-	std::map<UINT, std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)>> _wndProcHandlers;
-	UINT _nextWndProcHandlerID = 1;
+	// 有新命令或会话增减时触发，唤醒等待中的渲染线程
+	Utils::ScopedHandle _renderEvent;
 };
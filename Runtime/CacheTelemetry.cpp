@@ -0,0 +1,96 @@
+#include "pch.h"
+#include "CacheTelemetry.h"
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+
+// 保留的 D3DCompile 记录的数量
+static constexpr const size_t MAX_PASS_COMPILE_RECORDS = 256;
+
+
+void CacheTelemetry::RecordPassCompile(std::string_view effectName, UINT passIdx, uint64_t time) {
+	Add(Counter::ShaderCompiles);
+	Add(Counter::CompileTime, time);
+
+	std::scoped_lock lk(_cs);
+
+	if (_passCompiles.size() >= MAX_PASS_COMPILE_RECORDS) {
+		_passCompiles.pop_front();
+	}
+	_passCompiles.push_back({ std::string(effectName), passIdx, time });
+}
+
+std::string CacheTelemetry::ToJson() {
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+
+	for (size_t i = 0; i < (size_t)Counter::COUNT; ++i) {
+		writer.Key(GetCounterName((Counter)i));
+		writer.Uint64(GetValue((Counter)i));
+	}
+
+	writer.Key("passCompiles");
+	writer.StartArray();
+	{
+		std::scoped_lock lk(_cs);
+
+		for (const _PassCompileRecord& record : _passCompiles) {
+			writer.StartObject();
+			writer.Key("effect");
+			writer.String(record.effectName.c_str(), (rapidjson::SizeType)record.effectName.size());
+			writer.Key("pass");
+			writer.Uint(record.passIdx);
+			writer.Key("time");
+			writer.Uint64(record.time);
+			writer.EndObject();
+		}
+	}
+	writer.EndArray();
+
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+void CacheTelemetry::Reset() {
+	for (auto& counter : _counters) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+
+	std::scoped_lock lk(_cs);
+	_passCompiles.clear();
+}
+
+const char* CacheTelemetry::GetCounterName(Counter counter) noexcept {
+	switch (counter) {
+	case Counter::MemoryHits:
+		return "memoryHits";
+	case Counter::DiskHits:
+		return "diskHits";
+	case Counter::Misses:
+		return "misses";
+	case Counter::ShaderSessionHits:
+		return "shaderSessionHits";
+	case Counter::ShaderDiskHits:
+		return "shaderDiskHits";
+	case Counter::ShaderCompiles:
+		return "shaderCompiles";
+	case Counter::BytesRead:
+		return "bytesRead";
+	case Counter::BytesWritten:
+		return "bytesWritten";
+	case Counter::DecompressTime:
+		return "decompressTimeUs";
+	case Counter::DeserializeTime:
+		return "deserializeTimeUs";
+	case Counter::PreprocessTime:
+		return "preprocessTimeUs";
+	case Counter::CompileTime:
+		return "compileTimeUs";
+	default:
+		assert(false);
+		return "";
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+#include <deque>
+
+
+// 缓存和编译的统计数据，用于确定缓存预算以及定位冷启动的瓶颈
+// 所有方法都是线程安全的
+class CacheTelemetry {
+public:
+	static CacheTelemetry& Get() noexcept {
+		static CacheTelemetry instance;
+		return instance;
+	}
+
+	enum class Counter {
+		// 效果缓存
+		MemoryHits,
+		DiskHits,
+		Misses,
+		// 着色器字节码
+		ShaderSessionHits,
+		ShaderDiskHits,
+		ShaderCompiles,
+		// 磁盘读写的字节数，均为压缩后的大小
+		BytesRead,
+		BytesWritten,
+		// 以下单位为微秒
+		DecompressTime,
+		DeserializeTime,
+		PreprocessTime,
+		CompileTime,
+		COUNT
+	};
+
+	void Add(Counter counter, uint64_t value = 1) noexcept {
+		_counters[(size_t)counter].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	uint64_t GetValue(Counter counter) const noexcept {
+		return _counters[(size_t)counter].load(std::memory_order_relaxed);
+	}
+
+	// 记录一次 D3DCompile 的用时，单位为微秒
+	void RecordPassCompile(std::string_view effectName, UINT passIdx, uint64_t time);
+
+	// 生成 JSON 格式的快照
+	std::string ToJson();
+
+	void Reset();
+
+	static const char* GetCounterName(Counter counter) noexcept;
+
+private:
+	std::array<std::atomic<uint64_t>, (size_t)Counter::COUNT> _counters{};
+
+	struct _PassCompileRecord {
+		std::string effectName;
+		UINT passIdx;
+		uint64_t time;
+	};
+
+	// 用于同步对 _passCompiles 的访问
+	Utils::CSMutex _cs;
+	// 只保留最近的记录
+	std::deque<_PassCompileRecord> _passCompiles;
+};
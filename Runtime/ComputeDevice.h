@@ -0,0 +1,92 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include "EffectPassPlan.h"
+#include "DirtyRegion.h"
+#include <span>
+
+
+// 执行效果所需的最小设备接口：纹理、视图、采样器、常量缓冲区、调度和时间戳
+// 资源以句柄表示，不暴露图形 API 的对象，因此调度、资源和计时的逻辑可以在没有 GPU 的环境中运行
+// 通道的绑定和调度尺寸来自 EffectPassPlan。所有方法都应在同一个线程中调用
+class ComputeDevice {
+public:
+	using Handle = uint32_t;
+	static constexpr Handle INVALID_HANDLE = 0;
+
+	enum class ViewType {
+		// 对应 BindingType::SampledTexture
+		ShaderResource,
+		// 对应 BindingType::StorageTexture
+		UnorderedAccess
+	};
+
+	enum class SamplerFilter {
+		Linear,
+		Point
+	};
+
+	enum class SamplerAddress {
+		Clamp,
+		Wrap
+	};
+
+	virtual ~ComputeDevice() = default;
+
+	// format 的取值和 DXGI_FORMAT 相同，后端据此决定存储方式。失败时返回 INVALID_HANDLE
+	virtual Handle CreateTexture(uint32_t width, uint32_t height, uint32_t format) = 0;
+
+	virtual Handle CreateView(Handle texture, ViewType type) = 0;
+
+	virtual Handle CreateSampler(SamplerFilter filter, SamplerAddress address) = 0;
+
+	// byteSize 必须为 16 的倍数
+	virtual Handle CreateConstantBuffer(uint32_t byteSize) = 0;
+
+	virtual bool UpdateConstantBuffer(Handle buffer, const void* data, uint32_t byteSize) = 0;
+
+	// 可以释放任何类型的资源。纹理释放后它的视图失效，使用它们调度将失败
+	virtual void Release(Handle handle) = 0;
+
+	// 执行一个通道，kernel 的含义由后端决定
+	// bindings 和 pass.bindings 一一对应，元素为常量缓冲区、采样器或视图的句柄
+	// 执行 [groupOffset, groupOffset + groups) 内的线程组，必须在 pass.groups 内，用于只计算变化的区域
+	virtual bool Dispatch(
+		Handle kernel,
+		const EffectPassPlan::Pass& pass,
+		std::span<const Handle> bindings,
+		EffectPassPlan::Size groupOffset,
+		EffectPassPlan::Size groups
+	) = 0;
+
+	// 依次调度每个矩形内的线程组，用于只计算变化的区域，blockRects 通常来自 DirtyRegion::GetBlockRects
+	// 任何一次调度失败时立即返回 false。空矩形和越界的矩形由 Dispatch 拒绝
+	bool DispatchBlocks(
+		Handle kernel,
+		const EffectPassPlan::Pass& pass,
+		std::span<const Handle> bindings,
+		std::span<const DirtyRegion::Rect> blockRects
+	) {
+		for (const DirtyRegion::Rect& rect : blockRects) {
+			if (!Dispatch(
+				kernel,
+				pass,
+				bindings,
+				{ (uint32_t)rect.left, (uint32_t)rect.top },
+				{ uint32_t(rect.right - rect.left), uint32_t(rect.bottom - rect.top) }
+			)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// 在之前提交的调度完成时记录时间，返回时间戳的索引
+	virtual uint32_t WriteTimestamp() = 0;
+
+	// 取得并清空已记录的时间戳，单位为纳秒，起点由后端决定
+	virtual bool ResolveTimestamps(std::vector<uint64_t>& timestamps) = 0;
+
+	// 最近一次失败的原因
+	virtual const char* GetError() const noexcept = 0;
+};
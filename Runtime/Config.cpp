@@ -17,7 +17,8 @@ enum class FlagMasks : UINT {
 	DisableEffectCache = 0x400,
 	DisableVSync = 0x800,
 	WarningsAreErrors = 0x1000,
-	ShowFPS = 0x2000
+	ShowFPS = 0x2000,
+	MatchSourceFrameRate = 0x4000
 };
 
 
@@ -42,6 +43,7 @@ bool Config::Initialize(float cursorZoomFactor, UINT cursorInterpolationMode, in
 	_isDisableVSync = flags & (UINT)FlagMasks::DisableVSync;
 	_isTreatWarningsAsErrors = flags & (UINT)FlagMasks::WarningsAreErrors;
 	_isShowFPS = flags & (UINT)FlagMasks::ShowFPS;
+	_isMatchSourceFrameRate = flags & (UINT)FlagMasks::MatchSourceFrameRate;
 
 	Logger::Get().Info(fmt::format(R"(运行时配置:
 	IsAdjustCursorSpeed: {}
@@ -59,7 +61,8 @@ bool Config::Initialize(float cursorZoomFactor, UINT cursorInterpolationMode, in
 	IsSimulateExclusiveFullscreen: {}
 	CursorInterpolationMode: {}
 	CropBorders: [{}, {}, {}, {}]
-	IsShowFPS: {})",
+	IsShowFPS: {}
+	IsMatchSourceFrameRate: {})",
 		IsAdjustCursorSpeed(),
 		IsDisableLowLatency(),
 		IsBreakpointMode(),
@@ -75,7 +78,8 @@ bool Config::Initialize(float cursorZoomFactor, UINT cursorInterpolationMode, in
 		IsSimulateExclusiveFullscreen(),
 		GetCursorInterpolationMode(),
 		cropBorders.left, cropBorders.top, cropBorders.right, cropBorders.bottom,
-		IsShowFPS()
+		IsShowFPS(),
+		IsMatchSourceFrameRate()
 	));
 
 	return true;
@@ -88,6 +88,11 @@ public:
 		_isDisableVSync = value;
 	}
 
+	// 帧率不超过源窗口的帧率
+	bool IsMatchSourceFrameRate() const noexcept {
+		return _isMatchSourceFrameRate;
+	}
+
 	bool IsSaveEffectSources() const noexcept {
 		return _isSaveEffectSources;
 	}
@@ -126,6 +131,7 @@ private:
 	bool _isSimulateExclusiveFullscreen = false;
 	bool _isDisableVSync = false;
 	bool _isShowFPS = false;
+	bool _isMatchSourceFrameRate = false;
 
 	// 用于调试
 	bool _isBreakpointMode = false;
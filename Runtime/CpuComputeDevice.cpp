@@ -0,0 +1,327 @@
+#include "CpuComputeDevice.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+// D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+static constexpr uint32_t MAX_TEXTURE_DIMENSION = 16384;
+
+static uint32_t ApplyAddress(int64_t coord, uint32_t size, ComputeDevice::SamplerAddress address) noexcept {
+	if (address == ComputeDevice::SamplerAddress::Wrap) {
+		return uint32_t(((coord % size) + size) % size);
+	} else {
+		return (uint32_t)std::clamp<int64_t>(coord, 0, int64_t(size) - 1);
+	}
+}
+
+CpuComputeDevice::Texel CpuComputeDevice::Sampler::Sample(const Texture& texture, float u, float v) const noexcept {
+	const uint32_t width = texture.GetWidth();
+	const uint32_t height = texture.GetHeight();
+
+	if (filter == SamplerFilter::Point) {
+		return texture.Load(
+			ApplyAddress((int64_t)std::floor(u * width), width, address),
+			ApplyAddress((int64_t)std::floor(v * height), height, address)
+		);
+	}
+
+	// 以像素中心为采样点
+	const float x = u * width - 0.5f;
+	const float y = v * height - 0.5f;
+	const float x0 = std::floor(x);
+	const float y0 = std::floor(y);
+	const float fx = x - x0;
+	const float fy = y - y0;
+
+	const uint32_t left = ApplyAddress((int64_t)x0, width, address);
+	const uint32_t right = ApplyAddress((int64_t)x0 + 1, width, address);
+	const uint32_t top = ApplyAddress((int64_t)y0, height, address);
+	const uint32_t bottom = ApplyAddress((int64_t)y0 + 1, height, address);
+
+	const Texel tl = texture.Load(left, top);
+	const Texel tr = texture.Load(right, top);
+	const Texel bl = texture.Load(left, bottom);
+	const Texel br = texture.Load(right, bottom);
+
+	Texel result;
+	for (size_t i = 0; i < result.size(); ++i) {
+		const float t = tl[i] + (tr[i] - tl[i]) * fx;
+		const float b = bl[i] + (br[i] - bl[i]) * fx;
+		result[i] = t + (b - t) * fy;
+	}
+	return result;
+}
+
+CpuComputeDevice::CpuComputeDevice(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// 调用 Dispatch 的线程也执行线程组
+	_workers.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; ++i) {
+		_workers.emplace_back(&CpuComputeDevice::_WorkerProc, this);
+	}
+}
+
+CpuComputeDevice::~CpuComputeDevice() {
+	{
+		std::scoped_lock lk(_mutex);
+		_isExiting = true;
+	}
+	_workCV.notify_all();
+
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+ComputeDevice::Handle CpuComputeDevice::RegisterKernel(Kernel kernel) {
+	if (!kernel) {
+		_Fail("内核为空");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::move(kernel));
+}
+
+ComputeDevice::Handle CpuComputeDevice::CreateTexture(uint32_t width, uint32_t height, uint32_t format) {
+	if (width == 0 || height == 0 || width > MAX_TEXTURE_DIMENSION || height > MAX_TEXTURE_DIMENSION) {
+		_Fail("纹理尺寸无效");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::make_unique<Texture>(width, height, format));
+}
+
+ComputeDevice::Handle CpuComputeDevice::CreateView(Handle texture, ViewType type) {
+	if (!_Find<std::unique_ptr<Texture>>(texture)) {
+		_Fail("纹理不存在");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(_View{ texture, type });
+}
+
+ComputeDevice::Handle CpuComputeDevice::CreateSampler(SamplerFilter filter, SamplerAddress address) {
+	return _Add(Sampler{ filter, address });
+}
+
+ComputeDevice::Handle CpuComputeDevice::CreateConstantBuffer(uint32_t byteSize) {
+	if (byteSize == 0 || byteSize % 16 != 0) {
+		_Fail("常量缓冲区的尺寸必须为 16 的倍数");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::vector<uint8_t>(byteSize));
+}
+
+bool CpuComputeDevice::UpdateConstantBuffer(Handle buffer, const void* data, uint32_t byteSize) {
+	std::vector<uint8_t>* bufferData = _Find<std::vector<uint8_t>>(buffer);
+	if (!bufferData) {
+		return _Fail("常量缓冲区不存在");
+	}
+
+	if (byteSize > bufferData->size()) {
+		return _Fail("数据超出常量缓冲区");
+	}
+
+	std::memcpy(bufferData->data(), data, byteSize);
+	return true;
+}
+
+void CpuComputeDevice::Release(Handle handle) {
+	_resources.erase(handle);
+}
+
+bool CpuComputeDevice::Dispatch(
+	Handle kernel,
+	const EffectPassPlan::Pass& pass,
+	std::span<const Handle> bindings,
+	EffectPassPlan::Size groupOffset,
+	EffectPassPlan::Size groups
+) {
+	const Kernel* kernelFunc = _Find<Kernel>(kernel);
+	if (!kernelFunc) {
+		return _Fail("内核不存在");
+	}
+
+	if (groups.width == 0 || groups.height == 0) {
+		return _Fail("调度尺寸为 0");
+	}
+
+	if (groups.width > EffectPassPlan::MAX_GROUPS_PER_DIMENSION || groups.height > EffectPassPlan::MAX_GROUPS_PER_DIMENSION
+		|| uint64_t(groupOffset.width) + groups.width > pass.groups.width
+		|| uint64_t(groupOffset.height) + groups.height > pass.groups.height) {
+		return _Fail("调度超出通道的范围");
+	}
+
+	if (bindings.size() != pass.bindings.size()) {
+		return _Fail("绑定的数量和通道不符");
+	}
+
+	KernelContext context;
+	context.pass = &pass;
+	context._inputs.resize(pass.inputs.size());
+	context._outputs.resize(pass.outputs.size());
+	context._samplers.resize(std::count_if(pass.bindings.begin(), pass.bindings.end(),
+		[](const EffectPassPlan::Binding& binding) { return binding.type == EffectPassPlan::BindingType::Sampler; }));
+
+	// 用于检查读写冲突
+	std::vector<Handle> inputTextures;
+	std::vector<Handle> outputTextures;
+
+	for (size_t i = 0; i < bindings.size(); ++i) {
+		const EffectPassPlan::Binding& binding = pass.bindings[i];
+
+		switch (binding.type) {
+		case EffectPassPlan::BindingType::ConstantBuffer:
+		{
+			const std::vector<uint8_t>* buffer = _Find<std::vector<uint8_t>>(bindings[i]);
+			if (!buffer || binding.slot >= context._constantBuffers.size()) {
+				return _Fail("常量缓冲区绑定无效");
+			}
+			context._constantBuffers[binding.slot] = buffer->data();
+			break;
+		}
+		case EffectPassPlan::BindingType::Sampler:
+		{
+			const Sampler* sampler = _Find<Sampler>(bindings[i]);
+			if (!sampler || binding.slot >= context._samplers.size()) {
+				return _Fail("采样器绑定无效");
+			}
+			context._samplers[binding.slot] = sampler;
+			break;
+		}
+		case EffectPassPlan::BindingType::SampledTexture:
+		case EffectPassPlan::BindingType::StorageTexture:
+		{
+			const bool isOutput = binding.type == EffectPassPlan::BindingType::StorageTexture;
+
+			const _View* view = _Find<_View>(bindings[i]);
+			if (!view || view->type != (isOutput ? ViewType::UnorderedAccess : ViewType::ShaderResource)) {
+				return _Fail("视图绑定无效或类型不符");
+			}
+
+			std::unique_ptr<Texture>* texture = _Find<std::unique_ptr<Texture>>(view->texture);
+			if (!texture) {
+				return _Fail("视图的纹理已被释放");
+			}
+
+			if (isOutput) {
+				if (binding.slot >= context._outputs.size()) {
+					return _Fail("输出绑定越界");
+				}
+				context._outputs[binding.slot] = texture->get();
+				outputTextures.push_back(view->texture);
+			} else {
+				if (binding.slot >= context._inputs.size()) {
+					return _Fail("输入绑定越界");
+				}
+				context._inputs[binding.slot] = texture->get();
+				inputTextures.push_back(view->texture);
+			}
+			break;
+		}
+		}
+	}
+
+	// 和 D3D 不同，这里不会静默解绑冲突的视图
+	std::sort(outputTextures.begin(), outputTextures.end());
+	if (std::adjacent_find(outputTextures.begin(), outputTextures.end()) != outputTextures.end()) {
+		return _Fail("纹理被多次作为输出");
+	}
+	for (Handle input : inputTextures) {
+		if (std::binary_search(outputTextures.begin(), outputTextures.end(), input)) {
+			return _Fail("纹理同时作为输入和输出");
+		}
+	}
+
+	_curKernel = kernelFunc;
+	_curContext = &context;
+	_curOffset = groupOffset;
+	_curGroups = groups;
+	_nextGroup.store(0, std::memory_order_relaxed);
+
+	if (_workers.empty() || uint64_t(groups.width) * groups.height == 1) {
+		_RunGroups();
+	} else {
+		{
+			std::scoped_lock lk(_mutex);
+			++_dispatchId;
+			_busyWorkers = (uint32_t)_workers.size();
+		}
+		_workCV.notify_all();
+
+		_RunGroups();
+
+		std::unique_lock lk(_mutex);
+		_doneCV.wait(lk, [&]() { return _busyWorkers == 0; });
+	}
+
+	_curKernel = nullptr;
+	_curContext = nullptr;
+	return true;
+}
+
+uint32_t CpuComputeDevice::WriteTimestamp() {
+	_timestamps.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - _startTime).count());
+	return uint32_t(_timestamps.size() - 1);
+}
+
+bool CpuComputeDevice::ResolveTimestamps(std::vector<uint64_t>& timestamps) {
+	timestamps = std::move(_timestamps);
+	_timestamps.clear();
+	return true;
+}
+
+CpuComputeDevice::Texture* CpuComputeDevice::GetTexture(Handle texture) noexcept {
+	std::unique_ptr<Texture>* result = _Find<std::unique_ptr<Texture>>(texture);
+	return result ? result->get() : nullptr;
+}
+
+ComputeDevice::Handle CpuComputeDevice::_Add(_Resource&& resource) {
+	const Handle handle = _nextHandle++;
+	_resources.emplace(handle, std::move(resource));
+	return handle;
+}
+
+void CpuComputeDevice::_RunGroups() {
+	const uint64_t groupCount = uint64_t(_curGroups.width) * _curGroups.height;
+
+	while (true) {
+		const uint64_t idx = _nextGroup.fetch_add(1, std::memory_order_relaxed);
+		if (idx >= groupCount) {
+			break;
+		}
+
+		(*_curKernel)(
+			*_curContext,
+			_curOffset.width + uint32_t(idx % _curGroups.width),
+			_curOffset.height + uint32_t(idx / _curGroups.width)
+		);
+	}
+}
+
+void CpuComputeDevice::_WorkerProc() {
+	uint64_t lastDispatchId = 0;
+
+	std::unique_lock lk(_mutex);
+	while (true) {
+		_workCV.wait(lk, [&]() { return _isExiting || _dispatchId != lastDispatchId; });
+		if (_isExiting) {
+			return;
+		}
+		lastDispatchId = _dispatchId;
+
+		lk.unlock();
+		_RunGroups();
+		lk.lock();
+
+		if (--_busyWorkers == 0) {
+			_doneCV.notify_one();
+		}
+	}
+}
@@ -0,0 +1,176 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include "ComputeDevice.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+
+
+// ComputeDevice 的 CPU 参考实现，通道由注册的本机内核执行，线程组分配到多个工作线程
+// 每次调度前检查绑定的类型、资源是否存在、读写冲突和调度尺寸，不需要 GPU 即可运行效果的调度逻辑
+// 纹理统一以每像素 4 个 float 存储，不模拟格式的精度
+class CpuComputeDevice : public ComputeDevice {
+public:
+	using Texel = std::array<float, 4>;
+
+	class Texture {
+	public:
+		Texture(uint32_t width, uint32_t height, uint32_t format)
+			: _width(width), _height(height), _format(format), _texels(size_t(width) * height) {}
+
+		uint32_t GetWidth() const noexcept { return _width; }
+		uint32_t GetHeight() const noexcept { return _height; }
+		uint32_t GetFormat() const noexcept { return _format; }
+
+		// 和 D3D 相同，越界读取返回 0，越界写入被忽略
+		Texel Load(uint32_t x, uint32_t y) const noexcept {
+			return (x < _width && y < _height) ? _texels[size_t(y) * _width + x] : Texel{};
+		}
+
+		void Store(uint32_t x, uint32_t y, const Texel& value) noexcept {
+			if (x < _width && y < _height) {
+				_texels[size_t(y) * _width + x] = value;
+			}
+		}
+
+	private:
+		uint32_t _width;
+		uint32_t _height;
+		uint32_t _format;
+		std::vector<Texel> _texels;
+	};
+
+	struct Sampler {
+		SamplerFilter filter = SamplerFilter::Linear;
+		SamplerAddress address = SamplerAddress::Clamp;
+
+		// 和 SampleLevel(sampler, float2(u, v), 0) 相同
+		Texel Sample(const Texture& texture, float u, float v) const noexcept;
+	};
+
+	// 一次调度的所有资源，资源按 HLSL 中的寄存器号访问
+	class KernelContext {
+	public:
+		const EffectPassPlan::Pass* pass = nullptr;
+
+		const Texture& GetInput(uint32_t slot) const noexcept { return *_inputs[slot]; }
+		// 不同线程组不应写入同一像素
+		Texture& GetOutput(uint32_t slot) const noexcept { return *_outputs[slot]; }
+		const Sampler& GetSampler(uint32_t slot) const noexcept { return *_samplers[slot]; }
+		const void* GetConstantBuffer(uint32_t slot) const noexcept { return _constantBuffers[slot]; }
+
+	private:
+		friend class CpuComputeDevice;
+
+		std::vector<const Texture*> _inputs;
+		std::vector<Texture*> _outputs;
+		std::vector<const Sampler*> _samplers;
+		std::array<const void*, EffectPassPlan::CONSTANT_BUFFER_COUNT> _constantBuffers{};
+	};
+
+	// 内核一次执行一个线程组，groupX 和 groupY 已包含调度的偏移。可能在多个线程中同时调用
+	using Kernel = std::function<void(const KernelContext& context, uint32_t groupX, uint32_t groupY)>;
+
+	// threadCount 为 0 时使用硬件线程数
+	explicit CpuComputeDevice(uint32_t threadCount = 0);
+	CpuComputeDevice(const CpuComputeDevice&) = delete;
+	CpuComputeDevice(CpuComputeDevice&&) = delete;
+
+	~CpuComputeDevice() override;
+
+	// 返回的句柄用作 Dispatch 的 kernel
+	Handle RegisterKernel(Kernel kernel);
+
+	Handle CreateTexture(uint32_t width, uint32_t height, uint32_t format) override;
+
+	Handle CreateView(Handle texture, ViewType type) override;
+
+	Handle CreateSampler(SamplerFilter filter, SamplerAddress address) override;
+
+	Handle CreateConstantBuffer(uint32_t byteSize) override;
+
+	bool UpdateConstantBuffer(Handle buffer, const void* data, uint32_t byteSize) override;
+
+	void Release(Handle handle) override;
+
+	bool Dispatch(
+		Handle kernel,
+		const EffectPassPlan::Pass& pass,
+		std::span<const Handle> bindings,
+		EffectPassPlan::Size groupOffset,
+		EffectPassPlan::Size groups
+	) override;
+
+	// 调度是同步的，因此时间戳即为调用时间
+	uint32_t WriteTimestamp() override;
+
+	bool ResolveTimestamps(std::vector<uint64_t>& timestamps) override;
+
+	const char* GetError() const noexcept override {
+		return _error;
+	}
+
+	// 用于检查内核的结果或填充输入，句柄无效时返回 nullptr
+	Texture* GetTexture(Handle texture) noexcept;
+
+	uint32_t GetThreadCount() const noexcept {
+		return (uint32_t)_workers.size() + 1;
+	}
+
+private:
+	struct _View {
+		Handle texture = INVALID_HANDLE;
+		ViewType type = ViewType::ShaderResource;
+	};
+
+	using _Resource = std::variant<Kernel, std::unique_ptr<Texture>, _View, Sampler, std::vector<uint8_t>>;
+
+	template <typename T>
+	T* _Find(Handle handle) noexcept {
+		auto it = _resources.find(handle);
+		return it == _resources.end() ? nullptr : std::get_if<T>(&it->second);
+	}
+
+	Handle _Add(_Resource&& resource);
+
+	bool _Fail(const char* error) noexcept {
+		_error = error;
+		return false;
+	}
+
+	// 在工作线程和调用线程中执行线程组，直到全部完成
+	void _RunGroups();
+
+	void _WorkerProc();
+
+	std::unordered_map<Handle, _Resource> _resources;
+	Handle _nextHandle = 1;
+
+	std::vector<uint64_t> _timestamps;
+	const std::chrono::steady_clock::time_point _startTime = std::chrono::steady_clock::now();
+
+	const char* _error = "";
+
+	// 当前调度，工作线程只在 _RunGroups 期间读取
+	const Kernel* _curKernel = nullptr;
+	const KernelContext* _curContext = nullptr;
+	EffectPassPlan::Size _curOffset;
+	EffectPassPlan::Size _curGroups;
+	std::atomic<uint64_t> _nextGroup = 0;
+
+	std::vector<std::thread> _workers;
+	std::mutex _mutex;
+	std::condition_variable _workCV;
+	std::condition_variable _doneCV;
+	// 每次调度递增，工作线程据此得知有新的工作
+	uint64_t _dispatchId = 0;
+	uint32_t _busyWorkers = 0;
+	bool _isExiting = false;
+};
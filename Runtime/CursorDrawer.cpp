@@ -0,0 +1,281 @@
+#include "pch.h"
+#include "CursorDrawer.h"
+#include "App.h"
+#include "DeviceResources.h"
+#include "CursorManager.h"
+#include "FrameSourceBase.h"
+#include "Renderer.h"
+#include "Config.h"
+#include "Logger.h"
+#include "Utils.h"
+#include "EffectDesc.h"
+#include "GPUMemoryTracker.h"
+#include "shaders/CursorColorCS.h"
+#include "shaders/CursorMaskedColorCS.h"
+#include "shaders/CursorMonochromeCS.h"
+
+
+bool CursorDrawer::Initialize(ID3D11Texture2D* effectsOutput, const RECT& outputRect, const RECT& virtualOutputRect) {
+	_effectsOutput = effectsOutput;
+	_outputRect = outputRect;
+	_virtualOutputRect = virtualOutputRect;
+
+	DeviceResources& dr = App::Get().GetDeviceResources();
+
+	DXGI_SWAP_CHAIN_DESC1 sd{};
+	HRESULT hr = dr.GetSwapChain()->GetDesc1(&sd);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("GetDesc1 失败", hr);
+		return false;
+	}
+	_backBufferStates.resize(sd.BufferCount);
+
+	// 每种光标类型使用专门的着色器，顺序和 CursorManager::CursorType 相同
+	static const std::pair<const BYTE*, size_t> SHADERS[] = {
+		{ CursorColorCSShaderByteCode, sizeof(CursorColorCSShaderByteCode) },
+		{ CursorMaskedColorCSShaderByteCode, sizeof(CursorMaskedColorCSShaderByteCode) },
+		{ CursorMonochromeCSShaderByteCode, sizeof(CursorMonochromeCSShaderByteCode) }
+	};
+	static_assert(std::size(SHADERS) == std::tuple_size_v<decltype(_shaders)>);
+
+	for (size_t i = 0; i < _shaders.size(); ++i) {
+		hr = dr.GetD3DDevice()->CreateComputeShader(
+			SHADERS[i].first, SHADERS[i].second, nullptr, _shaders[i].put());
+		if (FAILED(hr)) {
+			Logger::Get().ComError("创建计算着色器失败", hr);
+			return false;
+		}
+	}
+
+	// cbuffer CB : register(b0) {
+	//     int4 cursorRect;
+	//     int2 drawOffset;
+	//     uint2 drawSize;
+	//     float2 cursorPt;
+	// };
+	D3D11_BUFFER_DESC bd{};
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bd.ByteWidth = 4 * 12;
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	hr = dr.GetD3DDevice()->CreateBuffer(&bd, nullptr, _constantBuffer.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateBuffer 失败", hr);
+		return false;
+	}
+	GPUMemoryTracker::Get().Track(_constantBuffer.get(), GPUMemoryTracker::Owner::Cursor);
+
+	if (!dr.GetSampler(
+		App::Get().GetConfig().GetCursorInterpolationMode() == 0 ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR,
+		D3D11_TEXTURE_ADDRESS_CLAMP,
+		&_sampler
+	)) {
+		Logger::Get().Error("GetSampler 失败");
+		return false;
+	}
+
+	return true;
+}
+
+void CursorDrawer::SetEffectsOutput(ID3D11Texture2D* effectsOutput, const RECT& outputRect, const RECT& virtualOutputRect) {
+	if (_outputRect != outputRect) {
+		for (_BackBufferState& state : _backBufferStates) {
+			state.isClearNeeded = true;
+		}
+	}
+
+	_effectsOutput = effectsOutput;
+	_outputRect = outputRect;
+	_virtualOutputRect = virtualOutputRect;
+	++_outputVersion;
+}
+
+void CursorDrawer::Draw(bool isNewFrame) {
+	if (isNewFrame) {
+		++_outputVersion;
+	}
+
+	DeviceResources& dr = App::Get().GetDeviceResources();
+	_BackBufferState& state = _backBufferStates[dr.GetSwapChain()->GetCurrentBackBufferIndex()];
+
+	RECT cursorRect{};
+	ID3D11Texture2D* cursorTex = nullptr;
+	CursorManager::CursorType cursorType = CursorManager::CursorType::Color;
+	if (!_GetCursorRect(cursorRect, &cursorTex, cursorType)) {
+		cursorRect = {};
+		cursorTex = nullptr;
+	}
+
+	_lastCursorRect = cursorRect;
+	_lastCursorTex = cursorTex;
+
+	if (state.outputVersion != _outputVersion) {
+		// 后缓冲区中是较早的帧
+		if (state.isClearNeeded) {
+			state.isClearNeeded = false;
+
+			ID3D11RenderTargetView* rtv = nullptr;
+			if (dr.GetRenderTargetView(dr.GetBackBuffer(), &rtv)) {
+				static constexpr FLOAT BLACK[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				dr.GetD3DDC()->ClearRenderTargetView(rtv, BLACK);
+			} else {
+				Logger::Get().Error("GetRenderTargetView 失败");
+			}
+		}
+
+		_CopyFromOutput(_outputRect);
+	} else if (state.cursorRect == cursorRect && state.cursorTex == cursorTex) {
+		// 后缓冲区中的内容和此帧完全相同
+		return;
+	} else {
+		// 画面没有变化，只需擦除旧的光标
+		_CopyFromOutput(state.cursorRect);
+	}
+
+	if (cursorTex) {
+		_DrawCursor(cursorRect, cursorTex, cursorType);
+	}
+
+	state.outputVersion = _outputVersion;
+	state.cursorRect = cursorRect;
+	state.cursorTex = cursorTex;
+}
+
+void CursorDrawer::InvalidateBackBuffer() {
+	DeviceResources& dr = App::Get().GetDeviceResources();
+	_backBufferStates[dr.GetSwapChain()->GetCurrentBackBufferIndex()].outputVersion = 0;
+}
+
+bool CursorDrawer::IsCursorChanged() const {
+	RECT cursorRect{};
+	ID3D11Texture2D* cursorTex = nullptr;
+	CursorManager::CursorType cursorType = CursorManager::CursorType::Color;
+	if (!_GetCursorRect(cursorRect, &cursorTex, cursorType)) {
+		cursorRect = {};
+		cursorTex = nullptr;
+	}
+
+	return cursorRect != _lastCursorRect || cursorTex != _lastCursorTex;
+}
+
+bool CursorDrawer::_GetCursorRect(RECT& result, ID3D11Texture2D** cursorTex, CursorManager::CursorType& cursorType) const {
+	CursorManager& cursorManager = App::Get().GetCursorManager();
+	if (!cursorManager.HasCursor()) {
+		return false;
+	}
+
+	// 3D 游戏模式下显示覆盖层时由覆盖层绘制光标
+	if (App::Get().GetConfig().Is3DMode() && App::Get().GetRenderer().IsUIVisiable()) {
+		return false;
+	}
+
+	if (!cursorManager.GetCursorTexture(cursorTex, cursorType)) {
+		Logger::Get().Error("GetCursorTexture 失败");
+		return false;
+	}
+
+	const POINT* pos = cursorManager.GetCursorPos();
+	const CursorManager::CursorInfo* ci = cursorManager.GetCursorInfo();
+	assert(pos && ci);
+
+	float cursorZoomFactor = App::Get().GetConfig().GetCursorZoomFactor();
+	if (cursorZoomFactor < 1e-5) {
+		SIZE srcFrameSize = Utils::GetSizeOfRect(App::Get().GetFrameSource().GetSrcFrameRect());
+		SIZE virtualOutputSize = Utils::GetSizeOfRect(_virtualOutputRect);
+		cursorZoomFactor = (((float)virtualOutputSize.cx / srcFrameSize.cx)
+			+ ((float)virtualOutputSize.cy / srcFrameSize.cy)) / 2;
+	}
+
+	result.left = pos->x - std::lroundf(ci->hotSpot.x * cursorZoomFactor);
+	result.top = pos->y - std::lroundf(ci->hotSpot.y * cursorZoomFactor);
+	result.right = result.left + std::lroundf(ci->size.cx * cursorZoomFactor);
+	result.bottom = result.top + std::lroundf(ci->size.cy * cursorZoomFactor);
+
+	return result.right > result.left && result.bottom > result.top;
+}
+
+void CursorDrawer::_CopyFromOutput(const RECT& rect) {
+	// 后缓冲区中输出区域以外的部分不会被修改
+	RECT copyRect;
+	if (!IntersectRect(&copyRect, &rect, &_outputRect)) {
+		return;
+	}
+
+	DeviceResources& dr = App::Get().GetDeviceResources();
+
+	D3D11_BOX box{
+		(UINT)copyRect.left,
+		(UINT)copyRect.top,
+		0,
+		(UINT)copyRect.right,
+		(UINT)copyRect.bottom,
+		1
+	};
+	dr.GetD3DDC()->CopySubresourceRegion(
+		dr.GetBackBuffer(), 0, copyRect.left, copyRect.top, 0, _effectsOutput, 0, &box);
+}
+
+void CursorDrawer::_DrawCursor(const RECT& cursorRect, ID3D11Texture2D* cursorTex, CursorManager::CursorType cursorType) {
+	RECT drawRect;
+	if (!IntersectRect(&drawRect, &cursorRect, &_outputRect)) {
+		return;
+	}
+
+	DeviceResources& dr = App::Get().GetDeviceResources();
+	auto d3dDC = dr.GetD3DDC();
+
+	{
+		D3D11_MAPPED_SUBRESOURCE ms;
+		HRESULT hr = d3dDC->Map(_constantBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
+		if (FAILED(hr)) {
+			Logger::Get().ComError("Map 失败", hr);
+			return;
+		}
+
+		EffectConstant32* data = (EffectConstant32*)ms.pData;
+		data[0].intVal = cursorRect.left;
+		data[1].intVal = cursorRect.top;
+		data[2].intVal = cursorRect.right;
+		data[3].intVal = cursorRect.bottom;
+		data[4].intVal = drawRect.left;
+		data[5].intVal = drawRect.top;
+		data[6].uintVal = drawRect.right - drawRect.left;
+		data[7].uintVal = drawRect.bottom - drawRect.top;
+		data[8].floatVal = 1.0f / (cursorRect.right - cursorRect.left);
+		data[9].floatVal = 1.0f / (cursorRect.bottom - cursorRect.top);
+
+		d3dDC->Unmap(_constantBuffer.get(), 0);
+	}
+
+	ID3D11ShaderResourceView* srvs[2]{};
+	ID3D11UnorderedAccessView* uav = nullptr;
+	if (!dr.GetShaderResourceView(_effectsOutput, &srvs[0])
+		|| !dr.GetShaderResourceView(cursorTex, &srvs[1])
+		|| !dr.GetUnorderedAccessView(dr.GetBackBuffer(), &uav)
+	) {
+		Logger::Get().Error("获取视图失败");
+		return;
+	}
+
+	{
+		ID3D11Buffer* t = _constantBuffer.get();
+		d3dDC->CSSetConstantBuffers(0, 1, &t);
+	}
+	d3dDC->CSSetSamplers(0, 1, &_sampler);
+	d3dDC->CSSetShader(_shaders[(size_t)cursorType].get(), nullptr, 0);
+	d3dDC->CSSetShaderResources(0, 2, srvs);
+	d3dDC->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+
+	d3dDC->Dispatch(
+		(drawRect.right - drawRect.left + 15) / 16,
+		(drawRect.bottom - drawRect.top + 15) / 16,
+		1
+	);
+
+	// 解绑，后缓冲区之后可能被用作渲染目标，效果的输出也将被写入
+	uav = nullptr;
+	d3dDC->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+	srvs[0] = srvs[1] = nullptr;
+	d3dDC->CSSetShaderResources(0, 2, srvs);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+#include "CursorManager.h"
+
+
+// 将最后一个效果的输出复制到后缓冲区并绘制光标
+// 效果的输出保存在单独的纹理中，画面无变化时只需重新合成光标所在的区域
+class CursorDrawer {
+public:
+	CursorDrawer() = default;
+	CursorDrawer(const CursorDrawer&) = delete;
+	CursorDrawer(CursorDrawer&&) = delete;
+
+	bool Initialize(ID3D11Texture2D* effectsOutput, const RECT& outputRect, const RECT& virtualOutputRect);
+
+	// 切换效果链后调用，之后所有后缓冲区都需要完整复制
+	void SetEffectsOutput(ID3D11Texture2D* effectsOutput, const RECT& outputRect, const RECT& virtualOutputRect);
+
+	// isNewFrame 为真表示效果的输出在此帧中被更新
+	void Draw(bool isNewFrame);
+
+	// 当前后缓冲区被其他内容（如覆盖层）修改，下次使用时需完整复制
+	void InvalidateBackBuffer();
+
+	// 光标和上次绘制时相比是否发生变化，用于决定画面静止时是否需要呈现新帧
+	bool IsCursorChanged() const;
+
+private:
+	// 获取光标在后缓冲区中的位置，没有光标时返回 false
+	bool _GetCursorRect(RECT& result, ID3D11Texture2D** cursorTex, CursorManager::CursorType& cursorType) const;
+
+	void _CopyFromOutput(const RECT& rect);
+
+	void _DrawCursor(const RECT& cursorRect, ID3D11Texture2D* cursorTex, CursorManager::CursorType cursorType);
+
+	ID3D11Texture2D* _effectsOutput = nullptr;
+	RECT _outputRect{};
+	RECT _virtualOutputRect{};
+
+	// 每个后缓冲区中的内容
+	struct _BackBufferState {
+		// 和 _outputVersion 不同时表示内容已过时
+		UINT64 outputVersion = 0;
+		RECT cursorRect{};
+		ID3D11Texture2D* cursorTex = nullptr;
+		// 输出区域改变后需先清空，否则新区域之外会残留旧的画面
+		bool isClearNeeded = false;
+	};
+	// 顺序和交换链的后缓冲区索引相同
+	std::vector<_BackBufferState> _backBufferStates;
+	UINT64 _outputVersion = 1;
+
+	// 上次绘制的光标，即屏幕上显示的光标
+	RECT _lastCursorRect{};
+	ID3D11Texture2D* _lastCursorTex = nullptr;
+
+	// 索引为 CursorManager::CursorType
+	std::array<winrt::com_ptr<ID3D11ComputeShader>, 3> _shaders;
+	winrt::com_ptr<ID3D11Buffer> _constantBuffer;
+	ID3D11SamplerState* _sampler = nullptr;
+};
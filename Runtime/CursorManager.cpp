@@ -7,6 +7,7 @@
 #include "Utils.h"
 #include "DeviceResources.h"
 #include "Config.h"
+#include "GPUMemoryTracker.h"
 
 
 // 将源窗口的光标位置映射到缩放后的光标位置
@@ -445,6 +446,7 @@ bool CursorManager::_ResolveCursor(HCURSOR hCursor, bool resolveTexture) {
 			Logger::Get().Error("创建纹理失败");
 			return false;
 		}
+		GPUMemoryTracker::Get().Track(_curCursorInfo->texture.get(), GPUMemoryTracker::Owner::Cursor);
 
 		return true;
 	}
@@ -519,6 +521,7 @@ bool CursorManager::_ResolveCursor(HCURSOR hCursor, bool resolveTexture) {
 		Logger::Get().Error("创建纹理失败");
 		return false;
 	}
+	GPUMemoryTracker::Get().Track(_curCursorInfo->texture.get(), GPUMemoryTracker::Owner::Cursor);
 
 	return true;
 }
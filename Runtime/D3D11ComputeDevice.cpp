@@ -0,0 +1,530 @@
+#include "pch.h"
+#include "D3D11ComputeDevice.h"
+#include "Logger.h"
+
+
+// __CB3 : register(b2)
+static constexpr uint32_t BLOCK_OFFSET_SLOT = 2;
+
+bool D3D11ComputeDevice::Initialize(ID3D11Device* d3dDevice, ID3D11DeviceContext* d3dDC) {
+	if (d3dDC->GetType() != D3D11_DEVICE_CONTEXT_IMMEDIATE) {
+		Logger::Get().Error("D3D11ComputeDevice 需要立即上下文");
+		return false;
+	}
+
+	_d3dDevice.copy_from(d3dDevice);
+	_d3dImmediateDC.copy_from(d3dDC);
+	_d3dDC = d3dDC;
+	return true;
+}
+
+void D3D11ComputeDevice::SetContext(ID3D11DeviceContext* d3dDC) noexcept {
+	_d3dDC = d3dDC;
+	++_contextId;
+
+	// 旧上下文中的绑定不再有效，输出应在切换前解绑
+	_ResetBoundPass();
+	_boundOutputCount = 0;
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::RegisterKernel(ID3D11ComputeShader* shader) {
+	if (!shader) {
+		_Fail("着色器为空");
+		return INVALID_HANDLE;
+	}
+
+	winrt::com_ptr<ID3D11ComputeShader> kernel;
+	kernel.copy_from(shader);
+	return _Add(std::move(kernel));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::RegisterTexture(ID3D11Texture2D* texture) {
+	if (!texture) {
+		_Fail("纹理为空");
+		return INVALID_HANDLE;
+	}
+
+	winrt::com_ptr<ID3D11Texture2D> result;
+	result.copy_from(texture);
+	return _Add(std::move(result));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::RegisterView(ID3D11ShaderResourceView* view) {
+	if (!view) {
+		_Fail("视图为空");
+		return INVALID_HANDLE;
+	}
+
+	_View result;
+	result.view.copy_from(view);
+	result.type = ViewType::ShaderResource;
+	return _Add(std::move(result));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::RegisterView(ID3D11UnorderedAccessView* view) {
+	if (!view) {
+		_Fail("视图为空");
+		return INVALID_HANDLE;
+	}
+
+	_View result;
+	result.view.copy_from(view);
+	result.type = ViewType::UnorderedAccess;
+	return _Add(std::move(result));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::RegisterSampler(ID3D11SamplerState* sampler) {
+	if (!sampler) {
+		_Fail("采样器为空");
+		return INVALID_HANDLE;
+	}
+
+	winrt::com_ptr<ID3D11SamplerState> result;
+	result.copy_from(sampler);
+	return _Add(std::move(result));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::RegisterConstantBuffer(ID3D11Buffer* buffer) {
+	if (!buffer) {
+		_Fail("常量缓冲区为空");
+		return INVALID_HANDLE;
+	}
+
+	D3D11_BUFFER_DESC desc;
+	buffer->GetDesc(&desc);
+	if (!(desc.BindFlags & D3D11_BIND_CONSTANT_BUFFER)) {
+		_Fail("不是常量缓冲区");
+		return INVALID_HANDLE;
+	}
+
+	_ConstantBuffer result;
+	result.buffer.copy_from(buffer);
+	result.byteSize = desc.ByteWidth;
+	result.isDynamic = desc.Usage == D3D11_USAGE_DYNAMIC && (desc.CPUAccessFlags & D3D11_CPU_ACCESS_WRITE);
+	return _Add(std::move(result));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::CreateTexture(uint32_t width, uint32_t height, uint32_t format) {
+	if (width == 0 || height == 0
+		|| width > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION || height > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION) {
+		_Fail("纹理尺寸无效");
+		return INVALID_HANDLE;
+	}
+
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = (DXGI_FORMAT)format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	winrt::com_ptr<ID3D11Texture2D> texture;
+	HRESULT hr = _d3dDevice->CreateTexture2D(&desc, nullptr, texture.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateTexture2D 失败", hr);
+		_Fail("创建纹理失败");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::move(texture));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::CreateView(Handle texture, ViewType type) {
+	winrt::com_ptr<ID3D11Texture2D>* d3dTexture = _Find<winrt::com_ptr<ID3D11Texture2D>>(texture);
+	if (!d3dTexture) {
+		_Fail("纹理不存在");
+		return INVALID_HANDLE;
+	}
+
+	_View result;
+	result.texture = texture;
+	result.type = type;
+
+	HRESULT hr;
+	if (type == ViewType::ShaderResource) {
+		winrt::com_ptr<ID3D11ShaderResourceView> srv;
+		hr = _d3dDevice->CreateShaderResourceView(d3dTexture->get(), nullptr, srv.put());
+		result.view.copy_from(srv.get());
+	} else {
+		winrt::com_ptr<ID3D11UnorderedAccessView> uav;
+		hr = _d3dDevice->CreateUnorderedAccessView(d3dTexture->get(), nullptr, uav.put());
+		result.view.copy_from(uav.get());
+	}
+
+	if (FAILED(hr)) {
+		Logger::Get().ComError("创建视图失败", hr);
+		_Fail("创建视图失败");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::move(result));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::CreateSampler(SamplerFilter filter, SamplerAddress address) {
+	const D3D11_TEXTURE_ADDRESS_MODE addressMode =
+		address == SamplerAddress::Clamp ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP;
+
+	// 和 GraphicsDevice::GetSampler 相同
+	D3D11_SAMPLER_DESC desc{};
+	desc.Filter = filter == SamplerFilter::Linear ? D3D11_FILTER_MIN_MAG_MIP_LINEAR : D3D11_FILTER_MIN_MAG_MIP_POINT;
+	desc.AddressU = addressMode;
+	desc.AddressV = addressMode;
+	desc.AddressW = addressMode;
+	desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+
+	winrt::com_ptr<ID3D11SamplerState> sampler;
+	HRESULT hr = _d3dDevice->CreateSamplerState(&desc, sampler.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateSamplerState 失败", hr);
+		_Fail("创建采样器失败");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::move(sampler));
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::CreateConstantBuffer(uint32_t byteSize) {
+	if (byteSize == 0 || byteSize % 16 != 0) {
+		_Fail("常量缓冲区的尺寸必须为 16 的倍数");
+		return INVALID_HANDLE;
+	}
+
+	D3D11_BUFFER_DESC desc{};
+	desc.ByteWidth = byteSize;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	_ConstantBuffer result;
+	HRESULT hr = _d3dDevice->CreateBuffer(&desc, nullptr, result.buffer.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateBuffer 失败", hr);
+		_Fail("创建常量缓冲区失败");
+		return INVALID_HANDLE;
+	}
+
+	result.byteSize = byteSize;
+	result.isDynamic = true;
+	return _Add(std::move(result));
+}
+
+bool D3D11ComputeDevice::UpdateConstantBuffer(Handle buffer, const void* data, uint32_t byteSize) {
+	_ConstantBuffer* constantBuffer = _Find<_ConstantBuffer>(buffer);
+	if (!constantBuffer) {
+		return _Fail("常量缓冲区不存在");
+	}
+
+	if (!constantBuffer->isDynamic) {
+		return _Fail("常量缓冲区不是动态的");
+	}
+
+	if (byteSize > constantBuffer->byteSize) {
+		return _Fail("数据超出常量缓冲区");
+	}
+
+	D3D11_MAPPED_SUBRESOURCE ms;
+	HRESULT hr = _d3dDC->Map(constantBuffer->buffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("Map 失败", hr);
+		return _Fail("映射常量缓冲区失败");
+	}
+
+	std::memcpy(ms.pData, data, byteSize);
+	_d3dDC->Unmap(constantBuffer->buffer.get(), 0);
+
+	// 起始线程组已被覆盖
+	constantBuffer->contextId = 0;
+	return true;
+}
+
+void D3D11ComputeDevice::Release(Handle handle) {
+	if (handle == _boundKernel || std::find(_boundBindings.begin(), _boundBindings.end(), handle) != _boundBindings.end()) {
+		_ResetBoundPass();
+	}
+
+	_resources.erase(handle);
+}
+
+bool D3D11ComputeDevice::Dispatch(
+	Handle kernel,
+	const EffectPassPlan::Pass& pass,
+	std::span<const Handle> bindings,
+	EffectPassPlan::Size groupOffset,
+	EffectPassPlan::Size groups
+) {
+	if (groups.width == 0 || groups.height == 0) {
+		return _Fail("调度尺寸为 0");
+	}
+
+	if (groups.width > EffectPassPlan::MAX_GROUPS_PER_DIMENSION || groups.height > EffectPassPlan::MAX_GROUPS_PER_DIMENSION
+		|| uint64_t(groupOffset.width) + groups.width > pass.groups.width
+		|| uint64_t(groupOffset.height) + groups.height > pass.groups.height) {
+		return _Fail("调度超出通道的范围");
+	}
+
+	if (kernel != _boundKernel || &pass != _boundPass
+		|| !std::equal(bindings.begin(), bindings.end(), _boundBindings.begin(), _boundBindings.end())) {
+		UnbindOutputs();
+
+		_ConstantBuffer* blockOffsetCB = nullptr;
+		if (!_BindPass(kernel, pass, bindings, blockOffsetCB)) {
+			return false;
+		}
+
+		_boundKernel = kernel;
+		_boundPass = &pass;
+		_boundBindings.assign(bindings.begin(), bindings.end());
+		_boundBlockOffsetCB = blockOffsetCB;
+		_boundOutputCount = (uint32_t)pass.outputs.size();
+	}
+
+	if (_boundBlockOffsetCB && !_WriteBlockOffset(*_boundBlockOffsetCB, groupOffset)) {
+		return false;
+	}
+
+	_d3dDC->Dispatch(groups.width, groups.height, 1);
+	return true;
+}
+
+void D3D11ComputeDevice::UnbindOutputs() noexcept {
+	if (_boundOutputCount > 0) {
+		static constexpr std::array<ID3D11UnorderedAccessView*, EffectPassPlan::MAX_OUTPUTS> nullUAVs{};
+		_d3dDC->CSSetUnorderedAccessViews(0, _boundOutputCount, nullUAVs.data(), nullptr);
+		_boundOutputCount = 0;
+	}
+
+	_ResetBoundPass();
+}
+
+uint32_t D3D11ComputeDevice::WriteTimestamp() {
+	// 创建失败的查询保留为空，ResolveTimestamps 将失败
+	if (_timestampQueries.empty()) {
+		if (!_disjointQuery) {
+			D3D11_QUERY_DESC desc{ D3D11_QUERY_TIMESTAMP_DISJOINT };
+			HRESULT hr = _d3dDevice->CreateQuery(&desc, _disjointQuery.put());
+			if (FAILED(hr)) {
+				Logger::Get().ComError("CreateQuery 失败", hr);
+			}
+		}
+
+		if (_disjointQuery) {
+			_d3dDC->Begin(_disjointQuery.get());
+			_isDisjointActive = true;
+		}
+	}
+
+	winrt::com_ptr<ID3D11Query>& query = _timestampQueries.emplace_back();
+	if (_freeTimestampQueries.empty()) {
+		D3D11_QUERY_DESC desc{ D3D11_QUERY_TIMESTAMP };
+		HRESULT hr = _d3dDevice->CreateQuery(&desc, query.put());
+		if (FAILED(hr)) {
+			Logger::Get().ComError("CreateQuery 失败", hr);
+		}
+	} else {
+		query = std::move(_freeTimestampQueries.back());
+		_freeTimestampQueries.pop_back();
+	}
+
+	if (query) {
+		_d3dDC->End(query.get());
+	}
+
+	return uint32_t(_timestampQueries.size() - 1);
+}
+
+void D3D11ComputeDevice::EndTimestamps() noexcept {
+	if (_isDisjointActive) {
+		_d3dDC->End(_disjointQuery.get());
+		_isDisjointActive = false;
+	}
+}
+
+template<typename T>
+static T GetQueryData(ID3D11DeviceContext* d3dDC, ID3D11Query* query) {
+	T data{};
+	while (S_OK != d3dDC->GetData(query, &data, sizeof(data), 0)) {
+		Sleep(0);
+	}
+	return data;
+}
+
+bool D3D11ComputeDevice::ResolveTimestamps(std::vector<uint64_t>& timestamps) {
+	timestamps.clear();
+
+	if (_timestampQueries.empty()) {
+		return true;
+	}
+
+	const bool hasDisjoint = _isDisjointActive;
+	EndTimestamps();
+
+	bool success = true;
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData{};
+	if (hasDisjoint) {
+		disjointData = GetQueryData<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>(_d3dImmediateDC.get(), _disjointQuery.get());
+		if (disjointData.Disjoint) {
+			success = _Fail("时间戳不连续");
+		}
+	} else {
+		success = _Fail("创建查询失败");
+	}
+
+	// 结果不可用时也取回所有查询的数据再放回池中，否则调试层会在复用时发出警告
+	timestamps.reserve(_timestampQueries.size());
+	for (winrt::com_ptr<ID3D11Query>& query : _timestampQueries) {
+		if (!query) {
+			if (success) {
+				success = _Fail("创建查询失败");
+			}
+			continue;
+		}
+
+		const UINT64 ticks = GetQueryData<UINT64>(_d3dImmediateDC.get(), query.get());
+		_freeTimestampQueries.push_back(std::move(query));
+
+		if (success) {
+			// 避免乘法溢出
+			const UINT64 frequency = disjointData.Frequency;
+			timestamps.push_back(ticks / frequency * 1'000'000'000 + ticks % frequency * 1'000'000'000 / frequency);
+		}
+	}
+	_timestampQueries.clear();
+
+	if (!success) {
+		timestamps.clear();
+	}
+	return success;
+}
+
+ComputeDevice::Handle D3D11ComputeDevice::_Add(_Resource&& resource) {
+	const Handle handle = _nextHandle++;
+	_resources.emplace(handle, std::move(resource));
+	return handle;
+}
+
+bool D3D11ComputeDevice::_BindPass(
+	Handle kernel,
+	const EffectPassPlan::Pass& pass,
+	std::span<const Handle> bindings,
+	_ConstantBuffer*& blockOffsetCB
+) {
+	const winrt::com_ptr<ID3D11ComputeShader>* shader = _Find<winrt::com_ptr<ID3D11ComputeShader>>(kernel);
+	if (!shader) {
+		return _Fail("内核不存在");
+	}
+
+	if (bindings.size() != pass.bindings.size()) {
+		return _Fail("绑定的数量和通道不符");
+	}
+
+	std::array<ID3D11Buffer*, EffectPassPlan::CONSTANT_BUFFER_COUNT> constantBuffers{};
+	std::array<ID3D11SamplerState*, EffectPassPlan::MAX_SAMPLERS> samplers{};
+	std::array<ID3D11ShaderResourceView*, EffectPassPlan::MAX_INPUTS> srvs{};
+	std::array<ID3D11UnorderedAccessView*, EffectPassPlan::MAX_OUTPUTS> uavs{};
+	uint32_t samplerCount = 0;
+
+	// 先检查所有绑定，失败时不改变上下文的状态
+	for (size_t i = 0; i < bindings.size(); ++i) {
+		const EffectPassPlan::Binding& binding = pass.bindings[i];
+
+		switch (binding.type) {
+		case EffectPassPlan::BindingType::ConstantBuffer:
+		{
+			_ConstantBuffer* buffer = _Find<_ConstantBuffer>(bindings[i]);
+			if (!buffer || binding.slot >= constantBuffers.size()) {
+				return _Fail("常量缓冲区绑定无效");
+			}
+			constantBuffers[binding.slot] = buffer->buffer.get();
+
+			if (binding.slot == BLOCK_OFFSET_SLOT) {
+				if (!buffer->isDynamic) {
+					return _Fail("__CB3 必须为动态缓冲区");
+				}
+				blockOffsetCB = buffer;
+			}
+			break;
+		}
+		case EffectPassPlan::BindingType::Sampler:
+		{
+			const winrt::com_ptr<ID3D11SamplerState>* sampler = _Find<winrt::com_ptr<ID3D11SamplerState>>(bindings[i]);
+			if (!sampler || binding.slot >= samplers.size()) {
+				return _Fail("采样器绑定无效");
+			}
+			samplers[binding.slot] = sampler->get();
+			samplerCount = std::max(samplerCount, binding.slot + 1);
+			break;
+		}
+		case EffectPassPlan::BindingType::SampledTexture:
+		case EffectPassPlan::BindingType::StorageTexture:
+		{
+			const bool isOutput = binding.type == EffectPassPlan::BindingType::StorageTexture;
+
+			const _View* view = _Find<_View>(bindings[i]);
+			if (!view || view->type != (isOutput ? ViewType::UnorderedAccess : ViewType::ShaderResource)) {
+				return _Fail("视图绑定无效或类型不符");
+			}
+
+			if (view->texture != INVALID_HANDLE && !_Find<winrt::com_ptr<ID3D11Texture2D>>(view->texture)) {
+				return _Fail("视图的纹理已被释放");
+			}
+
+			// 读写冲突已由 EffectPassPlan 排除，注册的视图也无法得知纹理
+			if (isOutput) {
+				if (binding.slot >= pass.outputs.size()) {
+					return _Fail("输出绑定越界");
+				}
+				uavs[binding.slot] = static_cast<ID3D11UnorderedAccessView*>(view->view.get());
+			} else {
+				if (binding.slot >= pass.inputs.size()) {
+					return _Fail("输入绑定越界");
+				}
+				srvs[binding.slot] = static_cast<ID3D11ShaderResourceView*>(view->view.get());
+			}
+			break;
+		}
+		}
+	}
+
+	_d3dDC->CSSetShader(shader->get(), nullptr, 0);
+	_d3dDC->CSSetConstantBuffers(0, (UINT)constantBuffers.size(), constantBuffers.data());
+	if (samplerCount > 0) {
+		_d3dDC->CSSetSamplers(0, samplerCount, samplers.data());
+	}
+	_d3dDC->CSSetShaderResources(0, (UINT)pass.inputs.size(), srvs.data());
+	_d3dDC->CSSetUnorderedAccessViews(0, (UINT)pass.outputs.size(), uavs.data(), nullptr);
+	return true;
+}
+
+bool D3D11ComputeDevice::_WriteBlockOffset(_ConstantBuffer& buffer, EffectPassPlan::Size blockOffset) {
+	// 延迟上下文在使用动态资源前必须先在同一上下文中 Map，因此切换上下文后总是写入
+	if (buffer.contextId == _contextId
+		&& buffer.blockOffset.width == blockOffset.width && buffer.blockOffset.height == blockOffset.height) {
+		return true;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE ms;
+	HRESULT hr = _d3dDC->Map(buffer.buffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("Map 失败", hr);
+		return _Fail("映射常量缓冲区失败");
+	}
+
+	UINT* data = (UINT*)ms.pData;
+	data[0] = blockOffset.width;
+	data[1] = blockOffset.height;
+	_d3dDC->Unmap(buffer.buffer.get(), 0);
+
+	buffer.blockOffset = blockOffset;
+	buffer.contextId = _contextId;
+	return true;
+}
+
+void D3D11ComputeDevice::_ResetBoundPass() noexcept {
+	_boundKernel = INVALID_HANDLE;
+	_boundPass = nullptr;
+	_boundBindings.clear();
+	_boundBlockOffsetCB = nullptr;
+}
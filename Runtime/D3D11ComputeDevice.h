@@ -0,0 +1,154 @@
+#pragma once
+#include "pch.h"
+#include "ComputeDevice.h"
+#include <unordered_map>
+#include <variant>
+
+
+// ComputeDevice 的 D3D11 实现，内核为计算着色器
+// 除了创建资源，也可以注册已有的 D3D 对象，如 DeviceResources 缓存的视图和采样器，注册后持有它们的引用
+// 调度和常量缓冲区的更新通过 SetContext 设置的上下文执行，可以是录制命令列表的延迟上下文
+// 和 EffectCompiler 生成的着色器约定，__CB3（slot 2）保存起始线程组，Dispatch 将 groupOffset 写入绑定在这里的缓冲区
+class D3D11ComputeDevice : public ComputeDevice {
+public:
+	D3D11ComputeDevice() = default;
+	D3D11ComputeDevice(const D3D11ComputeDevice&) = delete;
+	D3D11ComputeDevice(D3D11ComputeDevice&&) = delete;
+
+	// d3dDC 必须为立即上下文，用于读取时间戳
+	bool Initialize(ID3D11Device* d3dDevice, ID3D11DeviceContext* d3dDC);
+
+	// 之后的调度和更新在 d3dDC 中执行。即使和当前上下文相同，也假定绑定和常量缓冲区的内容已被改变，
+	// 如执行了命令列表，因此下次调度时重新绑定并写入起始线程组
+	void SetContext(ID3D11DeviceContext* d3dDC) noexcept;
+
+	Handle RegisterKernel(ID3D11ComputeShader* shader);
+
+	Handle RegisterTexture(ID3D11Texture2D* texture);
+
+	Handle RegisterView(ID3D11ShaderResourceView* view);
+
+	Handle RegisterView(ID3D11UnorderedAccessView* view);
+
+	Handle RegisterSampler(ID3D11SamplerState* sampler);
+
+	// 只有动态缓冲区可以通过 UpdateConstantBuffer 更新或用作 __CB3
+	Handle RegisterConstantBuffer(ID3D11Buffer* buffer);
+
+	Handle CreateTexture(uint32_t width, uint32_t height, uint32_t format) override;
+
+	Handle CreateView(Handle texture, ViewType type) override;
+
+	Handle CreateSampler(SamplerFilter filter, SamplerAddress address) override;
+
+	// 创建动态缓冲区
+	Handle CreateConstantBuffer(uint32_t byteSize) override;
+
+	bool UpdateConstantBuffer(Handle buffer, const void* data, uint32_t byteSize) override;
+
+	void Release(Handle handle) override;
+
+	// 绑定和上一次调度相同时不再重新绑定，因此对同一通道多次调度只需写入起始线程组
+	// 输出保持绑定，直到绑定其他通道或调用 UnbindOutputs
+	bool Dispatch(
+		Handle kernel,
+		const EffectPassPlan::Pass& pass,
+		std::span<const Handle> bindings,
+		EffectPassPlan::Size groupOffset,
+		EffectPassPlan::Size groups
+	) override;
+
+	// 解绑上一次调度的输出，之后这些纹理才能作为其他着色器的输入
+	void UnbindOutputs() noexcept;
+
+	// 在当前上下文中记录时间戳，查询对象在 ResolveTimestamps 后复用
+	uint32_t WriteTimestamp() override;
+
+	// 结束这一组时间戳，之后 ResolveTimestamps 不必等待此后提交的命令
+	// 用于在几帧之后才取回时间戳，不调用时由 ResolveTimestamps 结束
+	void EndTimestamps() noexcept;
+
+	// 在立即上下文中等待所有时间戳可用，GPU 频率在此期间改变时失败
+	bool ResolveTimestamps(std::vector<uint64_t>& timestamps) override;
+
+	const char* GetError() const noexcept override {
+		return _error;
+	}
+
+private:
+	struct _View {
+		winrt::com_ptr<ID3D11View> view;
+		// 注册的视图为 INVALID_HANDLE，不检查纹理是否已释放
+		Handle texture = INVALID_HANDLE;
+		ViewType type = ViewType::ShaderResource;
+	};
+
+	struct _ConstantBuffer {
+		winrt::com_ptr<ID3D11Buffer> buffer;
+		uint32_t byteSize = 0;
+		bool isDynamic = false;
+		// 最后写入的起始线程组，contextId 和 _contextId 不同时无效
+		EffectPassPlan::Size blockOffset;
+		uint64_t contextId = 0;
+	};
+
+	using _Resource = std::variant<
+		winrt::com_ptr<ID3D11ComputeShader>,
+		winrt::com_ptr<ID3D11Texture2D>,
+		_View,
+		winrt::com_ptr<ID3D11SamplerState>,
+		_ConstantBuffer
+	>;
+
+	template <typename T>
+	T* _Find(Handle handle) noexcept {
+		auto it = _resources.find(handle);
+		return it == _resources.end() ? nullptr : std::get_if<T>(&it->second);
+	}
+
+	Handle _Add(_Resource&& resource);
+
+	bool _Fail(const char* error) noexcept {
+		_error = error;
+		return false;
+	}
+
+	// 检查并绑定通道的所有资源，blockOffsetCB 为 __CB3 绑定的缓冲区
+	bool _BindPass(
+		Handle kernel,
+		const EffectPassPlan::Pass& pass,
+		std::span<const Handle> bindings,
+		_ConstantBuffer*& blockOffsetCB
+	);
+
+	bool _WriteBlockOffset(_ConstantBuffer& buffer, EffectPassPlan::Size blockOffset);
+
+	// 下次调度时重新绑定
+	void _ResetBoundPass() noexcept;
+
+	winrt::com_ptr<ID3D11Device> _d3dDevice;
+	winrt::com_ptr<ID3D11DeviceContext> _d3dImmediateDC;
+	ID3D11DeviceContext* _d3dDC = nullptr;
+	// 每次 SetContext 递增
+	uint64_t _contextId = 1;
+
+	std::unordered_map<Handle, _Resource> _resources;
+	Handle _nextHandle = 1;
+
+	// 上一次调度绑定的资源
+	Handle _boundKernel = INVALID_HANDLE;
+	const EffectPassPlan::Pass* _boundPass = nullptr;
+	std::vector<Handle> _boundBindings;
+	_ConstantBuffer* _boundBlockOffsetCB = nullptr;
+	uint32_t _boundOutputCount = 0;
+
+	winrt::com_ptr<ID3D11Query> _disjointQuery;
+	// 尚未取回的时间戳，创建失败的为空
+	std::vector<winrt::com_ptr<ID3D11Query>> _timestampQueries;
+	// 已取回数据，可以再次使用的查询
+	std::vector<winrt::com_ptr<ID3D11Query>> _freeTimestampQueries;
+	// _disjointQuery 已开始但尚未结束
+	bool _isDisjointActive = false;
+
+	const char* _error = "";
+};
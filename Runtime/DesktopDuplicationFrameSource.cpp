@@ -3,6 +3,7 @@
 #include "App.h"
 #include "DeviceResources.h"
 #include "Logger.h"
+#include "GPUMemoryTracker.h"
 
 
 static winrt::com_ptr<IDXGIOutput1> FindMonitor(IDXGIAdapter1* adapter, HMONITOR hMonitor) {
@@ -119,42 +120,15 @@ bool DesktopDuplicationFrameSource::Initialize() {
 		Logger::Get().Error("创建 Texture2D 失败");
 		return false;
 	}
+	GPUMemoryTracker::Get().Track(_output.get(), GPUMemoryTracker::Owner::FrameSource);
 
-	// 创建共享纹理
-	_sharedTex = dr.CreateTexture2D(
-		DXGI_FORMAT_B8G8R8A8_UNORM,
-		_srcFrameRect.right - _srcFrameRect.left,
-		_srcFrameRect.bottom - _srcFrameRect.top,
-		D3D11_BIND_SHADER_RESOURCE,
-		D3D11_USAGE_DEFAULT,
-		D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX
-	);
-	if (!_sharedTex) {
-		Logger::Get().Error("创建 Texture2D 失败");
-		return false;
-	}
-
-	_sharedTexMutex = _sharedTex.try_as<IDXGIKeyedMutex>();
-	if (!_sharedTexMutex) {
-		Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
-		return false;
-	}
-
-	winrt::com_ptr<IDXGIResource> sharedDxgiRes = _sharedTex.try_as<IDXGIResource>();
-	if (!sharedDxgiRes) {
-		Logger::Get().Error("检索 IDXGIResource 失败");
-		return false;
-	}
-
-	HANDLE hSharedTex = NULL;
-	HRESULT hr = sharedDxgiRes->GetSharedHandle(&hSharedTex);
-	if (FAILED(hr)) {
-		Logger::Get().Error("GetSharedHandle 失败");
+	if (!_InitializeDdpD3D()) {
+		Logger::Get().Error("初始化 D3D 失败");
 		return false;
 	}
 
-	if (!_InitializeDdpD3D(hSharedTex)) {
-		Logger::Get().Error("初始化 D3D 失败");
+	if (!_CreateSharedTextures()) {
+		Logger::Get().Error("_CreateSharedTextures 失败");
 		return false;
 	}
 
@@ -164,7 +138,7 @@ bool DesktopDuplicationFrameSource::Initialize() {
 		return false;
 	}
 
-	hr = output->DuplicateOutput(_ddpD3dDevice.get(), _outputDup.put());
+	HRESULT hr = output->DuplicateOutput(_ddpD3dDevice.get(), _outputDup.put());
 	if (FAILED(hr)) {
 		Logger::Get().ComError("DuplicateOutput 失败", hr);
 		return false;
@@ -192,7 +166,11 @@ bool DesktopDuplicationFrameSource::Initialize() {
 		Logger::Get().Win32Error("SetWindowDisplayAffinity 失败");
 		return false;
 	}
-	
+
+	if (!_CreateNewFrameEvent()) {
+		Logger::Get().Error("_CreateNewFrameEvent 失败");
+		return false;
+	}
 
 	_hDDPThread = CreateThread(nullptr, 0, _DDPThreadProc, this, 0, nullptr);
 	if (!_hDDPThread) {
@@ -205,37 +183,12 @@ bool DesktopDuplicationFrameSource::Initialize() {
 
 
 FrameSourceBase::UpdateState DesktopDuplicationFrameSource::Update() {
-	UINT newFrameState = _newFrameState.load();
-	if (newFrameState == 2) {
-		// 第一帧之前不渲染
-		return UpdateState::Waiting;
-	} else if (newFrameState == 0) {
-		return UpdateState::NoUpdate;
-	}
-
-	// 不必等待，当 newFrameState 变化时 DDP 线程已将锁释放
-	HRESULT hr = _sharedTexMutex->AcquireSync(1, 0);
-	if (hr == static_cast<HRESULT>(WAIT_TIMEOUT)) {
-		return UpdateState::Waiting;
-	}
-	
-	if (FAILED(hr)) {
-		Logger::Get().ComError("AcquireSync 失败", hr);
-		return UpdateState::Error;
-	}
-
-	_newFrameState.store(0);
-
-	App::Get().GetDeviceResources().GetD3DDC()->CopyResource(_output.get(), _sharedTex.get());
-
-	_sharedTexMutex->ReleaseSync(0);
-
-	return UpdateState::NewFrame;
+	return _UpdateFromMailbox();
 }
 
-bool DesktopDuplicationFrameSource::_InitializeDdpD3D(HANDLE hSharedTex) {
+bool DesktopDuplicationFrameSource::_InitializeDdpD3D() {
 	UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
-	if (DeviceResources::IsDebugLayersAvailable()) {
+	if (GraphicsDevice::IsDebugLayersAvailable()) {
 		// 在 DEBUG 配置启用调试层
 		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 	}
@@ -265,19 +218,59 @@ bool DesktopDuplicationFrameSource::_InitializeDdpD3D(HANDLE hSharedTex) {
 		return false;
 	}
 
-	// 获取共享纹理
-	hr = _ddpD3dDevice->OpenSharedResource(hSharedTex, IID_PPV_ARGS(_ddpSharedTex.put()));
-	if (FAILED(hr)) {
-		Logger::Get().ComError("OpenSharedResource 失败", hr);
-		return false;
-	}
+	return true;
+}
 
-	_ddpSharedTexMutex = _ddpSharedTex.try_as<IDXGIKeyedMutex>();
-	if (!_ddpSharedTexMutex) {
-		Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
-		return false;
+bool DesktopDuplicationFrameSource::_CreateSharedTextures() {
+	auto& dr = App::Get().GetDeviceResources();
+
+	for (_SharedTexture& sharedTex : _sharedTextures) {
+		sharedTex.texture = dr.CreateTexture2D(
+			DXGI_FORMAT_B8G8R8A8_UNORM,
+			_srcFrameRect.right - _srcFrameRect.left,
+			_srcFrameRect.bottom - _srcFrameRect.top,
+			D3D11_BIND_SHADER_RESOURCE,
+			D3D11_USAGE_DEFAULT,
+			D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX
+		);
+		if (!sharedTex.texture) {
+			Logger::Get().Error("创建 Texture2D 失败");
+			return false;
+		}
+		GPUMemoryTracker::Get().Track(sharedTex.texture.get(), GPUMemoryTracker::Owner::FrameSource);
+
+		sharedTex.keyedMutex = sharedTex.texture.try_as<IDXGIKeyedMutex>();
+		if (!sharedTex.keyedMutex) {
+			Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
+			return false;
+		}
+
+		winrt::com_ptr<IDXGIResource> sharedDxgiRes = sharedTex.texture.try_as<IDXGIResource>();
+		if (!sharedDxgiRes) {
+			Logger::Get().Error("检索 IDXGIResource 失败");
+			return false;
+		}
+
+		HANDLE hSharedTex = NULL;
+		HRESULT hr = sharedDxgiRes->GetSharedHandle(&hSharedTex);
+		if (FAILED(hr)) {
+			Logger::Get().Error("GetSharedHandle 失败");
+			return false;
+		}
+
+		hr = _ddpD3dDevice->OpenSharedResource(hSharedTex, IID_PPV_ARGS(sharedTex.ddpTexture.put()));
+		if (FAILED(hr)) {
+			Logger::Get().ComError("OpenSharedResource 失败", hr);
+			return false;
+		}
+
+		sharedTex.ddpKeyedMutex = sharedTex.ddpTexture.try_as<IDXGIKeyedMutex>();
+		if (!sharedTex.ddpKeyedMutex) {
+			Logger::Get().Error("检索 IDXGIKeyedMutex 失败");
+			return false;
+		}
 	}
-	
+
 	return true;
 }
 
@@ -287,6 +280,15 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 	DXGI_OUTDUPL_FRAME_INFO info{};
 	winrt::com_ptr<IDXGIResource> dxgiRes;
 	std::vector<BYTE> dupMetaData;
+	std::vector<DirtyRegion::Move> moves;
+	std::vector<DirtyRegion::Rect> dirtyRects;
+
+	const uint32_t frameWidth = that._frameInMonitor.right - that._frameInMonitor.left;
+	const uint32_t frameHeight = that._frameInMonitor.bottom - that._frameInMonitor.top;
+
+	// 最近若干帧各自的变化区域，以序号为索引
+	// 渲染线程可能没有取得每一帧，发布时将它取得的帧之后所有帧的变化合并
+	std::array<DirtyRegion, 8> history;
 
 	while (!that._exiting.load()) {
 		if (dxgiRes) {
@@ -302,10 +304,22 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
-		bool noUpdate = true;
-
 		// 检索 move rects 和 dirty rects
 		// 这些区域如果和窗口客户区有重叠则表明画面有变化
+		// 重叠的部分转换到输出纹理的坐标系后记录下来
+		moves.clear();
+		dirtyRects.clear();
+		auto addDirtyRect = [&](const RECT& rect) {
+			if (Utils::CheckOverlap(that._srcClientInMonitor, rect)) {
+				dirtyRects.push_back({
+					rect.left - that._srcClientInMonitor.left,
+					rect.top - that._srcClientInMonitor.top,
+					rect.right - that._srcClientInMonitor.left,
+					rect.bottom - that._srcClientInMonitor.top
+				});
+			}
+		};
+
 		if (info.TotalMetadataBufferSize) {
 			if (info.TotalMetadataBufferSize > dupMetaData.size()) {
 				dupMetaData.resize(info.TotalMetadataBufferSize);
@@ -314,6 +328,7 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			UINT bufSize = info.TotalMetadataBufferSize;
 
 			// move rects
+			// 滚动等操作产生，渲染时可以平移上一帧的结果
 			hr = that._outputDup->GetFrameMoveRects(bufSize, (DXGI_OUTDUPL_MOVE_RECT*)dupMetaData.data(), &bufSize);
 			if (FAILED(hr)) {
 				Logger::Get().ComError("GetFrameMoveRects 失败", hr);
@@ -323,34 +338,40 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			UINT nRect = bufSize / sizeof(DXGI_OUTDUPL_MOVE_RECT);
 			for (UINT i = 0; i < nRect; ++i) {
 				const DXGI_OUTDUPL_MOVE_RECT& rect = ((DXGI_OUTDUPL_MOVE_RECT*)dupMetaData.data())[i];
-				if (Utils::CheckOverlap(that._srcClientInMonitor, rect.DestinationRect)) {
-					noUpdate = false;
-					break;
+				if (!Utils::CheckOverlap(that._srcClientInMonitor, rect.DestinationRect)) {
+					continue;
 				}
+
+				const LONG dx = rect.DestinationRect.left - rect.SourcePoint.x;
+				const LONG dy = rect.DestinationRect.top - rect.SourcePoint.y;
+				moves.push_back({
+					DirtyRegion::Rect{
+						rect.SourcePoint.x - that._srcClientInMonitor.left,
+						rect.SourcePoint.y - that._srcClientInMonitor.top,
+						rect.DestinationRect.right - dx - that._srcClientInMonitor.left,
+						rect.DestinationRect.bottom - dy - that._srcClientInMonitor.top
+					},
+					dx,
+					dy
+				});
 			}
 
-			if (noUpdate) {
-				bufSize = info.TotalMetadataBufferSize;
+			bufSize = info.TotalMetadataBufferSize;
 
-				// dirty rects
-				hr = that._outputDup->GetFrameDirtyRects(bufSize, (RECT*)dupMetaData.data(), &bufSize);
-				if (FAILED(hr)) {
-					Logger::Get().ComError("GetFrameDirtyRects 失败", hr);
-					continue;
-				}
+			// dirty rects
+			hr = that._outputDup->GetFrameDirtyRects(bufSize, (RECT*)dupMetaData.data(), &bufSize);
+			if (FAILED(hr)) {
+				Logger::Get().ComError("GetFrameDirtyRects 失败", hr);
+				continue;
+			}
 
-				nRect = bufSize / sizeof(RECT);
-				for (UINT i = 0; i < nRect; ++i) {
-					const RECT& rect = ((RECT*)dupMetaData.data())[i];
-					if (Utils::CheckOverlap(that._srcClientInMonitor, rect)) {
-						noUpdate = false;
-						break;
-					}
-				}
+			nRect = bufSize / sizeof(RECT);
+			for (UINT i = 0; i < nRect; ++i) {
+				addDirtyRect(((RECT*)dupMetaData.data())[i]);
 			}
 		}
 
-		if (noUpdate) {
+		if (moves.empty() && dirtyRects.empty()) {
 			continue;
 		}
 
@@ -360,13 +381,15 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
-		hr = that._ddpSharedTexMutex->AcquireSync(0, 100);
+		// 邮箱保证渲染线程不会访问后缓冲区，这里只是等待渲染设备上的复制完成
+		_SharedTexture& sharedTex = that._sharedTextures[that._mailbox.GetBackIndex()];
+		hr = sharedTex.ddpKeyedMutex->AcquireSync(0, 100);
 		while (hr == static_cast<HRESULT>(WAIT_TIMEOUT)) {
 			if (that._exiting.load()) {
 				return 0;
 			}
 
-			hr = that._ddpSharedTexMutex->AcquireSync(0, 100);
+			hr = sharedTex.ddpKeyedMutex->AcquireSync(0, 100);
 		}
 
 		if (FAILED(hr)) {
@@ -374,10 +397,43 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
+		that._ddpD3dDC->CopySubresourceRegion(sharedTex.ddpTexture.get(), 0, 0, 0, 0, d3dRes.get(), 0, &that._frameInMonitor);
+		sharedTex.ddpKeyedMutex->ReleaseSync(0);
+
+		// 记录此帧的变化区域，第一帧需要完整渲染
+		const uint64_t sequence = that._mailbox.GetPublishedCount() + 1;
+		DirtyRegion& frameRegion = history[sequence % history.size()];
+		frameRegion = DirtyRegion(frameWidth, frameHeight);
+		if (sequence == 1) {
+			frameRegion.SetFull();
+		} else {
+			// 平移先于变化区域发生
+			for (const DirtyRegion::Move& move : moves) {
+				frameRegion.SetMove(move);
+			}
+			for (const DirtyRegion::Rect& rect : dirtyRects) {
+				frameRegion.Add(rect);
+			}
+		}
+
+		_CapturedFrame& frame = that._mailbox.GetBackBuffer();
+		frame.texture = sharedTex.texture;
+		frame.keyedMutex = sharedTex.keyedMutex;
+		frame.box = { 0, 0, 0, frameWidth, frameHeight, 1 };
+
+		// 读取到的序号可能已经过时，这时变化区域偏大，渲染线程会放弃其中的平移
+		frame.baseSequence = that._mailbox.GetConsumedSequence();
+		if (sequence - frame.baseSequence > history.size()) {
+			frame.dirtyRegion = DirtyRegion(frameWidth, frameHeight);
+			frame.dirtyRegion.SetFull();
+		} else {
+			frame.dirtyRegion = history[(frame.baseSequence + 1) % history.size()];
+			for (uint64_t i = frame.baseSequence + 2; i <= sequence; ++i) {
+				frame.dirtyRegion.Append(history[i % history.size()]);
+			}
+		}
 
-		that._ddpD3dDC->CopySubresourceRegion(that._ddpSharedTex.get(), 0, 0, 0, 0, d3dRes.get(), 0, &that._frameInMonitor);
-		that._ddpSharedTexMutex->ReleaseSync(1);
-		that._newFrameState.store(1);
+		that._PublishFrame();
 	}
 
 	return 0;
@@ -1,5 +1,6 @@
 #pragma once
 #include "FrameSourceBase.h"
+#include "Utils.h"
 
 
 // 使用 Desktop Duplication API 捕获窗口
@@ -27,7 +28,10 @@ protected:
 	}
 
 private:
-	bool _InitializeDdpD3D(HANDLE hSharedTex);
+	bool _InitializeDdpD3D();
+
+	// 创建每个邮箱缓冲区对应的共享纹理
+	bool _CreateSharedTextures();
 
 	static DWORD WINAPI _DDPThreadProc(LPVOID lpThreadParameter);
 
@@ -36,23 +40,23 @@ private:
 
 	HANDLE _hDDPThread = NULL;
 	std::atomic<bool> _exiting = false;
-	// 0: 等待新帧
-	// 1: 新帧到达
-	// 2: 等待第一帧
-	std::atomic<UINT> _newFrameState = 2;
 
 	// DDP 线程使用的 D3D 设备
 	winrt::com_ptr<ID3D11Device> _ddpD3dDevice;
 	winrt::com_ptr<ID3D11DeviceContext> _ddpD3dDC;
 
-	// 这些均指向同一个纹理
-	// 用于在 D3D Device 间同步对该纹理的访问
-	winrt::com_ptr<ID3D11Texture2D> _sharedTex;
-	winrt::com_ptr<IDXGIKeyedMutex> _sharedTexMutex;
-	winrt::com_ptr<ID3D11Texture2D> _ddpSharedTex;
-	winrt::com_ptr<IDXGIKeyedMutex> _ddpSharedTexMutex;
+	// 每个邮箱缓冲区对应一个共享纹理，DDP 线程写入后缓冲区时渲染线程可以同时读取前缓冲区
+	// 键控互斥体只用于在两个 D3D 设备间同步 GPU 的访问，邮箱保证了不会发生争用
+	struct _SharedTexture {
+		// 渲染线程的 D3D 设备使用
+		winrt::com_ptr<ID3D11Texture2D> texture;
+		winrt::com_ptr<IDXGIKeyedMutex> keyedMutex;
+		// DDP 线程的 D3D 设备使用，和 texture 指向同一个纹理
+		winrt::com_ptr<ID3D11Texture2D> ddpTexture;
+		winrt::com_ptr<IDXGIKeyedMutex> ddpKeyedMutex;
+	};
+	std::array<_SharedTexture, FrameMailbox<_CapturedFrame>::SLOT_COUNT> _sharedTextures;
 
 	RECT _srcClientInMonitor{};
 	D3D11_BOX _frameInMonitor{};
 };
-
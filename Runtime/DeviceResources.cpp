@@ -4,215 +4,21 @@
 #include "StrUtils.h"
 #include "Logger.h"
 #include "Config.h"
+#include "GraphicsDevice.h"
 
 
-static inline void LogAdapter(const DXGI_ADAPTER_DESC1& adapterDesc) {
-	Logger::Get().Info(fmt::format("当前图形适配器：\n\tVendorId：{:#x}\n\tDeviceId：{:#x}\n\t描述：{}",
-		adapterDesc.VendorId, adapterDesc.DeviceId, StrUtils::UTF16ToUTF8(adapterDesc.Description)));
-}
-
-static winrt::com_ptr<IDXGIAdapter3> ObtainGraphicsAdapter(IDXGIFactory4* dxgiFactory, int adapterIdx) {
-	winrt::com_ptr<IDXGIAdapter1> adapter;
-
-	if (adapterIdx >= 0) {
-		HRESULT hr = dxgiFactory->EnumAdapters1(adapterIdx, adapter.put());
-		if (SUCCEEDED(hr)) {
-			DXGI_ADAPTER_DESC1 desc;
-			HRESULT hr = adapter->GetDesc1(&desc);
-			if (FAILED(hr)) {
-				return nullptr;
-			}
-
-			LogAdapter(desc);
-			return adapter.try_as<IDXGIAdapter3>();
-		}
-	}
-
-	// 枚举查找第一个支持 D3D11 的图形适配器
-	for (UINT adapterIndex = 0;
-		SUCCEEDED(dxgiFactory->EnumAdapters1(adapterIndex, adapter.put()));
-		++adapterIndex
-	) {
-		DXGI_ADAPTER_DESC1 desc;
-		HRESULT hr = adapter->GetDesc1(&desc);
-		if (FAILED(hr)) {
-			continue;
-		}
-
-		if (desc.Flags == DXGI_ADAPTER_FLAG_SOFTWARE) {
-			continue;
-		}
-
-		D3D_FEATURE_LEVEL featureLevels[] = {
-			D3D_FEATURE_LEVEL_11_1,
-			D3D_FEATURE_LEVEL_11_0
-		};
-		UINT nFeatureLevels = ARRAYSIZE(featureLevels);
-
-		hr = D3D11CreateDevice(
-			adapter.get(),
-			D3D_DRIVER_TYPE_UNKNOWN,
-			nullptr,
-			0,
-			featureLevels,
-			nFeatureLevels,
-			D3D11_SDK_VERSION,
-			nullptr,
-			nullptr,
-			nullptr
-		);
-		if (SUCCEEDED(hr)) {
-			LogAdapter(desc);
-			return adapter.try_as<IDXGIAdapter3>();
-		}
-	}
-
-	// 回落到 Basic Render Driver Adapter（WARP）
-	// https://docs.microsoft.com/en-us/windows/win32/direct3darticles/directx-warp
-	HRESULT hr = dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&adapter));
-	if (FAILED(hr)) {
-		Logger::Get().ComError("创建 WARP 设备失败", hr);
-		return nullptr;
-	}
-
-	return adapter.try_as<IDXGIAdapter3>();
-}
-
-bool DeviceResources::Initialize() {
-#ifdef _DEBUG
-	UINT flag = DXGI_CREATE_FACTORY_DEBUG;
-#else
-	UINT flag = 0;
-#endif // _DEBUG
-
-	HRESULT hr = CreateDXGIFactory2(flag, IID_PPV_ARGS(_dxgiFactory.put()));
-	if (FAILED(hr)) {
-		return false;
-	}
-
-	// 检查可变帧率支持
-	BOOL supportTearing = FALSE;
+bool DeviceResources::Initialize(std::shared_ptr<GraphicsDevice> device) {
+	_device = std::move(device);
 
-	hr = _dxgiFactory->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &supportTearing, sizeof(supportTearing));
-	if (FAILED(hr)) {
-		Logger::Get().ComWarn("CheckFeatureSupport 失败", hr);
-	}
-	_supportTearing = !!supportTearing;
-
-	Logger::Get().Info(fmt::format("可变刷新率支持：{}", supportTearing ? "是" : "否"));
-
-	if (App::Get().GetConfig().IsDisableVSync() && !supportTearing) {
+	if (App::Get().GetConfig().IsDisableVSync() && !_device->IsTearingSupported()) {
 		Logger::Get().Error("当前显示器不支持可变刷新率");
 		App::Get().SetErrorMsg(ErrorMessages::VSYNC_OFF_NOT_SUPPORTED);
 		return false;
 	}
 
-	UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
-	if (IsDebugLayersAvailable()) {
-		// 在 DEBUG 配置启用调试层
-		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
-	}
-
-	D3D_FEATURE_LEVEL featureLevels[] = {
-		D3D_FEATURE_LEVEL_11_1,
-		D3D_FEATURE_LEVEL_11_0
-	};
-	UINT nFeatureLevels = ARRAYSIZE(featureLevels);
-
-	_graphicsAdapter = ObtainGraphicsAdapter(_dxgiFactory.get(), App::Get().GetConfig().GetAdapterIdx());
-	if (!_graphicsAdapter) {
-		Logger::Get().Error("找不到可用 Adapter");
-		return false;
-	}
-
-	winrt::com_ptr<ID3D11Device> d3dDevice;
-	winrt::com_ptr<ID3D11DeviceContext> d3dDC;
-	hr = D3D11CreateDevice(
-		_graphicsAdapter.get(),
-		D3D_DRIVER_TYPE_UNKNOWN,
-		nullptr,
-		createDeviceFlags,
-		featureLevels,
-		nFeatureLevels,
-		D3D11_SDK_VERSION,
-		d3dDevice.put(),
-		&_featureLevel,
-		d3dDC.put()
-	);
-
-	if (FAILED(hr)) {
-		Logger::Get().ComError("D3D11CreateDevice 失败", hr);
-		return false;
-	}
-
-	std::string_view fl;
-	switch (_featureLevel) {
-	case D3D_FEATURE_LEVEL_11_1:
-		fl = "11.1";
-		break;
-	case D3D_FEATURE_LEVEL_11_0:
-		fl = "11.0";
-		break;
-	default:
-		fl = "未知";
-		break;
-	}
-	Logger::Get().Info(fmt::format("已创建 D3D Device\n\t功能级别：{}", fl));
-
-	_d3dDevice = d3dDevice.try_as<ID3D11Device3>();
-	if (!_d3dDevice) {
-		Logger::Get().Error("获取 ID3D11Device1 失败");
-		return false;
-	}
-
-	_d3dDC = d3dDC.try_as<ID3D11DeviceContext3>();
-	if (!_d3dDC) {
-		Logger::Get().Error("获取 ID3D11DeviceContext1 失败");
-		return false;
-	}
-
-	_dxgiDevice = _d3dDevice.try_as<IDXGIDevice4>();
-	if (!_dxgiDevice) {
-		Logger::Get().Error("获取 IDXGIDevice 失败");
-		return false;
-	}
-
-	if (!_CreateSwapChain()) {
-		Logger::Get().Error("_CreateSwapChain 失败");
-		return false;
-	}
-
 	return true;
 }
 
-bool DeviceResources::IsDebugLayersAvailable() {
-#ifdef _DEBUG
-	static std::optional<bool> result = std::nullopt;
-
-	if (!result.has_value()) {
-		HRESULT hr = D3D11CreateDevice(
-			nullptr,
-			D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
-			nullptr,
-			D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
-			nullptr,                    // Any feature level will do.
-			0,
-			D3D11_SDK_VERSION,
-			nullptr,                    // No need to keep the D3D device reference.
-			nullptr,                    // No need to know the feature level.
-			nullptr                     // No need to keep the D3D device context reference.
-		);
-
-		result = SUCCEEDED(hr);
-	}
-
-	return result.value_or(false);
-#else
-	// Relaese 配置不使用调试层
-	return false;
-#endif
-}
-
 winrt::com_ptr<ID3D11Texture2D> DeviceResources::CreateTexture2D(
 	DXGI_FORMAT format,
 	UINT width,
@@ -235,7 +41,7 @@ winrt::com_ptr<ID3D11Texture2D> DeviceResources::CreateTexture2D(
 	desc.MiscFlags = miscFlags;
 
 	winrt::com_ptr<ID3D11Texture2D> result;
-	HRESULT hr = _d3dDevice->CreateTexture2D(&desc, pInitialData, result.put());
+	HRESULT hr = _device->GetD3DDevice()->CreateTexture2D(&desc, pInitialData, result.put());
 	if (FAILED(hr)) {
 		Logger::Get().ComError("CreateTexture2D 失败", hr);
 		return nullptr;
@@ -244,9 +50,17 @@ winrt::com_ptr<ID3D11Texture2D> DeviceResources::CreateTexture2D(
 	return result;
 }
 
-void DeviceResources::BeginFrame() {
-	WaitForSingleObjectEx(_frameLatencyWaitableObject.get(), 1000, TRUE);
-	_d3dDC->ClearState();
+bool DeviceResources::BeginFrame() {
+	++_frameNumber;
+
+	// 多个会话共享渲染线程时不能在一个交换链上阻塞，未就绪时由渲染线程稍后重试
+	const DWORD timeout = App::Get().GetSessionCount() > 1 ? 0 : 1000;
+	if (WaitForSingleObjectEx(_frameLatencyWaitableObject.get(), timeout, TRUE) == WAIT_TIMEOUT && timeout == 0) {
+		return false;
+	}
+
+	_device->GetD3DDC()->ClearState();
+	return true;
 }
 
 void DeviceResources::EndFrame() {
@@ -257,7 +71,7 @@ void DeviceResources::EndFrame() {
 	}
 }
 
-bool DeviceResources::_CreateSwapChain() {
+bool DeviceResources::CreateSwapChain() {
 	const RECT& hostWndRect = App::Get().GetHostWndRect();
 	const Config& config = App::Get().GetConfig();
 
@@ -276,12 +90,12 @@ bool DeviceResources::_CreateSwapChain() {
 	// 否则将不得不在每帧渲染前清空后缓冲区，这个操作在一些显卡上比较耗时
 	sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
 	// 只要显卡支持始终启用 DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING
-	sd.Flags = (_supportTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0)
+	sd.Flags = (_device->IsTearingSupported() ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0)
 		| DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
 	winrt::com_ptr<IDXGISwapChain1> dxgiSwapChain = nullptr;
-	HRESULT hr = _dxgiFactory->CreateSwapChainForHwnd(
-		_d3dDevice.get(),
+	HRESULT hr = _device->GetDXGIFactory()->CreateSwapChainForHwnd(
+		_device->GetD3DDevice(),
 		App::Get().GetHwndHost(),
 		&sd,
 		nullptr,
@@ -308,7 +122,7 @@ bool DeviceResources::_CreateSwapChain() {
 		return false;
 	}
 
-	hr = _dxgiFactory->MakeWindowAssociation(App::Get().GetHwndHost(), DXGI_MWA_NO_ALT_ENTER);
+	hr = _device->GetDXGIFactory()->MakeWindowAssociation(App::Get().GetHwndHost(), DXGI_MWA_NO_ALT_ENTER);
 	if (FAILED(hr)) {
 		Logger::Get().ComError("MakeWindowAssociation 失败", hr);
 	}
@@ -354,50 +168,133 @@ bool DeviceResources::_CreateSwapChain() {
 	return true;
 }
 
-bool DeviceResources::GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResourceView** result) {
-	auto it = _srvMap.find(texture);
-	if (it != _srvMap.end()) {
-		*result = it->second.get();
-		return true;
+// 纹理的代 ID 存储在纹理的私有数据中，所有会话共用
+// {6C2E7B4A-3F1D-4E8B-9A5C-2D7F0B1E4C93}
+static constexpr GUID GUID_VIEW_CACHE_GENERATION =
+	{ 0x6c2e7b4a, 0x3f1d, 0x4e8b, { 0x9a, 0x5c, 0x2d, 0x7f, 0x0b, 0x1e, 0x4c, 0x93 } };
+
+static std::atomic<uint64_t> nextGeneration = 1;
+
+// 第一次调用时为纹理分配代 ID，之后返回相同的值。ID 永不重复，即使纹理的地址被复用
+static uint64_t GetTextureGeneration(ID3D11Texture2D* texture) {
+	uint64_t generation = 0;
+	UINT dataSize = sizeof(generation);
+	if (SUCCEEDED(texture->GetPrivateData(GUID_VIEW_CACHE_GENERATION, &dataSize, &generation))
+		&& dataSize == sizeof(generation)) {
+		return generation;
 	}
 
-	winrt::com_ptr<ID3D11ShaderResourceView>& r = _srvMap[texture];
-	HRESULT hr = _d3dDevice->CreateShaderResourceView(texture, nullptr, r.put());
+	generation = nextGeneration.fetch_add(1, std::memory_order_relaxed);
+	HRESULT hr = texture->SetPrivateData(GUID_VIEW_CACHE_GENERATION, sizeof(generation), &generation);
 	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateShaderResourceView 失败", hr);
-		return false;
-	} else {
-		*result = r.get();
-		return true;
+		// 仍可使用，但下次获取视图时无法命中
+		Logger::Get().ComError("SetPrivateData 失败", hr);
 	}
+
+	return generation;
 }
 
-bool DeviceResources::GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result) {
-	auto it = _uavMap.find(texture);
-	if (it != _uavMap.end()) {
-		*result = it->second.get();
+template <typename T, typename F>
+bool DeviceResources::_GetView(
+	ID3D11Texture2D* texture,
+	winrt::com_ptr<T> _TextureViews::* member,
+	T** result,
+	const char* createFuncName,
+	const F& createView
+) {
+	const uint64_t generation = GetTextureGeneration(texture);
+
+	auto it = _viewCache.find(generation);
+	if (it != _viewCache.end() && it->second.*member) {
+		++_viewCacheStats.hits;
+		it->second.lastUsedFrame = _frameNumber;
+		*result = (it->second.*member).get();
 		return true;
 	}
 
-	winrt::com_ptr<ID3D11UnorderedAccessView>& r = _uavMap[texture];
-
-	D3D11_UNORDERED_ACCESS_VIEW_DESC desc{};
-	desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
-	desc.Texture2D.MipSlice = 0;
+	++_viewCacheStats.misses;
 
-	HRESULT hr = _d3dDevice->CreateUnorderedAccessView(texture, &desc, r.put());
+	winrt::com_ptr<T> view;
+	HRESULT hr = createView(view.put());
 	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateUnorderedAccessView 失败", hr);
+		Logger::Get().ComError(StrUtils::Concat(createFuncName, " 失败"), hr);
 		return false;
-	} else {
-		*result = r.get();
-		return true;
 	}
+
+	// 创建成功后才加入缓存，因此缓存中的纹理至少有一个视图
+	_TextureViews& views = _viewCache[generation];
+	views.texture = texture;
+	views.*member = std::move(view);
+	views.lastUsedFrame = _frameNumber;
+	*result = (views.*member).get();
+
+	// 此纹理正被调用者使用且在当前帧被访问，不会被移除
+	_EvictViews();
+	return true;
 }
 
-bool DeviceResources::CompileShader(std::string_view hlsl, const char* entryPoint, ID3DBlob** blob, const char* sourceName, ID3DInclude* include, const std::vector<std::pair<std::string, std::string>>& macros) {
-	winrt::com_ptr<ID3DBlob> errorMsgs = nullptr;
+void DeviceResources::_EvictViews() {
+	// 视图只持有纹理的内部引用，外部引用计数为 0 说明纹理的所有者已将其释放，只有缓存使它存活
+	// AddRef 和 Release 的返回值只用于判断是否为 0
+	for (auto it = _viewCache.begin(); it != _viewCache.end();) {
+		ID3D11Texture2D* texture = it->second.texture;
+		texture->AddRef();
+		if (texture->Release() == 0) {
+			it = _viewCache.erase(it);
+			++_viewCacheStats.evictions;
+		} else {
+			++it;
+		}
+	}
+
+	// 当前帧使用的视图可能仍被调用者以裸指针持有，不能移除
+	while (_viewCache.size() > MAX_VIEW_CACHE_SIZE) {
+		auto oldest = _viewCache.end();
+		for (auto it = _viewCache.begin(); it != _viewCache.end(); ++it) {
+			if (it->second.lastUsedFrame < _frameNumber
+				&& (oldest == _viewCache.end() || it->second.lastUsedFrame < oldest->second.lastUsedFrame)) {
+				oldest = it;
+			}
+		}
+
+		if (oldest == _viewCache.end()) {
+			break;
+		}
 
+		_viewCache.erase(oldest);
+		++_viewCacheStats.evictions;
+	}
+}
+
+bool DeviceResources::GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result) {
+	return _GetView(texture, &_TextureViews::rtv, result, "CreateRenderTargetView",
+		[&](ID3D11RenderTargetView** view) {
+			return _device->GetD3DDevice()->CreateRenderTargetView(texture, nullptr, view);
+		}
+	);
+}
+
+bool DeviceResources::GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResourceView** result) {
+	return _GetView(texture, &_TextureViews::srv, result, "CreateShaderResourceView",
+		[&](ID3D11ShaderResourceView** view) {
+			return _device->GetD3DDevice()->CreateShaderResourceView(texture, nullptr, view);
+		}
+	);
+}
+
+bool DeviceResources::GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result) {
+	return _GetView(texture, &_TextureViews::uav, result, "CreateUnorderedAccessView",
+		[&](ID3D11UnorderedAccessView** view) {
+			D3D11_UNORDERED_ACCESS_VIEW_DESC desc{};
+			desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+			desc.Texture2D.MipSlice = 0;
+
+			return _device->GetD3DDevice()->CreateUnorderedAccessView(texture, &desc, view);
+		}
+	);
+}
+
+UINT DeviceResources::GetShaderCompileFlags() noexcept {
 	UINT flags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_ALL_RESOURCES_BOUND;
 	if (App::Get().GetConfig().IsTreatWarningsAsErrors()) {
 		flags |= D3DCOMPILE_WARNINGS_ARE_ERRORS;
@@ -409,72 +306,60 @@ bool DeviceResources::CompileShader(std::string_view hlsl, const char* entryPoin
 	flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
 #endif // _DEBUG
 
+	return flags;
+}
+
+bool DeviceResources::PreprocessShader(std::string_view hlsl, std::string& result, const char* sourceName, ID3DInclude* include, const std::vector<std::pair<std::string, std::string>>& macros) {
+	winrt::com_ptr<ID3DBlob> errorMsgs = nullptr;
+
 	std::vector<D3D_SHADER_MACRO> mc(macros.size() + 1);
 	for (UINT i = 0; i < macros.size(); ++i) {
 		mc[i] = { macros[i].first.c_str(), macros[i].second.c_str() };
 	}
 	mc.back() = { nullptr,nullptr };
 
-	HRESULT hr = D3DCompile(hlsl.data(), hlsl.size(), sourceName, mc.data(), include,
-		entryPoint, "cs_5_0", flags, 0, blob, errorMsgs.put());
+	winrt::com_ptr<ID3DBlob> blob;
+	HRESULT hr = D3DPreprocess(hlsl.data(), hlsl.size(), sourceName, mc.data(), include, blob.put(), errorMsgs.put());
 	if (FAILED(hr)) {
 		if (errorMsgs) {
-			Logger::Get().ComError(StrUtils::Concat("编译计算着色器失败：", (const char*)errorMsgs->GetBufferPointer()), hr);
+			Logger::Get().ComError(StrUtils::Concat("预处理着色器失败：", (const char*)errorMsgs->GetBufferPointer()), hr);
 		}
 		return false;
-	} else {
-		// 警告消息
-		if (errorMsgs) {
-			Logger::Get().Warn(StrUtils::Concat("编译计算着色器时产生警告：", (const char*)errorMsgs->GetBufferPointer()));
-		}
+	}
+
+	// 结果以 NULL 结尾
+	result.assign((const char*)blob->GetBufferPointer(), blob->GetBufferSize());
+	while (!result.empty() && result.back() == '\0') {
+		result.pop_back();
 	}
 
 	return true;
 }
 
-bool DeviceResources::GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result) {
-	auto it = _rtvMap.find(texture);
-	if (it != _rtvMap.end()) {
-		*result = it->second.get();
-		return true;
-	}
+bool DeviceResources::CompileShader(std::string_view hlsl, const char* entryPoint, ID3DBlob** blob, const char* sourceName, ID3DInclude* include, const std::vector<std::pair<std::string, std::string>>& macros) {
+	winrt::com_ptr<ID3DBlob> errorMsgs = nullptr;
 
-	winrt::com_ptr<ID3D11RenderTargetView>& r = _rtvMap[texture];
-	HRESULT hr = _d3dDevice->CreateRenderTargetView(texture, nullptr, r.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("CreateRenderTargetView 失败", hr);
-		return false;
-	} else {
-		*result = r.get();
-		return true;
-	}
-}
+	UINT flags = GetShaderCompileFlags();
 
-bool DeviceResources::GetSampler(D3D11_FILTER filterMode, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** result) {
-	auto key = std::make_pair(filterMode, addressMode);
-	auto it = _samMap.find(key);
-	if (it != _samMap.end()) {
-		*result = it->second.get();
-		return true;
+	std::vector<D3D_SHADER_MACRO> mc(macros.size() + 1);
+	for (UINT i = 0; i < macros.size(); ++i) {
+		mc[i] = { macros[i].first.c_str(), macros[i].second.c_str() };
 	}
+	mc.back() = { nullptr,nullptr };
 
-	winrt::com_ptr<ID3D11SamplerState> sam;
-
-	D3D11_SAMPLER_DESC desc{};
-	desc.Filter = filterMode;
-	desc.AddressU = addressMode;
-	desc.AddressV = addressMode;
-	desc.AddressW = addressMode;
-	desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-	desc.MinLOD = 0;
-	desc.MaxLOD = 0;
-	HRESULT hr = _d3dDevice->CreateSamplerState(&desc, sam.put());
+	HRESULT hr = D3DCompile(hlsl.data(), hlsl.size(), sourceName, mc.data(), include,
+		entryPoint, "cs_5_0", flags, 0, blob, errorMsgs.put());
 	if (FAILED(hr)) {
-		Logger::Get().ComError("创建 ID3D11SamplerState 出错", hr);
+		if (errorMsgs) {
+			Logger::Get().ComError(StrUtils::Concat("编译计算着色器失败：", (const char*)errorMsgs->GetBufferPointer()), hr);
+		}
 		return false;
+	} else {
+		// 警告消息
+		if (errorMsgs) {
+			Logger::Get().Warn(StrUtils::Concat("编译计算着色器时产生警告：", (const char*)errorMsgs->GetBufferPointer()));
+		}
 	}
 
-	*result = sam.get();
-	_samMap.emplace(key, std::move(sam));
 	return true;
 }
@@ -1,17 +1,26 @@
 #pragma once
 #include "pch.h"
 #include "Utils.h"
+#include "GraphicsDevice.h"
 
 
+// 一个缩放会话使用的 D3D 资源。设备可能和其他会话共享，交换链和视图只属于此会话
+// 视图会引用此会话的纹理，复用上次缩放的效果时需通过 EffectDrawer::Rebind 重新获取
 class DeviceResources {
 public:
 	DeviceResources() = default;
 	DeviceResources(const DeviceResources&) = delete;
 	DeviceResources(DeviceResources&&) = delete;
 
-	bool Initialize();
+	// device 应已初始化
+	bool Initialize(std::shared_ptr<GraphicsDevice> device);
 
-	static bool IsDebugLayersAvailable();
+	// 主窗口创建后调用
+	bool CreateSwapChain();
+
+	GraphicsDevice& GetDevice() const noexcept { return *_device; }
+
+	const std::shared_ptr<GraphicsDevice>& GetSharedDevice() const noexcept { return _device; }
 
 	winrt::com_ptr<ID3D11Texture2D> CreateTexture2D(
 		DXGI_FORMAT format,
@@ -23,52 +32,88 @@ public:
 		const D3D11_SUBRESOURCE_DATA* pInitialData = nullptr
 	);
 
-	bool GetSampler(D3D11_FILTER filterMode, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** result);
+	bool GetSampler(D3D11_FILTER filterMode, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** result) {
+		return _device->GetSampler(filterMode, addressMode, result);
+	}
 
+	// 视图由缓存持有，返回的指针只保证在当前帧有效，跨帧使用时调用者应自行持有引用
 	bool GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result);
 
 	bool GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResourceView** result);
 
 	bool GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result);
 
-	bool CompileShader(std::string_view hlsl, const char* entryPoint,
+	struct ViewCacheStats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		// 因纹理已被释放或缓存已满而移除的纹理数
+		uint64_t evictions = 0;
+		// 当前缓存了视图的纹理数
+		size_t size = 0;
+	};
+
+	ViewCacheStats GetViewCacheStats() const noexcept {
+		ViewCacheStats stats = _viewCacheStats;
+		stats.size = _viewCache.size();
+		return stats;
+	}
+
+	// 最多为多少个纹理缓存视图
+	static constexpr size_t MAX_VIEW_CACHE_SIZE = 256;
+
+	// 编译和预处理不依赖设备，可以在设备创建前调用
+	static bool CompileShader(std::string_view hlsl, const char* entryPoint,
 		ID3DBlob** blob, const char* sourceName = nullptr, ID3DInclude* include = nullptr, const std::vector<std::pair<std::string, std::string>>& macros = {});
 
-	ID3D11Device3* GetD3DDevice() const noexcept { return _d3dDevice.get(); }
-	D3D_FEATURE_LEVEL GetFeatureLevel() const noexcept { return _featureLevel; }
-	ID3D11DeviceContext3* GetD3DDC() const noexcept { return _d3dDC.get(); }
+	// 展开宏和 #include，结果可以直接传给 CompileShader
+	static bool PreprocessShader(std::string_view hlsl, std::string& result, const char* sourceName = nullptr,
+		ID3DInclude* include = nullptr, const std::vector<std::pair<std::string, std::string>>& macros = {});
+
+	// CompileShader 使用的编译标志
+	static UINT GetShaderCompileFlags() noexcept;
+
+	ID3D11Device3* GetD3DDevice() const noexcept { return _device->GetD3DDevice(); }
+	D3D_FEATURE_LEVEL GetFeatureLevel() const noexcept { return _device->GetFeatureLevel(); }
+	ID3D11DeviceContext3* GetD3DDC() const noexcept { return _device->GetD3DDC(); }
 	IDXGISwapChain4* GetSwapChain() const noexcept { return _swapChain.get(); };
 	ID3D11Texture2D* GetBackBuffer() const noexcept { return _backBuffer.get(); }
-	IDXGIFactory5* GetDXGIFactory() const noexcept { return _dxgiFactory.get(); }
-	IDXGIDevice4* GetDXGIDevice() const noexcept { return _dxgiDevice.get(); }
-	IDXGIAdapter3* GetGraphicsAdapter() const noexcept { return _graphicsAdapter.get(); }
+	IDXGIFactory5* GetDXGIFactory() const noexcept { return _device->GetDXGIFactory(); }
+	IDXGIDevice4* GetDXGIDevice() const noexcept { return _device->GetDXGIDevice(); }
+	IDXGIAdapter3* GetGraphicsAdapter() const noexcept { return _device->GetGraphicsAdapter(); }
 
-	void BeginFrame();
+	// 交换链未就绪时返回 false，只在多个会话共享渲染线程时发生
+	bool BeginFrame();
 
 	void EndFrame();
 
 private:
-	bool _CreateSwapChain();
+	std::shared_ptr<GraphicsDevice> _device;
 
-	winrt::com_ptr<IDXGIFactory5> _dxgiFactory;
-	winrt::com_ptr<IDXGIDevice4> _dxgiDevice;
 	winrt::com_ptr<IDXGISwapChain4> _swapChain;
-	winrt::com_ptr<IDXGIAdapter3> _graphicsAdapter;
-	winrt::com_ptr<ID3D11Device3> _d3dDevice;
-	winrt::com_ptr<ID3D11DeviceContext3> _d3dDC;
-
 	Utils::ScopedHandle _frameLatencyWaitableObject;
-	bool _supportTearing = false;
-	D3D_FEATURE_LEVEL _featureLevel = D3D_FEATURE_LEVEL_10_0;
-
 	winrt::com_ptr<ID3D11Texture2D> _backBuffer;
 
-	std::unordered_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11RenderTargetView>> _rtvMap;
-	std::unordered_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11ShaderResourceView>> _srvMap;
-	std::unordered_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11UnorderedAccessView>> _uavMap;
-
-	std::unordered_map<
-		std::pair<D3D11_FILTER, D3D11_TEXTURE_ADDRESS_MODE>,
-		winrt::com_ptr<ID3D11SamplerState>
-	> _samMap;
+	// 一个纹理的所有视图
+	struct _TextureViews {
+		// 视图持有纹理的内部引用，因此缓存中的纹理不会被销毁
+		ID3D11Texture2D* texture = nullptr;
+		winrt::com_ptr<ID3D11RenderTargetView> rtv;
+		winrt::com_ptr<ID3D11ShaderResourceView> srv;
+		winrt::com_ptr<ID3D11UnorderedAccessView> uav;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	// 查找视图，未命中时调用 createView 创建并加入缓存
+	template <typename T, typename F>
+	bool _GetView(ID3D11Texture2D* texture, winrt::com_ptr<T> _TextureViews::* member,
+		T** result, const char* createFuncName, const F& createView);
+
+	// 移除除调用者外没有其他引用的纹理，仍超出上限时移除当前帧未使用且最久未使用的纹理
+	void _EvictViews();
+
+	// 键为纹理的代 ID 而不是指针，纹理销毁后指针可能被新纹理复用
+	std::unordered_map<uint64_t, _TextureViews> _viewCache;
+	ViewCacheStats _viewCacheStats;
+	// BeginFrame 时递增，用于找出最久未使用的纹理
+	uint64_t _frameNumber = 0;
 };
@@ -0,0 +1,273 @@
+#include "DirtyRegion.h"
+#include <algorithm>
+
+
+static int32_t DivCeil(int64_t a, int64_t b) noexcept {
+	return int32_t((a + b - 1) / b);
+}
+
+// 向外取整
+static DirtyRegion::Rect ScaleOutward(const DirtyRegion::Rect& rect, uint32_t srcWidth, uint32_t srcHeight, uint32_t width, uint32_t height) noexcept {
+	return DirtyRegion::Rect{
+		int32_t(int64_t(rect.left) * width / srcWidth),
+		int32_t(int64_t(rect.top) * height / srcHeight),
+		DivCeil(int64_t(rect.right) * width, srcWidth),
+		DivCeil(int64_t(rect.bottom) * height, srcHeight)
+	};
+}
+
+// 向内取整
+static DirtyRegion::Rect ScaleInward(const DirtyRegion::Rect& rect, uint32_t srcWidth, uint32_t srcHeight, uint32_t width, uint32_t height) noexcept {
+	return DirtyRegion::Rect{
+		DivCeil(int64_t(rect.left) * width, srcWidth),
+		DivCeil(int64_t(rect.top) * height, srcHeight),
+		int32_t(int64_t(rect.right) * width / srcWidth),
+		int32_t(int64_t(rect.bottom) * height / srcHeight)
+	};
+}
+
+uint64_t DirtyRegion::GetArea() const noexcept {
+	if (_isFull) {
+		return uint64_t(_width) * _height;
+	}
+
+	// 矩形互不重叠
+	uint64_t result = 0;
+	for (const Rect& rect : _rects) {
+		result += rect.GetArea();
+	}
+	return result;
+}
+
+void DirtyRegion::Add(const Rect& rect) {
+	if (_isFull) {
+		return;
+	}
+
+	Rect clipped{
+		std::max(rect.left, 0),
+		std::max(rect.top, 0),
+		std::min(rect.right, (int32_t)_width),
+		std::min(rect.bottom, (int32_t)_height)
+	};
+	if (clipped.IsEmpty()) {
+		return;
+	}
+
+	// 和已有矩形重叠时合并为包围盒，合并后可能和其他矩形重叠，因此需重新检查
+	bool merged = true;
+	while (merged) {
+		merged = false;
+
+		for (auto it = _rects.begin(); it != _rects.end(); ++it) {
+			if (it->IsOverlapped(clipped)) {
+				clipped = _Union(*it, clipped);
+				_rects.erase(it);
+				merged = true;
+				break;
+			}
+		}
+	}
+
+	if (clipped.left == 0 && clipped.top == 0
+		&& clipped.right == (int32_t)_width && clipped.bottom == (int32_t)_height
+	) {
+		SetFull();
+		return;
+	}
+
+	_rects.push_back(clipped);
+
+	if (_rects.size() > MAX_RECTS) {
+		_CollapseToBoundingRect();
+	}
+}
+
+void DirtyRegion::Add(const DirtyRegion& other) {
+	if (other._isFull) {
+		SetFull();
+		return;
+	}
+
+	for (const Rect& rect : other._rects) {
+		Add(rect);
+	}
+}
+
+void DirtyRegion::SetMove(const Move& move) {
+	if (_isFull) {
+		return;
+	}
+
+	const Rect bounds{ 0, 0, (int32_t)_width, (int32_t)_height };
+	const Rect dest = _Intersect(move.GetDestRect(), bounds);
+	if (dest.IsEmpty() || (move.dx == 0 && move.dy == 0)) {
+		return;
+	}
+
+	if (_move || !_rects.empty()) {
+		Add(dest);
+		return;
+	}
+
+	// 源区域只保留纹理内的部分
+	const Rect src = _Intersect(
+		Rect{ dest.left - move.dx, dest.top - move.dy, dest.right - move.dx, dest.bottom - move.dy },
+		bounds
+	);
+	if (src.IsEmpty()) {
+		Add(dest);
+		return;
+	}
+
+	_move = Move{ src, move.dx, move.dy };
+	_AddDifference(dest, _move->GetDestRect());
+}
+
+void DirtyRegion::DropMove() {
+	if (!_move) {
+		return;
+	}
+
+	const Rect dest = _move->GetDestRect();
+	_move.reset();
+	Add(dest);
+}
+
+void DirtyRegion::Append(const DirtyRegion& next) {
+	if (next._isFull) {
+		SetFull();
+		return;
+	}
+
+	// 本区域已有变化时 SetMove 将平移的目标区域作为变化区域处理
+	if (next._move) {
+		SetMove(*next._move);
+	}
+	Add(next);
+}
+
+DirtyRegion DirtyRegion::Propagate(uint32_t width, uint32_t height, uint32_t halo) const {
+	DirtyRegion result(width, height);
+
+	if (_isFull) {
+		result.SetFull();
+		return result;
+	}
+
+	if (_width == 0 || _height == 0) {
+		return result;
+	}
+
+	// 额外扩大一个像素以覆盖采样位置的舍入误差
+	const int32_t inflate = (int32_t)halo + 1;
+	const Rect bounds{ 0, 0, (int32_t)_width, (int32_t)_height };
+
+	if (_move) {
+		const Rect dest = _move->GetDestRect();
+		// 受目标区域影响的所有像素
+		const Rect affected = ScaleOutward(_Intersect(Rect{
+			dest.left - inflate,
+			dest.top - inflate,
+			dest.right + inflate,
+			dest.bottom + inflate
+		}, bounds), _width, _height, width, height);
+
+		const int64_t dx = int64_t(_move->dx) * width;
+		const int64_t dy = int64_t(_move->dy) * height;
+
+		// 采样范围完全位于源区域内的像素可以平移
+		// 超出纹理的采样被限制在边缘，因此平移前后都紧贴同一边缘的一侧不必收缩
+		// 平移后离开边缘的一侧必须收缩，这些像素之前采样的是边缘，现在应采样新的内容
+		const Rect& moveRect = _move->rect;
+		const Rect src = ScaleInward(Rect{
+			moveRect.left == 0 && _move->dx == 0 ? 0 : moveRect.left + inflate,
+			moveRect.top == 0 && _move->dy == 0 ? 0 : moveRect.top + inflate,
+			moveRect.right == bounds.right && _move->dx == 0 ? bounds.right : moveRect.right - inflate,
+			moveRect.bottom == bounds.bottom && _move->dy == 0 ? bounds.bottom : moveRect.bottom - inflate
+		}, _width, _height, width, height);
+
+		if (dx % _width == 0 && dy % _height == 0 && !src.IsEmpty()) {
+			result._move = Move{ src, int32_t(dx / _width), int32_t(dy / _height) };
+			result._AddDifference(affected, result._move->GetDestRect());
+		} else {
+			result.Add(affected);
+		}
+	}
+
+	for (const Rect& rect : _rects) {
+		result.Add(ScaleOutward(_Intersect(Rect{
+			rect.left - inflate,
+			rect.top - inflate,
+			rect.right + inflate,
+			rect.bottom + inflate
+		}, bounds), _width, _height, width, height));
+
+		if (result._isFull) {
+			break;
+		}
+	}
+
+	return result;
+}
+
+std::vector<DirtyRegion::Rect> DirtyRegion::GetBlockRects(uint32_t blockWidth, uint32_t blockHeight) const {
+	const uint32_t groupsX = DivCeil(_width, blockWidth);
+	const uint32_t groupsY = DivCeil(_height, blockHeight);
+
+	if (_isFull) {
+		return { Rect{ 0, 0, (int32_t)groupsX, (int32_t)groupsY } };
+	}
+
+	// 对齐到线程组后可能重叠，借助 Add 合并
+	DirtyRegion groups(groupsX, groupsY);
+	for (const Rect& rect : _rects) {
+		groups.Add(Rect{
+			rect.left / (int32_t)blockWidth,
+			rect.top / (int32_t)blockHeight,
+			DivCeil(rect.right, blockWidth),
+			DivCeil(rect.bottom, blockHeight)
+		});
+	}
+
+	if (groups._isFull) {
+		return { Rect{ 0, 0, (int32_t)groupsX, (int32_t)groupsY } };
+	}
+
+	return std::move(groups._rects);
+}
+
+DirtyRegion::Rect DirtyRegion::_Union(const Rect& r1, const Rect& r2) noexcept {
+	return Rect{
+		std::min(r1.left, r2.left),
+		std::min(r1.top, r2.top),
+		std::max(r1.right, r2.right),
+		std::max(r1.bottom, r2.bottom)
+	};
+}
+
+DirtyRegion::Rect DirtyRegion::_Intersect(const Rect& r1, const Rect& r2) noexcept {
+	return Rect{
+		std::max(r1.left, r2.left),
+		std::max(r1.top, r2.top),
+		std::min(r1.right, r2.right),
+		std::min(r1.bottom, r2.bottom)
+	};
+}
+
+void DirtyRegion::_AddDifference(const Rect& outer, const Rect& inner) {
+	Add(Rect{ outer.left, outer.top, outer.right, inner.top });
+	Add(Rect{ outer.left, inner.bottom, outer.right, outer.bottom });
+	Add(Rect{ outer.left, inner.top, inner.left, inner.bottom });
+	Add(Rect{ inner.right, inner.top, outer.right, inner.bottom });
+}
+
+void DirtyRegion::_CollapseToBoundingRect() {
+	Rect bounds = _rects[0];
+	for (size_t i = 1; i < _rects.size(); ++i) {
+		bounds = _Union(bounds, _rects[i]);
+	}
+
+	_rects.clear();
+	Add(bounds);
+}
@@ -0,0 +1,135 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+
+// 纹理中发生变化的区域，由若干互不重叠的矩形组成，另外可以包含一个内容平移
+// 用于只重新计算变化的部分，其余部分沿用上一帧的结果
+// 应用时先平移，再重新计算变化的矩形
+class DirtyRegion {
+public:
+	struct Rect {
+		int32_t left = 0;
+		int32_t top = 0;
+		int32_t right = 0;
+		int32_t bottom = 0;
+
+		bool IsEmpty() const noexcept {
+			return right <= left || bottom <= top;
+		}
+
+		uint64_t GetArea() const noexcept {
+			return IsEmpty() ? 0 : uint64_t(right - left) * uint64_t(bottom - top);
+		}
+
+		bool IsOverlapped(const Rect& other) const noexcept {
+			return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+		}
+
+		bool operator==(const Rect&) const noexcept = default;
+	};
+
+	// 上一帧中 rect 内的内容移动了 (dx, dy)，如滚动
+	struct Move {
+		Rect rect;
+		int32_t dx = 0;
+		int32_t dy = 0;
+
+		Rect GetDestRect() const noexcept {
+			return Rect{ rect.left + dx, rect.top + dy, rect.right + dx, rect.bottom + dy };
+		}
+
+		bool operator==(const Move&) const noexcept = default;
+	};
+
+	DirtyRegion() noexcept = default;
+
+	DirtyRegion(uint32_t width, uint32_t height) noexcept : _width(width), _height(height) {}
+
+	uint32_t GetWidth() const noexcept {
+		return _width;
+	}
+
+	uint32_t GetHeight() const noexcept {
+		return _height;
+	}
+
+	// 整个纹理都发生了变化
+	bool IsFull() const noexcept {
+		return _isFull;
+	}
+
+	bool IsEmpty() const noexcept {
+		return !_isFull && _rects.empty() && !_move;
+	}
+
+	void SetFull() noexcept {
+		_isFull = true;
+		_rects.clear();
+		_move.reset();
+	}
+
+	void Clear() noexcept {
+		_isFull = false;
+		_rects.clear();
+		_move.reset();
+	}
+
+	// 只有 IsFull 为假时才有意义
+	const std::vector<Rect>& GetRects() const noexcept {
+		return _rects;
+	}
+
+	uint64_t GetArea() const noexcept;
+
+	// 超出纹理的部分被裁剪，和已有矩形重叠时合并
+	void Add(const Rect& rect);
+
+	// 不合并 other 中的平移，需要时先调用 DropMove
+	void Add(const DirtyRegion& other);
+
+	const std::optional<Move>& GetMove() const noexcept {
+		return _move;
+	}
+
+	// 只支持一个平移，且必须在所有变化的矩形之前发生，否则目标区域作为变化区域处理
+	// 源区域超出纹理的部分无法平移，它们在目标区域中对应的部分也作为变化区域处理
+	void SetMove(const Move& move);
+
+	// 放弃平移，将目标区域作为变化区域处理
+	void DropMove();
+
+	// 合并紧随其后的一帧的变化，结果为相对于本区域所基于的帧的变化
+	void Append(const DirtyRegion& next);
+
+	// 计算此区域对另一尺寸纹理的影响
+	// halo 为以本纹理的像素为单位的采样范围，区域先扩大 halo 再缩放，结果总是向外取整
+	// 平移量缩放后为整数时平移被保留，源区域向内收缩 halo 后缩放，目标区域中其余部分作为变化区域
+	DirtyRegion Propagate(uint32_t width, uint32_t height, uint32_t halo) const;
+
+	// 将区域转换为 Dispatch 的线程组范围，每个线程组处理 blockWidth x blockHeight 的块
+	// 返回的矩形以线程组为单位且互不重叠
+	std::vector<Rect> GetBlockRects(uint32_t blockWidth, uint32_t blockHeight) const;
+
+	// 矩形数量的上限，超出时合并为包围盒以限制 Dispatch 的次数
+	static constexpr size_t MAX_RECTS = 16;
+
+private:
+	static Rect _Union(const Rect& r1, const Rect& r2) noexcept;
+
+	static Rect _Intersect(const Rect& r1, const Rect& r2) noexcept;
+
+	// inner 必须位于 outer 内部，添加 outer 中除 inner 之外的部分
+	void _AddDifference(const Rect& outer, const Rect& inner);
+
+	void _CollapseToBoundingRect();
+
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	bool _isFull = false;
+	std::vector<Rect> _rects;
+	std::optional<Move> _move;
+};
@@ -19,6 +19,12 @@
 #include "Utils.h"
 #include "StrUtils.h"
 #include "Logger.h"
+#include "EffectCacheManager.h"
+#include "CacheTelemetry.h"
+#include "WarmSession.h"
+#include "GPUMemoryTracker.h"
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
 
 
 #define API_DECLSPEC extern "C" __declspec(dllexport)
@@ -52,6 +58,25 @@ API_DECLSPEC void WINAPI SetLogLevel(UINT logLevel) {
 	Logger::Get().SetLevel((spdlog::level::level_enum)logLevel);
 }
 
+// 磁盘缓存的总大小上限，单位为字节，超出时按 LRU 顺序删除旧缓存
+// 为 0 时使用默认值
+API_DECLSPEC void WINAPI SetEffectCacheBudget(UINT64 budgetInBytes) {
+	EffectCacheManager::Get().SetDiskBudget(
+		budgetInBytes == 0 ? EffectCacheManager::DEFAULT_DISK_BUDGET : budgetInBytes);
+}
+
+// 在后台将最近使用的缓存读入内存，Initialize 中已使用默认值调用过一次
+// threadCount 和 memoryBudgetInBytes 为 0 时使用默认值
+API_DECLSPEC BOOL WINAPI PrewarmEffectCache(UINT threadCount, UINT64 memoryBudgetInBytes) {
+	return EffectCacheManager::Get().Prewarm(threadCount, memoryBudgetInBytes);
+}
+
+// 缩放结束后保留 D3D 设备和效果链的时长，单位为毫秒，以相同的配置再次缩放时复用它们
+// 为 0 时不保留并立即释放已保留的资源
+API_DECLSPEC void WINAPI SetWarmSessionTimeout(UINT timeoutInMs) {
+	WarmSession::Get().SetTimeout(timeoutInMs);
+}
+
 
 API_DECLSPEC BOOL WINAPI Initialize(
 	UINT logLevel,
@@ -69,14 +94,17 @@ API_DECLSPEC BOOL WINAPI Initialize(
 		return FALSE;
 	}
 
-	// 初始化 Hasher
-	if (!Utils::Hasher::Get().Initialize()) {
-		return FALSE;
-	}
+	// 在后台将常用的缓存读入内存
+	EffectCacheManager::Get().Prewarm();
 
 	return TRUE;
 }
 
+// 等待后台线程退出并写回缓存索引，应在所有 Run 返回后调用
+API_DECLSPEC void WINAPI Uninitialize() {
+	App::Get().Uninitialize();
+}
+
 API_DECLSPEC const char* WINAPI Run(
 	HWND hwndSrc,
 	const char* effectsJson,
@@ -114,14 +142,14 @@ API_DECLSPEC const char* WINAPI Run(
 		}
 	}
 
-	App& app = App::Get();
-	if (!app.Run(hwndSrc, effectsJson, captureMode,
+	// 可以在多个线程中同时缩放不同的源窗口
+	const char* errorMsg = App::Get().Run(hwndSrc, effectsJson, captureMode,
 		cursorZoomFactor, cursorInterpolationMode, adapterIdx, multiMonitorUsage,
-		RECT{(LONG)cropLeft, (LONG)cropTop, (LONG)cropRight, (LONG)cropBottom}, flags)
-	) {
+		RECT{(LONG)cropLeft, (LONG)cropTop, (LONG)cropRight, (LONG)cropBottom}, flags);
+	if (errorMsg) {
 		// 初始化失败
 		Logger::Get().Info("App.Run 失败");
-		return app.GetErrorMsg();
+		return errorMsg;
 	}
 
 	logger.Info("即将退出");
@@ -166,3 +194,65 @@ API_DECLSPEC const char* WINAPI GetAllGraphicsAdapters(const char* delimiter) {
 
 	return result.c_str();
 }
+
+// 缓存和编译的统计数据，JSON 格式。时间的单位为微秒
+// 返回的字符串在下次调用前有效
+API_DECLSPEC const char* WINAPI GetCacheTelemetry() {
+	static std::string result;
+	result = CacheTelemetry::Get().ToJson();
+	return result.c_str();
+}
+
+API_DECLSPEC void WINAPI ResetCacheTelemetry() {
+	CacheTelemetry::Get().Reset();
+}
+
+// 效果链中间纹理和输出纹理的显存上限，单位为字节。超出时分块执行，无法分块时缩放失败
+// 为 0 时不限制
+API_DECLSPEC void WINAPI SetGPUMemoryBudget(UINT64 budgetInBytes) {
+	GPUMemoryTracker::Get().SetBudget(budgetInBytes);
+}
+
+// 已分配的纹理和缓冲区占用的显存，JSON 格式，单位为字节
+// 返回的字符串在下次调用前有效
+API_DECLSPEC const char* WINAPI GetGPUMemoryUsage() {
+	static std::string result;
+	result = GPUMemoryTracker::Get().ToJson();
+	return result.c_str();
+}
+
+// 不开始缩放，估计效果链中每个效果占用的显存，单位为字节，用于在 UI 中显示开销
+// 返回 JSON 格式的数组，失败时返回 nullptr。返回的字符串在下次调用前有效
+API_DECLSPEC const char* WINAPI EstimateGPUMemory(
+	const char* effectsJson,
+	UINT flags,
+	UINT inputWidth,
+	UINT inputHeight,
+	UINT hostWidth,
+	UINT hostHeight
+) {
+	std::vector<std::string> effectNames;
+	std::vector<uint64_t> effectBytes;
+	if (!App::Get().EstimateGPUMemory(effectsJson, flags, SIZE{ (LONG)inputWidth, (LONG)inputHeight },
+		SIZE{ (LONG)hostWidth, (LONG)hostHeight }, effectNames, effectBytes)
+	) {
+		return nullptr;
+	}
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	writer.StartArray();
+	for (size_t i = 0; i < effectNames.size(); ++i) {
+		writer.StartObject();
+		writer.Key("effect");
+		writer.String(effectNames[i].c_str(), (rapidjson::SizeType)effectNames[i].size());
+		writer.Key("bytes");
+		writer.Uint64(effectBytes[i]);
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	static std::string result;
+	result.assign(buffer.GetString(), buffer.GetSize());
+	return result.c_str();
+}
@@ -3,6 +3,8 @@
 #include "App.h"
 #include "DeviceResources.h"
 #include "Logger.h"
+#include "GPUMemoryTracker.h"
+#include "shaders/FrameDiffCS.h"
 
 
 bool DwmSharedSurfaceFrameSource::Initialize() {
@@ -63,16 +65,69 @@ bool DwmSharedSurfaceFrameSource::Initialize() {
 		1
 	};
 
-	_output = App::Get().GetDeviceResources().CreateTexture2D(
+	DeviceResources& dr = App::Get().GetDeviceResources();
+	const SIZE frameSize = Utils::GetSizeOfRect(frameRect);
+
+	_output = dr.CreateTexture2D(
 		DXGI_FORMAT_B8G8R8A8_UNORM,
-		frameRect.right - frameRect.left,
-		frameRect.bottom - frameRect.top,
+		frameSize.cx,
+		frameSize.cy,
 		D3D11_BIND_SHADER_RESOURCE
 	);
 	if (!_output) {
 		Logger::Get().Error("创建 Texture2D 失败");
 		return false;
 	}
+	GPUMemoryTracker::Get().Track(_output.get(), GPUMemoryTracker::Owner::FrameSource);
+
+	_newFrame = dr.CreateTexture2D(
+		DXGI_FORMAT_B8G8R8A8_UNORM,
+		frameSize.cx,
+		frameSize.cy,
+		D3D11_BIND_SHADER_RESOURCE
+	);
+	if (!_newFrame) {
+		Logger::Get().Error("创建 Texture2D 失败");
+		return false;
+	}
+	GPUMemoryTracker::Get().Track(_newFrame.get(), GPUMemoryTracker::Owner::FrameSource);
+
+	_changeDetector = FrameChangeDetector(frameSize.cx, frameSize.cy);
+
+	_tileFlags = dr.CreateTexture2D(
+		DXGI_FORMAT_R32_UINT,
+		_changeDetector.GetTileCountX(),
+		_changeDetector.GetTileCountY(),
+		D3D11_BIND_UNORDERED_ACCESS
+	);
+	if (!_tileFlags) {
+		Logger::Get().Error("创建 Texture2D 失败");
+		return false;
+	}
+	GPUMemoryTracker::Get().Track(_tileFlags.get(), GPUMemoryTracker::Owner::FrameSource);
+
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		_tileFlags->GetDesc(&desc);
+		desc.BindFlags = 0;
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+		for (winrt::com_ptr<ID3D11Texture2D>& staging : _tileFlagsStagings) {
+			HRESULT hr = dr.GetD3DDevice()->CreateTexture2D(&desc, nullptr, staging.put());
+			if (FAILED(hr)) {
+				Logger::Get().ComError("创建 Texture2D 失败", hr);
+				return false;
+			}
+		}
+	}
+
+	HRESULT hr = dr.GetD3DDevice()->CreateComputeShader(
+		FrameDiffCSShaderByteCode, sizeof(FrameDiffCSShaderByteCode), nullptr, _frameDiffShader.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("创建计算着色器失败", hr);
+		return false;
+	}
 
 	Logger::Get().Info("DwmSharedSurfaceFrameSource 初始化完成");
 	return true;
@@ -96,8 +151,123 @@ FrameSourceBase::UpdateState DwmSharedSurfaceFrameSource::Update() {
 		return UpdateState::Error;
 	}
 	
-	App::Get().GetDeviceResources().GetD3DDC()
-		->CopySubresourceRegion(_output.get(), 0, 0, 0, 0, sharedTexture.get(), 0, &_frameInWnd);
+	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
+	d3dDC->CopySubresourceRegion(_newFrame.get(), 0, 0, 0, 0, sharedTexture.get(), 0, &_frameInWnd);
+
+	if (_isFirstFrame) {
+		_isFirstFrame = false;
+
+		d3dDC->CopyResource(_output.get(), _newFrame.get());
+		_dirtyRegion.SetFull();
+		return UpdateState::NewFrame;
+	}
+
+	// 变化在检测到的下一帧才被处理，复制的是当前帧的内容
+	if (!_ReadChanges(_dirtyRegion)) {
+		Logger::Get().Error("_ReadChanges 失败");
+		_dirtyRegion.SetFull();
+	}
+
+	if (_dirtyRegion.IsFull()) {
+		d3dDC->CopyResource(_output.get(), _newFrame.get());
+	} else {
+		// 只复制变化的部分
+		for (const DirtyRegion::Rect& rect : _dirtyRegion.GetRects()) {
+			D3D11_BOX box{ (UINT)rect.left, (UINT)rect.top, 0, (UINT)rect.right, (UINT)rect.bottom, 1 };
+			d3dDC->CopySubresourceRegion(_output.get(), 0, rect.left, rect.top, 0, _newFrame.get(), 0, &box);
+		}
+	}
+
+	// 在复制之后比较，结果只包含输出中尚未更新的部分
+	if (!_DetectChanges()) {
+		Logger::Get().Error("_DetectChanges 失败");
+
+		if (!_dirtyRegion.IsFull()) {
+			d3dDC->CopyResource(_output.get(), _newFrame.get());
+			_dirtyRegion.SetFull();
+		}
+	}
+
+	return _dirtyRegion.IsEmpty() ? UpdateState::NoUpdate : UpdateState::NewFrame;
+}
+
+bool DwmSharedSurfaceFrameSource::_DetectChanges() {
+	if (_pendingStagingCount == _TILE_FLAGS_STAGING_COUNT) {
+		return true;
+	}
+
+	DeviceResources& dr = App::Get().GetDeviceResources();
+	auto d3dDC = dr.GetD3DDC();
+
+	ID3D11ShaderResourceView* srvs[2]{};
+	ID3D11UnorderedAccessView* uav = nullptr;
+	if (!dr.GetShaderResourceView(_newFrame.get(), &srvs[0])
+		|| !dr.GetShaderResourceView(_output.get(), &srvs[1])
+		|| !dr.GetUnorderedAccessView(_tileFlags.get(), &uav)
+	) {
+		Logger::Get().Error("获取视图失败");
+		return false;
+	}
+
+	static constexpr UINT ZERO[4]{};
+	d3dDC->ClearUnorderedAccessViewUint(uav, ZERO);
+
+	d3dDC->CSSetShader(_frameDiffShader.get(), nullptr, 0);
+	d3dDC->CSSetShaderResources(0, 2, srvs);
+	d3dDC->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+
+	d3dDC->Dispatch(_changeDetector.GetTileCountX(), _changeDetector.GetTileCountY(), 1);
+
+	ID3D11ShaderResourceView* nullSrvs[2]{};
+	ID3D11UnorderedAccessView* nullUav = nullptr;
+	d3dDC->CSSetShaderResources(0, 2, nullSrvs);
+	d3dDC->CSSetUnorderedAccessViews(0, 1, &nullUav, nullptr);
+
+	const UINT slot = (_pendingStagingStart + _pendingStagingCount) % _TILE_FLAGS_STAGING_COUNT;
+	d3dDC->CopyResource(_tileFlagsStagings[slot].get(), _tileFlags.get());
+	++_pendingStagingCount;
 
-	return UpdateState::NewFrame;
+	return true;
+}
+
+bool DwmSharedSurfaceFrameSource::_ReadChanges(DirtyRegion& result) {
+	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
+
+	const UINT tileCountX = _changeDetector.GetTileCountX();
+	const UINT tileCountY = _changeDetector.GetTileCountY();
+
+	result = DirtyRegion(_frameInWnd.right - _frameInWnd.left, _frameInWnd.bottom - _frameInWnd.top);
+
+	// 按提交的顺序读取，前一个未完成时之后的也不会完成
+	while (_pendingStagingCount > 0) {
+		ID3D11Texture2D* staging = _tileFlagsStagings[_pendingStagingStart].get();
+
+		D3D11_MAPPED_SUBRESOURCE ms;
+		HRESULT hr = d3dDC->Map(staging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &ms);
+		if (hr == DXGI_ERROR_WAS_STILL_DRAWING) {
+			break;
+		}
+
+		_pendingStagingStart = (_pendingStagingStart + 1) % _TILE_FLAGS_STAGING_COUNT;
+		--_pendingStagingCount;
+
+		if (FAILED(hr)) {
+			Logger::Get().ComError("Map 失败", hr);
+			return false;
+		}
+
+		_tileFlagsCPU.resize((size_t)tileCountX * tileCountY);
+		for (UINT y = 0; y < tileCountY; ++y) {
+			const UINT* row = (const UINT*)((const BYTE*)ms.pData + (size_t)y * ms.RowPitch);
+			for (UINT x = 0; x < tileCountX; ++x) {
+				_tileFlagsCPU[(size_t)y * tileCountX + x] = row[x] != 0;
+			}
+		}
+
+		d3dDC->Unmap(staging, 0);
+
+		result.Add(_changeDetector.TilesToRegion(_tileFlagsCPU.data()));
+	}
+
+	return true;
 }
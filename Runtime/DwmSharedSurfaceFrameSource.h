@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include "FrameSourceBase.h"
+#include "FrameChangeDetector.h"
 
 
 class DwmSharedSurfaceFrameSource : public FrameSourceBase {
@@ -36,7 +37,29 @@ private:
 	);
 	_DwmGetDxSharedSurfaceFunc *_dwmGetDxSharedSurface = nullptr;
 
+	// 在 GPU 上比较新帧和输出，结果复制到暂存纹理，之后的帧中由 _ReadChanges 读取
+	// 暂存纹理都在等待读取时跳过本次比较，之后的比较会包含这些变化
+	bool _DetectChanges();
+
+	// 读取已完成的比较结果并合并到 result，不等待 GPU
+	bool _ReadChanges(DirtyRegion& result);
+
 	D3D11_BOX _frameInWnd{};
-	
+
+	// DwmGetDxSharedSurface 总是返回新帧，因此先复制到这里，和上一帧比较后再复制变化的部分
+	winrt::com_ptr<ID3D11Texture2D> _newFrame;
+	winrt::com_ptr<ID3D11ComputeShader> _frameDiffShader;
+	// 每个块一个像素，非零表示该块发生了变化
+	winrt::com_ptr<ID3D11Texture2D> _tileFlags;
+	// 同步读回需要等待 GPU 完成比较，因此轮流使用多个暂存纹理，晚一帧读取
+	static constexpr UINT _TILE_FLAGS_STAGING_COUNT = 3;
+	std::array<winrt::com_ptr<ID3D11Texture2D>, _TILE_FLAGS_STAGING_COUNT> _tileFlagsStagings;
+	// 已提交比较但尚未读取的暂存纹理，从 _pendingStagingStart 开始
+	UINT _pendingStagingStart = 0;
+	UINT _pendingStagingCount = 0;
+	std::vector<uint8_t> _tileFlagsCPU;
+
+	FrameChangeDetector _changeDetector;
+	bool _isFirstFrame = true;
 };
 
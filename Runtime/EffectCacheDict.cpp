@@ -0,0 +1,43 @@
+#include "EffectCacheDict.h"
+#include <zstd.h>
+#include <zdict.h>
+
+
+EffectCacheDict::~EffectCacheDict() {
+	ZSTD_freeCDict(_cdict);
+	ZSTD_freeDDict(_ddict);
+}
+
+std::vector<uint8_t> EffectCacheDict::Train(
+	std::span<const uint8_t> samples,
+	std::span<const size_t> sampleSizes,
+	const char*& error
+) {
+	std::vector<uint8_t> result(CAPACITY);
+	size_t dictSize = ZDICT_trainFromBuffer(result.data(), result.size(),
+		samples.data(), sampleSizes.data(), (unsigned)sampleSizes.size());
+	if (ZDICT_isError(dictSize)) {
+		error = ZDICT_getErrorName(dictSize);
+		return {};
+	}
+
+	result.resize(dictSize);
+	return result;
+}
+
+std::shared_ptr<const EffectCacheDict> EffectCacheDict::Create(std::span<const uint8_t> data) {
+	uint32_t id = ZDICT_getDictID(data.data(), data.size());
+	if (id == 0) {
+		return nullptr;
+	}
+
+	auto result = std::make_shared<EffectCacheDict>();
+	result->_id = id;
+	result->_cdict = ZSTD_createCDict(data.data(), data.size(), COMPRESSION_LEVEL);
+	result->_ddict = ZSTD_createDDict(data.data(), data.size());
+	if (!result->_cdict || !result->_ddict) {
+		return nullptr;
+	}
+
+	return result;
+}
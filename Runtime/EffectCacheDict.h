@@ -0,0 +1,60 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+// 同一系列的效果（如 Anime4K 的各种变体）编译出的 DXBC 有大量相同的结构
+// 使用从已有缓存训练的字典压缩可以显著减小缓存文件并加快解压
+// ZSTD_CDict 和 ZSTD_DDict 创建后只读，可以在多个线程中同时使用
+class EffectCacheDict {
+public:
+	// 缓存的压缩等级
+	static constexpr int COMPRESSION_LEVEL = 1;
+	// 字典的最大大小
+	static constexpr size_t CAPACITY = 64 * 1024;
+	// 缓存数量达到此值时开始训练字典
+	static constexpr size_t MIN_SAMPLES = 16;
+	// 训练字典使用的样本的总大小上限
+	static constexpr size_t MAX_SAMPLES_SIZE = 8 * 1024 * 1024;
+
+	EffectCacheDict() = default;
+	EffectCacheDict(const EffectCacheDict&) = delete;
+	EffectCacheDict(EffectCacheDict&&) = delete;
+
+	~EffectCacheDict();
+
+	// 所有样本首尾相连，sampleSizes 为每个样本的大小。耗时较长，不应在渲染或 UI 线程中调用
+	// 失败时返回空，error 为原因
+	static std::vector<uint8_t> Train(
+		std::span<const uint8_t> samples,
+		std::span<const size_t> sampleSizes,
+		const char*& error
+	);
+
+	// 从 Train 的结果或字典文件创建，格式错误时返回 nullptr
+	static std::shared_ptr<const EffectCacheDict> Create(std::span<const uint8_t> data);
+
+	// 写入缓存文件头，为 0 表示未使用字典
+	uint32_t GetId() const noexcept {
+		return _id;
+	}
+
+	const ZSTD_CDict_s* GetCDict() const noexcept {
+		return _cdict;
+	}
+
+	const ZSTD_DDict_s* GetDDict() const noexcept {
+		return _ddict;
+	}
+
+private:
+	ZSTD_CDict_s* _cdict = nullptr;
+	ZSTD_DDict_s* _ddict = nullptr;
+	uint32_t _id = 0;
+};
@@ -0,0 +1,48 @@
+#include "EffectCacheFile.h"
+#include <cstring>
+
+
+void EffectCacheFile::WriteHeader(std::vector<uint8_t>& result, uint32_t version, uint32_t dictId) {
+	Header header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = version;
+	header.dictId = dictId;
+
+	result.resize(sizeof(header));
+	std::memcpy(result.data(), &header, sizeof(header));
+}
+
+bool EffectCacheFile::GetDictId(std::span<const uint8_t> file, uint32_t version, uint32_t& dictId) noexcept {
+	if (file.size() < sizeof(Header)) {
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != version) {
+		return false;
+	}
+
+	dictId = header.dictId;
+	return true;
+}
+
+EffectCacheFile::Status EffectCacheFile::Check(
+	std::span<const uint8_t> file,
+	uint32_t version,
+	uint32_t currentDictId,
+	std::span<const uint8_t>& payload
+) noexcept {
+	uint32_t dictId = 0;
+	// 没有压缩的数据也视为损坏
+	if (!GetDictId(file, version, dictId) || file.size() == sizeof(Header)) {
+		return Status::Corrupt;
+	}
+
+	if (dictId != 0 && dictId != currentDictId) {
+		return Status::DictMismatch;
+	}
+
+	payload = file.subspan(sizeof(Header));
+	return Status::Ok;
+}
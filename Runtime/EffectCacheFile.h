@@ -0,0 +1,43 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+// 缓存文件的格式：文件头之后是 zstd 压缩的数据，压缩和读写文件由 EffectCacheManager 负责
+// 读取失败的缓存文件应删除并移出索引，否则索引中的条目会阻止重新写入内容相同的字节码
+class EffectCacheFile {
+public:
+	enum class Status {
+		Ok,
+		// 文件截断、格式错误或版本不符
+		Corrupt,
+		// 压缩使用的字典和当前字典不同，字典重新训练后出现
+		DictMismatch
+	};
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		// 压缩使用的字典的 ID，为 0 表示未使用字典
+		uint32_t dictId;
+		uint32_t reserved;
+	};
+
+	static constexpr char MAGIC[4] = { 'M', 'P', 'E', 'C' };
+
+	// 清空 result 并写入文件头，压缩的数据应追加在其后
+	static void WriteHeader(std::vector<uint8_t>& result, uint32_t version, uint32_t dictId);
+
+	// currentDictId 为当前字典的 ID，没有字典时为 0。成功时 payload 为压缩的数据
+	static Status Check(
+		std::span<const uint8_t> file,
+		uint32_t version,
+		uint32_t currentDictId,
+		std::span<const uint8_t>& payload
+	) noexcept;
+
+	// 用于判断是否可以作为训练字典的样本，文件头无效时返回 false
+	static bool GetDictId(std::span<const uint8_t> file, uint32_t version, uint32_t& dictId) noexcept;
+};
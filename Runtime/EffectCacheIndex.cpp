@@ -0,0 +1,226 @@
+#include "EffectCacheIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+// 索引文件的格式（所有整数均为小端序）：
+// "MPCI" | VERSION (u32) | 条目数 (u64)
+// 每个条目：文件名长度 (u32) | 文件名 | 效果名长度 (u32) | 效果名 | 大小 (u64) | 最后使用时间 (u64)
+static constexpr const uint8_t MAGIC[4] = { 'M', 'P', 'C', 'I' };
+
+
+template<typename T>
+static void WriteInt(std::vector<uint8_t>& buf, T value) {
+	for (size_t i = 0; i < sizeof(T); ++i) {
+		buf.push_back(uint8_t(value >> (i * 8)));
+	}
+}
+
+static void WriteString(std::vector<uint8_t>& buf, std::string_view str) {
+	WriteInt(buf, (uint32_t)str.size());
+	buf.insert(buf.end(), str.begin(), str.end());
+}
+
+template<typename T>
+static bool ReadInt(std::span<const uint8_t>& data, T& value) {
+	if (data.size() < sizeof(T)) {
+		return false;
+	}
+
+	value = 0;
+	for (size_t i = 0; i < sizeof(T); ++i) {
+		value |= T(data[i]) << (i * 8);
+	}
+	data = data.subspan(sizeof(T));
+	return true;
+}
+
+static bool ReadString(std::span<const uint8_t>& data, std::string& str) {
+	uint32_t len = 0;
+	if (!ReadInt(data, len) || data.size() < len) {
+		return false;
+	}
+
+	str.assign((const char*)data.data(), len);
+	data = data.subspan(len);
+	return true;
+}
+
+bool EffectCacheIndex::Deserialize(std::span<const uint8_t> data) {
+	Clear();
+
+	if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+		return false;
+	}
+	data = data.subspan(sizeof(MAGIC));
+
+	uint32_t version = 0;
+	uint64_t count = 0;
+	if (!ReadInt(data, version) || version != VERSION || !ReadInt(data, count)) {
+		return false;
+	}
+
+	for (uint64_t i = 0; i < count; ++i) {
+		std::string fileName;
+		Entry entry;
+		if (!ReadString(data, fileName) || !ReadString(data, entry.effectName)
+			|| !ReadInt(data, entry.size) || !ReadInt(data, entry.lastUse)
+		) {
+			Clear();
+			return false;
+		}
+
+		_lastTimestamp = std::max(_lastTimestamp, entry.lastUse);
+		_totalSize += entry.size;
+
+		auto [it, inserted] = _entries.try_emplace(std::move(fileName), std::move(entry));
+		if (!inserted) {
+			// 重复的条目
+			Clear();
+			return false;
+		}
+	}
+
+	return data.empty();
+}
+
+void EffectCacheIndex::Serialize(std::vector<uint8_t>& result) const {
+	result.clear();
+	result.reserve(16 + _entries.size() * 96);
+
+	result.insert(result.end(), std::begin(MAGIC), std::end(MAGIC));
+	WriteInt(result, VERSION);
+	WriteInt(result, (uint64_t)_entries.size());
+
+	for (const auto& [fileName, entry] : _entries) {
+		WriteString(result, fileName);
+		WriteString(result, entry.effectName);
+		WriteInt(result, entry.size);
+		WriteInt(result, entry.lastUse);
+	}
+}
+
+void EffectCacheIndex::Add(const std::string& fileName, std::string_view effectName, uint64_t size) {
+	Entry& entry = _entries[fileName];
+	_totalSize = _totalSize - entry.size + size;
+
+	entry.effectName = effectName;
+	entry.size = size;
+	entry.lastUse = _NextTimestamp();
+
+	_removed.erase(fileName);
+	_dirty = true;
+}
+
+bool EffectCacheIndex::Touch(const std::string& fileName) {
+	auto it = _entries.find(fileName);
+	if (it == _entries.end()) {
+		return false;
+	}
+
+	it->second.lastUse = _NextTimestamp();
+	_dirty = true;
+	return true;
+}
+
+void EffectCacheIndex::Remove(const std::string& fileName) {
+	auto it = _entries.find(fileName);
+	if (it == _entries.end()) {
+		return;
+	}
+
+	_totalSize -= it->second.size;
+	_entries.erase(it);
+	_removed.insert(fileName);
+	_dirty = true;
+}
+
+const EffectCacheIndex::Entry* EffectCacheIndex::Find(const std::string& fileName) const {
+	auto it = _entries.find(fileName);
+	return it == _entries.end() ? nullptr : &it->second;
+}
+
+void EffectCacheIndex::Merge(const EffectCacheIndex& other) {
+	for (const auto& [fileName, otherEntry] : other._entries) {
+		if (_removed.contains(fileName)) {
+			continue;
+		}
+
+		auto [it, inserted] = _entries.try_emplace(fileName, otherEntry);
+		if (inserted) {
+			_totalSize += otherEntry.size;
+			_dirty = true;
+		} else if (otherEntry.lastUse > it->second.lastUse) {
+			_totalSize = _totalSize - it->second.size + otherEntry.size;
+			it->second = otherEntry;
+			_dirty = true;
+		}
+	}
+
+	_lastTimestamp = std::max(_lastTimestamp, other._lastTimestamp);
+}
+
+std::vector<std::string> EffectCacheIndex::Evict(uint64_t budget, std::span<const std::string> keep) {
+	std::vector<std::string> result;
+	if (_totalSize <= budget) {
+		return result;
+	}
+
+	std::vector<std::pair<uint64_t, const std::string*>> lru;
+	lru.reserve(_entries.size());
+	for (const auto& [fileName, entry] : _entries) {
+		if (std::find(keep.begin(), keep.end(), fileName) == keep.end()) {
+			lru.emplace_back(entry.lastUse, &fileName);
+		}
+	}
+	std::sort(lru.begin(), lru.end(), [](const auto& l, const auto& r) {
+		return l.first != r.first ? l.first < r.first : *l.second < *r.second;
+	});
+
+	uint64_t totalSize = _totalSize;
+	for (const auto& [lastUse, fileName] : lru) {
+		if (totalSize <= budget) {
+			break;
+		}
+
+		totalSize -= _entries[*fileName].size;
+		result.push_back(*fileName);
+	}
+
+	for (const std::string& fileName : result) {
+		Remove(fileName);
+	}
+
+	return result;
+}
+
+std::vector<std::pair<std::string, EffectCacheIndex::Entry>> EffectCacheIndex::GetEntriesByRecency() const {
+	std::vector<std::pair<std::string, Entry>> result(_entries.begin(), _entries.end());
+	std::sort(result.begin(), result.end(), [](const auto& l, const auto& r) {
+		return l.second.lastUse != r.second.lastUse ? l.second.lastUse > r.second.lastUse : l.first < r.first;
+	});
+	return result;
+}
+
+void EffectCacheIndex::Clear() noexcept {
+	_entries.clear();
+	_removed.clear();
+	_totalSize = 0;
+	_lastTimestamp = 0;
+	_dirty = false;
+}
+
+std::string_view EffectCacheIndex::EffectNameFromFileName(std::string_view fileName) noexcept {
+	// {效果名}_{标志位}{哈希}，效果名中也可能包含下划线
+	size_t pos = fileName.find_last_of('_');
+	return pos == std::string_view::npos ? fileName : fileName.substr(0, pos);
+}
+
+uint64_t EffectCacheIndex::_NextTimestamp() noexcept {
+	using namespace std::chrono;
+	uint64_t now = (uint64_t)duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	// 保证严格递增，即使系统时间被调整
+	_lastTimestamp = std::max(now, _lastTimestamp + 1);
+	return _lastTimestamp;
+}
@@ -0,0 +1,85 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+
+
+// 磁盘缓存的索引，记录每个缓存文件的大小、最后使用时间和所属效果
+// 用于在不扫描缓存文件夹的情况下按 LRU 策略将缓存限制在预算之内
+// 文件的读写和删除由调用者负责，此类不是线程安全的
+class EffectCacheIndex {
+public:
+	struct Entry {
+		std::string effectName;
+		uint64_t size = 0;
+		// 最后使用的时间戳，单位为毫秒。同一索引中保证严格递增
+		uint64_t lastUse = 0;
+	};
+
+	// 数据格式或版本不符时返回 false 并清空索引
+	bool Deserialize(std::span<const uint8_t> data);
+
+	void Serialize(std::vector<uint8_t>& result) const;
+
+	// 已存在则更新大小和使用时间
+	void Add(const std::string& fileName, std::string_view effectName, uint64_t size);
+
+	// 更新使用时间，不存在返回 false
+	bool Touch(const std::string& fileName);
+
+	void Remove(const std::string& fileName);
+
+	const Entry* Find(const std::string& fileName) const;
+
+	// 合并其他会话写入的索引，本会话已删除的条目不会被重新加入
+	// 两者都有的条目保留较新的使用时间
+	void Merge(const EffectCacheIndex& other);
+
+	// 按 LRU 顺序移除条目直到总大小不超过 budget，返回被移除的文件名
+	// keep 中的条目不会被移除
+	std::vector<std::string> Evict(uint64_t budget, std::span<const std::string> keep = {});
+
+	// 按最后使用时间从新到旧排列
+	std::vector<std::pair<std::string, Entry>> GetEntriesByRecency() const;
+
+	uint64_t GetTotalSize() const noexcept {
+		return _totalSize;
+	}
+
+	size_t GetCount() const noexcept {
+		return _entries.size();
+	}
+
+	bool IsDirty() const noexcept {
+		return _dirty;
+	}
+
+	// 索引写入磁盘后调用
+	void ClearDirty() noexcept {
+		_dirty = false;
+		_removed.clear();
+	}
+
+	void Clear() noexcept;
+
+	// 从缓存文件名推断效果名，缓存文件的命名见 EffectCacheManager
+	static std::string_view EffectNameFromFileName(std::string_view fileName) noexcept;
+
+	// 索引格式版本，更改序列化格式时更新
+	static constexpr uint32_t VERSION = 1;
+
+private:
+	uint64_t _NextTimestamp() noexcept;
+
+	std::unordered_map<std::string, Entry> _entries;
+	// 本会话中删除的条目，合并时忽略
+	std::unordered_set<std::string> _removed;
+	uint64_t _totalSize = 0;
+	uint64_t _lastTimestamp = 0;
+	bool _dirty = false;
+};
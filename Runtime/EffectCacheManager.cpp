@@ -7,58 +7,53 @@
 #include <yas/types/std/string.hpp>
 #include <yas/types/std/vector.hpp>
 #include "EffectCompiler.h"
-#include <regex>
 #include "App.h"
 #include "DeviceResources.h"
 #include "StrUtils.h"
 #include "Logger.h"
+#include "CacheTelemetry.h"
+#include "EffectCacheDict.h"
+#include "ShaderHash.h"
+#include "EffectCacheFile.h"
 
 
 static constexpr const size_t MAX_CACHE_COUNT = 128;
 
 // 缓存版本
 // 当缓存文件结构有更改时更新它，使旧缓存失效
-static constexpr const UINT CACHE_VERSION = 8;
-
-// 缓存的压缩等级
-static constexpr const int CACHE_COMPRESSION_LEVEL = 1;
+static constexpr const UINT CACHE_VERSION = 12;
 
 static const wchar_t* CACHE_DIR = L".\\cache";
 
+// 缓存索引的文件名，不会和缓存文件冲突，因为缓存文件名总是包含下划线
+static const wchar_t* CACHE_INDEX_FILE_NAME = L".\\cache\\index";
+
+// 缓存字典的文件名，同样不会和缓存文件冲突
+static const wchar_t* CACHE_DICT_FILE_NAME = L".\\cache\\dict";
+
 
-std::wstring GetCacheFileName(std::string_view effectName, std::string_view hash, UINT flags) {
+static std::string GetCacheKey(std::string_view effectName, std::string_view hash, UINT flags) {
 	// 缓存文件的命名：{效果名}_{标志位（16进制）}{哈希}
-	return fmt::format(L"{}\\{}_{:02x}{}", CACHE_DIR, StrUtils::UTF8ToUTF16(effectName), flags, StrUtils::UTF8ToUTF16(hash));
+	return fmt::format("{}_{:02x}{}", effectName, flags, hash);
 }
 
+// 着色器字节码以哈希为键单独保存，不同效果的相同通道共用同一个文件
+// 效果名的缓存文件名中哈希之前还有标志位，因此不会冲突
+static constexpr std::string_view BLOB_CACHE_KEY_PREFIX = "blob_";
 
-template<typename Archive>
-void serialize(Archive& ar, winrt::com_ptr<ID3DBlob>& o) {
-	SIZE_T size = 0;
-	ar& size;
-	HRESULT hr = D3DCreateBlob(size, o.put());
-	if (FAILED(hr)) {
-		Logger::Get().ComError("D3DCreateBlob 失败", hr);
-		throw new std::exception();
-	}
-
-	BYTE* buf = (BYTE*)o->GetBufferPointer();
-	for (SIZE_T i = 0; i < size; ++i) {
-		ar& (*buf++);
-	}
+static std::string GetBlobCacheKey(std::string_view shaderHash) {
+	return StrUtils::Concat(BLOB_CACHE_KEY_PREFIX, shaderHash);
 }
 
-template<typename Archive>
-void serialize(Archive& ar, const winrt::com_ptr<ID3DBlob>& o) {
-	SIZE_T size = o->GetBufferSize();
-	ar& size;
+static bool IsBlobCacheKey(std::string_view cacheKey) noexcept {
+	return cacheKey.starts_with(BLOB_CACHE_KEY_PREFIX);
+}
 
-	BYTE* buf = (BYTE*)o->GetBufferPointer();
-	for (SIZE_T i = 0; i < size; ++i) {
-		ar& (*buf++);
-	}
+static std::wstring GetCacheFileName(std::string_view cacheKey) {
+	return StrUtils::ConcatW(CACHE_DIR, L"\\", StrUtils::UTF8ToUTF16(cacheKey));
 }
 
+
 template<typename Archive>
 void serialize(Archive& ar, const EffectParameterDesc& o) {
 	size_t index = o.defaultValue.index();
@@ -143,7 +138,7 @@ void serialize(Archive& ar, EffectSamplerDesc& o) {
 
 template<typename Archive>
 void serialize(Archive& ar, EffectPassDesc& o) {
-	ar& o.cso& o.inputs& o.outputs& o.numThreads[0] & o.numThreads[1] & o.numThreads[2] & o.blockSize& o.desc& o.isPSStyle;
+	ar& o.csoHash& o.inputs& o.outputs& o.numThreads[0] & o.numThreads[1] & o.numThreads[2] & o.blockSize& o.desc& o.halo& o.isPSStyle;
 }
 
 template<typename Archive>
@@ -151,6 +146,34 @@ void serialize(Archive& ar, EffectDesc& o) {
 	ar& o.name& o.outSizeExpr& o.params& o.textures& o.samplers& o.passes& o.flags& o.isUseDynamic;
 }
 
+EffectCacheManager::~EffectCacheManager() {
+	// 后台线程应已在 Shutdown 中退出。此时可能持有加载器锁，不能等待线程
+	// 未调用 Shutdown 时只有进程退出才会析构，其他线程已被终止
+	if (_hPrewarmThread) {
+		CloseHandle(_hPrewarmThread);
+	}
+	if (_hDictThread) {
+		CloseHandle(_hDictThread);
+	}
+}
+
+void EffectCacheManager::Shutdown() {
+	_isShuttingDown = true;
+	_isPrewarmCancelled = true;
+	// 之后不再启动训练
+	_isDictTrainAttempted = true;
+
+	for (HANDLE* hThread : { &_hPrewarmThread, &_hDictThread }) {
+		if (*hThread) {
+			WaitForSingleObject(*hThread, INFINITE);
+			CloseHandle(*hThread);
+			*hThread = NULL;
+		}
+	}
+
+	FlushIndex();
+}
+
 void EffectCacheManager::_AddToMemCache(const std::wstring& cacheFileName, const EffectDesc& desc) {
 	std::scoped_lock lk(_cs);
 
@@ -193,43 +216,173 @@ bool EffectCacheManager::_LoadFromMemCache(const std::wstring& cacheFileName, Ef
 	return false;
 }
 
+bool EffectCacheManager::_IsInMemCache(const std::wstring& cacheFileName) {
+	std::scoped_lock lk(_cs);
+	return _memCache.contains(cacheFileName);
+}
+
+EffectCacheFile::Status EffectCacheManager::_ReadCacheFile(const std::wstring& fileName, std::vector<BYTE>& result, size_t& fileSize) {
+	std::vector<BYTE> compressedBuf;
+	if (!Utils::ReadFile(fileName.c_str(), compressedBuf)) {
+		return EffectCacheFile::Status::Corrupt;
+	}
+	fileSize = compressedBuf.size();
+	CacheTelemetry::Get().Add(CacheTelemetry::Counter::BytesRead, fileSize);
+
+	std::shared_ptr<const EffectCacheDict> dict = _GetDict();
+	std::span<const BYTE> payload;
+	const EffectCacheFile::Status status =
+		EffectCacheFile::Check(compressedBuf, CACHE_VERSION, dict ? dict->GetId() : 0, payload);
+	if (status == EffectCacheFile::Status::Corrupt) {
+		Logger::Get().Error("缓存文件格式错误");
+		return status;
+	} else if (status == EffectCacheFile::Status::DictMismatch) {
+		Logger::Get().Info("缓存使用的字典已失效");
+		return status;
+	}
+
+	uint32_t dictId = 0;
+	EffectCacheFile::GetDictId(compressedBuf, CACHE_VERSION, dictId);
+
+	bool success = true;
+	int duration = Utils::Measure([&]() {
+		success = Utils::ZstdDecompress(payload, result, dictId != 0 ? dict->GetDDict() : nullptr);
+	});
+	CacheTelemetry::Get().Add(CacheTelemetry::Counter::DecompressTime, duration);
+
+	if (!success) {
+		Logger::Get().Error("解压缓存失败");
+		return EffectCacheFile::Status::Corrupt;
+	}
+
+	return EffectCacheFile::Status::Ok;
+}
+
+bool EffectCacheManager::_WriteCacheFile(const std::wstring& fileName, std::span<const BYTE> data, size_t& fileSize) {
+	std::shared_ptr<const EffectCacheDict> dict = _GetDict();
+
+	std::vector<BYTE> compressedBuf;
+	EffectCacheFile::WriteHeader(compressedBuf, CACHE_VERSION, dict ? dict->GetId() : 0);
+
+	if (!Utils::ZstdCompress(data, compressedBuf, EffectCacheDict::COMPRESSION_LEVEL, dict ? dict->GetCDict() : nullptr)) {
+		Logger::Get().Error("压缩缓存失败");
+		return false;
+	}
+
+	if (!Utils::DirExists(CACHE_DIR)) {
+		if (!CreateDirectory(CACHE_DIR, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) {
+			Logger::Get().Win32Error("创建 cache 文件夹失败");
+			return false;
+		}
+	}
+
+	if (!Utils::WriteFileAtomic(fileName.c_str(), compressedBuf.data(), compressedBuf.size())) {
+		return false;
+	}
+
+	fileSize = compressedBuf.size();
+	CacheTelemetry::Get().Add(CacheTelemetry::Counter::BytesWritten, fileSize);
+	return true;
+}
+
+bool EffectCacheManager::_LoadFromDisk(const std::wstring& cacheFileName, EffectDesc& desc, size_t& fileSize, size_t& memSize) {
+	std::vector<BYTE> buf;
+	if (_ReadCacheFile(cacheFileName, buf, fileSize) != EffectCacheFile::Status::Ok) {
+		return false;
+	}
+	memSize = buf.size();
+
+	bool success = true;
+	int duration = Utils::Measure([&]() {
+		try {
+			yas::mem_istream mi(buf.data(), buf.size());
+			yas::binary_iarchive<yas::mem_istream, yas::binary> ia(mi);
+
+			ia& desc;
+		} catch (...) {
+			success = false;
+		}
+	});
+	CacheTelemetry::Get().Add(CacheTelemetry::Counter::DeserializeTime, duration);
+
+	if (!success) {
+		Logger::Get().Error("反序列化失败");
+		desc = {};
+		return false;
+	}
+
+	// 字节码单独保存
+	for (EffectPassDesc& passDesc : desc.passes) {
+		passDesc.cso = _LoadBlob(passDesc.csoHash);
+		if (!passDesc.cso) {
+			Logger::Get().Info(StrUtils::Concat("缺少着色器缓存 ", passDesc.csoHash));
+			desc = {};
+			return false;
+		}
+
+		memSize += passDesc.cso->GetBufferSize();
+	}
+
+	return true;
+}
+
 bool EffectCacheManager::Load(std::string_view effectName, std::string_view hash, EffectDesc& desc) {
 	assert(!effectName.empty() && !hash.empty());
 
-	std::wstring cacheFileName = GetCacheFileName(effectName, hash, desc.flags);
+	std::string cacheKey = GetCacheKey(effectName, hash, desc.flags);
+	std::wstring cacheFileName = GetCacheFileName(cacheKey);
+
+	CacheTelemetry& telemetry = CacheTelemetry::Get();
 
 	if (_LoadFromMemCache(cacheFileName, desc)) {
+		telemetry.Add(CacheTelemetry::Counter::MemoryHits);
+
+		std::scoped_lock lk(_indexCs);
+		_EnsureIndexLoaded();
+		_index.Touch(cacheKey);
+		for (const EffectPassDesc& passDesc : desc.passes) {
+			_index.Touch(GetBlobCacheKey(passDesc.csoHash));
+		}
 		return true;
 	}
 
 	if (!Utils::FileExists(cacheFileName.c_str())) {
+		telemetry.Add(CacheTelemetry::Counter::Misses);
 		return false;
 	}
 	
-	std::vector<BYTE> buf;
+	size_t fileSize = 0;
+	size_t memSize = 0;
+	bool success = _LoadFromDisk(cacheFileName, desc, fileSize, memSize);
+
 	{
-		std::vector<BYTE> compressedBuf;
-		if (!Utils::ReadFile(cacheFileName.c_str(), compressedBuf) || compressedBuf.empty()) {
-			return false;
-		}
-		
-		if (!Utils::ZstdDecompress(compressedBuf, buf)) {
-			Logger::Get().Error("解压缓存失败");
-			return false;
+		std::scoped_lock lk(_indexCs);
+		_EnsureIndexLoaded();
+
+		if (success) {
+			if (!_index.Touch(cacheKey)) {
+				// 索引中缺少此条目，可能由其他会话写入
+				_index.Add(cacheKey, effectName, fileSize);
+			}
+
+			for (const EffectPassDesc& passDesc : desc.passes) {
+				_index.Touch(GetBlobCacheKey(passDesc.csoHash));
+			}
+		} else {
+			// 缓存已损坏，删除以免再次读取
+			if (!DeleteFile(cacheFileName.c_str())) {
+				Logger::Get().Win32Error(StrUtils::Concat("删除缓存文件 ", cacheKey, " 失败"));
+			}
+			_index.Remove(cacheKey);
 		}
 	}
 
-	try {
-		yas::mem_istream mi(buf.data(), buf.size());
-		yas::binary_iarchive<yas::mem_istream, yas::binary> ia(mi);
-
-		ia& desc;
-	} catch (...) {
-		Logger::Get().Error("反序列化失败");
-		desc = {};
+	if (!success) {
+		telemetry.Add(CacheTelemetry::Counter::Misses);
 		return false;
 	}
 
+	telemetry.Add(CacheTelemetry::Counter::DiskHits);
 	_AddToMemCache(cacheFileName, desc);
 	
 	Logger::Get().Info(StrUtils::Concat("已读取缓存 ", StrUtils::UTF16ToUTF8(cacheFileName)));
@@ -237,125 +390,529 @@ bool EffectCacheManager::Load(std::string_view effectName, std::string_view hash
 }
 
 void EffectCacheManager::Save(std::string_view effectName, std::string_view hash, const EffectDesc& desc) {
-	std::vector<BYTE> compressedBuf;
+	std::vector<BYTE> buf;
+	buf.reserve(4096);
+
+	try {
+		yas::vector_ostream os(buf);
+		yas::binary_oarchive<yas::vector_ostream<BYTE>, yas::binary> oa(os);
+
+		oa& desc;
+	} catch (...) {
+		Logger::Get().Error("序列化失败");
+		return;
+	}
+
+	// 先保存效果引用的字节码
+	for (const EffectPassDesc& passDesc : desc.passes) {
+		_SaveBlob(passDesc.csoHash, passDesc.cso.get());
+	}
+	
+	std::string cacheKey = GetCacheKey(effectName, hash, desc.flags);
+	std::wstring cacheFileName = GetCacheFileName(cacheKey);
+	size_t fileSize = 0;
+	if (!_WriteCacheFile(cacheFileName, buf, fileSize)) {
+		Logger::Get().Error("保存缓存失败");
+	} else {
+		bool canTrainDict = false;
+		{
+			std::scoped_lock lk(_indexCs);
+			_EnsureIndexLoaded();
+			_index.Add(cacheKey, effectName, fileSize);
+			// 刚保存的缓存不会被淘汰
+			_unflushedKeys.push_back(cacheKey);
+
+			canTrainDict = _index.GetCount() >= EffectCacheDict::MIN_SAMPLES;
+		}
+
+		// 训练需读取并解压大量缓存，在后台线程中进行，完成前写入的缓存不使用字典
+		if (canTrainDict && !_GetDict() && !_isDictTrainAttempted.exchange(true)) {
+			_hDictThread = CreateThread(nullptr, 0, _TrainDictThreadProc, this, 0, nullptr);
+			if (!_hDictThread) {
+				Logger::Get().Win32Error("创建训练缓存字典的线程失败");
+			}
+		}
+	}
+
+	_AddToMemCache(cacheFileName, desc);
+
+	Logger::Get().Info(StrUtils::Concat("已保存缓存 ", StrUtils::UTF16ToUTF8(cacheFileName)));
+}
+
+winrt::com_ptr<ID3DBlob> EffectCacheManager::GetOrCompileShader(
+	const std::string& shaderHash,
+	bool useDiskCache,
+	const std::function<bool(ID3DBlob**)>& compile
+) {
+	std::promise<winrt::com_ptr<ID3DBlob>> promise;
+	std::shared_future<winrt::com_ptr<ID3DBlob>> future;
 	{
-		std::vector<BYTE> buf;
-		buf.reserve(4096);
+		std::scoped_lock lk(_blobCs);
 
-		try {
-			yas::vector_ostream os(buf);
-			yas::binary_oarchive<yas::vector_ostream<BYTE>, yas::binary> oa(os);
+		auto it = _blobCache.find(shaderHash);
+		if (it != _blobCache.end()) {
+			future = it->second;
+		} else {
+			_blobCache.emplace(shaderHash, promise.get_future().share());
+		}
+	}
 
-			oa& desc;
-		} catch (...) {
-			Logger::Get().Error("序列化失败");
-			return;
+	if (future.valid()) {
+		// 相同的着色器已经编译过或正在其他线程中编译
+		CacheTelemetry::Get().Add(CacheTelemetry::Counter::ShaderSessionHits);
+		return future.get();
+	}
+
+	winrt::com_ptr<ID3DBlob> blob;
+	if (useDiskCache) {
+		blob = _LoadBlobFromDisk(shaderHash);
+		if (blob) {
+			CacheTelemetry::Get().Add(CacheTelemetry::Counter::ShaderDiskHits);
 		}
+	}
+
+	if (!blob && !compile(blob.put())) {
+		blob = nullptr;
+	}
+
+	if (!blob) {
+		// 失败时不保留，之后可以重试
+		std::scoped_lock lk(_blobCs);
+		_blobCache.erase(shaderHash);
+	}
+
+	promise.set_value(blob);
+	return blob;
+}
+
+winrt::com_ptr<ID3DBlob> EffectCacheManager::_LoadBlob(const std::string& shaderHash) {
+	std::shared_future<winrt::com_ptr<ID3DBlob>> future;
+	{
+		std::scoped_lock lk(_blobCs);
+
+		auto it = _blobCache.find(shaderHash);
+		if (it != _blobCache.end()) {
+			future = it->second;
+		}
+	}
+
+	if (future.valid()) {
+		return future.get();
+	}
+
+	winrt::com_ptr<ID3DBlob> blob = _LoadBlobFromDisk(shaderHash);
+	if (blob) {
+		std::promise<winrt::com_ptr<ID3DBlob>> promise;
+		promise.set_value(blob);
+
+		std::scoped_lock lk(_blobCs);
+		_blobCache.try_emplace(shaderHash, promise.get_future().share());
+	}
+
+	return blob;
+}
+
+winrt::com_ptr<ID3DBlob> EffectCacheManager::_LoadBlobFromDisk(const std::string& shaderHash) {
+	std::string blobKey = GetBlobCacheKey(shaderHash);
+	std::wstring fileName = GetCacheFileName(blobKey);
+	if (!Utils::FileExists(fileName.c_str())) {
+		// 文件可能已被手动删除，移出索引以便 _SaveBlob 重新写入
+		std::scoped_lock lk(_indexCs);
+		_EnsureIndexLoaded();
+		_index.Remove(blobKey);
+		return nullptr;
+	}
+
+	std::vector<BYTE> buf;
+	size_t fileSize = 0;
+	if (_ReadCacheFile(fileName, buf, fileSize) != EffectCacheFile::Status::Ok) {
+		// 所有引用它的效果共用这个文件，不删除的话它们都将无法命中缓存
+		// 用旧字典压缩的文件同样删除，之后用当前字典重新写入
+		_DiscardCacheFile(blobKey);
+		return nullptr;
+	}
+
+	winrt::com_ptr<ID3DBlob> blob;
+	HRESULT hr = D3DCreateBlob(buf.size(), blob.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("D3DCreateBlob 失败", hr);
+		return nullptr;
+	}
+	std::memcpy(blob->GetBufferPointer(), buf.data(), buf.size());
+
+	return blob;
+}
 
-		
-		if (!Utils::ZstdCompress(buf, compressedBuf, CACHE_COMPRESSION_LEVEL)) {
-			Logger::Get().Error("压缩缓存失败");
+void EffectCacheManager::_DiscardCacheFile(const std::string& cacheKey) {
+	if (!DeleteFile(GetCacheFileName(cacheKey).c_str()) && GetLastError() != ERROR_FILE_NOT_FOUND) {
+		Logger::Get().Win32Error(StrUtils::Concat("删除缓存文件 ", cacheKey, " 失败"));
+	}
+
+	std::scoped_lock lk(_indexCs);
+	_EnsureIndexLoaded();
+	_index.Remove(cacheKey);
+}
+
+void EffectCacheManager::_SaveBlob(const std::string& shaderHash, ID3DBlob* blob) {
+	std::string blobKey = GetBlobCacheKey(shaderHash);
+	{
+		std::scoped_lock lk(_indexCs);
+		_EnsureIndexLoaded();
+		if (_index.Find(blobKey)) {
 			return;
 		}
 	}
-	
+
+	size_t fileSize = 0;
+	if (!_WriteCacheFile(GetCacheFileName(blobKey),
+		std::span((const BYTE*)blob->GetBufferPointer(), blob->GetBufferSize()), fileSize)
+	) {
+		Logger::Get().Error(StrUtils::Concat("保存着色器缓存 ", shaderHash, " 失败"));
+		return;
+	}
+
+	std::scoped_lock lk(_indexCs);
+	_index.Add(blobKey, "blob", fileSize);
+	_unflushedKeys.push_back(std::move(blobKey));
+}
+
+void EffectCacheManager::_EnsureIndexLoaded() {
+	if (_isIndexLoaded) {
+		return;
+	}
+	_isIndexLoaded = true;
+
 	if (!Utils::DirExists(CACHE_DIR)) {
-		if (!CreateDirectory(CACHE_DIR, nullptr)) {
-			Logger::Get().Win32Error("创建 cache 文件夹失败");
+		return;
+	}
+
+	if (Utils::FileExists(CACHE_INDEX_FILE_NAME)) {
+		std::vector<BYTE> buf;
+		if (Utils::ReadFile(CACHE_INDEX_FILE_NAME, buf) && _index.Deserialize(buf)) {
 			return;
 		}
+
+		Logger::Get().Error("缓存索引已损坏");
+	}
+
+	_RebuildIndex();
+}
+
+void EffectCacheManager::_RebuildIndex() {
+	// 索引不存在或已损坏，扫描一次缓存文件夹重建索引
+	_index.Clear();
+
+	WIN32_FIND_DATA findData{};
+	HANDLE hFind = Utils::SafeHandle(FindFirstFileEx(StrUtils::ConcatW(CACHE_DIR, L"\\*").c_str(),
+		FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+	if (!hFind) {
+		Logger::Get().Win32Error("查找缓存文件失败");
+		return;
+	}
+
+	do {
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			continue;
+		}
+
+		std::wstring_view fileName = findData.cFileName;
+		// 跳过索引和未完成写入的临时文件
+		if (fileName.find(L'_') == std::wstring_view::npos || fileName.ends_with(L".tmp")) {
+			continue;
+		}
+
+		std::string cacheKey = StrUtils::UTF16ToUTF8(fileName);
+		uint64_t size = ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+		_index.Add(cacheKey, EffectCacheIndex::EffectNameFromFileName(cacheKey), size);
+	} while (FindNextFile(hFind, &findData));
+
+	FindClose(hFind);
+
+	Logger::Get().Info(fmt::format("已重建缓存索引，共 {} 个缓存", _index.GetCount()));
+}
+
+void EffectCacheManager::FlushIndex() {
+	std::scoped_lock lk(_indexCs);
+
+	// 没有读写过缓存
+	if (!_isIndexLoaded || !_index.IsDirty()) {
+		return;
+	}
+
+	_SaveIndex();
+}
+
+void EffectCacheManager::_SaveIndex() {
+	if (!Utils::DirExists(CACHE_DIR)) {
+		return;
+	}
+
+	// 其他会话可能已经更新了索引
+	if (Utils::FileExists(CACHE_INDEX_FILE_NAME)) {
+		std::vector<BYTE> buf;
+		EffectCacheIndex diskIndex;
+		if (Utils::ReadFile(CACHE_INDEX_FILE_NAME, buf) && diskIndex.Deserialize(buf)) {
+			_index.Merge(diskIndex);
+		}
+	}
+
+	for (const std::string& cacheKey : _index.Evict(GetDiskBudget(), _unflushedKeys)) {
+		if (!DeleteFile(GetCacheFileName(cacheKey).c_str()) && GetLastError() != ERROR_FILE_NOT_FOUND) {
+			Logger::Get().Win32Error(StrUtils::Concat("删除缓存文件 ", cacheKey, " 失败"));
+		} else {
+			Logger::Get().Info(StrUtils::Concat("已淘汰缓存 ", cacheKey));
+		}
+	}
+
+	if (!_index.IsDirty()) {
+		return;
+	}
+
+	std::vector<BYTE> buf;
+	_index.Serialize(buf);
+	if (Utils::WriteFileAtomic(CACHE_INDEX_FILE_NAME, buf.data(), buf.size())) {
+		_index.ClearDirty();
+		_unflushedKeys.clear();
 	} else {
-		// 删除所有该效果（flags 相同）的缓存
-		std::wregex regex(fmt::format(L"^{}_{:02x}[0-9,a-f]{{{}}}$", StrUtils::UTF8ToUTF16(effectName), desc.flags,
-				Utils::Hasher::Get().GetHashLength() * 2), std::wregex::optimize | std::wregex::nosubs);
-
-		WIN32_FIND_DATA findData{};
-		HANDLE hFind = Utils::SafeHandle(FindFirstFileEx(StrUtils::ConcatW(CACHE_DIR, L"\\*").c_str(),
-			FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
-		if (hFind) {
-			do {
-				if (StrUtils::StrLen(findData.cFileName) < 8) {
-					continue;
+		Logger::Get().Error("保存缓存索引失败");
+	}
+}
+
+bool EffectCacheManager::Prewarm(UINT threadCount, uint64_t memoryBudget) {
+	if (_isShuttingDown) {
+		return false;
+	}
+
+	if (_hPrewarmThread) {
+		if (WaitForSingleObject(_hPrewarmThread, 0) == WAIT_TIMEOUT) {
+			Logger::Get().Info("上一次缓存预热尚未完成");
+			return false;
+		}
+
+		CloseHandle(_hPrewarmThread);
+		_hPrewarmThread = NULL;
+	}
+
+	_prewarmThreadCount = threadCount == 0 ? DEFAULT_PREWARM_THREAD_COUNT : threadCount;
+	_prewarmMemoryBudget = memoryBudget == 0 ? DEFAULT_PREWARM_MEMORY_BUDGET : memoryBudget;
+	_isPrewarmCancelled = false;
+
+	_hPrewarmThread = CreateThread(nullptr, 0, _PrewarmThreadProc, this, 0, nullptr);
+	if (!_hPrewarmThread) {
+		Logger::Get().Win32Error("创建缓存预热线程失败");
+		return false;
+	}
+
+	return true;
+}
+
+DWORD WINAPI EffectCacheManager::_PrewarmThreadProc(LPVOID lpThreadParameter) {
+	((EffectCacheManager*)lpThreadParameter)->_RunPrewarm();
+	return 0;
+}
+
+void EffectCacheManager::_RunPrewarm() {
+	if (!Utils::DirExists(CACHE_DIR)) {
+		return;
+	}
+
+	std::vector<std::pair<std::string, EffectCacheIndex::Entry>> entries;
+	{
+		std::scoped_lock lk(_indexCs);
+		_EnsureIndexLoaded();
+		entries = _index.GetEntriesByRecency();
+	}
+
+	// 着色器字节码不是 EffectDesc，编译时由 GetOrCompileShader 按需读取
+	std::erase_if(entries, [](const auto& entry) { return IsBlobCacheKey(entry.first); });
+
+	// 预热的缓存过多会在 _AddToMemCache 中被清理
+	if (entries.size() > MAX_CACHE_COUNT / 2) {
+		entries.resize(MAX_CACHE_COUNT / 2);
+	}
+
+	std::atomic<size_t> nextEntry = 0;
+	std::atomic<uint64_t> usedMemory = 0;
+	std::atomic<UINT> loadedCount = 0;
+
+	int duration = Utils::Measure([&]() {
+		Utils::RunParallel([&](UINT) {
+			// 后台模式同时降低 CPU 和 I/O 优先级，不会影响前台的渲染
+			// 线程池中的线程返回前必须恢复
+			bool isBackground = SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+			while (!_isPrewarmCancelled.load(std::memory_order_relaxed)
+				&& usedMemory.load(std::memory_order_relaxed) < _prewarmMemoryBudget
+			) {
+				size_t i = nextEntry.fetch_add(1, std::memory_order_relaxed);
+				if (i >= entries.size()) {
+					break;
 				}
 
-				// 正则匹配文件名
-				if (!std::regex_match(findData.cFileName, regex)) {
+				std::wstring cacheFileName = GetCacheFileName(entries[i].first);
+				if (_IsInMemCache(cacheFileName)) {
 					continue;
 				}
 
-				if (!DeleteFile(StrUtils::ConcatW(CACHE_DIR, L"\\", findData.cFileName).c_str())) {
-					Logger::Get().Win32Error(StrUtils::Concat("删除缓存文件 ",
-						StrUtils::UTF16ToUTF8(findData.cFileName), " 失败"));
+				EffectDesc desc;
+				size_t fileSize = 0;
+				size_t memSize = 0;
+				if (!_LoadFromDisk(cacheFileName, desc, fileSize, memSize)) {
+					continue;
 				}
-			} while (FindNextFile(hFind, &findData));
 
-			FindClose(hFind);
-		} else {
-			Logger::Get().Win32Error("查找缓存文件失败");
+				usedMemory.fetch_add(memSize, std::memory_order_relaxed);
+				_AddToMemCache(cacheFileName, desc);
+				loadedCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			if (isBackground) {
+				SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+			}
+		}, _prewarmThreadCount);
+	});
+
+	Logger::Get().Info(fmt::format("缓存预热完成，已读取 {} 个缓存，共 {} 字节，用时 {} 毫秒",
+		loadedCount.load(), usedMemory.load(), duration / 1000.0f));
+}
+
+std::shared_ptr<const EffectCacheDict> EffectCacheManager::_GetDict() {
+	std::scoped_lock lk(_dictCs);
+
+	if (!_isDictLoaded) {
+		_isDictLoaded = true;
+
+		if (Utils::FileExists(CACHE_DICT_FILE_NAME)) {
+			std::vector<BYTE> buf;
+			if (Utils::ReadFile(CACHE_DICT_FILE_NAME, buf)) {
+				_dict = EffectCacheDict::Create(buf);
+			}
+
+			if (!_dict) {
+				Logger::Get().Error("加载缓存字典失败");
+			}
 		}
 	}
 	
-	std::wstring cacheFileName = GetCacheFileName(effectName, hash, desc.flags);
-	if (!Utils::WriteFile(cacheFileName.c_str(), compressedBuf.data(), compressedBuf.size())) {
-		Logger::Get().Error("保存缓存失败");
+	return _dict;
+}
+
+DWORD WINAPI EffectCacheManager::_TrainDictThreadProc(LPVOID lpThreadParameter) {
+	// 同时降低 CPU 和 I/O 优先级，不会影响前台的渲染
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+	((EffectCacheManager*)lpThreadParameter)->_TrainDict();
+	return 0;
+}
+
+void EffectCacheManager::_TrainDict() {
+	std::vector<std::pair<std::string, EffectCacheIndex::Entry>> entries;
+	{
+		std::scoped_lock lk(_indexCs);
+		_EnsureIndexLoaded();
+		entries = _index.GetEntriesByRecency();
 	}
 
-	_AddToMemCache(cacheFileName, desc);
+	// 使用最近使用的缓存作为样本，所有样本首尾相连
+	std::vector<BYTE> samples;
+	std::vector<size_t> sampleSizes;
+	for (const auto& [cacheKey, entry] : entries) {
+		if (_isShuttingDown.load(std::memory_order_relaxed)) {
+			return;
+		}
 
-	Logger::Get().Info(StrUtils::Concat("已保存缓存 ", StrUtils::UTF16ToUTF8(cacheFileName)));
-}
+		if (samples.size() >= EffectCacheDict::MAX_SAMPLES_SIZE) {
+			break;
+		}
 
-std::string EffectCacheManager::GetHash(
-	std::string_view source,
-	const std::map<std::string, std::variant<float, int>>* inlineParams
-) {
-	std::string str;
-	str.reserve(source.size() + 128);
-	str = source;
+		std::vector<BYTE> compressedBuf;
+		std::span<const BYTE> payload;
+		// 只使用没有用字典压缩的缓存
+		if (!Utils::ReadFile(GetCacheFileName(cacheKey).c_str(), compressedBuf)
+			|| EffectCacheFile::Check(compressedBuf, CACHE_VERSION, 0, payload) != EffectCacheFile::Status::Ok) {
+			continue;
+		}
 
-	str.append(fmt::format("CACHE_VERSION:{}\n", CACHE_VERSION));
-	if (inlineParams) {
-		for (const auto& pair : *inlineParams) {
-			if (pair.second.index() == 0) {
-				str.append(fmt::format("{}:{}\n", pair.first, std::get<0>(pair.second)));
-			} else {
-				str.append(fmt::format("{}:{}\n", pair.first, std::get<1>(pair.second)));
-			}
+		std::vector<BYTE> sample;
+		if (!Utils::ZstdDecompress(payload, sample)) {
+			continue;
 		}
+
+		samples.insert(samples.end(), sample.begin(), sample.end());
+		sampleSizes.push_back(sample.size());
+	}
+
+	if (sampleSizes.size() < EffectCacheDict::MIN_SAMPLES) {
+		return;
+	}
+
+	std::vector<BYTE> dictBuf;
+	const char* error = "";
+	int duration = Utils::Measure([&]() {
+		dictBuf = EffectCacheDict::Train(samples, sampleSizes, error);
+	});
+	if (dictBuf.empty()) {
+		Logger::Get().Error(StrUtils::Concat("训练缓存字典失败：", error));
+		return;
 	}
 
-	std::vector<BYTE> hashBytes;
-	if (!Utils::Hasher::Get().Hash(std::span((const BYTE*)source.data(), source.size()), hashBytes)) {
-		Logger::Get().Error("计算 hash 失败");
-		return "";
+	std::shared_ptr<const EffectCacheDict> dict = EffectCacheDict::Create(dictBuf);
+	if (!dict) {
+		Logger::Get().Error("创建缓存字典失败");
+		return;
 	}
 
-	return Utils::Bin2Hex(hashBytes);
+	std::scoped_lock lk(_dictCs);
+
+	if (_isShuttingDown.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	// 其他会话可能已经写入了字典，此时沿用它，以免使它写入的缓存失效
+	if (Utils::FileExists(CACHE_DICT_FILE_NAME)) {
+		_isDictLoaded = false;
+		return;
+	}
+
+	if (!Utils::WriteFileAtomic(CACHE_DICT_FILE_NAME, dictBuf.data(), dictBuf.size())) {
+		Logger::Get().Error("保存缓存字典失败");
+		return;
+	}
+
+	// 之后写入的缓存使用新字典，正在读写缓存的线程持有旧的 shared_ptr，不受影响
+	_dict = std::move(dict);
+	_isDictLoaded = true;
+
+	Logger::Get().Info(fmt::format("已训练缓存字典，ID：{}，大小：{}，样本数：{}，用时 {} 毫秒",
+		_dict->GetId(), dictBuf.size(), sampleSizes.size(), duration / 1000.0f));
+}
+
+std::string EffectCacheManager::GetShaderHash(std::string_view preprocessedSource, UINT compileFlags) {
+	return Utils::Bin2Hex(ShaderHash::Compute(preprocessedSource, CACHE_VERSION, compileFlags));
 }
 
-std::string EffectCacheManager::GetHash(std::string& source, const std::map<std::string, std::variant<float, int>>* inlineParams) {
-	size_t originSize = source.size();
+std::string EffectCacheManager::GetHash(
+	std::string_view source,
+	UINT flags,
+	const std::map<std::string, std::variant<float, int>>* inlineParams
+) {
+	Utils::Hasher hasher;
 
-	source.reserve(originSize + 128);
+	hasher.Update(source);
+	hasher.UpdateValue(CACHE_VERSION);
+	hasher.UpdateValue(flags);
 
-	source.append(fmt::format("CACHE_VERSION:{}\n", CACHE_VERSION));
 	if (inlineParams) {
+		hasher.UpdateValue((uint64_t)inlineParams->size());
 		for (const auto& pair : *inlineParams) {
+			hasher.Update(pair.first);
+			hasher.UpdateValue((UINT)pair.second.index());
 			if (pair.second.index() == 0) {
-				source.append(fmt::format("{}:{}\n", pair.first, std::get<0>(pair.second)));
+				hasher.UpdateValue(std::get<0>(pair.second));
 			} else {
-				source.append(fmt::format("{}:{}\n", pair.first, std::get<1>(pair.second)));
+				hasher.UpdateValue(std::get<1>(pair.second));
 			}
 		}
 	}
 
-	std::vector<BYTE> hashBytes;
-	bool success = Utils::Hasher::Get().Hash(std::span((const BYTE*)source.data(), source.size()), hashBytes);
-	if (!success) {
-		Logger::Get().Error("计算 hash 失败");
-	}
-
-	source.resize(originSize);
-
-	return success ? Utils::Bin2Hex(hashBytes) : "";
+	return Utils::Bin2Hex(hasher.Digest());
 }
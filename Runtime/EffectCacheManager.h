@@ -2,6 +2,10 @@
 #include "pch.h"
 #include "Utils.h"
 #include "EffectDesc.h"
+#include "EffectCacheIndex.h"
+#include "EffectCacheDict.h"
+#include "EffectCacheFile.h"
+#include <future>
 
 
 class EffectCacheManager {
@@ -11,28 +15,129 @@ public:
 		return instance;
 	}
 
+	~EffectCacheManager();
+
 	bool Load(std::string_view effectName, std::string_view hash, EffectDesc& desc);
 
 	void Save(std::string_view effectName, std::string_view hash, const EffectDesc& desc);
 
+	// 磁盘缓存的总大小上限，单位为字节。超出时按 LRU 顺序删除缓存文件
+	void SetDiskBudget(uint64_t budget) noexcept {
+		_diskBudget.store(budget, std::memory_order_relaxed);
+	}
+
+	uint64_t GetDiskBudget() const noexcept {
+		return _diskBudget.load(std::memory_order_relaxed);
+	}
+
+	static constexpr uint64_t DEFAULT_DISK_BUDGET = 128 * 1024 * 1024;
+
+	// 在低优先级的后台线程中将最近使用的磁盘缓存解压到内存缓存中
+	// 之后进入全屏时常用的效果无需读取磁盘
+	// threadCount 和 memoryBudget（单位为字节）为 0 时使用默认值
+	// 上一次预热尚未完成时返回 false
+	bool Prewarm(UINT threadCount = 0, uint64_t memoryBudget = 0);
+
+	static constexpr UINT DEFAULT_PREWARM_THREAD_COUNT = 1;
+
+	static constexpr uint64_t DEFAULT_PREWARM_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+	// 读写缓存时只更新内存中的索引，调用此函数才合并磁盘上的索引、淘汰超出预算的缓存并写回
+	// 编译完一条效果链后调用一次，避免每次命中缓存都重写索引文件
+	void FlushIndex();
+
+	// 取消预热和字典训练并等待后台线程退出，然后写回索引。之后不再启动后台线程
+	// 应在卸载 DLL 前调用，析构时可能持有加载器锁，无法安全地等待线程
+	void Shutdown();
+
+	// 着色器字节码按哈希保存，同一会话中相同的着色器只编译一次
+	// 缓存未命中时调用 compile 编译，失败返回空
+	// useDiskCache 为 false 时不读取磁盘，但仍在会话中共享字节码
+	winrt::com_ptr<ID3DBlob> GetOrCompileShader(
+		const std::string& shaderHash,
+		bool useDiskCache,
+		const std::function<bool(ID3DBlob**)>& compile
+	);
+
+	// 预处理后的源码和编译标志的哈希，用作着色器字节码的键，见 ShaderHash
+	static std::string GetShaderHash(std::string_view preprocessedSource, UINT compileFlags);
+
+	// 流式计算源码、缓存版本、标志位和内联变量的哈希，不会拼接或复制 source
 	// inlineParams 为内联变量，可以为空
-	// 接受 std::string& 的重载速度更快，且保证不修改 source
 	static std::string GetHash(
 		std::string_view source,
-		const std::map<std::string, std::variant<float, int>>* inlineParams = nullptr
-	);
-	static std::string GetHash(
-		std::string& source,
+		UINT flags,
 		const std::map<std::string, std::variant<float, int>>* inlineParams = nullptr
 	);
 
 private:
 	void _AddToMemCache(const std::wstring& cacheFileName, const EffectDesc& desc);
 	bool _LoadFromMemCache(const std::wstring& cacheFileName, EffectDesc& desc);
+	bool _IsInMemCache(const std::wstring& cacheFileName);
+
+	// 读写缓存文件，包括文件头和压缩。读取失败或解压失败视为文件损坏
+	EffectCacheFile::Status _ReadCacheFile(const std::wstring& fileName, std::vector<BYTE>& result, size_t& fileSize);
+	bool _WriteCacheFile(const std::wstring& fileName, std::span<const BYTE> data, size_t& fileSize);
+
+	// 先查找本会话中的字节码，然后从磁盘读取
+	winrt::com_ptr<ID3DBlob> _LoadBlob(const std::string& shaderHash);
+	winrt::com_ptr<ID3DBlob> _LoadBlobFromDisk(const std::string& shaderHash);
+	// 索引中已存在时不重复写入，因此读取失败的字节码必须通过 _DiscardCacheFile 移出索引
+	void _SaveBlob(const std::string& shaderHash, ID3DBlob* blob);
+	// 删除缓存文件并移出索引，调用前不能持有 _indexCs
+	void _DiscardCacheFile(const std::string& cacheKey);
+
+	// 用于同步对 _blobCache 的访问
+	Utils::CSMutex _blobCs;
+	// 着色器哈希 -> 字节码，正在编译的着色器也在其中
+	std::unordered_map<std::string, std::shared_future<winrt::com_ptr<ID3DBlob>>> _blobCache;
+
+	// 读取、解压并反序列化缓存文件，不更新索引和内存缓存
+	// fileSize 为缓存文件的大小，memSize 为解压后的大小
+	bool _LoadFromDisk(const std::wstring& cacheFileName, EffectDesc& desc, size_t& fileSize, size_t& memSize);
+
+	static DWORD WINAPI _PrewarmThreadProc(LPVOID lpThreadParameter);
+	void _RunPrewarm();
 
 	// 用于同步对 _memCache 的访问
 	Utils::CSMutex _cs;
 	// cacheFileName -> (EffectDesc, lastAccess)
 	std::unordered_map<std::wstring, std::pair<EffectDesc, UINT>> _memCache;
 	UINT _lastAccess = 0;
+
+	// 以下函数调用前需获取 _indexCs
+	void _EnsureIndexLoaded();
+	void _RebuildIndex();
+	// 合并磁盘上的索引，淘汰超出预算的缓存，然后写回磁盘
+	void _SaveIndex();
+
+	std::shared_ptr<const EffectCacheDict> _GetDict();
+
+	static DWORD WINAPI _TrainDictThreadProc(LPVOID lpThreadParameter);
+	// 从已有的缓存训练字典，每个会话最多尝试一次，在后台线程中执行
+	void _TrainDict();
+
+	// 用于同步对 _dict 的访问
+	Utils::CSMutex _dictCs;
+	std::shared_ptr<const EffectCacheDict> _dict;
+	bool _isDictLoaded = false;
+	std::atomic<bool> _isDictTrainAttempted = false;
+
+	// 用于同步对 _index 的访问，读写缓存文件时不持有
+	Utils::CSMutex _indexCs;
+	// 键为缓存文件名（不含路径）
+	EffectCacheIndex _index;
+	// 上次写回索引后保存的缓存，写回时不会被淘汰
+	std::vector<std::string> _unflushedKeys;
+	bool _isIndexLoaded = false;
+
+	std::atomic<uint64_t> _diskBudget = DEFAULT_DISK_BUDGET;
+
+	HANDLE _hDictThread = NULL;
+
+	HANDLE _hPrewarmThread = NULL;
+	UINT _prewarmThreadCount = DEFAULT_PREWARM_THREAD_COUNT;
+	uint64_t _prewarmMemoryBudget = DEFAULT_PREWARM_MEMORY_BUDGET;
+	std::atomic<bool> _isPrewarmCancelled = false;
+	std::atomic<bool> _isShuttingDown = false;
 };
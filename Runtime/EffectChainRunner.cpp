@@ -0,0 +1,249 @@
+#include "EffectChainRunner.h"
+#include <algorithm>
+#include <cstring>
+
+
+EffectChainRunner::~EffectChainRunner() {
+	_Release();
+}
+
+bool EffectChainRunner::Initialize(ComputeDevice& device, const Desc& desc) {
+	_Release();
+	_device = &device;
+	_error = "";
+
+	if (desc.kernels.size() != desc.passes.size()) {
+		return _Fail("内核的数量和通道不符");
+	}
+	if (desc.textures.size() < 2) {
+		return _Fail("效果至少需要 INPUT 和 OUTPUT");
+	}
+
+	std::vector<EffectPassPlan::Size> texSizes(desc.textures.size());
+	for (size_t i = 0; i < desc.textures.size(); ++i) {
+		texSizes[i] = desc.textures[i].size;
+	}
+
+	if (!_passPlan.Build(desc.passes, texSizes, texSizes.back(), (uint32_t)desc.samplers.size())) {
+		return _Fail(_passPlan.GetError());
+	}
+
+	_kernels = desc.kernels;
+
+	_textures.reserve(desc.textures.size());
+	for (const TextureDesc& texDesc : desc.textures) {
+		const ComputeDevice::Handle texture = _device->CreateTexture(texDesc.size.width, texDesc.size.height, texDesc.format);
+		if (texture == ComputeDevice::INVALID_HANDLE) {
+			return _Fail(_device->GetError());
+		}
+		_textures.push_back(texture);
+	}
+
+	_samplers.reserve(desc.samplers.size());
+	for (const SamplerDesc& samDesc : desc.samplers) {
+		const ComputeDevice::Handle sampler = _device->CreateSampler(samDesc.filter, samDesc.address);
+		if (sampler == ComputeDevice::INVALID_HANDLE) {
+			return _Fail(_device->GetError());
+		}
+		_samplers.push_back(sampler);
+	}
+
+	return _CreateConstantBuffers(desc) && _CreateBindings();
+}
+
+bool EffectChainRunner::Run(bool isProfiling) {
+	if (!_device || _bindings.empty()) {
+		return _Fail("尚未初始化");
+	}
+
+	// cbuffer __CB1 : register(b0) {
+	//     uint2 __cursorPos;
+	//     uint __frameCount;
+	// };
+	// 没有光标
+	const std::array<uint32_t, 4> dynamicConstants{ 0, 0, ++_frameCount, 0 };
+	if (!_device->UpdateConstantBuffer(_constantBuffers[0], dynamicConstants.data(), (uint32_t)sizeof(dynamicConstants))) {
+		return _Fail(_device->GetError());
+	}
+
+	if (isProfiling) {
+		_device->WriteTimestamp();
+	}
+
+	const std::vector<EffectPassPlan::Pass>& passes = _passPlan.GetPasses();
+	for (size_t i = 0; i < passes.size(); ++i) {
+		if (!_device->Dispatch(_kernels[i], passes[i], _bindings[i], {}, passes[i].groups)) {
+			return _Fail(_device->GetError());
+		}
+
+		if (isProfiling) {
+			_device->WriteTimestamp();
+		}
+	}
+
+	if (isProfiling) {
+		++_profiledRuns;
+	}
+
+	return true;
+}
+
+bool EffectChainRunner::GetPassTimes(std::vector<double>& passTimes) {
+	if (!_device) {
+		return _Fail("尚未初始化");
+	}
+
+	std::vector<uint64_t> timestamps;
+	const bool success = _device->ResolveTimestamps(timestamps);
+	const uint32_t runCount = _profiledRuns;
+	_profiledRuns = 0;
+
+	if (!success) {
+		return _Fail(_device->GetError());
+	}
+
+	// 每次执行记录通道数 + 1 个时间戳
+	const size_t passCount = _passPlan.GetPasses().size();
+	if (runCount == 0 || timestamps.size() != runCount * (passCount + 1)) {
+		return _Fail("时间戳的数量和执行次数不符");
+	}
+
+	passTimes.assign(passCount, 0.0);
+	for (uint32_t run = 0; run < runCount; ++run) {
+		const uint64_t* runTimestamps = timestamps.data() + run * (passCount + 1);
+		for (size_t i = 0; i < passCount; ++i) {
+			// 时间戳不一定单调，如 GPU 频率改变
+			if (runTimestamps[i + 1] >= runTimestamps[i]) {
+				passTimes[i] += double(runTimestamps[i + 1] - runTimestamps[i]);
+			}
+		}
+	}
+
+	// 纳秒转换为毫秒
+	for (double& time : passTimes) {
+		time /= runCount * 1e6;
+	}
+
+	return true;
+}
+
+bool EffectChainRunner::_CreateConstantBuffers(const Desc& desc) {
+	// cbuffer __CB2 : register(b1) {
+	//     uint2 __inputSize;
+	//     uint2 __outputSize;
+	//     float2 __inputPt;
+	//     float2 __outputPt;
+	//     float2 __scale;
+	//     int2 __viewport;
+	//     [PARAMETERS...]
+	// };
+	const EffectPassPlan::Size inputSize = desc.textures.front().size;
+	const EffectPassPlan::Size outputSize = desc.textures.back().size;
+
+	const float floatConstants[] = {
+		1.0f / inputSize.width,
+		1.0f / inputSize.height,
+		1.0f / outputSize.width,
+		1.0f / outputSize.height,
+		outputSize.width / (float)inputSize.width,
+		outputSize.height / (float)inputSize.height
+	};
+
+	// 大小必须为 4 的倍数
+	std::vector<uint32_t> constants((BUILTIN_CONSTANT_COUNT + desc.constants.size() + 3) / 4 * 4);
+	constants[0] = inputSize.width;
+	constants[1] = inputSize.height;
+	constants[2] = outputSize.width;
+	constants[3] = outputSize.height;
+	std::memcpy(&constants[4], floatConstants, sizeof(floatConstants));
+	// 整个输出都是视口
+	constants[10] = outputSize.width;
+	constants[11] = outputSize.height;
+	std::copy(desc.constants.begin(), desc.constants.end(), constants.begin() + BUILTIN_CONSTANT_COUNT);
+
+	// __CB1 和 __CB3 只有 4 个 uint
+	const uint32_t byteSizes[] = { 16, uint32_t(constants.size() * 4), 16 };
+	for (uint32_t i = 0; i < EffectPassPlan::CONSTANT_BUFFER_COUNT; ++i) {
+		_constantBuffers[i] = _device->CreateConstantBuffer(byteSizes[i]);
+		if (_constantBuffers[i] == ComputeDevice::INVALID_HANDLE) {
+			return _Fail(_device->GetError());
+		}
+	}
+
+	if (!_device->UpdateConstantBuffer(_constantBuffers[1], constants.data(), byteSizes[1])) {
+		return _Fail(_device->GetError());
+	}
+
+	return true;
+}
+
+bool EffectChainRunner::_CreateBindings() {
+	const std::vector<EffectPassPlan::Pass>& passes = _passPlan.GetPasses();
+	_bindings.resize(passes.size());
+
+	for (size_t i = 0; i < passes.size(); ++i) {
+		const EffectPassPlan::Pass& pass = passes[i];
+		_bindings[i].resize(pass.bindings.size());
+
+		for (size_t j = 0; j < pass.bindings.size(); ++j) {
+			const EffectPassPlan::Binding& binding = pass.bindings[j];
+			ComputeDevice::Handle& handle = _bindings[i][j];
+
+			switch (binding.type) {
+			case EffectPassPlan::BindingType::ConstantBuffer:
+				handle = _constantBuffers[binding.resource];
+				break;
+			case EffectPassPlan::BindingType::Sampler:
+				handle = _samplers[binding.resource];
+				break;
+			case EffectPassPlan::BindingType::SampledTexture:
+			case EffectPassPlan::BindingType::StorageTexture:
+				handle = _device->CreateView(
+					_textures[binding.resource],
+					binding.type == EffectPassPlan::BindingType::SampledTexture
+						? ComputeDevice::ViewType::ShaderResource : ComputeDevice::ViewType::UnorderedAccess
+				);
+				if (handle == ComputeDevice::INVALID_HANDLE) {
+					_bindings.clear();
+					return _Fail(_device->GetError());
+				}
+				_views.push_back(handle);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+void EffectChainRunner::_Release() noexcept {
+	if (!_device) {
+		return;
+	}
+
+	// 先释放视图再释放纹理
+	for (ComputeDevice::Handle view : _views) {
+		_device->Release(view);
+	}
+	for (ComputeDevice::Handle texture : _textures) {
+		_device->Release(texture);
+	}
+	for (ComputeDevice::Handle sampler : _samplers) {
+		_device->Release(sampler);
+	}
+	for (ComputeDevice::Handle buffer : _constantBuffers) {
+		if (buffer != ComputeDevice::INVALID_HANDLE) {
+			_device->Release(buffer);
+		}
+	}
+
+	_views.clear();
+	_textures.clear();
+	_samplers.clear();
+	_constantBuffers = {};
+	_bindings.clear();
+	_kernels.clear();
+	_frameCount = 0;
+	_profiledRuns = 0;
+	_device = nullptr;
+}
@@ -0,0 +1,95 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include "ComputeDevice.h"
+
+
+// 在任意 ComputeDevice 上完整执行一个效果的所有通道，用于没有 D3D11 的环境中批量处理和测量性能
+// 负责创建纹理、视图、采样器和常量缓冲区并按顺序调度，着色器由后端编译并注册，和通道一一对应
+// 常量缓冲区的布局和 EffectDrawer 相同，但没有 __offset，因此不能执行带有 EFFECT_FLAG_LAST_EFFECT 的效果
+class EffectChainRunner {
+public:
+	struct TextureDesc {
+		EffectPassPlan::Size size;
+		// 取值和 DXGI_FORMAT 相同
+		uint32_t format = 0;
+	};
+
+	struct SamplerDesc {
+		ComputeDevice::SamplerFilter filter = ComputeDevice::SamplerFilter::Linear;
+		ComputeDevice::SamplerAddress address = ComputeDevice::SamplerAddress::Clamp;
+	};
+
+	struct Desc {
+		// 第一个为 INPUT，最后一个为 OUTPUT，和 EffectDesc::textures 的顺序相同
+		std::vector<TextureDesc> textures;
+		std::vector<SamplerDesc> samplers;
+		std::vector<EffectPassPlan::PassDesc> passes;
+		// 和 passes 一一对应
+		std::vector<ComputeDevice::Handle> kernels;
+		// __CB2 中内置常量之后的部分，即 PS 样式通道的输出尺寸和效果的参数
+		std::vector<uint32_t> constants;
+	};
+
+	EffectChainRunner() = default;
+	EffectChainRunner(const EffectChainRunner&) = delete;
+	EffectChainRunner(EffectChainRunner&&) = delete;
+
+	// 释放创建的资源，device 必须仍然有效
+	~EffectChainRunner();
+
+	// 失败时 GetError 返回原因，已创建的资源在析构时释放
+	bool Initialize(ComputeDevice& device, const Desc& desc);
+
+	// 完整执行一次所有通道，每次执行前递增 __frameCount。isProfiling 为真时在每个通道前后记录时间戳
+	bool Run(bool isProfiling = false);
+
+	// 取回之前 isProfiling 为真的所有执行的时间戳，passTimes 为每个通道的平均用时，单位为毫秒
+	bool GetPassTimes(std::vector<double>& passTimes);
+
+	// 纹理的句柄，顺序和 Desc::textures 相同，用于写入输入和读取输出
+	ComputeDevice::Handle GetTexture(uint32_t idx) const noexcept {
+		return idx < _textures.size() ? _textures[idx] : ComputeDevice::INVALID_HANDLE;
+	}
+
+	const EffectPassPlan& GetPassPlan() const noexcept {
+		return _passPlan;
+	}
+
+	const char* GetError() const noexcept {
+		return _error;
+	}
+
+	// __CB2 中内置常量的数量，效果的参数从这里开始
+	static constexpr uint32_t BUILTIN_CONSTANT_COUNT = 12;
+
+private:
+	bool _Fail(const char* error) noexcept {
+		_error = error;
+		return false;
+	}
+
+	bool _CreateConstantBuffers(const Desc& desc);
+
+	bool _CreateBindings();
+
+	void _Release() noexcept;
+
+	ComputeDevice* _device = nullptr;
+	EffectPassPlan _passPlan;
+	std::vector<ComputeDevice::Handle> _kernels;
+
+	std::vector<ComputeDevice::Handle> _textures;
+	std::vector<ComputeDevice::Handle> _samplers;
+	// __CB1、__CB2、__CB3
+	std::array<ComputeDevice::Handle, EffectPassPlan::CONSTANT_BUFFER_COUNT> _constantBuffers{};
+	// 和 _passPlan 中各通道的 bindings 一一对应
+	std::vector<std::vector<ComputeDevice::Handle>> _bindings;
+	// 所有视图，析构时释放
+	std::vector<ComputeDevice::Handle> _views;
+
+	uint32_t _frameCount = 0;
+	// 记录了时间戳但尚未取回的执行次数
+	uint32_t _profiledRuns = 0;
+
+	const char* _error = "";
+};
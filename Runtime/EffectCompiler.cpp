@@ -5,6 +5,7 @@
 #include <bitset>
 #include <charconv>
 #include "EffectCacheManager.h"
+#include "CacheTelemetry.h"
 #include "StrUtils.h"
 #include "App.h"
 #include "DeviceResources.h"
@@ -772,7 +773,7 @@ UINT ResolvePasses(
 	EffectDesc& desc
 ) {
 	// 必选项：IN
-	// 可选项：OUT, BLOCK_SIZE, NUM_THREADS, STYLE
+	// 可选项：OUT, BLOCK_SIZE, NUM_THREADS, STYLE, DESC, HALO
 	// STYLE 为 PS 时不能有 BLOCK_SIZE 或 NUM_THREADS
 
 	std::string_view token;
@@ -833,7 +834,7 @@ UINT ResolvePasses(
 			texNames.emplace(desc.textures[i].name, (UINT)i);
 		}
 
-		std::bitset<6> processed;
+		std::bitset<7> processed;
 
 		while (true) {
 			if (!CheckNextToken<true>(block, META_INDICATOR)) {
@@ -1005,6 +1006,22 @@ UINT ResolvePasses(
 
 				StrUtils::Trim(val);
 				passDesc.desc = val;
+			} else if (t == "HALO") {
+				if (processed[6]) {
+					return 1;
+				}
+				processed[6] = true;
+
+				UINT num;
+				if (GetNextNumber(block, num)) {
+					return 1;
+				}
+
+				if (GetNextToken<false>(block, token) != 2) {
+					return 1;
+				}
+
+				passDesc.halo = (int)num;
 			} else {
 				return 1;
 			}
@@ -1070,10 +1087,6 @@ UINT GeneratePassSource(
 		result.append(fmt::format("Texture2D<{}> {} : register(t{});\n", EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].srvTexelType, texDesc.name, i));
 	}
 
-	if (isLastEffect && isLastPass) {
-		result.append(fmt::format("Texture2D<float4> __CURSOR : register(t{});\n", passDesc.inputs.size()));
-	}
-
 	// UAV
 	if (passDesc.outputs.empty()) {
 		if (!isLastPass) {
@@ -1099,11 +1112,6 @@ UINT GeneratePassSource(
 		}
 	}
 
-	if (isLastEffect) {
-		// 绘制光标使用的采样器
-		result.append(fmt::format("SamplerState __CURSOR_SAMPLER : register(s{});\n", desc.samplers.size()));
-	}
-
 	result.push_back('\n');
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1211,37 +1219,8 @@ UINT GeneratePassSource(
 		result.append("bool CheckViewport(int2 pos) { return pos.x < __viewport.x && pos.y < __viewport.y; }\n");
 
 		if (isLastEffect) {
-			// 255.001953 的由来见 https://stackoverflow.com/questions/52103720/why-does-d3dcolortoubyte4-multiplies-components-by-255-001953f
-			result.append(R"(void WriteToOutput(uint2 pos, float3 color) {
-	color = saturate(color);
-	pos += __offset.zw;
-	if ((int)pos.x >= __cursorRect.x && (int)pos.y >= __cursorRect.y && (int)pos.x < __cursorRect.z && (int)pos.y < __cursorRect.w) {
-		float4 mask = __CURSOR.SampleLevel(__CURSOR_SAMPLER, (pos - __cursorRect.xy + 0.5f) * __cursorPt, 0);
-		if (__cursorType == 0){
-			color = color * mask.a + mask.rgb;
-		} else if (__cursorType == 1) {
-			if (mask.a < 0.5f){
-				color = mask.rgb;
-			} else {
-				color = (uint3(round(color * 255.0f)) ^ uint3(mask.rgb * 255.001953f)) / 255.0f;
-			}
-		} else {
-			if( mask.x > 0.5f) {
-				if (mask.y > 0.5f) {
-					color = 1 - color;
-				}
-			} else {
-				if (mask.y > 0.5f) {
-					color = float3(1, 1, 1);
-				} else {
-					color = float3(0, 0, 0);
-				}
-			}
-		}
-	}
-	__OUTPUT[pos] = float4(color, 1);
-}
-)");
+			// 光标由 CursorDrawer 在单独的通道中绘制
+			result.append("#define WriteToOutput(pos,color) __OUTPUT[(pos) + __offset.zw] = float4(saturate(color), 1)\n");
 		} else {
 			result.append("#define WriteToOutput(pos,color) __OUTPUT[pos] = float4(color, 1)\n");
 		}
@@ -1289,7 +1268,7 @@ uint2 GetCursorPos() { return __cursorPos; }
 			if (isLastPass) {
 				result.append(fmt::format(R"([numthreads(64, 1, 1)]
 void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
-	uint2 gxy = Rmp8x8(tid.x) + (gid.xy << 4u){0};
+	uint2 gxy = Rmp8x8(tid.x) + ((gid.xy + __blockOffset) << 4u){0};
 	float2 pos = (gxy + 0.5f) * __outputPt;
 	float2 step = 8 * __outputPt;
 	
@@ -1321,7 +1300,7 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 			} else {
 				result.append(fmt::format(R"([numthreads(64, 1, 1)]
 void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
-	uint2 gxy = Rmp8x8(tid.x) + (gid.xy << 4u);
+	uint2 gxy = Rmp8x8(tid.x) + ((gid.xy + __blockOffset) << 4u);
 	if (gxy.x >= __pass{0}OutputSize.x || gxy.y >= __pass{0}OutputSize.y) {{
 		return;
 	}}
@@ -1358,7 +1337,7 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 
 			result.append(fmt::format(R"([numthreads(64, 1, 1)]
 void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
-	uint2 gxy = Rmp8x8(tid.x) + (gid.xy << 4u);
+	uint2 gxy = Rmp8x8(tid.x) + ((gid.xy + __blockOffset) << 4u);
 	if (gxy.x >= __pass{0}OutputSize.x || gxy.y >= __pass{0}OutputSize.y) {{
 		return;
 	}}
@@ -1407,9 +1386,9 @@ void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {{
 		std::string blockStartExpr;
 		if (passDesc.blockSize.first == passDesc.blockSize.second && std::has_single_bit(passDesc.blockSize.first)) {
 			UINT nShift = std::lroundf(std::log2f((float)passDesc.blockSize.first));
-			blockStartExpr = fmt::format("(gid.xy << {})", nShift);
+			blockStartExpr = fmt::format("((gid.xy + __blockOffset) << {})", nShift);
 		} else {
-			blockStartExpr = fmt::format("gid.xy * uint2({}, {})", passDesc.blockSize.first, passDesc.blockSize.second);
+			blockStartExpr = fmt::format("(gid.xy + __blockOffset) * uint2({}, {})", passDesc.blockSize.first, passDesc.blockSize.second);
 		}
 
 		result.append(fmt::format(R"([numthreads({}, {}, {})]
@@ -1435,10 +1414,7 @@ UINT CompilePasses(
 	////////////////////////////////////////////////////////////////////////////////////////////////////////
 	
 	std::string cbHlsl = R"(cbuffer __CB1 : register(b0) {
-	int4 __cursorRect;
-	float2 __cursorPt;
 	uint2 __cursorPos;
-	uint __cursorType;
 	uint __frameCount;
 };
 cbuffer __CB2 : register(b1) {
@@ -1472,7 +1448,10 @@ cbuffer __CB2 : register(b1) {
 		}
 	}
 
-	cbHlsl.append("};\n\n");
+	cbHlsl.append("};\n");
+
+	// 只更新部分区域时 Dispatch 的起始线程组
+	cbHlsl.append("cbuffer __CB3 : register(b2) {\n\tuint2 __blockOffset;\n};\n\n");
 
 	if (App::Get().GetConfig().IsSaveEffectSources() && !Utils::DirExists(SAVE_SOURCE_DIR)) {
 		if (!CreateDirectory(SAVE_SOURCE_DIR, nullptr)) {
@@ -1480,8 +1459,11 @@ cbuffer __CB2 : register(b1) {
 		}
 	}
 
-	// 并行生成代码和编译
+	// 并行生成代码和编译，编译时需要读取当前会话的配置
+	ScalingSession* session = &App::Get().GetSession();
 	Utils::RunParallel([&](UINT id) {
+		App::SessionScope scope(session);
+
 		std::string source;
 		std::vector<std::pair<std::string, std::string>> macros;
 		if (GeneratePassSource(desc, id + 1, cbHlsl, commonBlocks, passBlocks[id], inlineParams, source, macros)) {
@@ -1501,9 +1483,38 @@ cbuffer __CB2 : register(b1) {
 
 		static PassInclude passInclude;
 
-		if (!App::Get().GetDeviceResources().CompileShader(source, "__M", desc.passes[id].cso.put(),
-			fmt::format("{}_Pass{}.hlsl", desc.name, id + 1).c_str(), &passInclude, macros)
-		) {
+		std::string sourceName = fmt::format("{}_Pass{}.hlsl", desc.name, id + 1);
+
+		// 不同效果（或同一效果的不同变体）可能生成相同的通道
+		// 因此以预处理后的源码为键缓存字节码
+		std::string preprocessed;
+		bool success = true;
+		int duration = Utils::Measure([&]() {
+			success = DeviceResources::PreprocessShader(source, preprocessed, sourceName.c_str(), &passInclude, macros);
+		});
+		CacheTelemetry::Get().Add(CacheTelemetry::Counter::PreprocessTime, duration);
+
+		if (!success) {
+			Logger::Get().Error(fmt::format("预处理 Pass{} 失败", id + 1));
+			return;
+		}
+
+		EffectPassDesc& passDesc = desc.passes[id];
+		passDesc.csoHash = EffectCacheManager::GetShaderHash(preprocessed, DeviceResources::GetShaderCompileFlags());
+		passDesc.cso = EffectCacheManager::Get().GetOrCompileShader(
+			passDesc.csoHash,
+			!App::Get().GetConfig().IsDisableEffectCache(),
+			[&](ID3DBlob** blob) {
+				bool result = true;
+				int duration = Utils::Measure([&]() {
+					result = DeviceResources::CompileShader(preprocessed, "__M", blob, sourceName.c_str());
+				});
+				CacheTelemetry::Get().RecordPassCompile(desc.name, id + 1, duration);
+				return result;
+			}
+		);
+
+		if (!passDesc.cso) {
 			Logger::Get().Error(fmt::format("编译 Pass{} 失败", id + 1));
 		}
 	}, (UINT)passBlocks.size());
@@ -1550,12 +1561,10 @@ UINT EffectCompiler::Compile(
 
 	std::string hash;
 	if (!App::Get().GetConfig().IsDisableEffectCache()) {
-		hash = EffectCacheManager::GetHash(source, flags & EFFECT_FLAG_INLINE_PARAMETERS ? &inlineParams : nullptr);
-		if (!hash.empty()) {
-			if (EffectCacheManager::Get().Load(effectName, hash, desc)) {
-				// 已从缓存中读取
-				return 0;
-			}
+		hash = EffectCacheManager::GetHash(source, flags, flags & EFFECT_FLAG_INLINE_PARAMETERS ? &inlineParams : nullptr);
+		if (EffectCacheManager::Get().Load(effectName, hash, desc)) {
+			// 已从缓存中读取
+			return 0;
 		}
 	}
 
@@ -1738,7 +1747,7 @@ UINT EffectCompiler::Compile(
 		return 1;
 	}
 
-	if (!App::Get().GetConfig().IsDisableEffectCache() && !hash.empty()) {
+	if (!hash.empty()) {
 		EffectCacheManager::Get().Save(effectName, hash, desc);
 	}
 
@@ -98,11 +98,15 @@ struct EffectParameterDesc {
 
 struct EffectPassDesc {
 	winrt::com_ptr<ID3DBlob> cso;
+	// 预处理后的源码和编译标志的哈希，缓存中通过它引用字节码
+	std::string csoHash;
 	std::vector<UINT> inputs;
 	std::vector<UINT> outputs;
 	std::array<UINT, 3> numThreads{};
 	std::pair<UINT, UINT> blockSize{};
 	std::string desc;
+	// 计算一个输出像素时在输入上的采样范围，以输入纹理的像素为单位，-1 表示未指定
+	int halo = -1;
 	bool isPSStyle = false;
 };
 
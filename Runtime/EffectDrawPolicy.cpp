@@ -0,0 +1,50 @@
+#include "EffectDrawPolicy.h"
+
+
+EffectDrawPolicy::FullDraw EffectDrawPolicy::GetFullDraw(bool isProfiling) const noexcept {
+	if (_isUseDynamic || isProfiling || _isRecordFailed) {
+		return FullDraw::Direct;
+	}
+
+	return _isRecorded ? FullDraw::Replay : FullDraw::Record;
+}
+
+bool EffectDrawPolicy::CanDrawDirtyRegion(
+	const DirtyRegion* dirtyRegion,
+	bool isTileable,
+	uint32_t inputWidth,
+	uint32_t inputHeight
+) noexcept {
+	return dirtyRegion && isTileable && !dirtyRegion->IsFull()
+		&& dirtyRegion->GetWidth() == inputWidth && dirtyRegion->GetHeight() == inputHeight;
+}
+
+EffectDrawPolicy::PassDraw EffectDrawPolicy::GetPassDraw(
+	const DirtyRegion& region,
+	const EffectPassPlan::Pass& pass,
+	std::vector<DirtyRegion::Rect>& blockRects
+) {
+	blockRects.clear();
+
+	if (region.IsFull()) {
+		return PassDraw::Full;
+	}
+
+	if (region.IsEmpty()) {
+		return PassDraw::Skip;
+	}
+
+	blockRects = region.GetBlockRects(pass.blockSize.width, pass.blockSize.height);
+
+	uint64_t blockCount = 0;
+	for (const DirtyRegion::Rect& rect : blockRects) {
+		blockCount += rect.GetArea();
+	}
+
+	if (blockCount * 4 >= uint64_t(pass.groups.width) * pass.groups.height * 3) {
+		blockRects.clear();
+		return PassDraw::Full;
+	}
+
+	return PassDraw::Blocks;
+}
@@ -0,0 +1,79 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <vector>
+#include "DirtyRegion.h"
+#include "EffectPassPlan.h"
+
+
+// 决定 EffectDrawer 每帧如何执行效果：重放或录制命令列表，还是逐个通道执行，以及每个通道是否只计算变化的块
+// 只记录命令列表的状态，不持有它，EffectDrawer 按返回的方式执行并报告录制结果
+class EffectDrawPolicy {
+public:
+	// 完整执行所有通道的方式
+	enum class FullDraw {
+		// 重放已录制的命令列表
+		Replay,
+		// 录制命令列表然后重放
+		Record,
+		// 逐个通道执行
+		Direct
+	};
+
+	// 只计算变化区域时单个通道的执行方式
+	enum class PassDraw {
+		// 输出没有变化
+		Skip,
+		// 完整执行
+		Full,
+		// 平移上一帧的结果后只计算变化的块
+		Blocks
+	};
+
+	// 使用动态常量的效果不能录制命令列表：__CB1 只在立即上下文中更新，
+	// 而延迟上下文必须先以 WRITE_DISCARD 映射动态缓冲区才能使用它
+	void Initialize(bool isUseDynamic) noexcept {
+		_isUseDynamic = isUseDynamic;
+		_isRecorded = false;
+		_isRecordFailed = false;
+	}
+
+	// 统计各通道用时时需在通道之间插入查询，因此不能使用命令列表
+	FullDraw GetFullDraw(bool isProfiling) const noexcept;
+
+	// 录制失败后不再尝试，之后总是逐个通道执行
+	void OnRecorded(bool success) noexcept {
+		_isRecorded = success;
+		_isRecordFailed = !success;
+	}
+
+	// 命令列表引用的视图或常量缓冲区已改变，下次完整执行时重新录制
+	void Invalidate() noexcept {
+		_isRecorded = false;
+	}
+
+	bool IsRecorded() const noexcept {
+		return _isRecorded;
+	}
+
+	// dirtyRegion 为输入纹理中变化的区域，为空、已全部变化、尺寸和输入不同或效果不可分块时需完整执行
+	static bool CanDrawDirtyRegion(
+		const DirtyRegion* dirtyRegion,
+		bool isTileable,
+		uint32_t inputWidth,
+		uint32_t inputHeight
+	) noexcept;
+
+	// region 为通道输出中变化的区域。返回 Blocks 时 blockRects 为需要计算的线程组范围，可能为空，此时只需平移
+	// 需要计算的线程组达到整个通道的 3/4 时多次 Dispatch 没有优势，改为完整执行
+	static PassDraw GetPassDraw(
+		const DirtyRegion& region,
+		const EffectPassPlan::Pass& pass,
+		std::vector<DirtyRegion::Rect>& blockRects
+	);
+
+private:
+	bool _isUseDynamic = false;
+	bool _isRecorded = false;
+	bool _isRecordFailed = false;
+};
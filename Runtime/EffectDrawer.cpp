@@ -7,10 +7,9 @@
 #include "TextureLoader.h"
 #include "StrUtils.h"
 #include "Renderer.h"
-#include "CursorManager.h"
 #include <unordered_set>
-#include "Config.h"
 #include "GPUTimer.h"
+#include "GPUMemoryTracker.h"
 
 #pragma push_macro("_UNICODE")
 #undef _UNICODE
@@ -41,83 +40,32 @@ bool EffectDrawer::Initialize(
 	bool isInlineParams = desc.flags & EFFECT_FLAG_INLINE_PARAMETERS;
 
 	DeviceResources& dr = App::Get().GetDeviceResources();
-	auto d3dDevice = dr.GetD3DDevice();
-
-	static mu::Parser exprParser;
-	exprParser.DefineConst("INPUT_WIDTH", inputSize.cx);
-	exprParser.DefineConst("INPUT_HEIGHT", inputSize.cy);
 
 	SIZE outputSize{};
-
-	if (desc.outSizeExpr.first.empty()) {
-		if (params.scale.has_value()) {
-			outputSize = hostSize;
-
-			// scale 属性
-			// [+, +]：缩放比例
-			// [0, 0]：非等比例缩放到屏幕大小
-			// [-, -]：相对于屏幕能容纳的最大等比缩放的比例
-
-			static float DELTA = 1e-5f;
-
-			float scaleX = params.scale.value().first;
-			float scaleY = params.scale.value().second;
-
-			float fillScale = std::min(float(outputSize.cx) / inputSize.cx, float(outputSize.cy) / inputSize.cy);
-
-			if (scaleX >= DELTA) {
-				outputSize.cx = std::lroundf(inputSize.cx * scaleX);
-			} else if (scaleX < -DELTA) {
-				outputSize.cx = std::lroundf(inputSize.cx * fillScale * -scaleX);
-			}
-
-			if (scaleY >= DELTA) {
-				outputSize.cy = std::lroundf(inputSize.cy * scaleY);
-			} else if (scaleY < -DELTA) {
-				outputSize.cy = std::lroundf(inputSize.cy * fillScale * -scaleY);
-			}
-		} else {
-			outputSize = inputSize;
-		}
-	} else {
-		assert(!desc.outSizeExpr.second.empty());
-
-		if (params.scale.has_value()) {
-			Logger::Get().Error("无法指定缩放");
-			return false;
-		}
-
-		try {
-			exprParser.SetExpr(desc.outSizeExpr.first);
-			outputSize.cx = std::lround(exprParser.Eval());
-
-			exprParser.SetExpr(desc.outSizeExpr.second);
-			outputSize.cy = std::lround(exprParser.Eval());
-		} catch (const mu::ParserError& e) {
-			Logger::Get().Error(fmt::format("计算输出尺寸 {} 失败：{}", e.GetExpr(), e.GetMsg()));
-			return false;
-		}
+	std::vector<SIZE> texSizes;
+	if (!CalcTextureSizes(desc, params, inputSize, hostSize, outputSize, texSizes)) {
+		Logger::Get().Error("计算纹理尺寸失败");
+		return false;
 	}
 
-	if (outputSize.cx <= 0 || outputSize.cy <= 0) {
-		Logger::Get().Error("非法的输出尺寸");
+	if (!_computeDevice.Initialize(dr.GetD3DDevice(), dr.GetD3DDC())) {
+		Logger::Get().Error("初始化 D3D11ComputeDevice 失败");
 		return false;
 	}
 
-	exprParser.DefineConst("OUTPUT_WIDTH", outputSize.cx);
-	exprParser.DefineConst("OUTPUT_HEIGHT", outputSize.cy);
-
 	_samplers.resize(desc.samplers.size());
 	for (UINT i = 0; i < _samplers.size(); ++i) {
 		const EffectSamplerDesc& samDesc = desc.samplers[i];
+		ID3D11SamplerState* sampler = nullptr;
 		if (!dr.GetSampler(
 			samDesc.filterType == EffectSamplerFilterType::Linear ? D3D11_FILTER_MIN_MAG_MIP_LINEAR : D3D11_FILTER_MIN_MAG_MIP_POINT,
 			samDesc.addressType == EffectSamplerAddressType::Clamp ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP,
-			&_samplers[i])
+			&sampler)
 		) {
 			Logger::Get().Error(fmt::format("创建采样器 {} 失败", samDesc.name));
 			return false;
 		}
+		_samplers[i] = _computeDevice.RegisterSampler(sampler);
 	}
 
 	// 创建中间纹理
@@ -146,22 +94,7 @@ bool EffectDrawer::Initialize(
 			}
 			
 		} else {
-			SIZE texSize{};
-			try {
-				exprParser.SetExpr(texDesc.sizeExpr.first);
-				texSize.cx = std::lround(exprParser.Eval());
-				exprParser.SetExpr(texDesc.sizeExpr.second);
-				texSize.cy = std::lround(exprParser.Eval());
-			} catch (const mu::ParserError& e) {
-				Logger::Get().Error(fmt::format("计算中间纹理尺寸 {} 失败：{}", e.GetExpr(), e.GetMsg()));
-				return false;
-			}
-
-			if (texSize.cx <= 0 || texSize.cy <= 0) {
-				Logger::Get().Error("非法的中间纹理尺寸");
-				return false;
-			}
-
+			const SIZE texSize = texSizes[i];
 			_textures[i] = dr.CreateTexture2D(
 				EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)texDesc.format].dxgiFormat,
 				texSize.cx,
@@ -175,91 +108,69 @@ bool EffectDrawer::Initialize(
 		}
 	}
 
-	if (!isLastEffect) {
-		// 创建输出纹理
-		_textures.back() = dr.CreateTexture2D(
-			DXGI_FORMAT_R8G8B8A8_UNORM,
-			outputSize.cx,
-			outputSize.cy,
-			D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
-		);
-		
-		if (!_textures.back()) {
-			Logger::Get().Error("创建纹理失败");
-			return false;
-		}
-	} else {
-		_textures.back().copy_from(dr.GetBackBuffer());
+	// 创建输出纹理
+	// 最后一个效果的输出纹理和后缓冲区尺寸相同，由 CursorDrawer 复制到后缓冲区
+	// 因此它的内容可以保留到下一帧
+	_textures.back() = dr.CreateTexture2D(
+		DXGI_FORMAT_R8G8B8A8_UNORM,
+		isLastEffect ? hostSize.cx : outputSize.cx,
+		isLastEffect ? hostSize.cy : outputSize.cy,
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS
+	);
+
+	if (!_textures.back()) {
+		Logger::Get().Error("创建纹理失败");
+		return false;
 	}
 
 	*outputTex = _textures.back().get();
 
-	_shaders.resize(desc.passes.size());
-	_srvs.resize(desc.passes.size());
-	_uavs.resize(desc.passes.size());
-	for (UINT i = 0; i < _shaders.size(); ++i) {
-		const EffectPassDesc& passDesc = desc.passes[i];
-
-		HRESULT hr = d3dDevice->CreateComputeShader(
-			passDesc.cso->GetBufferPointer(), passDesc.cso->GetBufferSize(), nullptr, _shaders[i].put());
-		if (FAILED(hr)) {
-			Logger::Get().ComError("创建计算着色器失败", hr);
-			return false;
-		}
-
-		_srvs[i].resize(passDesc.inputs.size());
-		for (UINT j = 0; j < passDesc.inputs.size(); ++j) {
-			if (!dr.GetShaderResourceView(_textures[passDesc.inputs[j]].get(), &_srvs[i][j])) {
-				Logger::Get().Error("GetShaderResourceView 失败");
-				return false;
-			}
-		}
-		
-		if (!passDesc.outputs.empty()) {
-			_uavs[i].resize(passDesc.outputs.size() * 2);
-			for (UINT j = 0; j < passDesc.outputs.size(); ++j) {
-				if (!dr.GetUnorderedAccessView(_textures[passDesc.outputs[j]].get(), &_uavs[i][j])) {
-					Logger::Get().Error("GetUnorderedAccessView 失败");
-					return false;
-				}
-			}
+	std::vector<EffectPassPlan::Size> planTexSizes(_textures.size());
+	for (size_t i = 0; i < _textures.size(); ++i) {
+		D3D11_TEXTURE2D_DESC texDesc;
+		_textures[i]->GetDesc(&texDesc);
+		planTexSizes[i] = { texDesc.Width, texDesc.Height };
+	}
 
-			D3D11_TEXTURE2D_DESC desc;
-			_textures[passDesc.outputs[0]]->GetDesc(&desc);
-			_dispatches.emplace_back(
-				(desc.Width + passDesc.blockSize.first - 1) / passDesc.blockSize.first,
-				(desc.Height + passDesc.blockSize.second - 1) / passDesc.blockSize.second
-			);
-		} else {
-			// 最后一个 pass 输出到 OUTPUT
-			_uavs[i].resize(2);
-			if (!dr.GetUnorderedAccessView(_textures.back().get(), &_uavs[i][0])) {
-				Logger::Get().Error("GetUnorderedAccessView 失败");
-				return false;
-			}
+	// 调度尺寸和绑定不依赖 D3D，由 EffectPassPlan 计算并检查
+	std::vector<EffectPassPlan::PassDesc> planPasses(desc.passes.size());
+	for (size_t i = 0; i < desc.passes.size(); ++i) {
+		const EffectPassDesc& passDesc = desc.passes[i];
+		EffectPassPlan::PassDesc& planPass = planPasses[i];
+		planPass.inputs.assign(passDesc.inputs.begin(), passDesc.inputs.end());
+		planPass.outputs.assign(passDesc.outputs.begin(), passDesc.outputs.end());
+		planPass.numThreads = passDesc.numThreads;
+		planPass.blockSize = { passDesc.blockSize.first, passDesc.blockSize.second };
+	}
 
-			D3D11_TEXTURE2D_DESC desc;
-			_textures.back()->GetDesc(&desc);
+	if (!_passPlan.Build(planPasses, planTexSizes, { (uint32_t)outputSize.cx, (uint32_t)outputSize.cy }, (uint32_t)desc.samplers.size())) {
+		Logger::Get().Error(StrUtils::Concat("效果 ", desc.name, " 的通道无效：", _passPlan.GetError()));
+		return false;
+	}
 
-			_dispatches.emplace_back(
-				(std::min(desc.Width, (UINT)outputSize.cx) + passDesc.blockSize.first - 1) / passDesc.blockSize.first,
-				(std::min(desc.Height, (UINT)outputSize.cy) + passDesc.blockSize.second - 1) / passDesc.blockSize.second
-			);
-		}
+	_textureSizes.resize(_textures.size());
+	for (size_t i = 0; i < _textures.size(); ++i) {
+		_textureSizes[i] = { planTexSizes[i].width, planTexSizes[i].height };
 	}
+	// 最后一个通道使用的坐标不包含 __offset，变化区域也以此为准
+	_textureSizes.back() = { (UINT)outputSize.cx, (UINT)outputSize.cy };
 
-	if (isLastEffect) {
-		// 为光标渲染预留空间
-		_srvs.back().push_back(nullptr);
+	_kernels.resize(desc.passes.size());
+	_passOutputs.resize(desc.passes.size());
+	for (UINT i = 0; i < _kernels.size(); ++i) {
+		const EffectPassDesc& passDesc = desc.passes[i];
 
-		if (!dr.GetSampler(
-			App::Get().GetConfig().GetCursorInterpolationMode() == 0 ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR,
-			D3D11_TEXTURE_ADDRESS_CLAMP,
-			&_samplers.emplace_back(nullptr)
-		)) {
-			Logger::Get().Error("GetSampler 失败");
+		// 多个会话使用相同的效果时共享着色器对象
+		winrt::com_ptr<ID3D11ComputeShader> shader = dr.GetDevice().GetComputeShader(passDesc.csoHash, passDesc.cso.get());
+		if (!shader) {
+			Logger::Get().Error("GetComputeShader 失败");
 			return false;
 		}
+		_kernels[i] = _computeDevice.RegisterKernel(shader.get());
+
+		// 最后一个通道的 OUTPUT 已展开为最后一个纹理
+		const EffectPassPlan::Pass& planPass = _passPlan.GetPasses()[i];
+		_passOutputs[i].assign(planPass.outputs.begin(), planPass.outputs.end());
 	}
 
 	// 大小必须为 4 的倍数
@@ -427,58 +338,504 @@ bool EffectDrawer::Initialize(
 		Logger::Get().ComError("CreateBuffer 失败", hr);
 		return false;
 	}
+
+	// cbuffer __CB3 : register(b2) {
+	//     uint2 __blockOffset;
+	// };
+	// 初始为 0，即从第一个线程组开始
+	{
+		std::array<UINT, 4> blockOffset{};
+
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bd.ByteWidth = 4 * (UINT)blockOffset.size();
+		initData.pSysMem = blockOffset.data();
+
+		hr = dr.GetD3DDevice()->CreateBuffer(&bd, &initData, _tileCB.put());
+		if (FAILED(hr)) {
+			Logger::Get().ComError("CreateBuffer 失败", hr);
+			return false;
+		}
+	}
+
+	_constantBufferHandle = _computeDevice.RegisterConstantBuffer(_constantBuffer.get());
+	_tileCBHandle = _computeDevice.RegisterConstantBuffer(_tileCB.get());
+
+	if (!_CreateBindings()) {
+		Logger::Get().Error("_CreateBindings 失败");
+		return false;
+	}
+
+	// 统计显存占用，第一个纹理为输入，不属于此效果
+	GPUMemoryTracker& memoryTracker = GPUMemoryTracker::Get();
+	for (UINT i = 1; i < (UINT)_textures.size(); ++i) {
+		int writerPass = -1;
+		for (UINT j = 0; j < (UINT)_passOutputs.size() && writerPass < 0; ++j) {
+			if (std::find(_passOutputs[j].begin(), _passOutputs[j].end(), i) != _passOutputs[j].end()) {
+				writerPass = (int)j;
+			}
+		}
+		memoryTracker.Track(_textures[i].get(), GPUMemoryTracker::Owner::Effect, _desc.name, writerPass);
+	}
+	memoryTracker.Track(_constantBuffer.get(), GPUMemoryTracker::Owner::Effect, _desc.name);
+	memoryTracker.Track(_tileCB.get(), GPUMemoryTracker::Owner::Effect, _desc.name);
+
+	_isTileable = CheckTileable(_desc);
+	_drawPolicy.Initialize(_desc.isUseDynamic);
 	
 	return true;
 }
 
-void EffectDrawer::Draw(UINT& idx, bool noUpdate) {
+bool EffectDrawer::Rebind(ID3D11Texture2D* inputTex) {
+	// 命令列表引用了旧的视图和 Renderer 的常量缓冲区
+	_commandList = nullptr;
+	_drawPolicy.Invalidate();
+	_computeDevice.Release(_rendererCBHandle);
+	_rendererCBHandle = ComputeDevice::INVALID_HANDLE;
+
+	_textures[0].copy_from(inputTex);
+	return _CreateBindings();
+}
+
+bool EffectDrawer::CalcTextureSizes(
+	const EffectDesc& desc,
+	const EffectParams& params,
+	SIZE inputSize,
+	SIZE hostSize,
+	SIZE& outputSize,
+	std::vector<SIZE>& textureSizes
+) {
+	// 多个会话的 UI 线程和渲染线程都可能调用
+	thread_local mu::Parser exprParser;
+	exprParser.DefineConst("INPUT_WIDTH", inputSize.cx);
+	exprParser.DefineConst("INPUT_HEIGHT", inputSize.cy);
+
+	outputSize = {};
+
+	if (desc.outSizeExpr.first.empty()) {
+		if (params.scale.has_value()) {
+			outputSize = hostSize;
+
+			// scale 属性
+			// [+, +]：缩放比例
+			// [0, 0]：非等比例缩放到屏幕大小
+			// [-, -]：相对于屏幕能容纳的最大等比缩放的比例
+
+			static float DELTA = 1e-5f;
+
+			float scaleX = params.scale.value().first;
+			float scaleY = params.scale.value().second;
+
+			float fillScale = std::min(float(outputSize.cx) / inputSize.cx, float(outputSize.cy) / inputSize.cy);
+
+			if (scaleX >= DELTA) {
+				outputSize.cx = std::lroundf(inputSize.cx * scaleX);
+			} else if (scaleX < -DELTA) {
+				outputSize.cx = std::lroundf(inputSize.cx * fillScale * -scaleX);
+			}
+
+			if (scaleY >= DELTA) {
+				outputSize.cy = std::lroundf(inputSize.cy * scaleY);
+			} else if (scaleY < -DELTA) {
+				outputSize.cy = std::lroundf(inputSize.cy * fillScale * -scaleY);
+			}
+		} else {
+			outputSize = inputSize;
+		}
+	} else {
+		assert(!desc.outSizeExpr.second.empty());
+
+		if (params.scale.has_value()) {
+			Logger::Get().Error("无法指定缩放");
+			return false;
+		}
+
+		try {
+			exprParser.SetExpr(desc.outSizeExpr.first);
+			outputSize.cx = std::lround(exprParser.Eval());
+
+			exprParser.SetExpr(desc.outSizeExpr.second);
+			outputSize.cy = std::lround(exprParser.Eval());
+		} catch (const mu::ParserError& e) {
+			Logger::Get().Error(fmt::format("计算输出尺寸 {} 失败：{}", e.GetExpr(), e.GetMsg()));
+			return false;
+		}
+	}
+
+	if (outputSize.cx <= 0 || outputSize.cy <= 0) {
+		Logger::Get().Error("非法的输出尺寸");
+		return false;
+	}
+
+	exprParser.DefineConst("OUTPUT_WIDTH", outputSize.cx);
+	exprParser.DefineConst("OUTPUT_HEIGHT", outputSize.cy);
+
+	textureSizes.assign(desc.textures.size(), SIZE{});
+	textureSizes[0] = inputSize;
+	for (size_t i = 1; i < desc.textures.size(); ++i) {
+		const EffectIntermediateTextureDesc& texDesc = desc.textures[i];
+		if (!texDesc.source.empty()) {
+			// 从文件加载的纹理尺寸未知
+			continue;
+		}
+
+		SIZE& texSize = textureSizes[i];
+		try {
+			exprParser.SetExpr(texDesc.sizeExpr.first);
+			texSize.cx = std::lround(exprParser.Eval());
+			exprParser.SetExpr(texDesc.sizeExpr.second);
+			texSize.cy = std::lround(exprParser.Eval());
+		} catch (const mu::ParserError& e) {
+			Logger::Get().Error(fmt::format("计算中间纹理尺寸 {} 失败：{}", e.GetExpr(), e.GetMsg()));
+			return false;
+		}
+
+		if (texSize.cx <= 0 || texSize.cy <= 0) {
+			Logger::Get().Error("非法的中间纹理尺寸");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void EffectDrawer::Draw(UINT& idx, DirtyRegion* dirtyRegion) {
 	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
 	auto& gpuTimer = App::Get().GetRenderer().GetGPUTimer();
+	const std::vector<EffectPassPlan::Pass>& passes = _passPlan.GetPasses();
 
-	{
-		ID3D11Buffer* t = _constantBuffer.get();
-		d3dDC->CSSetConstantBuffers(1, 1, &t);
+	const bool isLastEffect = _desc.flags & EFFECT_FLAG_LAST_EFFECT;
+	const UINT lastPass = UINT(passes.size() - 1);
+
+	if (_rendererCBHandle == ComputeDevice::INVALID_HANDLE && !_RegisterRendererCB()) {
+		idx += (UINT)passes.size();
+		return;
 	}
-	d3dDC->CSSetSamplers(0, (UINT)_samplers.size(), _samplers.data());
 
-	for (UINT i = 0; i < _dispatches.size(); ++i) {
-		// noUpdate 为真则只渲染最后一个通道
-		if (!noUpdate || i == UINT(_dispatches.size() - 1)) {
+	// 各纹理中变化的区域，为空表示全部重新计算
+	std::vector<DirtyRegion> texRegions;
+	if (EffectDrawPolicy::CanDrawDirtyRegion(dirtyRegion, _isTileable, _textureSizes[0].first, _textureSizes[0].second)) {
+		texRegions.reserve(_textures.size());
+		texRegions.push_back(*dirtyRegion);
+		for (size_t i = 1; i < _textures.size(); ++i) {
+			texRegions.emplace_back(_textureSizes[i].first, _textureSizes[i].second);
+		}
+	}
+
+	if (texRegions.empty()) {
+		const EffectDrawPolicy::FullDraw fullDraw = _drawPolicy.GetFullDraw(gpuTimer.IsProfiling());
+		if (fullDraw != EffectDrawPolicy::FullDraw::Direct
+			&& _ExecuteCommandList(fullDraw == EffectDrawPolicy::FullDraw::Record)
+		) {
+			idx += (UINT)passes.size();
+
+			if (dirtyRegion) {
+				*dirtyRegion = DirtyRegion(_textureSizes.back().first, _textureSizes.back().second);
+				dirtyRegion->SetFull();
+			}
+			return;
+		}
+	}
+
+	_computeDevice.SetContext(d3dDC);
+
+	for (UINT i = 0; i < passes.size(); ++i) {
+		if (texRegions.empty()) {
 			_DrawPass(i);
+		} else {
+			for (UINT output : _passOutputs[i]) {
+				texRegions[output] = _GetPassDirtyRegion(i, texRegions, output);
+			}
+
+			if (isLastEffect && i == lastPass) {
+				// 最后一个通道写入时有 __offset 偏移且可能被视口裁剪，不支持平移
+				texRegions.back().DropMove();
+			}
+
+			std::vector<DirtyRegion::Rect> blockRects;
+			switch (EffectDrawPolicy::GetPassDraw(texRegions[_passOutputs[i][0]], passes[i], blockRects)) {
+			case EffectDrawPolicy::PassDraw::Full:
+			{
+				_DrawPass(i);
+				break;
+			}
+			case EffectDrawPolicy::PassDraw::Blocks:
+			{
+				// 先平移上一帧的结果，再计算变化的区域
+				for (UINT output : _passOutputs[i]) {
+					if (const auto& move = texRegions[output].GetMove()) {
+						_ApplyMove(output, *move);
+					}
+				}
+
+				if (!blockRects.empty()) {
+					_DrawPass(i, &blockRects);
+				}
+				break;
+			}
+			case EffectDrawPolicy::PassDraw::Skip:
+				break;
+			}
 		}
 
-		// 不渲染的通道也在 GPUTimer 中记录
 		gpuTimer.OnEndPass(idx++);
 	}
+
+	if (dirtyRegion) {
+		if (texRegions.empty()) {
+			*dirtyRegion = DirtyRegion(_textureSizes.back().first, _textureSizes.back().second);
+			dirtyRegion->SetFull();
+		} else {
+			*dirtyRegion = std::move(texRegions.back());
+		}
+	}
+}
+
+bool EffectDrawer::CheckTileable(const EffectDesc& desc) {
+	if (desc.isUseDynamic) {
+		return false;
+	}
+
+	// 重复寻址时边缘的变化会影响到对侧
+	for (const EffectSamplerDesc& samDesc : desc.samplers) {
+		if (samDesc.addressType == EffectSamplerAddressType::Wrap) {
+			return false;
+		}
+	}
+
+	// 每个中间纹理最多由一个通道写入，且不能在写入前读取，即不能使用上一帧的结果
+	std::vector<int> writers(desc.textures.size(), -1);
+	for (UINT i = 0; i < desc.passes.size(); ++i) {
+		const EffectPassDesc& passDesc = desc.passes[i];
+
+		if (passDesc.halo < 0) {
+			return false;
+		}
+
+		for (UINT output : passDesc.outputs) {
+			if (writers[output] >= 0) {
+				return false;
+			}
+			writers[output] = (int)i;
+		}
+	}
+
+	for (UINT i = 0; i < desc.passes.size(); ++i) {
+		for (UINT input : desc.passes[i].inputs) {
+			if (writers[input] >= (int)i) {
+				return false;
+			}
+		}
+	}
+
+	return true;
 }
 
-void EffectDrawer::_DrawPass(UINT i) {
+DirtyRegion EffectDrawer::_GetPassDirtyRegion(UINT i, const std::vector<DirtyRegion>& texRegions, UINT outputIdx) const {
+	const auto& [width, height] = _textureSizes[outputIdx];
+	const EffectPassDesc& passDesc = _desc.passes[i];
+
+	std::vector<DirtyRegion> inputRegions;
+	inputRegions.reserve(passDesc.inputs.size());
+	for (UINT input : passDesc.inputs) {
+		inputRegions.push_back(texRegions[input].Propagate(width, height, (UINT)passDesc.halo));
+	}
+
+	// 所有输入以相同的方式平移时输出才能平移
+	bool canMove = inputRegions[0].GetMove().has_value();
+	for (size_t j = 1; j < inputRegions.size() && canMove; ++j) {
+		canMove = inputRegions[j].GetMove() == inputRegions[0].GetMove();
+	}
+
+	DirtyRegion result(width, height);
+	if (canMove) {
+		result.SetMove(*inputRegions[0].GetMove());
+	}
+
+	for (DirtyRegion& region : inputRegions) {
+		if (!canMove) {
+			region.DropMove();
+		}
+
+		result.Add(region);
+		if (result.IsFull()) {
+			break;
+		}
+	}
+
+	return result;
+}
+
+void EffectDrawer::_ApplyMove(UINT texIdx, const DirtyRegion::Move& move) {
 	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
-	d3dDC->CSSetShader(_shaders[i].get(), nullptr, 0);
-
-	if ((_desc.flags & EFFECT_FLAG_LAST_EFFECT) && i == _dispatches.size() - 1) {
-		// 最后一个效果的最后一个通道负责渲染光标
-
-		// 光标纹理
-		CursorManager& cm = App::Get().GetCursorManager();
-		if (cm.HasCursor()) {
-			ID3D11Texture2D* cursorTex;
-			CursorManager::CursorType ct;
-			if (cm.GetCursorTexture(&cursorTex, ct)) {
-				if (!App::Get().GetDeviceResources().GetShaderResourceView(cursorTex, &_srvs[i].back())) {
-					Logger::Get().Error("GetShaderResourceView 出错");
+	ID3D11Texture2D* tex = _textures[texIdx].get();
+
+	const DirtyRegion::Rect dest = move.GetDestRect();
+	D3D11_BOX srcBox{
+		(UINT)move.rect.left,
+		(UINT)move.rect.top,
+		0,
+		(UINT)move.rect.right,
+		(UINT)move.rect.bottom,
+		1
+	};
+
+	if (!move.rect.IsOverlapped(dest)) {
+		d3dDC->CopySubresourceRegion(tex, 0, dest.left, dest.top, 0, tex, 0, &srcBox);
+		return;
+	}
+
+	// 源和目标重叠时不能直接复制，需借助临时纹理
+	if (_moveTextures.empty()) {
+		_moveTextures.resize(_textures.size());
+	}
+
+	winrt::com_ptr<ID3D11Texture2D>& moveTex = _moveTextures[texIdx];
+	if (!moveTex) {
+		D3D11_TEXTURE2D_DESC texDesc;
+		tex->GetDesc(&texDesc);
+
+		moveTex = App::Get().GetDeviceResources().CreateTexture2D(texDesc.Format, texDesc.Width, texDesc.Height, 0);
+		if (!moveTex) {
+			Logger::Get().Error("创建纹理失败");
+			return;
+		}
+		GPUMemoryTracker::Get().Track(moveTex.get(), GPUMemoryTracker::Owner::Effect, _desc.name);
+	}
+
+	d3dDC->CopySubresourceRegion(moveTex.get(), 0, 0, 0, 0, tex, 0, &srcBox);
+
+	D3D11_BOX moveBox{ 0, 0, 0, srcBox.right - srcBox.left, srcBox.bottom - srcBox.top, 1 };
+	d3dDC->CopySubresourceRegion(tex, 0, dest.left, dest.top, 0, moveTex.get(), 0, &moveBox);
+}
+
+bool EffectDrawer::_CreateBindings() {
+	DeviceResources& dr = App::Get().GetDeviceResources();
+
+	for (ComputeDevice::Handle handle : _viewHandles) {
+		_computeDevice.Release(handle);
+	}
+	_viewHandles.clear();
+
+	const std::vector<EffectPassPlan::Pass>& passes = _passPlan.GetPasses();
+	_bindings.resize(passes.size());
+	for (size_t i = 0; i < passes.size(); ++i) {
+		const EffectPassPlan::Pass& pass = passes[i];
+		std::vector<ComputeDevice::Handle>& bindings = _bindings[i];
+
+		bindings.resize(pass.bindings.size());
+		for (size_t j = 0; j < pass.bindings.size(); ++j) {
+			const EffectPassPlan::Binding& binding = pass.bindings[j];
+			ComputeDevice::Handle& handle = bindings[j];
+
+			switch (binding.type) {
+			case EffectPassPlan::BindingType::ConstantBuffer:
+			{
+				// __CB1、__CB2、__CB3。__CB1 在第一次绘制时填入
+				const ComputeDevice::Handle constantBuffers[] = { _rendererCBHandle, _constantBufferHandle, _tileCBHandle };
+				handle = constantBuffers[binding.slot];
+				break;
+			}
+			case EffectPassPlan::BindingType::Sampler:
+			{
+				handle = _samplers[binding.resource];
+				break;
+			}
+			case EffectPassPlan::BindingType::SampledTexture:
+			{
+				// DeviceResources 的缓存已满时可能移除视图，注册后由 _computeDevice 持有引用
+				ID3D11ShaderResourceView* srv = nullptr;
+				if (!dr.GetShaderResourceView(_textures[binding.resource].get(), &srv)) {
+					Logger::Get().Error("GetShaderResourceView 失败");
+					return false;
 				}
-			} else {
-				Logger::Get().Error("GetCursorTexture 出错");
+				handle = _computeDevice.RegisterView(srv);
+				_viewHandles.push_back(handle);
+				break;
+			}
+			case EffectPassPlan::BindingType::StorageTexture:
+			{
+				ID3D11UnorderedAccessView* uav = nullptr;
+				if (!dr.GetUnorderedAccessView(_textures[binding.resource].get(), &uav)) {
+					Logger::Get().Error("GetUnorderedAccessView 失败");
+					return false;
+				}
+				handle = _computeDevice.RegisterView(uav);
+				_viewHandles.push_back(handle);
+				break;
+			}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool EffectDrawer::_RegisterRendererCB() {
+	_rendererCBHandle = _computeDevice.RegisterConstantBuffer(App::Get().GetRenderer().GetDynamicConstantBuffer());
+	if (_rendererCBHandle == ComputeDevice::INVALID_HANDLE) {
+		Logger::Get().Error(StrUtils::Concat("RegisterConstantBuffer 失败：", _computeDevice.GetError()));
+		return false;
+	}
+
+	const std::vector<EffectPassPlan::Pass>& passes = _passPlan.GetPasses();
+	for (size_t i = 0; i < passes.size(); ++i) {
+		for (size_t j = 0; j < passes[i].bindings.size(); ++j) {
+			const EffectPassPlan::Binding& binding = passes[i].bindings[j];
+			if (binding.type == EffectPassPlan::BindingType::ConstantBuffer && binding.slot == 0) {
+				_bindings[i][j] = _rendererCBHandle;
 			}
 		}
 	}
 
-	d3dDC->CSSetShaderResources(0, (UINT)_srvs[i].size(), _srvs[i].data());
-	UINT uavCount = (UINT)_uavs[i].size() / 2;
-	d3dDC->CSSetUnorderedAccessViews(0, uavCount, _uavs[i].data(), nullptr);
+	return true;
+}
+
+void EffectDrawer::_DrawPass(UINT i, const std::vector<DirtyRegion::Rect>* blockRects) {
+	const EffectPassPlan::Pass& pass = _passPlan.GetPasses()[i];
+
+	// 只计算变化的区域时每个矩形调度一次，起始线程组通过当前上下文写入 __CB3
+	const bool success = blockRects
+		? _computeDevice.DispatchBlocks(_kernels[i], pass, _bindings[i], *blockRects)
+		: _computeDevice.Dispatch(_kernels[i], pass, _bindings[i], {}, pass.groups);
+
+	if (!success) {
+		Logger::Get().Error(StrUtils::Concat("Dispatch 失败：", _computeDevice.GetError()));
+	}
+
+	_computeDevice.UnbindOutputs();
+}
+
+bool EffectDrawer::_ExecuteCommandList(bool record) {
+	DeviceResources& dr = App::Get().GetDeviceResources();
+
+	if (record) {
+		_commandList = nullptr;
+
+		ID3D11DeviceContext3* deferredDC = dr.GetDevice().GetDeferredDC();
+		if (!deferredDC) {
+			_drawPolicy.OnRecorded(false);
+			return false;
+		}
+
+		// 只有不使用动态常量的效果会录制命令列表，它们的着色器不读取 __CB1
+		// __CB3 在延迟上下文中写入 (0, 0)，不影响立即上下文
+		_computeDevice.SetContext(deferredDC);
+		for (UINT i = 0; i < _kernels.size(); ++i) {
+			_DrawPass(i);
+		}
+		_computeDevice.SetContext(dr.GetD3DDC());
+
+		HRESULT hr = deferredDC->FinishCommandList(FALSE, _commandList.put());
+		if (FAILED(hr)) {
+			Logger::Get().ComError("FinishCommandList 失败", hr);
+			_drawPolicy.OnRecorded(false);
+			return false;
+		}
 
-	d3dDC->Dispatch(_dispatches[i].first, _dispatches[i].second, 1);
+		_drawPolicy.OnRecorded(true);
+	}
 
-	d3dDC->CSSetUnorderedAccessViews(0, uavCount, _uavs[i].data() + uavCount, nullptr);
+	dr.GetD3DDC()->ExecuteCommandList(_commandList.get(), FALSE);
+	return true;
 }
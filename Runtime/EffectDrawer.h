@@ -1,6 +1,9 @@
 #pragma once
 #include "pch.h"
 #include "EffectDesc.h"
+#include "DirtyRegion.h"
+#include "D3D11ComputeDevice.h"
+#include "EffectDrawPolicy.h"
 
 
 class EffectDrawer {
@@ -18,7 +21,9 @@ public:
 		RECT* virtualOutputRect = nullptr
 	);
 
-	void Draw(UINT& idx, bool noUpdate = false);
+	// dirtyRegion 非空时为输入纹理中变化的区域，可以只重新计算受影响的部分
+	// 返回时 dirtyRegion 为输出纹理中变化的区域
+	void Draw(UINT& idx, DirtyRegion* dirtyRegion = nullptr);
 
 	bool IsUseDynamic() const noexcept {
 		return _desc.isUseDynamic;
@@ -28,21 +33,87 @@ public:
 		return _desc;
 	}
 
+	// 是否可以只重新计算变化的区域
+	bool IsTileable() const noexcept {
+		return _isTileable;
+	}
+
+	// 换为尺寸和格式都相同的另一个输入纹理，并重新获取所有视图
+	// 用于复用上次缩放时创建的效果，DeviceResources 中的视图此前已被释放
+	bool Rebind(ID3D11Texture2D* inputTex);
+
+	ID3D11Texture2D* GetOutput() const noexcept {
+		return _textures.back().get();
+	}
+
+	// 效果的每个输出像素只依赖输入中附近的像素，因此可以只计算部分区域或分块执行
+	static bool CheckTileable(const EffectDesc& desc);
+
+	// 计算输出尺寸和中间纹理的尺寸，不创建任何资源，也不依赖缩放会话
+	// textureSizes 的顺序和 desc.textures 相同，第一个为输入尺寸，从文件加载的纹理尺寸为 0
+	static bool CalcTextureSizes(
+		const EffectDesc& desc,
+		const EffectParams& params,
+		SIZE inputSize,
+		SIZE hostSize,
+		SIZE& outputSize,
+		std::vector<SIZE>& textureSizes
+	);
+
 private:
-	void _DrawPass(UINT i);
+	// 从 DeviceResources 获取各通道使用的视图，和常量缓冲区、采样器一起填入 _bindings
+	bool _CreateBindings();
+
+	// Renderer 的常量缓冲区在效果初始化之后才创建，复用效果时也会改变，因此在绘制前注册
+	bool _RegisterRendererCB();
+
+	// 在 _computeDevice 的当前上下文中执行，录制命令列表时 blockRects 必须为空
+	void _DrawPass(UINT i, const std::vector<DirtyRegion::Rect>* blockRects = nullptr);
+
+	// 完整执行所有通道时重放录制的命令列表，record 为真时先重新录制。失败时返回 false，应改为逐个通道执行
+	// 是否可以使用以及何时录制由 _drawPolicy 决定
+	bool _ExecuteCommandList(bool record);
+
+	// 根据各输入纹理的变化区域计算某个输出纹理的变化区域
+	DirtyRegion _GetPassDirtyRegion(UINT i, const std::vector<DirtyRegion>& texRegions, UINT outputIdx) const;
+
+	// 平移纹理中上一帧的结果
+	void _ApplyMove(UINT texIdx, const DirtyRegion::Move& move);
 
 	EffectDesc _desc;
 
-	std::vector<ID3D11SamplerState*> _samplers;
+	// 所有通道通过它执行，它持有着色器、采样器、视图和常量缓冲区的引用
+	D3D11ComputeDevice _computeDevice;
+	// 各通道的调度尺寸和绑定
+	EffectPassPlan _passPlan;
+	std::vector<ComputeDevice::Handle> _kernels;
+	std::vector<ComputeDevice::Handle> _samplers;
+	// 和 _passPlan 中各通道的 bindings 一一对应
+	std::vector<std::vector<ComputeDevice::Handle>> _bindings;
+	// 重新绑定时释放
+	std::vector<ComputeDevice::Handle> _viewHandles;
+	ComputeDevice::Handle _rendererCBHandle = ComputeDevice::INVALID_HANDLE;
+
 	std::vector<winrt::com_ptr<ID3D11Texture2D>> _textures;
-	std::vector<std::vector<ID3D11ShaderResourceView*>> _srvs;
-	// 后半部分为空，用于解绑
-	std::vector<std::vector<ID3D11UnorderedAccessView*>> _uavs;
 
 	std::vector<EffectConstant32> _constants;
 	winrt::com_ptr<ID3D11Buffer> _constantBuffer;
+	ComputeDevice::Handle _constantBufferHandle = ComputeDevice::INVALID_HANDLE;
+
+	// 所有纹理的尺寸，顺序和 _textures 相同
+	std::vector<std::pair<UINT, UINT>> _textureSizes;
+	// 每个通道写入的纹理，最后一个通道为 OUTPUT
+	std::vector<std::vector<UINT>> _passOutputs;
+
+	// __CB3，保存 Dispatch 的起始线程组，由 _computeDevice 写入
+	winrt::com_ptr<ID3D11Buffer> _tileCB;
+	ComputeDevice::Handle _tileCBHandle = ComputeDevice::INVALID_HANDLE;
+	// 平移时使用的临时纹理，顺序和 _textures 相同，按需创建
+	std::vector<winrt::com_ptr<ID3D11Texture2D>> _moveTextures;
 
-	std::vector<winrt::com_ptr<ID3D11ComputeShader>> _shaders;
+	bool _isTileable = false;
 
-	std::vector<std::pair<UINT, UINT>> _dispatches;
+	// 完整执行所有通道的命令，不包含 GPUTimer 的查询。视图改变后需重新录制
+	winrt::com_ptr<ID3D11CommandList> _commandList;
+	EffectDrawPolicy _drawPolicy;
 };
@@ -0,0 +1,108 @@
+#include "EffectPassPlan.h"
+#include <algorithm>
+
+
+bool EffectPassPlan::Build(
+	const std::vector<PassDesc>& passes,
+	const std::vector<Size>& textureSizes,
+	Size outputSize,
+	uint32_t samplerCount
+) {
+	_passes.clear();
+	_error = "";
+
+	// 至少有 INPUT 和 OUTPUT
+	if (passes.empty() || textureSizes.size() < 2) {
+		return _Fail("效果没有通道或纹理");
+	}
+
+	if (samplerCount > MAX_SAMPLERS) {
+		return _Fail("采样器过多");
+	}
+
+	const uint32_t outputIdx = uint32_t(textureSizes.size() - 1);
+
+	_passes.resize(passes.size());
+	for (size_t i = 0; i < passes.size(); ++i) {
+		const PassDesc& desc = passes[i];
+		Pass& pass = _passes[i];
+
+		pass.inputs = desc.inputs;
+		pass.numThreads = desc.numThreads;
+		pass.blockSize = desc.blockSize;
+
+		const bool isOutputPass = desc.outputs.empty();
+		if (isOutputPass) {
+			if (i + 1 != passes.size()) {
+				return _Fail("只有最后一个通道可以输出到 OUTPUT");
+			}
+			pass.outputs.push_back(outputIdx);
+		} else {
+			pass.outputs = desc.outputs;
+		}
+
+		if (pass.inputs.size() > MAX_INPUTS) {
+			return _Fail("通道的输入过多");
+		}
+		if (pass.outputs.size() > MAX_OUTPUTS) {
+			return _Fail("通道的输出过多");
+		}
+
+		// OUTPUT 不能作为输入，INPUT 不能作为输出
+		for (uint32_t input : pass.inputs) {
+			if (input >= outputIdx) {
+				return _Fail("通道的输入越界");
+			}
+		}
+		for (uint32_t output : pass.outputs) {
+			if (output == 0 || output > outputIdx || (output == outputIdx && !isOutputPass)) {
+				return _Fail("通道的输出越界");
+			}
+
+			if (std::find(pass.inputs.begin(), pass.inputs.end(), output) != pass.inputs.end()) {
+				return _Fail("通道读写同一纹理");
+			}
+		}
+
+		const uint64_t threadCount = uint64_t(pass.numThreads[0]) * pass.numThreads[1] * pass.numThreads[2];
+		if (threadCount == 0 || threadCount > MAX_THREADS_PER_GROUP || pass.numThreads[2] > MAX_THREADS_Z) {
+			return _Fail("线程组尺寸无效");
+		}
+
+		if (pass.blockSize.width == 0 || pass.blockSize.height == 0) {
+			return _Fail("块尺寸无效");
+		}
+
+		// 调度尺寸由第一个输出决定，输出到 OUTPUT 时只需覆盖效果的输出尺寸
+		Size targetSize = textureSizes[pass.outputs[0]];
+		if (isOutputPass) {
+			targetSize.width = std::min(targetSize.width, outputSize.width);
+			targetSize.height = std::min(targetSize.height, outputSize.height);
+		}
+
+		pass.groups.width = (targetSize.width + pass.blockSize.width - 1) / pass.blockSize.width;
+		pass.groups.height = (targetSize.height + pass.blockSize.height - 1) / pass.blockSize.height;
+		if (pass.groups.width == 0 || pass.groups.height == 0
+			|| pass.groups.width > MAX_GROUPS_PER_DIMENSION || pass.groups.height > MAX_GROUPS_PER_DIMENSION) {
+			return _Fail("调度尺寸超出限制");
+		}
+
+		// 绑定编号和 EffectCompiler 生成的寄存器一一对应
+		uint32_t binding = 0;
+		pass.bindings.reserve(CONSTANT_BUFFER_COUNT + samplerCount + pass.inputs.size() + pass.outputs.size());
+		for (uint32_t j = 0; j < CONSTANT_BUFFER_COUNT; ++j) {
+			pass.bindings.push_back({ BindingType::ConstantBuffer, j, binding++, j });
+		}
+		for (uint32_t j = 0; j < samplerCount; ++j) {
+			pass.bindings.push_back({ BindingType::Sampler, j, binding++, j });
+		}
+		for (uint32_t j = 0; j < (uint32_t)pass.inputs.size(); ++j) {
+			pass.bindings.push_back({ BindingType::SampledTexture, j, binding++, pass.inputs[j] });
+		}
+		for (uint32_t j = 0; j < (uint32_t)pass.outputs.size(); ++j) {
+			pass.bindings.push_back({ BindingType::StorageTexture, j, binding++, pass.outputs[j] });
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// 效果中每个通道的调度尺寸和资源绑定，只由通道的描述和纹理尺寸决定，不依赖图形 API
+// D3D11 按寄存器号绑定；使用描述符的后端可以使用 binding，它将所有寄存器统一编号
+class EffectPassPlan {
+public:
+	struct Size {
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	enum class BindingType {
+		// __CB1、__CB2、__CB3
+		ConstantBuffer,
+		Sampler,
+		// 输入纹理，即 SRV
+		SampledTexture,
+		// 输出纹理，即 UAV
+		StorageTexture
+	};
+
+	struct Binding {
+		BindingType type = BindingType::ConstantBuffer;
+		// HLSL 中的寄存器号，如 t1 为 1
+		uint32_t slot = 0;
+		// 顺序为常量缓冲区、采样器、输入纹理、输出纹理
+		uint32_t binding = 0;
+		// 纹理或采样器的索引，常量缓冲区为 slot
+		uint32_t resource = 0;
+	};
+
+	// 和 EffectPassDesc 对应
+	struct PassDesc {
+		std::vector<uint32_t> inputs;
+		// 为空表示输出到 OUTPUT，只有最后一个通道可以为空
+		std::vector<uint32_t> outputs;
+		std::array<uint32_t, 3> numThreads{};
+		Size blockSize;
+	};
+
+	struct Pass {
+		std::vector<uint32_t> inputs;
+		// OUTPUT 已展开为最后一个纹理的索引
+		std::vector<uint32_t> outputs;
+		std::array<uint32_t, 3> numThreads{};
+		Size blockSize;
+		// 完整计算一次所需的线程组数
+		Size groups;
+		std::vector<Binding> bindings;
+	};
+
+	// 常量缓冲区的数量和绑定方式所有通道相同
+	static constexpr uint32_t CONSTANT_BUFFER_COUNT = 3;
+
+	// cs_5_0 的限制
+	static constexpr uint32_t MAX_SAMPLERS = 16;
+	static constexpr uint32_t MAX_INPUTS = 128;
+	static constexpr uint32_t MAX_OUTPUTS = 8;
+	static constexpr uint32_t MAX_THREADS_PER_GROUP = 1024;
+	static constexpr uint32_t MAX_THREADS_Z = 64;
+	static constexpr uint32_t MAX_GROUPS_PER_DIMENSION = 65535;
+
+	EffectPassPlan() noexcept = default;
+
+	// textureSizes 的顺序和效果的纹理相同，第一个为 INPUT，最后一个为 OUTPUT
+	// outputSize 为效果的输出尺寸，最后一个效果的 OUTPUT 纹理比它大时只计算 outputSize 内的部分
+	// 纹理索引越界、通道读写同一纹理或调度尺寸超出限制时返回 false，GetError 返回原因
+	bool Build(
+		const std::vector<PassDesc>& passes,
+		const std::vector<Size>& textureSizes,
+		Size outputSize,
+		uint32_t samplerCount
+	);
+
+	const std::vector<Pass>& GetPasses() const noexcept {
+		return _passes;
+	}
+
+	const char* GetError() const noexcept {
+		return _error;
+	}
+
+private:
+	bool _Fail(const char* error) noexcept {
+		_passes.clear();
+		_error = error;
+		return false;
+	}
+
+	std::vector<Pass> _passes;
+	const char* _error = "";
+};
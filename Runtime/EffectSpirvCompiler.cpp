@@ -0,0 +1,117 @@
+#include "EffectSpirvCompiler.h"
+#include "EffectPassPlan.h"
+#include <cstring>
+#include <dxc/dxcapi.h>
+
+
+// dxcapi.h 只在 Windows 以外的平台提供 CComPtr
+template <typename T>
+class DxcPtr {
+public:
+	DxcPtr() = default;
+	DxcPtr(const DxcPtr&) = delete;
+
+	~DxcPtr() {
+		if (_ptr) {
+			_ptr->Release();
+		}
+	}
+
+	T* operator->() const noexcept {
+		return _ptr;
+	}
+
+	T* get() const noexcept {
+		return _ptr;
+	}
+
+	void** put_void() noexcept {
+		return (void**)&_ptr;
+	}
+
+private:
+	T* _ptr = nullptr;
+};
+
+EffectSpirvCompiler::RegisterShifts EffectSpirvCompiler::GetRegisterShifts(uint32_t samplerCount, uint32_t inputCount) noexcept {
+	RegisterShifts result;
+	result.sampler = EffectPassPlan::CONSTANT_BUFFER_COUNT;
+	result.texture = result.sampler + samplerCount;
+	result.uav = result.texture + inputCount;
+	return result;
+}
+
+bool EffectSpirvCompiler::Compile(
+	std::string_view hlsl,
+	uint32_t samplerCount,
+	uint32_t inputCount,
+	std::vector<uint32_t>& spirv,
+	std::string& messages
+) {
+	spirv.clear();
+	messages.clear();
+
+	DxcPtr<IDxcCompiler3> compiler;
+	if (FAILED(DxcCreateInstance(CLSID_DxcCompiler, __uuidof(IDxcCompiler3), compiler.put_void()))) {
+		messages = "创建 DXC 编译器失败";
+		return false;
+	}
+
+	const RegisterShifts shifts = GetRegisterShifts(samplerCount, inputCount);
+	const std::wstring samplerShift = std::to_wstring(shifts.sampler);
+	const std::wstring textureShift = std::to_wstring(shifts.texture);
+	const std::wstring uavShift = std::to_wstring(shifts.uav);
+
+	const wchar_t* args[] = {
+		L"-spirv",
+		L"-fspv-target-env=vulkan1.1",
+		L"-T", L"cs_6_0",
+		L"-E", L"__M",
+		L"-O3",
+		// 常量缓冲区的布局和 D3D 相同，EffectChainRunner 按 D3D 的规则填写
+		L"-fvk-use-dx-layout",
+		// UAV 的格式由纹理决定，不从 HLSL 的类型推断
+		L"-fspv-use-unknown-image-format",
+		// 所有寄存器都在 space0
+		L"-fvk-s-shift", samplerShift.c_str(), L"0",
+		L"-fvk-t-shift", textureShift.c_str(), L"0",
+		L"-fvk-u-shift", uavShift.c_str(), L"0"
+	};
+
+	DxcBuffer source{};
+	source.Ptr = hlsl.data();
+	source.Size = hlsl.size();
+	source.Encoding = DXC_CP_UTF8;
+
+	DxcPtr<IDxcResult> result;
+	if (FAILED(compiler->Compile(&source, args, (UINT32)std::size(args), nullptr,
+		__uuidof(IDxcResult), result.put_void()))) {
+		messages = "调用 DXC 失败";
+		return false;
+	}
+
+	DxcPtr<IDxcBlobUtf8> errors;
+	if (SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, __uuidof(IDxcBlobUtf8), errors.put_void(), nullptr))
+		&& errors.get() && errors->GetStringLength() > 0) {
+		messages.assign(errors->GetStringPointer(), errors->GetStringLength());
+	}
+
+	HRESULT status = E_FAIL;
+	result->GetStatus(&status);
+	if (FAILED(status)) {
+		return false;
+	}
+
+	DxcPtr<IDxcBlob> object;
+	if (FAILED(result->GetOutput(DXC_OUT_OBJECT, __uuidof(IDxcBlob), object.put_void(), nullptr))
+		|| !object.get() || object->GetBufferSize() == 0 || object->GetBufferSize() % sizeof(uint32_t) != 0) {
+		if (messages.empty()) {
+			messages = "DXC 没有输出 SPIR-V";
+		}
+		return false;
+	}
+
+	spirv.resize(object->GetBufferSize() / sizeof(uint32_t));
+	std::memcpy(spirv.data(), object->GetBufferPointer(), object->GetBufferSize());
+	return true;
+}
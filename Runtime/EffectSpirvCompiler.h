@@ -0,0 +1,32 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// 使用 DXC 将 EffectCompiler 生成的通道源码编译为 SPIR-V，供 VulkanComputeDevice 使用
+// 需要 DXC 1.8 或更新的版本，目前只由 Tests/CMakeLists.txt 构建，不属于 Runtime.vcxproj
+// 寄存器按 EffectPassPlan 的编号映射到 binding：b0~b2 为 0~2，之后依次为采样器、输入纹理和输出纹理
+class EffectSpirvCompiler {
+public:
+	// 寄存器到 binding 的偏移，只由采样器和输入的数量决定
+	struct RegisterShifts {
+		uint32_t sampler = 0;
+		uint32_t texture = 0;
+		uint32_t uav = 0;
+	};
+
+	static RegisterShifts GetRegisterShifts(uint32_t samplerCount, uint32_t inputCount) noexcept;
+
+	// hlsl 为一个通道的完整源码，入口点为 __M，可以是 EffectCompiler 保存到 sources 文件夹的源码
+	// 失败时 messages 为编译器的输出，成功时可能包含警告
+	static bool Compile(
+		std::string_view hlsl,
+		uint32_t samplerCount,
+		uint32_t inputCount,
+		std::vector<uint32_t>& spirv,
+		std::string& messages
+	);
+};
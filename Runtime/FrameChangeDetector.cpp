@@ -0,0 +1,95 @@
+#include "FrameChangeDetector.h"
+#include <algorithm>
+#include <xxhash.h>
+
+
+DirtyRegion FrameChangeDetector::Update(const uint8_t* data, uint32_t rowPitch) {
+	_curHashes.assign(size_t(_tileCountX) * _tileCountY, 0);
+
+	// 逐行处理以顺序访问内存，每个块的哈希以上一行的结果为种子
+	// XXH3 内部使用 SSE2/AVX2 等指令集
+	const size_t tileRowBytes = size_t(TILE_SIZE) * 4;
+	const size_t lastTileRowBytes = (size_t(_width) - size_t(_tileCountX - 1) * TILE_SIZE) * 4;
+
+	for (uint32_t y = 0; y < _height; ++y) {
+		const uint8_t* row = data + size_t(y) * rowPitch;
+		uint64_t* hashes = _curHashes.data() + size_t(y / TILE_SIZE) * _tileCountX;
+
+		for (uint32_t x = 0; x < _tileCountX; ++x) {
+			const size_t len = x + 1 == _tileCountX ? lastTileRowBytes : tileRowBytes;
+			hashes[x] = XXH3_64bits_withSeed(row + x * tileRowBytes, len, hashes[x]);
+		}
+	}
+
+	if (_hashes.empty()) {
+		_hashes.swap(_curHashes);
+
+		DirtyRegion result(_width, _height);
+		result.SetFull();
+		return result;
+	}
+
+	_tileFlags.resize(_curHashes.size());
+	for (size_t i = 0; i < _curHashes.size(); ++i) {
+		_tileFlags[i] = _curHashes[i] != _hashes[i];
+	}
+	_hashes.swap(_curHashes);
+
+	return TilesToRegion(_tileFlags.data());
+}
+
+DirtyRegion FrameChangeDetector::TilesToRegion(const uint8_t* tileFlags) const {
+	DirtyRegion result(_width, _height);
+
+	// 同一行中相邻的块合并为一个矩形，和上一行范围相同的矩形再纵向合并
+	// 以减少矩形的数量
+	std::vector<DirtyRegion::Rect> prevRow;
+	std::vector<DirtyRegion::Rect> curRow;
+
+	for (uint32_t ty = 0; ty < _tileCountY; ++ty) {
+		const uint8_t* flags = tileFlags + size_t(ty) * _tileCountX;
+
+		curRow.clear();
+		for (uint32_t tx = 0; tx < _tileCountX;) {
+			if (!flags[tx]) {
+				++tx;
+				continue;
+			}
+
+			uint32_t end = tx + 1;
+			while (end < _tileCountX && flags[end]) {
+				++end;
+			}
+
+			DirtyRegion::Rect rect{
+				int32_t(tx * TILE_SIZE),
+				int32_t(ty * TILE_SIZE),
+				int32_t(std::min(end * TILE_SIZE, _width)),
+				int32_t(std::min((ty + 1) * TILE_SIZE, _height))
+			};
+
+			auto it = std::find_if(prevRow.begin(), prevRow.end(), [&](const DirtyRegion::Rect& r) {
+				return r.left == rect.left && r.right == rect.right;
+			});
+			if (it != prevRow.end()) {
+				rect.top = it->top;
+				prevRow.erase(it);
+			}
+
+			curRow.push_back(rect);
+			tx = end;
+		}
+
+		// 上一行中没有延续的矩形已经完整
+		for (const DirtyRegion::Rect& rect : prevRow) {
+			result.Add(rect);
+		}
+		prevRow.swap(curRow);
+	}
+
+	for (const DirtyRegion::Rect& rect : prevRow) {
+		result.Add(rect);
+	}
+
+	return result;
+}
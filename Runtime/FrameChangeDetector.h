@@ -0,0 +1,53 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <vector>
+#include "DirtyRegion.h"
+
+
+// 将帧分为若干块，和上一帧比较得到变化的区域
+// 用于无法获知变化区域的捕获方式，画面没有变化时可以跳过渲染
+class FrameChangeDetector {
+public:
+	// 块的边长，以像素为单位
+	static constexpr uint32_t TILE_SIZE = 64;
+
+	FrameChangeDetector() noexcept = default;
+
+	FrameChangeDetector(uint32_t width, uint32_t height) noexcept
+		: _width(width), _height(height),
+		_tileCountX((width + TILE_SIZE - 1) / TILE_SIZE),
+		_tileCountY((height + TILE_SIZE - 1) / TILE_SIZE) {}
+
+	uint32_t GetTileCountX() const noexcept {
+		return _tileCountX;
+	}
+
+	uint32_t GetTileCountY() const noexcept {
+		return _tileCountY;
+	}
+
+	// data 为 4 字节一个像素的图像，rowPitch 为每行的字节数
+	// 计算每个块的哈希并和上一帧比较，第一帧总是完整的
+	DirtyRegion Update(const uint8_t* data, uint32_t rowPitch);
+
+	// tileFlags 按行排列，非零表示该块发生了变化
+	// 用于变化在其他地方（如 GPU 上）检测的情况
+	DirtyRegion TilesToRegion(const uint8_t* tileFlags) const;
+
+	// 下一次 Update 返回完整的区域
+	void Reset() noexcept {
+		_hashes.clear();
+	}
+
+private:
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	uint32_t _tileCountX = 0;
+	uint32_t _tileCountY = 0;
+
+	// 上一帧每个块的哈希，为空表示没有上一帧
+	std::vector<uint64_t> _hashes;
+	std::vector<uint64_t> _curHashes;
+	std::vector<uint8_t> _tileFlags;
+};
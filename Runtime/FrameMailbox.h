@@ -0,0 +1,121 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+// 单生产者单消费者的无锁三缓冲，只保留最新的帧
+// 生产者独占后缓冲区，消费者独占前缓冲区，中间缓冲区通过原子交换传递
+// 生产者发布时不会等待消费者，未被取走的帧直接被新帧替换并计入丢弃数
+template <typename T>
+class FrameMailbox {
+public:
+	static constexpr uint32_t SLOT_COUNT = 3;
+
+	FrameMailbox() = default;
+	FrameMailbox(const FrameMailbox&) = delete;
+	FrameMailbox(FrameMailbox&&) = delete;
+
+	// 只能在生产者线程中调用
+	T& GetBackBuffer() noexcept {
+		return _slots[_back].value;
+	}
+
+	// 只能在生产者线程中调用
+	// 后缓冲区的索引，可用于访问和每个缓冲区对应的外部资源
+	uint32_t GetBackIndex() const noexcept {
+		return _back;
+	}
+
+	// 只能在生产者线程中调用
+	// 发布后缓冲区并取得新的后缓冲区，其中可能是被丢弃的帧
+	// 返回新帧的序号，从 1 开始
+	uint64_t Publish() noexcept {
+		const uint64_t sequence = _publishedCount.load(std::memory_order_relaxed) + 1;
+		_slots[_back].sequence = sequence;
+
+		const uint32_t prev = _middle.exchange(_back | _NEW_FLAG, std::memory_order_acq_rel);
+		_back = prev & _INDEX_MASK;
+
+		if (prev & _NEW_FLAG) {
+			// 上一帧尚未被取走
+			_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		_publishedCount.store(sequence, std::memory_order_release);
+
+		return sequence;
+	}
+
+	// 只能在消费者线程中调用
+	// 有新帧时将其换到前缓冲区并返回 true
+	bool Acquire() noexcept {
+		if (!(_middle.load(std::memory_order_relaxed) & _NEW_FLAG)) {
+			return false;
+		}
+
+		// 生产者只会设置新帧标志，因此交换得到的一定是新帧
+		const uint32_t prev = _middle.exchange(_front, std::memory_order_acq_rel);
+		_front = prev & _INDEX_MASK;
+
+		_consumedSequence.store(_slots[_front].sequence, std::memory_order_release);
+		return true;
+	}
+
+	// 只能在消费者线程中调用
+	T& GetFrontBuffer() noexcept {
+		return _slots[_front].value;
+	}
+
+	// 只能在消费者线程中调用
+	uint32_t GetFrontIndex() const noexcept {
+		return _front;
+	}
+
+	// 只能在消费者线程中调用
+	// 前缓冲区中帧的序号，尚未取得过帧时为 0
+	uint64_t GetFrontSequence() const noexcept {
+		return _slots[_front].sequence;
+	}
+
+	// 可以在任何线程中调用
+	// 消费者最近取得的帧的序号，生产者读取时可能已经过时（偏小）
+	uint64_t GetConsumedSequence() const noexcept {
+		return _consumedSequence.load(std::memory_order_acquire);
+	}
+
+	// 可以在任何线程中调用
+	uint64_t GetPublishedCount() const noexcept {
+		return _publishedCount.load(std::memory_order_acquire);
+	}
+
+	// 可以在任何线程中调用
+	// 被新帧替换而没有被消费者取得的帧数
+	uint64_t GetDroppedCount() const noexcept {
+		return _droppedCount.load(std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr uint32_t _INDEX_MASK = 0x3;
+	static constexpr uint32_t _NEW_FLAG = 0x4;
+
+	struct _Slot {
+		T value{};
+		uint64_t sequence = 0;
+	};
+	std::array<_Slot, SLOT_COUNT> _slots{};
+
+	// 生产者和消费者修改的变量位于不同的缓存行，避免伪共享
+
+	// 生产者拥有
+	alignas(64) uint32_t _back = 0;
+	std::atomic<uint64_t> _publishedCount = 0;
+	std::atomic<uint64_t> _droppedCount = 0;
+
+	// 低两位为中间缓冲区的索引，_NEW_FLAG 表示其中是尚未被取走的帧
+	alignas(64) std::atomic<uint32_t> _middle = 1;
+
+	// 消费者拥有
+	alignas(64) uint32_t _front = 2;
+	std::atomic<uint64_t> _consumedSequence = 0;
+};
@@ -0,0 +1,49 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+
+
+void FrameScheduler::OnSourceFrame(TimePoint time) noexcept {
+	if (_hasSourceFrame) {
+		const Duration interval = time - _lastSourceTime;
+
+		if (interval > Duration::zero() && interval <= MAX_SOURCE_INTERVAL) {
+			if (_sourceInterval == Duration::zero()) {
+				_sourceInterval = interval;
+			} else {
+				// 指数移动平均，平滑单个帧的抖动
+				_sourceInterval += (interval - _sourceInterval) / 8;
+			}
+		}
+	}
+
+	_lastSourceTime = time;
+	_hasSourceFrame = true;
+}
+
+FrameScheduler::Duration FrameScheduler::GetMinFrameInterval() const noexcept {
+	if (!_isMatchSourceFrameRate) {
+		return Duration::zero();
+	}
+
+	// 留出 10% 的余量，源的帧间隔略有波动时不会被限制为一半的帧率
+	return _sourceInterval * 9 / 10;
+}
+
+FrameScheduler::TimePoint FrameScheduler::GetEarliestFrameTime() const noexcept {
+	if (!_hasPresented) {
+		return TimePoint{};
+	}
+
+	return _lastPresentTime + GetMinFrameInterval();
+}
+
+FrameScheduler::TimePoint FrameScheduler::GetWakeTime(TimePoint now, bool isAnimated) const noexcept {
+	const TimePoint earliest = GetEarliestFrameTime();
+	if (now < earliest) {
+		// 受帧率限制，到时间后检查是否有新帧
+		return earliest;
+	}
+
+	// 画面静止时定期醒来以更新光标
+	return isAnimated ? now : now + _idleInterval;
+}
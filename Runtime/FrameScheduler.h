@@ -0,0 +1,71 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <chrono>
+
+
+// 决定渲染线程何时醒来以及何时可以呈现下一帧
+// 时间均由调用者传入，不读取系统时钟，因此可以使用模拟的时钟驱动
+class FrameScheduler {
+public:
+	using Clock = std::chrono::steady_clock;
+	using TimePoint = Clock::time_point;
+	using Duration = Clock::duration;
+
+	// 两次源帧的间隔超过此值时视为源暂停，不计入平均帧间隔
+	static constexpr Duration MAX_SOURCE_INTERVAL = std::chrono::seconds(1);
+
+	FrameScheduler() noexcept = default;
+
+	// 画面静止时检查光标等变化的间隔，通常为显示器的刷新间隔
+	void SetIdleInterval(Duration value) noexcept {
+		_idleInterval = value;
+	}
+
+	Duration GetIdleInterval() const noexcept {
+		return _idleInterval;
+	}
+
+	// 为真时呈现的帧率不超过源的帧率
+	void SetMatchSourceFrameRate(bool value) noexcept {
+		_isMatchSourceFrameRate = value;
+	}
+
+	bool IsMatchSourceFrameRate() const noexcept {
+		return _isMatchSourceFrameRate;
+	}
+
+	// 源产生新帧时调用
+	void OnSourceFrame(TimePoint time) noexcept;
+
+	// 呈现一帧后调用
+	void OnFramePresented(TimePoint time) noexcept {
+		_lastPresentTime = time;
+		_hasPresented = true;
+	}
+
+	// 观测到的源的平均帧间隔，尚未观测到时为零
+	Duration GetSourceFrameInterval() const noexcept {
+		return _sourceInterval;
+	}
+
+	// 两次呈现之间的最小间隔，不限制帧率时为零
+	Duration GetMinFrameInterval() const noexcept;
+
+	// 下一帧最早可以呈现的时间
+	TimePoint GetEarliestFrameTime() const noexcept;
+
+	// 没有事件发生时渲染线程应当醒来的时间，不早于 now
+	// isAnimated 为真表示每帧都需要重新渲染，如存在使用动态常量的效果
+	TimePoint GetWakeTime(TimePoint now, bool isAnimated) const noexcept;
+
+private:
+	Duration _idleInterval = std::chrono::milliseconds(16);
+	Duration _sourceInterval{};
+
+	TimePoint _lastSourceTime{};
+	TimePoint _lastPresentTime{};
+
+	bool _hasSourceFrame = false;
+	bool _hasPresented = false;
+	bool _isMatchSourceFrameRate = false;
+};
@@ -4,9 +4,15 @@
 #include "App.h"
 #include "Logger.h"
 #include "Config.h"
+#include "DeviceResources.h"
 
 
 FrameSourceBase::~FrameSourceBase() {
+	if (const uint64_t publishedCount = _mailbox.GetPublishedCount()) {
+		Logger::Get().Info(fmt::format("捕获线程共发布 {} 帧，其中 {} 帧未被渲染即被替换",
+			publishedCount, _mailbox.GetDroppedCount()));
+	}
+
 	HWND hwndSrc = App::Get().GetHwndSrc();
 
 	// 还原窗口圆角
@@ -86,6 +92,62 @@ bool FrameSourceBase::Initialize() {
 	return true;
 }
 
+bool FrameSourceBase::_CreateNewFrameEvent() {
+	_newFrameEvent.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
+	if (!_newFrameEvent) {
+		Logger::Get().Win32Error("CreateEvent 失败");
+		return false;
+	}
+
+	return true;
+}
+
+void FrameSourceBase::_PublishFrame() noexcept {
+	_mailbox.Publish();
+	// 新的后缓冲区中可能是被丢弃的帧，立即释放以便捕获 API 复用它的缓冲区
+	_mailbox.GetBackBuffer().owner = nullptr;
+	_SignalNewFrame();
+}
+
+FrameSourceBase::UpdateState FrameSourceBase::_UpdateFromMailbox() {
+	const uint64_t lastSequence = _mailbox.GetFrontSequence();
+	if (!_mailbox.Acquire()) {
+		// 第一帧之前不渲染
+		return lastSequence == 0 ? UpdateState::Waiting : UpdateState::NoUpdate;
+	}
+
+	_CapturedFrame& frame = _mailbox.GetFrontBuffer();
+	// 复制后立即释放所有者
+	Utils::ScopeExit se([&frame]() {
+		frame.owner = nullptr;
+	});
+
+	if (frame.keyedMutex) {
+		// 捕获线程不会访问前缓冲区，这里只是等待另一个设备上的复制完成
+		HRESULT hr = frame.keyedMutex->AcquireSync(0, 1000);
+		if (hr != S_OK) {
+			Logger::Get().ComError("AcquireSync 失败", hr);
+			return UpdateState::Error;
+		}
+	}
+
+	App::Get().GetDeviceResources().GetD3DDC()->CopySubresourceRegion(
+		_output.get(), 0, 0, 0, 0, frame.texture.get(), 0, &frame.box);
+
+	if (frame.keyedMutex) {
+		frame.keyedMutex->ReleaseSync(0);
+	}
+
+	_dirtyRegion = std::move(frame.dirtyRegion);
+	if (frame.baseSequence != lastSequence) {
+		// 捕获线程计算变化区域时渲染线程已经取得了更新的帧，其中的平移可能已被应用过
+		// 此时放弃平移，变化区域依然覆盖了所有变化
+		_dirtyRegion.DropMove();
+	}
+
+	return UpdateState::NewFrame;
+}
+
 bool FrameSourceBase::_GetMapToOriginDPI(HWND hWnd, double& a, double& bx, double& by) {
 	// HDC 中的 HBITMAP 尺寸为窗口的原始尺寸
 	// 通过 GetWindowRect 获得的尺寸为窗口的 DPI 缩放后尺寸
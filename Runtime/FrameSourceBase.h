@@ -1,10 +1,15 @@
 #pragma once
 #include "pch.h"
+#include "DirtyRegion.h"
+#include "FrameMailbox.h"
+#include "Utils.h"
 
 
 class FrameSourceBase {
 public:
-	FrameSourceBase() {}
+	FrameSourceBase() {
+		_dirtyRegion.SetFull();
+	}
 
 	virtual ~FrameSourceBase();
 
@@ -32,9 +37,52 @@ public:
 		return _output.get();
 	}
 
+	// Update 返回 NewFrame 后可用，为输出纹理中和上一帧相比发生变化的区域
+	// 无法获知变化区域的捕获方式总是返回整个纹理
+	const DirtyRegion& GetDirtyRegion() const noexcept {
+		return _dirtyRegion;
+	}
+
 	virtual const char* GetName() const noexcept = 0;
 
+	// 新帧到达时被触发的自动重置事件，渲染线程等待它以避免轮询
+	// 需要轮询的捕获方式返回 NULL
+	HANDLE GetNewFrameEvent() const noexcept {
+		return _newFrameEvent.get();
+	}
+
 protected:
+	// 在其他线程中接收新帧的捕获方式在初始化时调用
+	bool _CreateNewFrameEvent();
+
+	// 在其他线程中捕获的帧，通过 _mailbox 传递给渲染线程
+	struct _CapturedFrame {
+		// 位于渲染线程的 D3D 设备上，取得时复制到 _output
+		winrt::com_ptr<ID3D11Texture2D> texture;
+		// 不为空时复制前后获取和释放，用于和其他 D3D 设备同步
+		winrt::com_ptr<IDXGIKeyedMutex> keyedMutex;
+		// texture 中需要复制的部分
+		D3D11_BOX box{};
+		// 纹理的所有者，如 Graphics Capture 的帧，被取得或丢弃时释放
+		winrt::Windows::Foundation::IInspectable owner{ nullptr };
+
+		// 和序号为 baseSequence 的帧相比发生变化的区域
+		DirtyRegion dirtyRegion;
+		uint64_t baseSequence = 0;
+	};
+
+	// 只能在捕获线程中调用
+	// 发布 _mailbox 的后缓冲区并唤醒渲染线程，未被取走的上一帧被丢弃
+	void _PublishFrame() noexcept;
+
+	// Update 的通用实现，取得最新的帧并复制到 _output，不会等待捕获线程
+	UpdateState _UpdateFromMailbox();
+
+	// 可以在任何线程中调用
+	void _SignalNewFrame() noexcept {
+		SetEvent(_newFrameEvent.get());
+	}
+
 	virtual bool _HasRoundCornerInWin11() = 0;
 
 	// 获取坐标系 1 到坐标系 2 的映射关系
@@ -53,6 +101,11 @@ protected:
 	RECT _srcFrameRect{};
 
 	winrt::com_ptr<ID3D11Texture2D> _output;
+	DirtyRegion _dirtyRegion;
+
+	Utils::ScopedHandle _newFrameEvent;
+
+	FrameMailbox<_CapturedFrame> _mailbox;
 
 	bool _roundCornerDisabled = false;
 	bool _windowResizingDisabled = false;
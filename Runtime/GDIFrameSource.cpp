@@ -3,8 +3,19 @@
 #include "App.h"
 #include "DeviceResources.h"
 #include "Logger.h"
+#include "GPUMemoryTracker.h"
 
 
+GDIFrameSource::~GDIFrameSource() {
+	if (_hdcMem) {
+		SelectObject(_hdcMem, _hOldBmp);
+		DeleteDC(_hdcMem);
+	}
+	if (_hBmp) {
+		DeleteObject(_hBmp);
+	}
+}
+
 bool GDIFrameSource::Initialize() {
 	if (!FrameSourceBase::Initialize()) {
 		Logger::Get().Error("初始化 FrameSourceBase 失败");
@@ -55,54 +66,87 @@ bool GDIFrameSource::Initialize() {
 		return false;
 	}
 
+	const SIZE frameSize = Utils::GetSizeOfRect(_frameRect);
+
 	_output = App::Get().GetDeviceResources().CreateTexture2D(
 		DXGI_FORMAT_B8G8R8A8_UNORM,
-		_frameRect.right - _frameRect.left,
-		_frameRect.bottom - _frameRect.top,
-		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET,
-		D3D11_USAGE_DEFAULT,
-		D3D11_RESOURCE_MISC_GDI_COMPATIBLE
+		frameSize.cx,
+		frameSize.cy,
+		D3D11_BIND_SHADER_RESOURCE
 	);
 	if (!_output) {
 		Logger::Get().Error("创建纹理失败");
 		return false;
 	}
+	GPUMemoryTracker::Get().Track(_output.get(), GPUMemoryTracker::Owner::FrameSource);
 
-	_dxgiSurface = _output.try_as<IDXGISurface1>();
-	if (!_dxgiSurface) {
-		Logger::Get().Error("从 Texture2D 获取 IDXGISurface1 失败");
+	_hdcMem = CreateCompatibleDC(NULL);
+	if (!_hdcMem) {
+		Logger::Get().Win32Error("CreateCompatibleDC 失败");
 		return false;
 	}
 
+	// 自上而下的 32 位位图，和 B8G8R8A8 的内存布局相同
+	BITMAPINFO bi{};
+	bi.bmiHeader.biSize = sizeof(bi.bmiHeader);
+	bi.bmiHeader.biWidth = frameSize.cx;
+	bi.bmiHeader.biHeight = -frameSize.cy;
+	bi.bmiHeader.biPlanes = 1;
+	bi.bmiHeader.biBitCount = 32;
+	bi.bmiHeader.biCompression = BI_RGB;
+
+	_hBmp = CreateDIBSection(_hdcMem, &bi, DIB_RGB_COLORS, (void**)&_dibBits, NULL, 0);
+	if (!_hBmp) {
+		Logger::Get().Win32Error("CreateDIBSection 失败");
+		return false;
+	}
+
+	_hOldBmp = SelectObject(_hdcMem, _hBmp);
+
+	_changeDetector = FrameChangeDetector(frameSize.cx, frameSize.cy);
+
 	Logger::Get().Info("GDIFrameSource 初始化完成");
 	return true;
 }
 
 FrameSourceBase::UpdateState GDIFrameSource::Update() {
 	HWND hwndSrc = App::Get().GetHwndSrc();
-
-	HDC hdcDest;
-	HRESULT hr = _dxgiSurface->GetDC(TRUE, &hdcDest);
-	if (FAILED(hr)) {
-		Logger::Get().ComError("从 Texture2D 获取 IDXGISurface1 失败", hr);
-		return UpdateState::Error;
-	}
+	const SIZE frameSize = Utils::GetSizeOfRect(_frameRect);
 
 	HDC hdcSrc = GetDCEx(hwndSrc, NULL, DCX_LOCKWINDOWUPDATE | DCX_WINDOW);
 	if (!hdcSrc) {
 		Logger::Get().Win32Error("GetDC 失败");
-		_dxgiSurface->ReleaseDC(nullptr);
 		return UpdateState::Error;
 	}
 
-	if (!BitBlt(hdcDest, 0, 0, _frameRect.right-_frameRect.left, _frameRect.bottom-_frameRect.top,
+	if (!BitBlt(_hdcMem, 0, 0, frameSize.cx, frameSize.cy,
 		hdcSrc, _frameRect.left, _frameRect.top, SRCCOPY)
 	) {
 		Logger::Get().Win32Error("BitBlt 失败");
 	}
 
 	ReleaseDC(hwndSrc, hdcSrc);
-	_dxgiSurface->ReleaseDC(nullptr);
+
+	// 确保 GDI 已写入位图
+	GdiFlush();
+
+	const UINT rowPitch = frameSize.cx * 4;
+	_dirtyRegion = _changeDetector.Update(_dibBits, rowPitch);
+	if (_dirtyRegion.IsEmpty()) {
+		return UpdateState::NoUpdate;
+	}
+
+	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
+	if (_dirtyRegion.IsFull()) {
+		d3dDC->UpdateSubresource(_output.get(), 0, nullptr, _dibBits, rowPitch, 0);
+	} else {
+		// 只上传变化的部分
+		for (const DirtyRegion::Rect& rect : _dirtyRegion.GetRects()) {
+			D3D11_BOX box{ (UINT)rect.left, (UINT)rect.top, 0, (UINT)rect.right, (UINT)rect.bottom, 1 };
+			d3dDC->UpdateSubresource(_output.get(), 0, &box,
+				_dibBits + (size_t)rect.top * rowPitch + (size_t)rect.left * 4, rowPitch, 0);
+		}
+	}
 
 	return UpdateState::NewFrame;
 }
@@ -1,12 +1,13 @@
 #pragma once
 #include "pch.h"
 #include "FrameSourceBase.h"
+#include "FrameChangeDetector.h"
 
 
 class GDIFrameSource : public FrameSourceBase {
 public:
 	GDIFrameSource() {};
-	virtual ~GDIFrameSource() {}
+	virtual ~GDIFrameSource();
 
 	bool Initialize() override;
 
@@ -27,5 +28,12 @@ protected:
 
 private:
 	RECT _frameRect{};
-	winrt::com_ptr<IDXGISurface1> _dxgiSurface;
+
+	// BitBlt 的目标，在 CPU 上检测变化后只上传变化的部分
+	HDC _hdcMem = NULL;
+	HBITMAP _hBmp = NULL;
+	HGDIOBJ _hOldBmp = NULL;
+	BYTE* _dibBits = nullptr;
+
+	FrameChangeDetector _changeDetector;
 };
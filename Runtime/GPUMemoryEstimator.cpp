@@ -0,0 +1,57 @@
+#include "GPUMemoryEstimator.h"
+
+
+uint64_t GPUMemoryEstimator::CalcTextureBytes(uint32_t format, uint32_t width, uint32_t height) noexcept {
+	// 格式按 DXGI_FORMAT 的顺序排列，同一布局的格式相邻
+	// 块压缩格式每 4x4 个像素占用 8 或 16 字节
+	// BC1、BC4：70~72、79~81
+	// BC2、BC3、BC5：73~78、82~84
+	// BC6H、BC7：94~99
+	if ((format >= 70 && format <= 72) || (format >= 79 && format <= 81)) {
+		return uint64_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+	}
+	if ((format >= 73 && format <= 78) || (format >= 82 && format <= 84) || (format >= 94 && format <= 99)) {
+		return uint64_t((width + 3) / 4) * ((height + 3) / 4) * 16;
+	}
+
+	uint32_t bytesPerPixel;
+	if (format >= 1 && format <= 4) {
+		// R32G32B32A32
+		bytesPerPixel = 16;
+	} else if (format >= 5 && format <= 8) {
+		// R32G32B32
+		bytesPerPixel = 12;
+	} else if (format >= 9 && format <= 18) {
+		// R16G16B16A16、R32G32
+		bytesPerPixel = 8;
+	} else if ((format >= 48 && format <= 59) || (format >= 85 && format <= 86) || format == 115) {
+		// R8G8、R16、B5G6R5、B5G5R5A1、B4G4R4A4
+		bytesPerPixel = 2;
+	} else if (format >= 60 && format <= 65) {
+		// R8、A8
+		bytesPerPixel = 1;
+	} else {
+		// 其他常用的格式都为 32 位
+		bytesPerPixel = 4;
+	}
+
+	return uint64_t(width) * height * bytesPerPixel;
+}
+
+std::vector<uint64_t> GPUMemoryEstimator::EstimateEffectChain(std::span<const Effect> effects, Size hostSize) {
+	std::vector<uint64_t> result(effects.size(), 0);
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		const Effect& effect = effects[i];
+
+		uint64_t& bytes = result[i];
+		for (const Texture& texture : effect.textures) {
+			bytes += CalcTextureBytes(texture.format, texture.size.width, texture.size.height);
+		}
+
+		const Size outputTexSize = effect.isLastEffect ? hostSize : effect.outputSize;
+		bytes += CalcTextureBytes(FORMAT_R8G8B8A8_UNORM, outputTexSize.width, outputTexSize.height);
+	}
+
+	return result;
+}
@@ -0,0 +1,49 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+// 计算纹理和效果链占用的显存，只使用格式和尺寸，不需要创建资源
+// 格式的取值和 DXGI_FORMAT 相同
+class GPUMemoryEstimator {
+public:
+	struct Size {
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	// 用到的 DXGI_FORMAT 的值
+	enum Format : uint32_t {
+		FORMAT_R32G32B32A32_FLOAT = 2,
+		FORMAT_R16G16B16A16_FLOAT = 10,
+		FORMAT_R8G8B8A8_UNORM = 28,
+		FORMAT_R16_FLOAT = 54,
+		FORMAT_R8_UNORM = 61,
+		FORMAT_BC1_UNORM = 71,
+		FORMAT_BC7_UNORM = 98
+	};
+
+	struct Texture {
+		uint32_t format = 0;
+		// 尺寸未知（如从文件加载）时为 0，不计算在内
+		Size size;
+	};
+
+	struct Effect {
+		// 中间纹理，不含 INPUT 和 OUTPUT
+		std::vector<Texture> textures;
+		Size outputSize;
+		// 带有 EFFECT_FLAG_LAST_EFFECT
+		bool isLastEffect = false;
+	};
+
+	// 一个 mip 层级占用的字节数，块压缩格式按块计算，未列出的格式按 32 位计算
+	static uint64_t CalcTextureBytes(uint32_t format, uint32_t width, uint32_t height) noexcept;
+
+	// 每个效果的中间纹理和输出纹理占用的字节数，和 EffectDrawer 创建的纹理相同
+	// 输出纹理的格式总为 R8G8B8A8_UNORM，最后一个效果的输出纹理和主窗口（hostSize）尺寸相同
+	// 效果链的最后一个效果不一定是 isLastEffect，如分块执行时
+	static std::vector<uint64_t> EstimateEffectChain(std::span<const Effect> effects, Size hostSize);
+};
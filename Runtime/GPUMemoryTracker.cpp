@@ -0,0 +1,206 @@
+#include "pch.h"
+#include "GPUMemoryTracker.h"
+#include "GPUMemoryEstimator.h"
+#include "EffectDrawer.h"
+#include "Logger.h"
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+
+void GPUMemoryTracker::Track(ID3D11Resource* resource, Owner owner, std::string_view effectName, int passIdx) {
+	if (!resource) {
+		return;
+	}
+
+	uint64_t bytes = 0;
+
+	D3D11_RESOURCE_DIMENSION dimension;
+	resource->GetType(&dimension);
+	if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D) {
+		D3D11_TEXTURE2D_DESC desc;
+		((ID3D11Texture2D*)resource)->GetDesc(&desc);
+
+		for (UINT i = 0; i < desc.MipLevels; ++i) {
+			bytes += CalcTextureBytes(desc.Format, std::max(desc.Width >> i, 1u), std::max(desc.Height >> i, 1u));
+		}
+		bytes *= desc.ArraySize;
+	} else if (dimension == D3D11_RESOURCE_DIMENSION_BUFFER) {
+		D3D11_BUFFER_DESC desc;
+		((ID3D11Buffer*)resource)->GetDesc(&desc);
+		bytes = desc.ByteWidth;
+	} else {
+		return;
+	}
+
+	// Win10 v1703 之前不支持 ID3DDestructionNotifier，此时无法得知资源何时销毁
+	winrt::com_ptr<ID3DDestructionNotifier> notifier;
+	HRESULT hr = resource->QueryInterface(IID_PPV_ARGS(notifier.put()));
+	if (FAILED(hr)) {
+		if (!_isNotifierUnsupported.exchange(true, std::memory_order_relaxed)) {
+			Logger::Get().ComError("获取 ID3DDestructionNotifier 失败，无法统计显存占用", hr);
+		}
+		return;
+	}
+
+	UINT id;
+	{
+		std::scoped_lock lk(_cs);
+
+		id = _nextId++;
+		_allocations.emplace(id, _Allocation{ owner, std::string(effectName), passIdx, bytes });
+	}
+	_ownerBytes[(size_t)owner].fetch_add(bytes, std::memory_order_relaxed);
+
+	UINT callbackId;
+	hr = notifier->RegisterDestructionCallback(_OnResourceDestroyed, (void*)(uintptr_t)id, &callbackId);
+	if (FAILED(hr)) {
+		Logger::Get().ComError("RegisterDestructionCallback 失败", hr);
+		_Untrack(id);
+	}
+}
+
+uint64_t GPUMemoryTracker::GetTotalBytes() const noexcept {
+	uint64_t result = 0;
+	for (const auto& bytes : _ownerBytes) {
+		result += bytes.load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+std::string GPUMemoryTracker::ToJson() {
+	// 同一效果的同一通道可能有多个纹理，多次缩放时也可能同时存在
+	std::map<std::pair<std::string, int>, uint64_t> passBytes;
+	{
+		std::scoped_lock lk(_cs);
+
+		for (const auto& [id, allocation] : _allocations) {
+			if (allocation.owner == Owner::Effect) {
+				passBytes[std::make_pair(allocation.effectName, allocation.passIdx)] += allocation.bytes;
+			}
+		}
+	}
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+
+	writer.Key("total");
+	writer.Uint64(GetTotalBytes());
+	writer.Key("budget");
+	writer.Uint64(GetBudget());
+
+	writer.Key("owners");
+	writer.StartObject();
+	for (size_t i = 0; i < (size_t)Owner::COUNT; ++i) {
+		writer.Key(GetOwnerName((Owner)i));
+		writer.Uint64(GetBytes((Owner)i));
+	}
+	writer.EndObject();
+
+	writer.Key("passes");
+	writer.StartArray();
+	for (const auto& [key, bytes] : passBytes) {
+		writer.StartObject();
+		writer.Key("effect");
+		writer.String(key.first.c_str(), (rapidjson::SizeType)key.first.size());
+		writer.Key("pass");
+		writer.Int(key.second);
+		writer.Key("bytes");
+		writer.Uint64(bytes);
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+const char* GPUMemoryTracker::GetOwnerName(Owner owner) noexcept {
+	switch (owner) {
+	case Owner::FrameSource:
+		return "frameSource";
+	case Owner::Effect:
+		return "effect";
+	case Owner::Cursor:
+		return "cursor";
+	case Owner::Overlay:
+		return "overlay";
+	case Owner::Renderer:
+		return "renderer";
+	default:
+		return "unknown";
+	}
+}
+
+// GPUMemoryEstimator 按 DXGI_FORMAT 的值计算
+static_assert(GPUMemoryEstimator::FORMAT_R32G32B32A32_FLOAT == DXGI_FORMAT_R32G32B32A32_FLOAT);
+static_assert(GPUMemoryEstimator::FORMAT_R16G16B16A16_FLOAT == DXGI_FORMAT_R16G16B16A16_FLOAT);
+static_assert(GPUMemoryEstimator::FORMAT_R8G8B8A8_UNORM == DXGI_FORMAT_R8G8B8A8_UNORM);
+static_assert(GPUMemoryEstimator::FORMAT_R16_FLOAT == DXGI_FORMAT_R16_FLOAT);
+static_assert(GPUMemoryEstimator::FORMAT_R8_UNORM == DXGI_FORMAT_R8_UNORM);
+static_assert(GPUMemoryEstimator::FORMAT_BC1_UNORM == DXGI_FORMAT_BC1_UNORM);
+static_assert(GPUMemoryEstimator::FORMAT_BC7_UNORM == DXGI_FORMAT_BC7_UNORM);
+static_assert(DXGI_FORMAT_R32G32_SINT == 18 && DXGI_FORMAT_R8G8_TYPELESS == 48 && DXGI_FORMAT_A8_UNORM == 65
+	&& DXGI_FORMAT_BC5_SNORM == 84 && DXGI_FORMAT_BC7_UNORM_SRGB == 99 && DXGI_FORMAT_B4G4R4A4_UNORM == 115);
+
+uint64_t GPUMemoryTracker::CalcTextureBytes(DXGI_FORMAT format, UINT width, UINT height) noexcept {
+	return GPUMemoryEstimator::CalcTextureBytes((uint32_t)format, width, height);
+}
+
+bool GPUMemoryTracker::EstimateEffectChain(
+	const std::vector<EffectDesc>& descs,
+	const std::vector<EffectParams>& params,
+	SIZE inputSize,
+	SIZE hostSize,
+	std::vector<uint64_t>& effectBytes,
+	SIZE& outputSize
+) {
+	effectBytes.clear();
+	outputSize = inputSize;
+
+	std::vector<GPUMemoryEstimator::Effect> effects(descs.size());
+
+	for (size_t i = 0; i < descs.size(); ++i) {
+		const EffectDesc& desc = descs[i];
+
+		SIZE effectOutputSize{};
+		std::vector<SIZE> texSizes;
+		if (!EffectDrawer::CalcTextureSizes(desc, params[i], outputSize, hostSize, effectOutputSize, texSizes)) {
+			return false;
+		}
+
+		GPUMemoryEstimator::Effect& effect = effects[i];
+		for (size_t j = 1; j < texSizes.size(); ++j) {
+			effect.textures.push_back({
+				(uint32_t)EffectIntermediateTextureDesc::FORMAT_DESCS[(UINT)desc.textures[j].format].dxgiFormat,
+				{ (uint32_t)texSizes[j].cx, (uint32_t)texSizes[j].cy }
+			});
+		}
+		effect.outputSize = { (uint32_t)effectOutputSize.cx, (uint32_t)effectOutputSize.cy };
+		effect.isLastEffect = desc.flags & EFFECT_FLAG_LAST_EFFECT;
+
+		outputSize = effectOutputSize;
+	}
+
+	effectBytes = GPUMemoryEstimator::EstimateEffectChain(
+		effects, { (uint32_t)hostSize.cx, (uint32_t)hostSize.cy });
+	return true;
+}
+
+void CALLBACK GPUMemoryTracker::_OnResourceDestroyed(void* context) {
+	Get()._Untrack((UINT)(uintptr_t)context);
+}
+
+void GPUMemoryTracker::_Untrack(UINT id) {
+	std::scoped_lock lk(_cs);
+
+	auto it = _allocations.find(id);
+	if (it == _allocations.end()) {
+		return;
+	}
+
+	_ownerBytes[(size_t)it->second.owner].fetch_sub(it->second.bytes, std::memory_order_relaxed);
+	_allocations.erase(it);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+#include "EffectDesc.h"
+
+
+// 统计纹理和缓冲区占用的显存，资源销毁时自动从统计中移除
+// 所有缩放会话共用，所有方法都是线程安全的
+class GPUMemoryTracker {
+public:
+	static GPUMemoryTracker& Get() noexcept {
+		static GPUMemoryTracker instance;
+		return instance;
+	}
+
+	GPUMemoryTracker(const GPUMemoryTracker&) = delete;
+	GPUMemoryTracker(GPUMemoryTracker&&) = delete;
+
+	// 资源的所有者
+	enum class Owner {
+		FrameSource,
+		Effect,
+		Cursor,
+		Overlay,
+		Renderer,
+		COUNT
+	};
+
+	// effectName 和 passIdx 只用于效果的资源，passIdx 为写入纹理的通道，不由某个通道写入时为 -1
+	void Track(ID3D11Resource* resource, Owner owner, std::string_view effectName = {}, int passIdx = -1);
+
+	uint64_t GetTotalBytes() const noexcept;
+
+	uint64_t GetBytes(Owner owner) const noexcept {
+		return _ownerBytes[(size_t)owner].load(std::memory_order_relaxed);
+	}
+
+	// 效果链的中间纹理和输出纹理的显存上限，单位为字节，为 0 时不限制
+	void SetBudget(uint64_t budget) noexcept {
+		_budget.store(budget, std::memory_order_relaxed);
+	}
+
+	uint64_t GetBudget() const noexcept {
+		return _budget.load(std::memory_order_relaxed);
+	}
+
+	// 生成 JSON 格式的快照，包含各所有者的总计和每个效果通道的占用
+	std::string ToJson();
+
+	static const char* GetOwnerName(Owner owner) noexcept;
+
+	// 一个 mip 层级占用的字节数，块压缩格式按块计算
+	static uint64_t CalcTextureBytes(DXGI_FORMAT format, UINT width, UINT height) noexcept;
+
+	// 预计效果链的中间纹理和输出纹理占用的显存，和 EffectDrawer 创建的纹理相同
+	// 不依赖缩放会话，因此 UI 可以在缩放前调用。从文件加载的纹理尺寸未知，不计算在内
+	// effectBytes 为每个效果的占用，outputSize 为最后一个效果的输出尺寸
+	static bool EstimateEffectChain(
+		const std::vector<EffectDesc>& descs,
+		const std::vector<EffectParams>& params,
+		SIZE inputSize,
+		SIZE hostSize,
+		std::vector<uint64_t>& effectBytes,
+		SIZE& outputSize
+	);
+
+private:
+	GPUMemoryTracker() = default;
+
+	static void CALLBACK _OnResourceDestroyed(void* context);
+
+	void _Untrack(UINT id);
+
+	struct _Allocation {
+		Owner owner;
+		std::string effectName;
+		int passIdx;
+		uint64_t bytes;
+	};
+
+	// 用于同步对 _allocations 的访问
+	Utils::CSMutex _cs;
+	std::unordered_map<UINT, _Allocation> _allocations;
+	UINT _nextId = 1;
+
+	std::array<std::atomic<uint64_t>, (size_t)Owner::COUNT> _ownerBytes{};
+	std::atomic<uint64_t> _budget = 0;
+	std::atomic<bool> _isNotifierUnsupported = false;
+};
@@ -3,6 +3,7 @@
 #include "App.h"
 #include "DeviceResources.h"
 #include "Config.h"
+#include "Logger.h"
 
 using namespace std::chrono_literals;
 
@@ -30,13 +31,25 @@ void GPUTimer::OnBeginFrame() {
 void GPUTimer::StartProfiling(std::chrono::microseconds updateInterval, UINT passCount) {
 	assert(passCount > 0);
 
+	// 可能正在统计，丢弃尚未取回的查询
+	_queries = {};
+	_lastEffectsTime = 0.0f;
+
 	_curQueryIdx = 0;
 	_updateProfilingTime = updateInterval;
 	_profilingCounter = {};
 
-	_queries[0].passes.resize(passCount);
-	if (App::Get().GetConfig().IsDisableLowLatency()) {
-		_queries[1].passes.resize(passCount);
+	DeviceResources& dr = App::Get().GetDeviceResources();
+	const size_t queryCount = App::Get().GetConfig().IsDisableLowLatency() ? 2 : 1;
+	for (size_t i = 0; i < queryCount; ++i) {
+		_QueryInfo& queryInfo = _queries[i];
+		queryInfo.device = std::make_unique<D3D11ComputeDevice>();
+		if (!queryInfo.device->Initialize(dr.GetD3DDevice(), dr.GetD3DDC())) {
+			Logger::Get().Error("初始化 D3D11ComputeDevice 失败");
+			StopProfiling();
+			return;
+		}
+		queryInfo.passes.resize(passCount);
 	}
 	_passesTimings.resize(passCount);
 	_gpuTimings.passes.resize(passCount);
@@ -51,18 +64,21 @@ void GPUTimer::StopProfiling() {
 	_queries = {};
 	_passesTimings = {};
 	_gpuTimings = {};
+	_lastEffectsTime = 0.0f;
 }
 
-void GPUTimer::OnBeginEffects() {
+void GPUTimer::OnBeginEffects(bool isFullFrame) {
 	if (_curQueryIdx < 0) {
 		return;
 	}
 
 	_UpdateGPUTimings();
 
-	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
-	d3dDC->Begin(_queries[_curQueryIdx].disjoint.get());
-	d3dDC->End(_queries[_curQueryIdx].start.get());
+	_QueryInfo& queryInfo = _queries[_curQueryIdx];
+	queryInfo.isFullFrame = isFullFrame;
+	queryInfo.isPending = true;
+	std::fill(queryInfo.passes.begin(), queryInfo.passes.end(), UINT32_MAX);
+	queryInfo.start = queryInfo.device->WriteTimestamp();
 }
 
 void GPUTimer::OnEndPass(UINT idx) {
@@ -70,7 +86,8 @@ void GPUTimer::OnEndPass(UINT idx) {
 		return;
 	}
 
-	App::Get().GetDeviceResources().GetD3DDC()->End(_queries[_curQueryIdx].passes[idx].get());
+	_QueryInfo& queryInfo = _queries[_curQueryIdx];
+	queryInfo.passes[idx] = queryInfo.device->WriteTimestamp();
 }
 
 void GPUTimer::OnEndEffects() {
@@ -78,16 +95,8 @@ void GPUTimer::OnEndEffects() {
 		return;
 	}
 
-	App::Get().GetDeviceResources().GetD3DDC()->End(_queries[_curQueryIdx].disjoint.get());
-}
-
-template<typename T>
-static T GetQueryData(ID3D11DeviceContext3* d3dDC, ID3D11Query* query) {
-	T data{};
-	while (S_OK != d3dDC->GetData(query, &data, sizeof(data), 0)) {
-		Sleep(0);
-	}
-	return data;
+	// 允许额外的延迟时下一帧开始前不会取回时间戳
+	_queries[_curQueryIdx].device->EndTimestamps();
 }
 
 void GPUTimer::_UpdateGPUTimings() {
@@ -99,71 +108,59 @@ void GPUTimer::_UpdateGPUTimings() {
 		_curQueryIdx = 1 - _curQueryIdx;
 	}
 
-	auto& curQueryInfo = _queries[_curQueryIdx];
-
-	if (curQueryInfo.disjoint) {
-		auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
+	_QueryInfo& curQueryInfo = _queries[_curQueryIdx];
+	if (!curQueryInfo.isPending) {
+		// 刚开始统计
+		return;
+	}
+	curQueryInfo.isPending = false;
 
-		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData = 
-			GetQueryData<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>(d3dDC, curQueryInfo.disjoint.get());
+	std::vector<uint64_t> timestamps;
+	if (curQueryInfo.device->ResolveTimestamps(timestamps)) {
+		static constexpr float NS_TO_MS = 1e-6f;
 
-		if (!disjointData.Disjoint) {
-			const float toMS = 1000.0f / disjointData.Frequency;
+		uint64_t startTimestamp = timestamps[curQueryInfo.start];
+		const uint64_t firstTimestamp = startTimestamp;
 
-			UINT64 startTimestamp = GetQueryData<UINT64>(d3dDC, curQueryInfo.start.get());
+		for (size_t i = 0; i < curQueryInfo.passes.size(); ++i) {
+			if (curQueryInfo.passes[i] == UINT32_MAX) {
+				continue;
+			}
 
-			for (size_t i = 0; i < curQueryInfo.passes.size(); ++i) {
-				UINT64 timestamp = GetQueryData<UINT64>(d3dDC, curQueryInfo.passes[i].get());
+			const uint64_t timestamp = timestamps[curQueryInfo.passes[i]];
 
-				float t = (timestamp - startTimestamp) * toMS;
-				if (t > 0.01) {
-					_passesTimings[i].first += t;
-					++_passesTimings[i].second;
-				}
-				startTimestamp = timestamp;
-			}
-		} else {
-			// 查询的值不可靠
-
-#ifdef _DEBUG
-			// 依然执行查询，否则调试层将发出警告
-			GetQueryData<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>(d3dDC, curQueryInfo.disjoint.get());
-			for (auto& query : curQueryInfo.passes) {
-				GetQueryData<UINT64>(d3dDC, query.get());
+			float t = (timestamp - startTimestamp) * NS_TO_MS;
+			if (t > 0.01) {
+				_passesTimings[i].first += t;
+				++_passesTimings[i].second;
 			}
-#endif // _DEBUG
+			startTimestamp = timestamp;
 		}
 
-		_profilingCounter += _elapsedTime;
+		if (curQueryInfo.isFullFrame) {
+			_lastEffectsTime = (startTimestamp - firstTimestamp) * NS_TO_MS;
+		}
+	}
+	// 否则查询的值不可靠
 
-		if (_firstProfilingFrame) {
-			_firstProfilingFrame = false;
+	_profilingCounter += _elapsedTime;
 
-			// 在第一帧更新一次
-			for (UINT i = 0; i < _passesTimings.size(); ++i) {
-				_gpuTimings.passes[i] = _passesTimings[i].first;
-			}
-		} else if (_profilingCounter >= _updateProfilingTime) {
-			// 更新渲染用时
-			for (UINT i = 0; i < _passesTimings.size(); ++i) {
-				_gpuTimings.passes[i] = _passesTimings[i].second == 0 ?
-					0.0f : _passesTimings[i].first / _passesTimings[i].second;
-			}
-
-			std::fill(_passesTimings.begin(), _passesTimings.end(), std::pair<float, UINT>());
+	if (_firstProfilingFrame) {
+		_firstProfilingFrame = false;
 
-			_profilingCounter %= _updateProfilingTime;
+		// 在第一帧更新一次
+		for (UINT i = 0; i < _passesTimings.size(); ++i) {
+			_gpuTimings.passes[i] = _passesTimings[i].first;
+		}
+	} else if (_profilingCounter >= _updateProfilingTime) {
+		// 更新渲染用时
+		for (UINT i = 0; i < _passesTimings.size(); ++i) {
+			_gpuTimings.passes[i] = _passesTimings[i].second == 0 ?
+				0.0f : _passesTimings[i].first / _passesTimings[i].second;
 		}
-	} else {
-		auto d3dDevice = App::Get().GetDeviceResources().GetD3DDevice();
 
-		D3D11_QUERY_DESC desc{ D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
-		d3dDevice->CreateQuery(&desc, curQueryInfo.disjoint.put());
+		std::fill(_passesTimings.begin(), _passesTimings.end(), std::pair<float, UINT>());
 
-		desc.Query = D3D11_QUERY_TIMESTAMP;
-		d3dDevice->CreateQuery(&desc, curQueryInfo.start.put());
-		for (UINT j = 0; j < curQueryInfo.passes.size(); ++j) {
-			d3dDevice->CreateQuery(&desc, curQueryInfo.passes[j].put());
-		}
+		_profilingCounter %= _updateProfilingTime;
 	}
 }
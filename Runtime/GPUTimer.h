@@ -1,5 +1,6 @@
 #pragma once
 #include "pch.h"
+#include "D3D11ComputeDevice.h"
 
 
 // 用于记录帧率和 GPU 时间
@@ -36,13 +37,24 @@ public:
 
 	void StopProfiling();
 
-	void OnBeginEffects();
+	bool IsProfiling() const noexcept {
+		return _curQueryIdx >= 0;
+	}
+
+	// isFullFrame 为真表示此帧中所有效果都完整渲染，只有这样的帧的用时会被 ConsumeEffectsTime 返回
+	void OnBeginEffects(bool isFullFrame);
 
 	// 每个通道结束后调用
 	void OnEndPass(UINT idx);
 
 	void OnEndEffects();
 
+	// 最近统计到的完整一帧中所有效果的总用时，单位为 ms
+	// 每帧的数据只返回一次，没有新数据时返回 0
+	float ConsumeEffectsTime() noexcept {
+		return std::exchange(_lastEffectsTime, 0.0f);
+	}
+
 private:
 	void _UpdateGPUTimings();
 
@@ -64,11 +76,16 @@ private:
 	std::chrono::nanoseconds _profilingCounter{};
 
 	struct _QueryInfo {
-		winrt::com_ptr<ID3D11Query> disjoint;
-		winrt::com_ptr<ID3D11Query> start;
-		std::vector<winrt::com_ptr<ID3D11Query>> passes;
+		// 只用于记录这一帧的时间戳，查询对象由它在帧之间复用
+		std::unique_ptr<D3D11ComputeDevice> device;
+		// 效果开始前的时间戳的索引
+		uint32_t start = 0;
+		// 每个通道结束时的时间戳的索引，没有记录的为 UINT32_MAX
+		std::vector<uint32_t> passes;
+		// 是否有尚未取回的时间戳
+		bool isPending = false;
+		bool isFullFrame = false;
 	};
-	// [(disjoint, [timestamp])]
 	// 允许额外的延迟时需保存两帧的数据
 	std::array<_QueryInfo, 2> _queries;
 	// -1：无需统计渲染时间
@@ -78,4 +95,6 @@ private:
 	// 用于保存渲染时间
 	// (总计用时, 已统计帧数)
 	std::vector<std::pair<float, UINT>> _passesTimings;
+
+	float _lastEffectsTime = 0.0f;
 };
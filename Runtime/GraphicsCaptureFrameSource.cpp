@@ -7,6 +7,7 @@
 #include "Utils.h"
 #include "DeviceResources.h"
 #include "Logger.h"
+#include "GPUMemoryTracker.h"
 
 
 namespace winrt {
@@ -29,6 +30,12 @@ bool GraphicsCaptureFrameSource::Initialize() {
 		return false;
 	}
 
+	// FrameArrived 可能在初始化完成前触发
+	if (!_CreateNewFrameEvent()) {
+		Logger::Get().Error("_CreateNewFrameEvent 失败");
+		return false;
+	}
+
 	HRESULT hr;
 	
 	winrt::com_ptr<IGraphicsCaptureItemInterop> interop;
@@ -87,7 +94,8 @@ bool GraphicsCaptureFrameSource::Initialize() {
 		_captureFramePool = winrt::Direct3D11CaptureFramePool::CreateFreeThreaded(
 			_wrappedD3DDevice,
 			winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized,
-			1,	// 帧的缓存数量
+			// 帧的缓存数量，邮箱的中间缓冲区、渲染线程和捕获各占用一个，捕获因此不会等待渲染线程
+			FrameMailbox<_CapturedFrame>::SLOT_COUNT,
 			{ (int)_frameBox.right, (int)_frameBox.bottom } // 帧的尺寸为包含源窗口的最小尺寸
 		);
 
@@ -143,8 +151,7 @@ bool GraphicsCaptureFrameSource::Initialize() {
 		Logger::Get().Error("创建纹理失败");
 		return false;
 	}
-
-	InitializeConditionVariable(&_cv);
+	GPUMemoryTracker::Get().Track(_output.get(), GPUMemoryTracker::Owner::FrameSource);
 
 	App::Get().SetErrorMsg(ErrorMessages::GENERIC);
 	Logger::Get().Info("GraphicsCaptureFrameSource 初始化完成");
@@ -152,51 +159,7 @@ bool GraphicsCaptureFrameSource::Initialize() {
 }
 
 FrameSourceBase::UpdateState GraphicsCaptureFrameSource::Update() {
-	// 每次睡眠 1 毫秒等待新帧到达，防止 CPU 占用过高
-	BOOL update = FALSE;
-
-	{
-		std::scoped_lock lk(_cs);
-		if (!_newFrameArrived) {
-			SleepConditionVariableCS(&_cv, _cs.get(), 1);
-		}
-
-		if (_newFrameArrived) {
-			_newFrameArrived = false;
-			update = TRUE;
-		}
-	}
-
-	if (update) {
-		winrt::Direct3D11CaptureFrame frame = _captureFramePool.TryGetNextFrame();
-		if (!frame) {
-			// 缓冲池没有帧，不应发生此情况
-			assert(false);
-
-			return UpdateState::Waiting;
-		}
-
-		// 从帧获取 IDXGISurface
-		winrt::IDirect3DSurface d3dSurface = frame.Surface();
-
-		winrt::com_ptr<::Windows::Graphics::DirectX::Direct3D11::IDirect3DDxgiInterfaceAccess> dxgiInterfaceAccess(
-			d3dSurface.as<::Windows::Graphics::DirectX::Direct3D11::IDirect3DDxgiInterfaceAccess>()
-		);
-
-		winrt::com_ptr<ID3D11Texture2D> withFrame;
-		HRESULT hr = dxgiInterfaceAccess->GetInterface(IID_PPV_ARGS(&withFrame));
-		if (FAILED(hr)) {
-			Logger::Get().ComError("从获取 IDirect3DSurface 获取 ID3D11Texture2D 失败", hr);
-			return UpdateState::Error;
-		}
-
-		App::Get().GetDeviceResources().GetD3DDC()
-			->CopySubresourceRegion(_output.get(), 0, 0, 0, 0, withFrame.get(), 0, &_frameBox);
-
-		return UpdateState::NewFrame;
-	} else {
-		return UpdateState::Waiting;
-	}
+	return _UpdateFromMailbox();
 }
 
 bool GraphicsCaptureFrameSource::_CaptureFromWindow(IGraphicsCaptureItemInterop* interop) {
@@ -344,14 +307,36 @@ bool GraphicsCaptureFrameSource::_CaptureFromMonitor(IGraphicsCaptureItemInterop
 	return true;
 }
 
-void GraphicsCaptureFrameSource::_OnFrameArrived(winrt::Direct3D11CaptureFramePool const&, winrt::IInspectable const&) {
-	// 更改标志，如果主线程正在等待，唤醒主线程
-	{
-		std::scoped_lock lk(_cs);
-		_newFrameArrived = true;
+void GraphicsCaptureFrameSource::_OnFrameArrived(winrt::Direct3D11CaptureFramePool const& sender, winrt::IInspectable const&) {
+	// 在回调中取出帧并发布，未被渲染的旧帧被替换后立即归还给缓冲池
+	winrt::Direct3D11CaptureFrame frame = sender.TryGetNextFrame();
+	if (!frame) {
+		return;
 	}
 
-	WakeConditionVariable(&_cv);
+	// 从帧获取 IDXGISurface
+	winrt::IDirect3DSurface d3dSurface = frame.Surface();
+
+	winrt::com_ptr<::Windows::Graphics::DirectX::Direct3D11::IDirect3DDxgiInterfaceAccess> dxgiInterfaceAccess(
+		d3dSurface.as<::Windows::Graphics::DirectX::Direct3D11::IDirect3DDxgiInterfaceAccess>()
+	);
+
+	winrt::com_ptr<ID3D11Texture2D> withFrame;
+	HRESULT hr = dxgiInterfaceAccess->GetInterface(IID_PPV_ARGS(&withFrame));
+	if (FAILED(hr)) {
+		Logger::Get().ComError("从获取 IDirect3DSurface 获取 ID3D11Texture2D 失败", hr);
+		return;
+	}
+
+	_CapturedFrame& captured = _mailbox.GetBackBuffer();
+	captured.texture = std::move(withFrame);
+	captured.box = _frameBox;
+	// 无法获知变化区域
+	captured.dirtyRegion.SetFull();
+	// 帧被释放前它的纹理不会被缓冲池复用
+	captured.owner = std::move(frame);
+
+	_PublishFrame();
 }
 
 GraphicsCaptureFrameSource::~GraphicsCaptureFrameSource() {
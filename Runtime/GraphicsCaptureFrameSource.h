@@ -58,9 +58,4 @@ private:
 	winrt::GraphicsCaptureSession _captureSession{ nullptr };
 	winrt::IDirect3DDevice _wrappedD3DDevice{ nullptr };
 	winrt::Direct3D11CaptureFramePool::FrameArrived_revoker _frameArrived;
-
-	// 用于线程同步
-	CONDITION_VARIABLE _cv{};
-	Utils::CSMutex _cs;
-	bool _newFrameArrived = false;
 };
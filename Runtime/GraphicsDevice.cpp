@@ -0,0 +1,286 @@
+#include "pch.h"
+#include "GraphicsDevice.h"
+#include "StrUtils.h"
+#include "Logger.h"
+
+
+static inline void LogAdapter(const DXGI_ADAPTER_DESC1& adapterDesc) {
+	Logger::Get().Info(fmt::format("当前图形适配器：\n\tVendorId：{:#x}\n\tDeviceId：{:#x}\n\t描述：{}",
+		adapterDesc.VendorId, adapterDesc.DeviceId, StrUtils::UTF16ToUTF8(adapterDesc.Description)));
+}
+
+static winrt::com_ptr<IDXGIAdapter3> ObtainGraphicsAdapter(IDXGIFactory4* dxgiFactory, int adapterIdx) {
+	winrt::com_ptr<IDXGIAdapter1> adapter;
+
+	if (adapterIdx >= 0) {
+		HRESULT hr = dxgiFactory->EnumAdapters1(adapterIdx, adapter.put());
+		if (SUCCEEDED(hr)) {
+			DXGI_ADAPTER_DESC1 desc;
+			HRESULT hr = adapter->GetDesc1(&desc);
+			if (FAILED(hr)) {
+				return nullptr;
+			}
+
+			LogAdapter(desc);
+			return adapter.try_as<IDXGIAdapter3>();
+		}
+	}
+
+	// 枚举查找第一个支持 D3D11 的图形适配器
+	for (UINT adapterIndex = 0;
+		SUCCEEDED(dxgiFactory->EnumAdapters1(adapterIndex, adapter.put()));
+		++adapterIndex
+	) {
+		DXGI_ADAPTER_DESC1 desc;
+		HRESULT hr = adapter->GetDesc1(&desc);
+		if (FAILED(hr)) {
+			continue;
+		}
+
+		if (desc.Flags == DXGI_ADAPTER_FLAG_SOFTWARE) {
+			continue;
+		}
+
+		D3D_FEATURE_LEVEL featureLevels[] = {
+			D3D_FEATURE_LEVEL_11_1,
+			D3D_FEATURE_LEVEL_11_0
+		};
+		UINT nFeatureLevels = ARRAYSIZE(featureLevels);
+
+		hr = D3D11CreateDevice(
+			adapter.get(),
+			D3D_DRIVER_TYPE_UNKNOWN,
+			nullptr,
+			0,
+			featureLevels,
+			nFeatureLevels,
+			D3D11_SDK_VERSION,
+			nullptr,
+			nullptr,
+			nullptr
+		);
+		if (SUCCEEDED(hr)) {
+			LogAdapter(desc);
+			return adapter.try_as<IDXGIAdapter3>();
+		}
+	}
+
+	// 回落到 Basic Render Driver Adapter（WARP）
+	// https://docs.microsoft.com/en-us/windows/win32/direct3darticles/directx-warp
+	HRESULT hr = dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&adapter));
+	if (FAILED(hr)) {
+		Logger::Get().ComError("创建 WARP 设备失败", hr);
+		return nullptr;
+	}
+
+	return adapter.try_as<IDXGIAdapter3>();
+}
+
+bool GraphicsDevice::Initialize(int adapterIdx) {
+	_adapterIdx = adapterIdx;
+
+#ifdef _DEBUG
+	UINT flag = DXGI_CREATE_FACTORY_DEBUG;
+#else
+	UINT flag = 0;
+#endif // _DEBUG
+
+	HRESULT hr = CreateDXGIFactory2(flag, IID_PPV_ARGS(_dxgiFactory.put()));
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	// 检查可变帧率支持
+	BOOL supportTearing = FALSE;
+
+	hr = _dxgiFactory->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &supportTearing, sizeof(supportTearing));
+	if (FAILED(hr)) {
+		Logger::Get().ComWarn("CheckFeatureSupport 失败", hr);
+	}
+	_supportTearing = !!supportTearing;
+
+	Logger::Get().Info(fmt::format("可变刷新率支持：{}", supportTearing ? "是" : "否"));
+
+	UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+	if (IsDebugLayersAvailable()) {
+		// 在 DEBUG 配置启用调试层
+		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
+	}
+
+	D3D_FEATURE_LEVEL featureLevels[] = {
+		D3D_FEATURE_LEVEL_11_1,
+		D3D_FEATURE_LEVEL_11_0
+	};
+	UINT nFeatureLevels = ARRAYSIZE(featureLevels);
+
+	_graphicsAdapter = ObtainGraphicsAdapter(_dxgiFactory.get(), adapterIdx);
+	if (!_graphicsAdapter) {
+		Logger::Get().Error("找不到可用 Adapter");
+		return false;
+	}
+
+	winrt::com_ptr<ID3D11Device> d3dDevice;
+	winrt::com_ptr<ID3D11DeviceContext> d3dDC;
+	hr = D3D11CreateDevice(
+		_graphicsAdapter.get(),
+		D3D_DRIVER_TYPE_UNKNOWN,
+		nullptr,
+		createDeviceFlags,
+		featureLevels,
+		nFeatureLevels,
+		D3D11_SDK_VERSION,
+		d3dDevice.put(),
+		&_featureLevel,
+		d3dDC.put()
+	);
+
+	if (FAILED(hr)) {
+		Logger::Get().ComError("D3D11CreateDevice 失败", hr);
+		return false;
+	}
+
+	std::string_view fl;
+	switch (_featureLevel) {
+	case D3D_FEATURE_LEVEL_11_1:
+		fl = "11.1";
+		break;
+	case D3D_FEATURE_LEVEL_11_0:
+		fl = "11.0";
+		break;
+	default:
+		fl = "未知";
+		break;
+	}
+	Logger::Get().Info(fmt::format("已创建 D3D Device\n\t功能级别：{}", fl));
+
+	_d3dDevice = d3dDevice.try_as<ID3D11Device3>();
+	if (!_d3dDevice) {
+		Logger::Get().Error("获取 ID3D11Device1 失败");
+		return false;
+	}
+
+	_d3dDC = d3dDC.try_as<ID3D11DeviceContext3>();
+	if (!_d3dDC) {
+		Logger::Get().Error("获取 ID3D11DeviceContext1 失败");
+		return false;
+	}
+
+	_dxgiDevice = _d3dDevice.try_as<IDXGIDevice4>();
+	if (!_dxgiDevice) {
+		Logger::Get().Error("获取 IDXGIDevice 失败");
+		return false;
+	}
+
+	return true;
+}
+
+bool GraphicsDevice::IsValid() const {
+	HRESULT hr = _d3dDevice->GetDeviceRemovedReason();
+	if (FAILED(hr)) {
+		Logger::Get().ComError("设备已被移除", hr);
+		return false;
+	}
+
+	// 添加或移除显卡后工厂不再是最新的，适配器的序号可能改变
+	return _dxgiFactory->IsCurrent();
+}
+
+bool GraphicsDevice::IsDebugLayersAvailable() {
+#ifdef _DEBUG
+	static std::optional<bool> result = std::nullopt;
+
+	if (!result.has_value()) {
+		HRESULT hr = D3D11CreateDevice(
+			nullptr,
+			D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
+			nullptr,
+			D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
+			nullptr,                    // Any feature level will do.
+			0,
+			D3D11_SDK_VERSION,
+			nullptr,                    // No need to keep the D3D device reference.
+			nullptr,                    // No need to know the feature level.
+			nullptr                     // No need to keep the D3D device context reference.
+		);
+
+		result = SUCCEEDED(hr);
+	}
+
+	return result.value_or(false);
+#else
+	// Relaese 配置不使用调试层
+	return false;
+#endif
+}
+
+ID3D11DeviceContext3* GraphicsDevice::GetDeferredDC() {
+	if (_deferredDC || _isDeferredDCFailed) {
+		return _deferredDC.get();
+	}
+
+	winrt::com_ptr<ID3D11DeviceContext3> d3dDC;
+	HRESULT hr = _d3dDevice->CreateDeferredContext3(0, d3dDC.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("CreateDeferredContext3 失败", hr);
+		_isDeferredDCFailed = true;
+		return nullptr;
+	}
+
+	_deferredDC = std::move(d3dDC);
+	return _deferredDC.get();
+}
+
+bool GraphicsDevice::GetSampler(D3D11_FILTER filterMode, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** result) {
+	std::scoped_lock lk(_cacheLock);
+
+	auto key = std::make_pair(filterMode, addressMode);
+	auto it = _samMap.find(key);
+	if (it != _samMap.end()) {
+		*result = it->second.get();
+		return true;
+	}
+
+	winrt::com_ptr<ID3D11SamplerState> sam;
+
+	D3D11_SAMPLER_DESC desc{};
+	desc.Filter = filterMode;
+	desc.AddressU = addressMode;
+	desc.AddressV = addressMode;
+	desc.AddressW = addressMode;
+	desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	desc.MinLOD = 0;
+	desc.MaxLOD = 0;
+	HRESULT hr = _d3dDevice->CreateSamplerState(&desc, sam.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("创建 ID3D11SamplerState 出错", hr);
+		return false;
+	}
+
+	*result = sam.get();
+	_samMap.emplace(key, std::move(sam));
+	return true;
+}
+
+winrt::com_ptr<ID3D11ComputeShader> GraphicsDevice::GetComputeShader(const std::string& hash, ID3DBlob* cso) {
+	std::scoped_lock lk(_cacheLock);
+
+	if (!hash.empty()) {
+		auto it = _shaderMap.find(hash);
+		if (it != _shaderMap.end()) {
+			return it->second;
+		}
+	}
+
+	winrt::com_ptr<ID3D11ComputeShader> result;
+	HRESULT hr = _d3dDevice->CreateComputeShader(cso->GetBufferPointer(), cso->GetBufferSize(), nullptr, result.put());
+	if (FAILED(hr)) {
+		Logger::Get().ComError("创建计算着色器失败", hr);
+		return nullptr;
+	}
+
+	if (!hash.empty()) {
+		_shaderMap.emplace(hash, result);
+	}
+
+	return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+
+
+// D3D 设备和只依赖设备的对象，由所有使用同一个图形适配器的缩放会话共享
+// 交换链和视图属于单个会话，见 DeviceResources
+class GraphicsDevice {
+public:
+	GraphicsDevice() = default;
+	GraphicsDevice(const GraphicsDevice&) = delete;
+	GraphicsDevice(GraphicsDevice&&) = delete;
+
+	// 不依赖主窗口，可以在其他线程中执行
+	bool Initialize(int adapterIdx);
+
+	// 设备没有被移除，且图形适配器没有变化
+	bool IsValid() const;
+
+	static bool IsDebugLayersAvailable();
+
+	// 创建时请求的图形适配器序号，只有序号相同的会话才能共享此设备
+	int GetAdapterIdx() const noexcept { return _adapterIdx; }
+
+	bool IsTearingSupported() const noexcept { return _supportTearing; }
+
+	ID3D11Device3* GetD3DDevice() const noexcept { return _d3dDevice.get(); }
+	D3D_FEATURE_LEVEL GetFeatureLevel() const noexcept { return _featureLevel; }
+	ID3D11DeviceContext3* GetD3DDC() const noexcept { return _d3dDC.get(); }
+	IDXGIFactory5* GetDXGIFactory() const noexcept { return _dxgiFactory.get(); }
+	IDXGIDevice4* GetDXGIDevice() const noexcept { return _dxgiDevice.get(); }
+	IDXGIAdapter3* GetGraphicsAdapter() const noexcept { return _graphicsAdapter.get(); }
+
+	// 多个会话在不同的线程中使用同一个设备上下文，使用前必须持有此锁
+	// 渲染线程渲染一个会话的一帧时持有它，会话在 UI 线程中初始化和销毁时也持有它
+	Utils::CSMutex& GetContextLock() noexcept { return _contextLock; }
+
+	// 用于录制命令列表的延迟上下文，首次使用时创建，失败时返回 nullptr
+	// 录制后状态被清空，因此同一时间只能录制一个命令列表，使用时也须持有 GetContextLock
+	ID3D11DeviceContext3* GetDeferredDC();
+
+	// 可以在任何线程中调用
+	bool GetSampler(D3D11_FILTER filterMode, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** result);
+
+	// 相同的字节码只创建一个着色器对象，hash 为空时不缓存
+	// 可以在任何线程中调用
+	winrt::com_ptr<ID3D11ComputeShader> GetComputeShader(const std::string& hash, ID3DBlob* cso);
+
+private:
+	winrt::com_ptr<IDXGIFactory5> _dxgiFactory;
+	winrt::com_ptr<IDXGIDevice4> _dxgiDevice;
+	winrt::com_ptr<IDXGIAdapter3> _graphicsAdapter;
+	winrt::com_ptr<ID3D11Device3> _d3dDevice;
+	winrt::com_ptr<ID3D11DeviceContext3> _d3dDC;
+	winrt::com_ptr<ID3D11DeviceContext3> _deferredDC;
+	bool _isDeferredDCFailed = false;
+
+	int _adapterIdx = 0;
+	bool _supportTearing = false;
+	D3D_FEATURE_LEVEL _featureLevel = D3D_FEATURE_LEVEL_10_0;
+
+	Utils::CSMutex _contextLock;
+
+	Utils::CSMutex _cacheLock;
+	std::unordered_map<
+		std::pair<D3D11_FILTER, D3D11_TEXTURE_ADDRESS_MODE>,
+		winrt::com_ptr<ID3D11SamplerState>
+	> _samMap;
+	std::unordered_map<std::string, winrt::com_ptr<ID3D11ComputeShader>> _shaderMap;
+};
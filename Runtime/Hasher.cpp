@@ -0,0 +1,33 @@
+#include "Hasher.h"
+#include <cstring>
+#include <new>
+#include <xxhash.h>
+
+
+Hasher::Hasher() {
+	_state = XXH3_createState();
+	if (!_state) {
+		// 只在内存不足时发生
+		throw std::bad_alloc();
+	}
+
+	XXH3_128bits_reset(_state);
+}
+
+Hasher::~Hasher() {
+	XXH3_freeState(_state);
+}
+
+void Hasher::Update(std::span<const uint8_t> data) noexcept {
+	XXH3_128bits_update(_state, data.data(), data.size());
+}
+
+std::array<uint8_t, Hasher::HASH_LENGTH> Hasher::Digest() const noexcept {
+	XXH128_canonical_t canonical;
+	XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(_state));
+
+	std::array<uint8_t, HASH_LENGTH> result;
+	static_assert(sizeof(canonical.digest) == HASH_LENGTH);
+	std::memcpy(result.data(), canonical.digest, HASH_LENGTH);
+	return result;
+}
@@ -0,0 +1,43 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+
+struct XXH3_state_s;
+
+// 流式的 XXH3-128，分多次写入和一次性计算全部数据的结果相同
+class Hasher {
+public:
+	Hasher();
+	~Hasher();
+
+	Hasher(const Hasher&) = delete;
+	Hasher(Hasher&&) = delete;
+
+	// 哈希结果的字节数
+	static constexpr uint32_t HASH_LENGTH = 16;
+
+	void Update(std::span<const uint8_t> data) noexcept;
+
+	// 同时写入字符串的长度，因此相邻字段的边界不会产生歧义
+	void Update(std::string_view str) noexcept {
+		UpdateValue((uint64_t)str.size());
+		Update(std::span((const uint8_t*)str.data(), str.size()));
+	}
+
+	template<typename T>
+	void UpdateValue(const T& value) noexcept {
+		static_assert(std::is_trivially_copyable_v<T>);
+		Update(std::span((const uint8_t*)&value, sizeof(T)));
+	}
+
+	// 不会改变内部状态，之后可以继续写入数据
+	std::array<uint8_t, HASH_LENGTH> Digest() const noexcept;
+
+private:
+	XXH3_state_s* _state = nullptr;
+};
@@ -10,9 +10,19 @@
 #include "Logger.h"
 #include "WindowsMessages.h"
 #include "Config.h"
+#include "GPUMemoryTracker.h"
 
 
+// 拥有 ImGui 上下文的实例
+static std::atomic<ImGuiImpl*> contextOwner = nullptr;
+// 鼠标钩子将消息转发到此窗口
+static HWND hwndHookTarget = NULL;
+
 ImGuiImpl::~ImGuiImpl() {
+	if (contextOwner.load(std::memory_order_acquire) != this) {
+		return;
+	}
+
 	ImGuiIO& io = ImGui::GetIO();
 	io.BackendPlatformName = nullptr;
 	io.BackendPlatformUserData = nullptr;
@@ -26,17 +36,20 @@ ImGuiImpl::~ImGuiImpl() {
 
 	ImGui_ImplDX11_Shutdown();
 	ImGui::DestroyContext();
+
+	contextOwner.store(nullptr, std::memory_order_release);
 }
 
-static std::optional<LRESULT> WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-	ImGuiIO& io = ImGui::GetIO();
+bool ImGuiImpl::IsAvailable() noexcept {
+	return contextOwner.load(std::memory_order_acquire) == nullptr;
+}
 
-	if (!io.WantCaptureMouse) {
-		if (msg == WM_LBUTTONDOWN && App::Get().GetConfig().Is3DMode()) {
-			App::Get().GetRenderer().SetUIVisibility(false);
-		}
-		return std::nullopt;
-	}
+// ImGui 的状态只能在渲染线程中修改，UI 线程通过此变量获知是否需要捕获鼠标
+static std::atomic<bool> wantCaptureMouse = false;
+
+// 在渲染线程中执行
+static void HandleMouseMessage(HWND hwnd, UINT msg, WPARAM wParam) {
+	ImGuiIO& io = ImGui::GetIO();
 
 	switch (msg) {
 	case WM_LBUTTONDOWN: case WM_LBUTTONDBLCLK:
@@ -51,9 +64,6 @@ static std::optional<LRESULT> WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam,
 		if (msg == WM_XBUTTONDOWN || msg == WM_XBUTTONDBLCLK) { button = (GET_XBUTTON_WPARAM(wParam) == XBUTTON1) ? 3 : 4; }
 
 		if (!ImGui::IsAnyMouseDown()) {
-			if (!GetCapture()) {
-				SetCapture(hwnd);
-			}
 			App::Get().GetCursorManager().OnCursorCapturedOnOverlay();
 		}
 
@@ -74,9 +84,8 @@ static std::optional<LRESULT> WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam,
 		io.MouseDown[button] = false;
 
 		if (!ImGui::IsAnyMouseDown()) {
-			if (GetCapture() == hwnd) {
-				ReleaseCapture();
-			}
+			// 鼠标捕获只能在 UI 线程中释放
+			PostMessage(hwnd, WindowsMessages::WM_RELEASE_CAPTURE, 0, 0);
 			App::Get().GetCursorManager().OnCursorReleasedOnOverlay();
 		}
 		
@@ -89,6 +98,46 @@ static std::optional<LRESULT> WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam,
 		io.MouseWheelH += (float)GET_WHEEL_DELTA_WPARAM(wParam) / (float)WHEEL_DELTA;
 		break;
 	}
+}
+
+// 在 UI 线程中执行
+static std::optional<LRESULT> WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	if (msg == WindowsMessages::WM_RELEASE_CAPTURE) {
+		if (GetCapture() == hwnd) {
+			ReleaseCapture();
+		}
+		return 0;
+	}
+
+	if (!wantCaptureMouse.load(std::memory_order_acquire)) {
+		if (msg == WM_LBUTTONDOWN && App::Get().GetConfig().Is3DMode()) {
+			App::Get().PostToRenderThread([]() {
+				App::Get().GetRenderer().SetUIVisibility(false);
+			});
+		}
+		return std::nullopt;
+	}
+
+	switch (msg) {
+	case WM_LBUTTONDOWN: case WM_LBUTTONDBLCLK:
+	case WM_RBUTTONDOWN: case WM_RBUTTONDBLCLK:
+	case WM_MBUTTONDOWN: case WM_MBUTTONDBLCLK:
+	case WM_XBUTTONDOWN: case WM_XBUTTONDBLCLK:
+		if (!GetCapture()) {
+			SetCapture(hwnd);
+		}
+		[[fallthrough]];
+	case WM_LBUTTONUP:
+	case WM_RBUTTONUP:
+	case WM_MBUTTONUP:
+	case WM_XBUTTONUP:
+	case WM_MOUSEWHEEL:
+	case WM_MOUSEHWHEEL:
+		App::Get().PostToRenderThread([hwnd, msg, wParam]() {
+			HandleMouseMessage(hwnd, msg, wParam);
+		});
+		break;
+	}
 
 	return std::nullopt;
 }
@@ -98,19 +147,19 @@ static LRESULT CALLBACK LowLevelMouseProc(
   _In_ WPARAM wParam,
   _In_ LPARAM lParam
 ) {
-	if (nCode != HC_ACTION || !ImGui::GetIO().WantCaptureMouse) {
+	if (nCode != HC_ACTION || !wantCaptureMouse.load(std::memory_order_acquire)) {
 		return CallNextHookEx(NULL, nCode, wParam, lParam);
 	}
 
 	if (wParam == WM_MOUSEWHEEL || wParam == WM_MOUSEHWHEEL) {
 		// 向主线程发送滚动数据
 		// 使用 Windows 消息进行线程同步
-		PostMessage(App::Get().GetHwndHost(), (UINT)wParam, ((MSLLHOOKSTRUCT*)lParam)->mouseData, 0);
+		PostMessage(hwndHookTarget, (UINT)wParam, ((MSLLHOOKSTRUCT*)lParam)->mouseData, 0);
 
 		// 阻断滚轮消息，防止传给源窗口
 		return -1;
 	} else if (wParam >= WM_LBUTTONDOWN && wParam <= WM_RBUTTONUP) {
-		PostMessage(App::Get().GetHwndHost(), (UINT)wParam, 0, 0);
+		PostMessage(hwndHookTarget, (UINT)wParam, 0, 0);
 
 		// 阻断点击消息，防止传给源窗口
 		return -1;
@@ -148,6 +197,12 @@ bool ImGuiImpl::Initialize() {
 		return false;
 	}
 #endif // _DEBUG
+
+	ImGuiImpl* expected = nullptr;
+	if (!contextOwner.compare_exchange_strong(expected, this, std::memory_order_acq_rel)) {
+		Logger::Get().Error("ImGui 已被其他缩放使用");
+		return false;
+	}
 	
 	ImGui::CreateContext();
 
@@ -161,10 +216,12 @@ bool ImGuiImpl::Initialize() {
 	auto& dr = App::Get().GetDeviceResources();
 	ImGui_ImplDX11_Init(dr.GetD3DDevice(), dr.GetD3DDC());
 
-	if (!dr.GetRenderTargetView(dr.GetBackBuffer(), &_rtv)) {
+	ID3D11RenderTargetView* rtv = nullptr;
+	if (!dr.GetRenderTargetView(dr.GetBackBuffer(), &rtv)) {
 		Logger::Get().Error("GetRenderTargetView 失败");
 		return false;
 	}
+	_rtv.copy_from(rtv);
 
 	_handlerId = App::Get().RegisterWndProcHandler(WndProcHandler);
 	if (_handlerId == 0) {
@@ -174,6 +231,8 @@ bool ImGuiImpl::Initialize() {
 
 	// 断点模式下不注册鼠标钩子，否则调试时鼠标无法使用
 	if (!App::Get().GetConfig().IsBreakpointMode() && !App::Get().GetConfig().Is3DMode()) {
+		// 钩子线程不属于任何会话
+		hwndHookTarget = App::Get().GetHwndHost();
 		_hHookThread = CreateThread(nullptr, 0, ThreadProc, nullptr, 0, &_hookThreadId);
 		if (!_hHookThread) {
 			Logger::Get().Win32Error("创建线程失败");
@@ -237,6 +296,13 @@ void ImGuiImpl::NewFrame() {
 	ImGui_ImplDX11_NewFrame();
 	ImGui::NewFrame();
 
+	if (!_isFontTextureTracked && io.Fonts->TexID) {
+		winrt::com_ptr<ID3D11Resource> fontTexture;
+		((ID3D11ShaderResourceView*)io.Fonts->TexID)->GetResource(fontTexture.put());
+		GPUMemoryTracker::Get().Track(fontTexture.get(), GPUMemoryTracker::Owner::Overlay);
+		_isFontTextureTracked = true;
+	}
+
 	// 将所有 ImGUI 窗口限制在视口内
 	SIZE outputSize = Utils::GetSizeOfRect(App::Get().GetRenderer().GetOutputRect());
 	for (ImGuiWindow* window : ImGui::GetCurrentContext()->Windows) {
@@ -261,6 +327,8 @@ void ImGuiImpl::NewFrame() {
 		ImGui::SetWindowPos(window, pos);
 	}
 
+	wantCaptureMouse.store(io.WantCaptureMouse, std::memory_order_release);
+
 	CursorManager& cm = App::Get().GetCursorManager();
 
 	if (io.WantCaptureMouse) {
@@ -280,7 +348,8 @@ void ImGuiImpl::EndFrame() {
 	ImGui::GetDrawData()->DisplaySize = ImVec2((float)(outputRect.right), (float)(outputRect.bottom));
 
 	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
-	d3dDC->OMSetRenderTargets(1, &_rtv, NULL);
+	ID3D11RenderTargetView* rtv = _rtv.get();
+	d3dDC->OMSetRenderTargets(1, &rtv, NULL);
 	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 }
 
@@ -318,9 +387,7 @@ void ImGuiImpl::ClearStates() {
 
 	auto& cm = App::Get().GetCursorManager();
 	if (cm.IsCursorCapturedOnOverlay()) {
-		if (GetCapture() == App::Get().GetHwndHost()) {
-			ReleaseCapture();
-		}
+		PostMessage(App::Get().GetHwndHost(), WindowsMessages::WM_RELEASE_CAPTURE, 0, 0);
 		cm.OnCursorReleasedOnOverlay();
 	}
 
@@ -337,4 +404,6 @@ void ImGuiImpl::ClearStates() {
 		ImGui::NewFrame();
 		ImGui::EndFrame();
 	}
+
+	wantCaptureMouse.store(io.WantCaptureMouse, std::memory_order_release);
 }
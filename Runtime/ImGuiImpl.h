@@ -20,11 +20,18 @@ public:
 
 	// 将提示窗口限制在屏幕内
 	static void Tooltip(const char* content, float maxWidth = -1.0f);
+
+	// ImGui 使用全局的上下文，同一时间只能有一个缩放会话使用它
+	static bool IsAvailable() noexcept;
 private:
-	ID3D11RenderTargetView* _rtv = nullptr;
+	// 后缓冲区的视图，持有引用以免被 DeviceResources 的缓存移除
+	winrt::com_ptr<ID3D11RenderTargetView> _rtv;
 	UINT _handlerId = 0;
 
 	HANDLE _hHookThread = NULL;
 	DWORD _hookThreadId = 0;
 	std::atomic<float> _wheelData = 0;
+
+	// 字体纹理在第一帧创建，之后统计其显存占用
+	bool _isFontTextureTracked = false;
 };
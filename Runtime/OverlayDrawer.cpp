@@ -10,6 +10,8 @@
 #include "Config.h"
 #include "StrUtils.h"
 #include "FrameSourceBase.h"
+#include "CacheTelemetry.h"
+#include "GPUMemoryTracker.h"
 #include <bit>	// std::bit_ceil
 #include <Wbemidl.h>
 #include <comdef.h>
@@ -20,6 +22,10 @@
 
 OverlayDrawer::OverlayDrawer() {}
 
+bool OverlayDrawer::IsAvailable() noexcept {
+	return ImGuiImpl::IsAvailable();
+}
+
 OverlayDrawer::~OverlayDrawer() {
 	if (App::Get().GetConfig().Is3DMode() && IsUIVisiable()) {
 		HWND hwndSrc = App::Get().GetHwndSrc();
@@ -219,11 +225,15 @@ bool OverlayDrawer::Initialize() {
 	return true;
 }
 
-void OverlayDrawer::Draw() {
+void OverlayDrawer::OnEffectsChanged() {
+	_timelineColors = GenerateTimelineColors();
+}
+
+bool OverlayDrawer::Draw() {
 	bool isShowFPS = App::Get().GetConfig().IsShowFPS();
 
 	if (!_isUIVisiable && !isShowFPS) {
-		return;
+		return false;
 	}
 
 	_imguiImpl->NewFrame();
@@ -240,6 +250,8 @@ void OverlayDrawer::Draw() {
 	ImGui::PopFont();
 	ImGui::Render();
 	_imguiImpl->EndFrame();
+
+	return true;
 }
 
 void OverlayDrawer::SetUIVisibility(bool value) {
@@ -682,6 +694,9 @@ void OverlayDrawer::_DrawUI() {
 	ImGui::TextUnformatted(StrUtils::Concat("CPU: ", _hardwareInfo.cpuName).c_str());
 	ImGui::TextUnformatted(StrUtils::Concat("VSync: ", config.IsDisableVSync() ? "OFF" : "ON").c_str());
 	ImGui::TextUnformatted(StrUtils::Concat("Capture Method: ", App::Get().GetFrameSource().GetName()).c_str());
+	if (const QualityGovernor& governor = renderer.GetQualityGovernor(); governor.GetLevelCount() > 1) {
+		ImGui::TextUnformatted(fmt::format("Fallback: {}/{}", governor.GetLevel(), governor.GetLevelCount() - 1).c_str());
+	}
 	ImGui::PopTextWrapPos();
 
 	ImGui::Spacing();
@@ -980,6 +995,85 @@ void OverlayDrawer::_DrawUI() {
 		ImGui::PopStyleVar();
 	}
 
+	ImGui::Spacing();
+	// 缓存和编译的统计，用于区分冷启动的开销来自编译还是磁盘读写
+	if (ImGui::CollapsingHeader("Cache")) {
+		const CacheTelemetry& telemetry = CacheTelemetry::Get();
+		using Counter = CacheTelemetry::Counter;
+
+		if (ImGui::BeginTable("cache", 2, ImGuiTableFlags_PadOuterX)) {
+			ImGui::TableSetupColumn("name", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+			ImGui::TableSetupColumn("value", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+
+			auto drawRow = [](const char* name, const std::string& value) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(name);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(value.c_str());
+			};
+
+			drawRow("Hits (memory/disk)", fmt::format("{} / {}",
+				telemetry.GetValue(Counter::MemoryHits), telemetry.GetValue(Counter::DiskHits)));
+			drawRow("Misses", fmt::format("{}", telemetry.GetValue(Counter::Misses)));
+			drawRow("Shader reuses (session/disk)", fmt::format("{} / {}",
+				telemetry.GetValue(Counter::ShaderSessionHits), telemetry.GetValue(Counter::ShaderDiskHits)));
+			drawRow("Shader compiles", fmt::format("{}", telemetry.GetValue(Counter::ShaderCompiles)));
+			drawRow("Read / Written", fmt::format("{:.1f} / {:.1f} KB",
+				telemetry.GetValue(Counter::BytesRead) / 1024.0f, telemetry.GetValue(Counter::BytesWritten) / 1024.0f));
+			drawRow("Decompress", fmt::format("{:.3f} ms", telemetry.GetValue(Counter::DecompressTime) / 1000.0f));
+			drawRow("Deserialize", fmt::format("{:.3f} ms", telemetry.GetValue(Counter::DeserializeTime) / 1000.0f));
+			drawRow("Preprocess", fmt::format("{:.3f} ms", telemetry.GetValue(Counter::PreprocessTime) / 1000.0f));
+			drawRow("Compile", fmt::format("{:.3f} ms", telemetry.GetValue(Counter::CompileTime) / 1000.0f));
+
+			ImGui::EndTable();
+		}
+	}
+
+	ImGui::Spacing();
+	// 所有缩放会话已分配的纹理和缓冲区
+	if (ImGui::CollapsingHeader("Video Memory")) {
+		const GPUMemoryTracker& memoryTracker = GPUMemoryTracker::Get();
+		using Owner = GPUMemoryTracker::Owner;
+
+		if (ImGui::BeginTable("memory", 2, ImGuiTableFlags_PadOuterX)) {
+			ImGui::TableSetupColumn("name", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+			ImGui::TableSetupColumn("value", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoResize | ImGuiTableColumnFlags_NoReorder);
+
+			auto drawRow = [](const char* name, uint64_t bytes) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(name);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(fmt::format("{:.1f} MB", bytes / 1048576.0f).c_str());
+			};
+
+			drawRow("Frame Source", memoryTracker.GetBytes(Owner::FrameSource));
+			drawRow("Effects", memoryTracker.GetBytes(Owner::Effect));
+			drawRow("Cursor", memoryTracker.GetBytes(Owner::Cursor));
+			drawRow("Overlay", memoryTracker.GetBytes(Owner::Overlay));
+			drawRow("Total", memoryTracker.GetTotalBytes());
+			if (const uint64_t budget = memoryTracker.GetBudget(); budget > 0) {
+				drawRow("Effects Budget", budget);
+			}
+
+			// 此缩放会话的视图缓存
+			const DeviceResources::ViewCacheStats viewStats = App::Get().GetDeviceResources().GetViewCacheStats();
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted("View Cache (hits/misses)");
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(fmt::format("{} / {}", viewStats.hits, viewStats.misses).c_str());
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted("View Cache (textures/evictions)");
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(fmt::format("{} / {}", viewStats.size, viewStats.evictions).c_str());
+
+			ImGui::EndTable();
+		}
+	}
+
 	ImGui::End();
 }
 
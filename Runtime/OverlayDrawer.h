@@ -15,7 +15,11 @@ public:
 
 	bool Initialize();
 
-	void Draw();
+	// 其他缩放正在显示叠加层时返回 false
+	static bool IsAvailable() noexcept;
+
+	// 返回是否在后缓冲区上绘制了内容
+	bool Draw();
 
 	bool IsUIVisiable() const noexcept {
 		return _isUIVisiable;
@@ -23,6 +27,9 @@ public:
 
 	void SetUIVisibility(bool value);
 
+	// 切换效果链后调用
+	void OnEffectsChanged();
+
 private:
 	void _DrawFPS();
 
@@ -0,0 +1,86 @@
+#include "QualityGovernor.h"
+#include <algorithm>
+
+
+// 升级所需采样数的最大倍数
+static constexpr uint32_t MAX_UP_BACKOFF_SHIFT = 4;
+
+QualityGovernor::QualityGovernor(uint32_t levelCount, const Options& options)
+	: _options(options), _levels(std::max(levelCount, 1u)) {}
+
+uint32_t QualityGovernor::OnSample(float time) {
+	if (_levels.size() <= 1 || time <= 0.0f) {
+		return _level;
+	}
+
+	if (++_samplesInLevel <= _options.warmupSamples) {
+		return _level;
+	}
+
+	if (_smoothedTime == 0.0f) {
+		_smoothedTime = time;
+	} else {
+		_smoothedTime += (time - _smoothedTime) * _options.smoothing;
+	}
+
+	_Level& cur = _levels[_level];
+	if (!_isSteppedUp && _level > 0 && cur.arrivalCost == 0.0f) {
+		cur.arrivalCost = _smoothedTime;
+	}
+
+	// 降级
+	if (_smoothedTime > _options.budget * _options.downThreshold) {
+		_underBudgetSamples = 0;
+
+		if (_level + 1 < _levels.size() && ++_overBudgetSamples >= _options.downSamples) {
+			if (_isSteppedUp && _samplesInLevel < _options.warmupSamples + _options.upSamples) {
+				// 刚升级就无法维持，之后需要更长时间才能再次升级到此等级
+				cur.failedUps = std::min(cur.failedUps + 1, MAX_UP_BACKOFF_SHIFT);
+			}
+
+			cur.cost = _smoothedTime;
+			_SetLevel(_level + 1);
+			_isSteppedUp = false;
+			// 重新测量比例
+			_levels[_level].arrivalCost = 0.0f;
+		}
+
+		return _level;
+	}
+
+	_overBudgetSamples = 0;
+
+	// 升级
+	if (_level > 0 && _PredictUpperTime() < _options.budget * _options.upThreshold) {
+		const uint32_t required = _options.upSamples << _levels[_level - 1].failedUps;
+		if (++_underBudgetSamples >= required) {
+			cur.cost = _smoothedTime;
+			_SetLevel(_level - 1);
+			_isSteppedUp = true;
+		}
+	} else {
+		_underBudgetSamples = 0;
+	}
+
+	return _level;
+}
+
+void QualityGovernor::_SetLevel(uint32_t level) {
+	_level = level;
+	_smoothedTime = 0.0f;
+	_samplesInLevel = 0;
+	_overBudgetSamples = 0;
+	_underBudgetSamples = 0;
+}
+
+float QualityGovernor::_PredictUpperTime() const noexcept {
+	const _Level& upper = _levels[_level - 1];
+	const _Level& cur = _levels[_level];
+
+	if (upper.cost == 0.0f || cur.arrivalCost == 0.0f) {
+		// 无法估计，假设上一等级的用时为预算，即永远不升级
+		return _options.budget;
+	}
+
+	return _smoothedTime * (upper.cost / cur.arrivalCost);
+}
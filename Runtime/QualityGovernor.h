@@ -0,0 +1,84 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <cstdint>
+#include <vector>
+
+
+// 根据渲染用时在若干效果链间切换，使每帧的用时不超过预算
+// 等级 0 为缩放配置中的效果链，之后依次为越来越轻量的备选效果链
+// 降级和升级使用不同的阈值和持续时间，避免在两个等级间反复切换
+class QualityGovernor {
+public:
+	struct Options {
+		// 每帧的用时预算，单位和采样相同
+		float budget = 16.0f;
+		// 平滑后的用时持续超过 budget * downThreshold 时降级
+		float downThreshold = 0.9f;
+		// 预计上一等级的用时持续低于 budget * upThreshold 时升级
+		float upThreshold = 0.7f;
+		// 降级和升级需要连续满足条件的采样数
+		uint32_t downSamples = 30;
+		uint32_t upSamples = 300;
+		// 切换等级后丢弃的采样数，新的效果链刚开始时用时不稳定
+		uint32_t warmupSamples = 10;
+		// 指数移动平均中新采样的权重
+		float smoothing = 0.1f;
+	};
+
+	QualityGovernor() noexcept = default;
+
+	QualityGovernor(uint32_t levelCount, const Options& options);
+
+	// 输入一帧的用时，返回此后应使用的等级
+	uint32_t OnSample(float time);
+
+	uint32_t GetLevel() const noexcept {
+		return _level;
+	}
+
+	uint32_t GetLevelCount() const noexcept {
+		return (uint32_t)_levels.size();
+	}
+
+	const Options& GetOptions() const noexcept {
+		return _options;
+	}
+
+	// 当前等级平滑后的用时，尚无采样时为 0
+	float GetSmoothedTime() const noexcept {
+		return _smoothedTime;
+	}
+
+	// 离开某等级时测得的用时，尚未测得时为 0
+	float GetLevelCost(uint32_t level) const noexcept {
+		return level < _levels.size() ? _levels[level].cost : 0.0f;
+	}
+
+private:
+	void _SetLevel(uint32_t level);
+
+	// 根据上一等级和当前等级用时的比例估计升级后的用时
+	float _PredictUpperTime() const noexcept;
+
+	struct _Level {
+		// 离开此等级时平滑后的用时
+		float cost = 0.0f;
+		// 从上一等级降级到此等级后首次稳定的用时，用于计算两者的比例
+		float arrivalCost = 0.0f;
+		// 升级到此等级后很快又降级的次数，每次使升级所需的采样数加倍
+		uint32_t failedUps = 0;
+	};
+
+	Options _options;
+	std::vector<_Level> _levels;
+
+	uint32_t _level = 0;
+	float _smoothedTime = 0.0f;
+	// 切换到当前等级后的采样数
+	uint32_t _samplesInLevel = 0;
+	// 连续满足降级或升级条件的采样数
+	uint32_t _overBudgetSamples = 0;
+	uint32_t _underBudgetSamples = 0;
+	// 当前等级是否由升级得到
+	bool _isSteppedUp = false;
+};
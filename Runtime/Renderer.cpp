@@ -4,15 +4,19 @@
 #include "Utils.h"
 #include "StrUtils.h"
 #include "EffectCompiler.h"
+#include "EffectCacheManager.h"
 #include "FrameSourceBase.h"
 #include "DeviceResources.h"
 #include "GPUTimer.h"
 #include "EffectDrawer.h"
 #include "OverlayDrawer.h"
+#include "CursorDrawer.h"
+#include "TiledEffectChain.h"
 #include "Logger.h"
 #include "CursorManager.h"
 #include "Config.h"
 #include "WindowsMessages.h"
+#include "GPUMemoryTracker.h"
 
 #pragma push_macro("GetObject")
 #undef GetObject
@@ -21,14 +25,36 @@
 
 static std::optional<LRESULT> WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 	if (msg == WindowsMessages::WM_TOGGLE_OVERLAY) {
-		Renderer& renderer = App::Get().GetRenderer();
-		renderer.SetUIVisibility(!renderer.IsUIVisiable());
+		// 覆盖层由渲染线程创建和绘制
+		App::Get().PostToRenderThread([]() {
+			Renderer& renderer = App::Get().GetRenderer();
+			renderer.SetUIVisibility(!renderer.IsUIVisiable());
+		});
 		return 0;
 	}
 
 	return std::nullopt;
 }
 
+// 获取主窗口所在显示器的刷新间隔，失败时假定为 60Hz
+static FrameScheduler::Duration GetRefreshInterval() {
+	DWORD frequency = 60;
+
+	HMONITOR hMonitor = MonitorFromWindow(App::Get().GetHwndHost(), MONITOR_DEFAULTTONEAREST);
+	MONITORINFOEX mi{};
+	mi.cbSize = sizeof(mi);
+	DEVMODE dm{};
+	dm.dmSize = sizeof(dm);
+	if (!GetMonitorInfo(hMonitor, &mi) || !EnumDisplaySettings(mi.szDevice, ENUM_CURRENT_SETTINGS, &dm)) {
+		Logger::Get().Win32Error("获取显示器刷新率失败");
+	} else if (dm.dmDisplayFrequency > 1) {
+		// 0 和 1 表示硬件默认的刷新率
+		frequency = dm.dmDisplayFrequency;
+	}
+
+	return std::chrono::duration_cast<FrameScheduler::Duration>(std::chrono::duration<double>(1.0 / frequency));
+}
+
 Renderer::Renderer() {}
 
 Renderer::~Renderer() {
@@ -37,7 +63,9 @@ Renderer::~Renderer() {
 	}
 }
 
-bool Renderer::Initialize(const std::string& effectsJson) {
+Renderer::EffectChainCache::~EffectChainCache() {}
+
+bool Renderer::Initialize(const std::string& effectsJson, std::unique_ptr<EffectChainCache> effectChains) {
 	_gpuTimer.reset(new GPUTimer());
 	
 	if (!GetWindowRect(App::Get().GetHwndSrc(), &_srcWndRect)) {
@@ -45,12 +73,42 @@ bool Renderer::Initialize(const std::string& effectsJson) {
 		return false;
 	}
 
-	if (!_ResolveEffectsJson(effectsJson)) {
-		Logger::Get().Error("_ResolveEffectsJson 失败");
+	if (effectChains && !_CheckMemoryBudget(*effectChains)) {
 		return false;
 	}
+
+	if (effectChains && !_AdoptEffectChains(*effectChains)) {
+		Logger::Get().Info("无法复用效果链，将重新编译");
+		_effectChains.clear();
+		effectChains.reset();
+	}
+
+	if (!effectChains) {
+		effectChains = CompileEffectChains(effectsJson);
+		if (!effectChains) {
+			Logger::Get().Error("CompileEffectChains 失败");
+			return false;
+		}
+
+		if (!_CheckMemoryBudget(*effectChains)) {
+			return false;
+		}
+
+		if (!_AdoptEffectChains(*effectChains)) {
+			Logger::Get().Error("_AdoptEffectChains 失败");
+			return false;
+		}
+	}
 	
-	if (App::Get().GetConfig().IsShowFPS()) {
+	_cursorDrawer.reset(new CursorDrawer());
+	if (!_cursorDrawer->Initialize(_effectsOutput, _outputRect, _virtualOutputRect)) {
+		Logger::Get().Error("初始化 CursorDrawer 失败");
+		return false;
+	}
+
+	if (App::Get().GetConfig().IsShowFPS() && !OverlayDrawer::IsAvailable()) {
+		Logger::Get().Info("其他缩放正在显示叠加层，不显示帧率");
+	} else if (App::Get().GetConfig().IsShowFPS()) {
 		_overlayDrawer.reset(new OverlayDrawer());
 		if (!_overlayDrawer->Initialize()) {
 			Logger::Get().Error("初始化 OverlayDrawer 失败");
@@ -71,6 +129,19 @@ bool Renderer::Initialize(const std::string& effectsJson) {
 		Logger::Get().ComError("CreateBuffer 失败", hr);
 		return false;
 	}
+	GPUMemoryTracker::Get().Track(_dynamicCB.get(), GPUMemoryTracker::Owner::Renderer);
+
+	_frameScheduler.SetIdleInterval(GetRefreshInterval());
+	_frameScheduler.SetMatchSourceFrameRate(App::Get().GetConfig().IsMatchSourceFrameRate());
+
+	if (_effectChains.size() > 1) {
+		// 预算为一个刷新间隔，降级阈值为光标和覆盖层留出了余量
+		QualityGovernor::Options options;
+		options.budget = std::chrono::duration<float, std::milli>(_frameScheduler.GetIdleInterval()).count();
+		_qualityGovernor = QualityGovernor((uint32_t)_effectChains.size(), options);
+
+		_UpdateProfiling();
+	}
 
 	_handlerID = App::Get().RegisterWndProcHandler(WndProcHandler);
 
@@ -78,6 +149,25 @@ bool Renderer::Initialize(const std::string& effectsJson) {
 }
 
 
+std::unique_ptr<Renderer::EffectChainCache> Renderer::DetachEffectChains() {
+	std::unique_ptr<EffectChainCache> result = std::make_unique<EffectChainCache>();
+
+	D3D11_TEXTURE2D_DESC inputDesc;
+	App::Get().GetFrameSource().GetOutput()->GetDesc(&inputDesc);
+	result->inputWidth = inputDesc.Width;
+	result->inputHeight = inputDesc.Height;
+	result->inputFormat = inputDesc.Format;
+
+	result->chains = std::move(_effectChains);
+	_effectChains.clear();
+
+	_effects.clear();
+	_tiledEffects = nullptr;
+	_effectsOutput = nullptr;
+
+	return result;
+}
+
 void Renderer::Render() {
 	if (!_CheckSrcState()) {
 		Logger::Get().Info("源窗口状态改变，退出全屏");
@@ -87,90 +177,143 @@ void Renderer::Render() {
 
 	DeviceResources& dr = App::Get().GetDeviceResources();
 
-	if (!_waitingForNextFrame) {
-		dr.BeginFrame();
+	if (!_isFrameBegun) {
+		// 在捕获前等待交换链，使捕获到的帧尽可能新
+		_isWaitingForSwapChain = !dr.BeginFrame();
+		if (_isWaitingForSwapChain) {
+			return;
+		}
+
 		_gpuTimer->OnBeginFrame();
+		_isFrameBegun = true;
 	}
 
 	// 首先处理配置改变产生的回调
 	App::Get().GetConfig().OnBeginFrame();
 
 	auto state = App::Get().GetFrameSource().Update();
-	_waitingForNextFrame = state == FrameSourceBase::UpdateState::Waiting
+	_isWaitingForSource = state == FrameSourceBase::UpdateState::Waiting
 		|| state == FrameSourceBase::UpdateState::Error;
-	if (_waitingForNextFrame) {
+	if (_isWaitingForSource) {
 		return;
 	}
+
+	if (state == FrameSourceBase::UpdateState::NewFrame) {
+		_frameScheduler.OnSourceFrame(FrameScheduler::Clock::now());
+	}
 	
 	App::Get().GetCursorManager().OnBeginFrame();
 
-	if (!_UpdateDynamicConstants()) {
-		Logger::Get().Error("_UpdateDynamicConstants 失败");
+	if (state == FrameSourceBase::UpdateState::NoUpdate && !_isFullFrameNeeded
+		&& !IsAnimated() && !_cursorDrawer->IsCursorChanged()) {
+		// 屏幕上的内容已是最新，保留已开始的帧直到有变化
+		return;
 	}
 
-	auto d3dDC = dr.GetD3DDC();
-
-	{
-		ID3D11Buffer* t = _dynamicCB.get();
-		d3dDC->CSSetConstantBuffers(0, 1, &t);
+	if (!_UpdateDynamicConstants()) {
+		Logger::Get().Error("_UpdateDynamicConstants 失败");
 	}
 
-	_gpuTimer->OnBeginEffects();
+	// 只有完整渲染的帧的用时可以反映效果链的开销
+	const DirtyRegion& srcDirtyRegion = App::Get().GetFrameSource().GetDirtyRegion();
+	const bool isFullFrame = _isFullFrameNeeded || (state == FrameSourceBase::UpdateState::NewFrame
+		&& (srcDirtyRegion.IsFull() || srcDirtyRegion.GetArea() == uint64_t(srcDirtyRegion.GetWidth()) * srcDirtyRegion.GetHeight()));
+	_gpuTimer->OnBeginEffects(isFullFrame);
 
 	UINT idx = 0;
-	if (state == FrameSourceBase::UpdateState::NoUpdate) {
+	bool isNewFrame = true;
+	if (_isFullFrameNeeded) {
+		_isFullFrameNeeded = false;
+
+		if (_tiledEffects) {
+			_tiledEffects->Draw(idx);
+		} else {
+			for (EffectDrawer* effect : _effects) {
+				effect->Draw(idx);
+			}
+		}
+	} else if (state == FrameSourceBase::UpdateState::NoUpdate) {
 		// 此帧内容无变化
 		// 从第一个使用动态常量的效果开始渲染
-		// 如果没有则只渲染最后一个效果的最后一个通道
+		// 如果没有则跳过所有效果，最后一个效果的输出保留着上一帧的结果
 
 		size_t i = 0;
-		for (size_t end = _effects.size() - 1; i < end; ++i) {
+		for (; i < _effects.size(); ++i) {
 			if (_effects[i]->IsUseDynamic()) {
 				break;
 			} else {
+				// 不渲染的通道也在 GPUTimer 中记录
 				for (UINT j = (UINT)_effects[i]->GetDesc().passes.size(); j > 0; --j) {
 					_gpuTimer->OnEndPass(idx++);
 				}
 			}
 		}
 
-		if (i == _effects.size()) {
-			// 只渲染最后一个 Effect 的最后一个 pass
-			_effects.back()->Draw(idx, true);
-		} else {
-			for (; i < _effects.size(); ++i) {
-				_effects[i]->Draw(idx);
-			}
+		isNewFrame = i < _effects.size();
+		for (; i < _effects.size(); ++i) {
+			_effects[i]->Draw(idx);
 		}
+	} else if (_tiledEffects) {
+		// 只重新渲染受变化区域影响的图块
+		_tiledEffects->Draw(idx, &srcDirtyRegion);
 	} else {
+		// 每个效果只重新计算受变化区域影响的部分
+		DirtyRegion dirtyRegion = srcDirtyRegion;
 		for (auto& effect : _effects) {
-			effect->Draw(idx);
+			effect->Draw(idx, &dirtyRegion);
 		}
 	}
 
 	_gpuTimer->OnEndEffects();
 
-	if (_overlayDrawer) {
-		_overlayDrawer->Draw();
+	// 复制到后缓冲区并绘制光标，画面无变化时只更新光标所在的区域
+	_cursorDrawer->Draw(isNewFrame);
+
+	if (_overlayDrawer && _overlayDrawer->Draw()) {
+		_cursorDrawer->InvalidateBackBuffer();
 	}
 
 	dr.EndFrame();
+	_isFrameBegun = false;
+	_frameScheduler.OnFramePresented(FrameScheduler::Clock::now());
+
+	_UpdateQualityLevel();
+}
+
+bool Renderer::IsAnimated() const noexcept {
+	// 源没有可用的帧时无法渲染，应等待新帧到达
+	if (_isWaitingForSource) {
+		return false;
+	}
+
+	if (_hasDynamicEffect) {
+		return true;
+	}
+
+	// 覆盖层每帧都需要绘制
+	return _overlayDrawer && (IsUIVisiable() || App::Get().GetConfig().IsShowFPS());
 }
 
 bool Renderer::IsUIVisiable() const noexcept {
-	return _overlayDrawer ? _overlayDrawer->IsUIVisiable() : false;
+	return _isUIVisible.load(std::memory_order_acquire);
 }
 
 void Renderer::SetUIVisibility(bool value) {
 	if (!value) {
 		if (_overlayDrawer && _overlayDrawer->IsUIVisiable()) {
 			_overlayDrawer->SetUIVisibility(false);
-			_gpuTimer->StopProfiling();
+			_UpdateProfiling();
 		}
+		_isUIVisible.store(false, std::memory_order_release);
 		return;
 	}
 
 	if (!_overlayDrawer) {
+		if (!OverlayDrawer::IsAvailable()) {
+			Logger::Get().Info("其他缩放正在显示叠加层");
+			return;
+		}
+
 		_overlayDrawer.reset(new OverlayDrawer());
 		if (!_overlayDrawer->Initialize()) {
 			Logger::Get().Error("初始化 OverlayDrawer 失败");
@@ -180,14 +323,9 @@ void Renderer::SetUIVisibility(bool value) {
 
 	if (!_overlayDrawer->IsUIVisiable()) {
 		_overlayDrawer->SetUIVisibility(true);
+		_UpdateProfiling();
 
-		UINT passCount = 0;
-		for (const auto& effect : _effects) {
-			passCount += (UINT)effect->GetDesc().passes.size();
-		}
-
-		// StartProfiling 必须在 OnBeginFrame 之前调用
-		_gpuTimer->StartProfiling(std::chrono::milliseconds(500), passCount);
+		_isUIVisible.store(true, std::memory_order_release);
 	}
 }
 
@@ -283,43 +421,43 @@ bool Renderer::_CheckSrcState() {
 	return true;
 }
 
-bool Renderer::_ResolveEffectsJson(const std::string& effectsJson) {
-	rapidjson::Document doc;
-	if (doc.Parse(effectsJson.c_str(), effectsJson.size()).HasParseError()) {
-		// 解析 json 失败
-		Logger::Get().Error(fmt::format("解析 json 失败\n\t错误码：{}", (int)doc.GetParseError()));
+// 并行编译一条效果链中的所有效果
+static bool CompileEffects(
+	const rapidjson::Value& effectsArr,
+	std::vector<std::string>& effectNames,
+	std::vector<EffectDesc>& effectDescs,
+	std::vector<EffectParams>& effectParams
+) {
+	if (!effectsArr.IsArray()) {
+		Logger::Get().Error("解析 json 失败：效果链不为数组");
 		return false;
 	}
 
-	if (!doc.IsArray()) {
-		Logger::Get().Error("解析 json 失败：根元素不为数组");
-		return false;
-	}
-
-	const auto& effectsArr = doc.GetArray();
-
 	// 不得为空
 	if (effectsArr.Empty()) {
-		Logger::Get().Error("解析 json 失败：根元素为空");
+		Logger::Get().Error("解析 json 失败：效果链为空");
 		return false;
 	}
 
-	// 并行编译所有效果
-
 	UINT effectCount = effectsArr.Size();
-	std::vector<const char*> effectNames(effectCount);
-	std::vector<EffectParams> effectParams(effectCount);
-	std::vector<EffectDesc> effectDescs(effectCount);
+	effectNames.resize(effectCount);
+	effectParams.resize(effectCount);
+	effectDescs.resize(effectCount);
 	std::atomic<bool> allSuccess = true;
 
+	// 编译时需要读取当前会话的配置
+	ScalingSession* session = &App::Get().GetSession();
+
 	int duration = Utils::Measure([&]() {
 		Utils::RunParallel([&](UINT id) {
+			App::SessionScope scope(session);
+
 			const auto& effectJson = effectsArr[id];
 			UINT effectFlag = (id == effectCount - 1) ? EFFECT_FLAG_LAST_EFFECT : 0;
 			EffectParams& params = effectParams[id];
 
 			if (!effectJson.IsObject()) {
-				Logger::Get().Error("解析 json 失败：根数组中存在非法成员");
+				Logger::Get().Error("解析 json 失败：效果链中存在非法成员");
 				allSuccess = false;
 				return;
 			}
@@ -419,90 +557,316 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson) {
 		}, effectCount);
 	});
 
-	if (allSuccess) {
-		if (effectCount > 1) {
-			Logger::Get().Info(fmt::format("编译着色器总计用时 {} 毫秒", duration / 1000.0f));
+	// 编译期间只更新了内存中的索引
+	EffectCacheManager::Get().FlushIndex();
+
+	if (!allSuccess) {
+		return false;
+	}
+
+	if (effectCount > 1) {
+		Logger::Get().Info(fmt::format("编译着色器总计用时 {} 毫秒", duration / 1000.0f));
+	}
+
+	return true;
+}
+
+std::unique_ptr<Renderer::EffectChainCache> Renderer::CompileEffectChains(const std::string& effectsJson) {
+	rapidjson::Document doc;
+	if (doc.Parse(effectsJson.c_str(), effectsJson.size()).HasParseError()) {
+		// 解析 json 失败
+		Logger::Get().Error(fmt::format("解析 json 失败\n\t错误码：{}", (int)doc.GetParseError()));
+		return nullptr;
+	}
+
+	// 根元素为效果链，或者为包含 effects 和 fallbacks 的对象
+	const rapidjson::Value* effectsArr = &doc;
+	const rapidjson::Value* fallbacksArr = nullptr;
+	if (doc.IsObject()) {
+		auto effectsProp = doc.FindMember("effects");
+		if (effectsProp == doc.MemberEnd()) {
+			Logger::Get().Error("解析 json 失败：未找到 effects 属性");
+			return nullptr;
 		}
-	} else {
+		effectsArr = &effectsProp->value;
+
+		auto fallbacksProp = doc.FindMember("fallbacks");
+		if (fallbacksProp != doc.MemberEnd()) {
+			if (!fallbacksProp->value.IsArray()) {
+				Logger::Get().Error("解析 json 失败：成员 fallbacks 必须为数组类型");
+				return nullptr;
+			}
+			fallbacksArr = &fallbacksProp->value;
+		}
+	} else if (!doc.IsArray()) {
+		Logger::Get().Error("解析 json 失败：根元素不为数组或对象");
+		return nullptr;
+	}
+
+	std::unique_ptr<EffectChainCache> result = std::make_unique<EffectChainCache>();
+	std::vector<_EffectChain>& effectChains = result->chains;
+
+	{
+		_EffectChain& chain = effectChains.emplace_back();
+		if (!CompileEffects(*effectsArr, chain.names, chain.descs, chain.params)) {
+			return nullptr;
+		}
+	}
+
+	if (fallbacksArr) {
+		// 备选效果链编译失败时只是不使用它
+		UINT idx = 0;
+		for (const auto& fallback : fallbacksArr->GetArray()) {
+			_EffectChain chain;
+			if (CompileEffects(fallback, chain.names, chain.descs, chain.params)) {
+				effectChains.emplace_back(std::move(chain));
+			} else {
+				Logger::Get().Error(fmt::format("编译备选效果链#{}失败", idx));
+			}
+			++idx;
+		}
+	}
+
+	if (effectChains.size() > 1) {
+		Logger::Get().Info(fmt::format("共有 {} 条备选效果链", effectChains.size() - 1));
+	}
+
+	return result;
+}
+
+bool Renderer::_CheckMemoryBudget(const EffectChainCache& effectChains) {
+	const uint64_t budget = GPUMemoryTracker::Get().GetBudget();
+	if (budget == 0) {
+		return true;
+	}
+
+	// 备选效果链更轻量，只需检查第一条效果链
+	const _EffectChain& chain = effectChains.chains[0];
+
+	D3D11_TEXTURE2D_DESC inputDesc;
+	App::Get().GetFrameSource().GetOutput()->GetDesc(&inputDesc);
+
+	std::vector<uint64_t> effectBytes;
+	SIZE outputSize{};
+	if (!GPUMemoryTracker::EstimateEffectChain(chain.descs, chain.params,
+		SIZE{ (LONG)inputDesc.Width, (LONG)inputDesc.Height },
+		Utils::GetSizeOfRect(App::Get().GetHostWndRect()), effectBytes, outputSize)
+	) {
+		Logger::Get().Error("估计显存占用失败");
 		return false;
 	}
 
+	uint64_t totalBytes = 0;
+	for (uint64_t bytes : effectBytes) {
+		totalBytes += bytes;
+	}
+
+	if (totalBytes <= budget) {
+		return true;
+	}
+
+	// 超出预算时 TiledEffectChain 会分块执行，中间纹理只需图块的尺寸
+	const bool isTileable = std::all_of(chain.descs.begin(), chain.descs.end(),
+		[](const EffectDesc& desc) { return EffectDrawer::CheckTileable(desc); });
+	if (isTileable) {
+		Logger::Get().Info(fmt::format("效果链预计占用 {} MiB 显存，超过预算 {} MiB，将分块执行",
+			totalBytes >> 20, budget >> 20));
+		return true;
+	}
+
+	std::string msg = fmt::format("效果链预计占用 {} MiB 显存，超过预算 {} MiB", totalBytes >> 20, budget >> 20);
+	for (size_t i = 0; i < effectBytes.size(); ++i) {
+		msg += fmt::format("\n\t{}：{} MiB", chain.names[i], effectBytes[i] >> 20);
+	}
+	Logger::Get().Error(msg);
+
+	App::Get().SetErrorMsg(ErrorMessages::GPU_MEMORY_BUDGET);
+	return false;
+}
+
+bool Renderer::_AdoptEffectChains(EffectChainCache& effectChains) {
+	const bool isCreated = std::any_of(effectChains.chains.begin(), effectChains.chains.end(),
+		[](const _EffectChain& chain) { return chain.tiled || !chain.drawers.empty(); });
+	if (isCreated && !_RebindEffectChains(effectChains)) {
+		return false;
+	}
+
+	_effectChains = std::move(effectChains.chains);
+	return _SetEffectChain(0);
+}
+
+bool Renderer::_RebindEffectChains(EffectChainCache& effectChains) {
 	ID3D11Texture2D* effectInput = App::Get().GetFrameSource().GetOutput();
-	_effects.resize(effectCount);
-
-	for (UINT i = 0; i < effectCount; ++i) {
-		bool isLastEffect = i == effectCount - 1;
-
-		_effects[i].reset(new EffectDrawer());
-		if (!_effects[i]->Initialize(
-			effectDescs[i], effectParams[i], effectInput, &effectInput,
-			isLastEffect ? &_outputRect : nullptr,
-			isLastEffect ? &_virtualOutputRect : nullptr
-		)) {
-			Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败", i, effectNames[i]));
-			return false;
+
+	D3D11_TEXTURE2D_DESC inputDesc;
+	effectInput->GetDesc(&inputDesc);
+	if (inputDesc.Width != effectChains.inputWidth || inputDesc.Height != effectChains.inputHeight
+		|| inputDesc.Format != effectChains.inputFormat) {
+		Logger::Get().Info("源的输出纹理已改变，无法复用效果链");
+		return false;
+	}
+
+	// 只有使用过的效果链需要重新绑定，其他效果链首次使用时创建
+	for (_EffectChain& chain : effectChains.chains) {
+		if (chain.tiled) {
+			if (!chain.tiled->Rebind(effectInput)) {
+				Logger::Get().Error("TiledEffectChain::Rebind 失败");
+				return false;
+			}
+			continue;
+		}
+
+		ID3D11Texture2D* curInput = effectInput;
+		for (const auto& drawer : chain.drawers) {
+			if (!drawer->Rebind(curInput)) {
+				Logger::Get().Error("EffectDrawer::Rebind 失败");
+				return false;
+			}
+			curInput = drawer->GetOutput();
+		}
+	}
+
+	Logger::Get().Info("已复用上次缩放的效果链");
+	return true;
+}
+
+bool Renderer::_SetEffectChain(UINT idx) {
+	_EffectChain& chain = _effectChains[idx];
+
+	if (chain.drawers.empty() && !chain.tiled) {
+		ID3D11Texture2D* effectInput = App::Get().GetFrameSource().GetOutput();
+
+		D3D11_TEXTURE2D_DESC inputDesc;
+		effectInput->GetDesc(&inputDesc);
+		if (TiledEffectChain::IsPreferred(chain.descs, chain.params, SIZE{ (LONG)inputDesc.Width, (LONG)inputDesc.Height })) {
+			chain.tiled.reset(new TiledEffectChain());
+			if (!chain.tiled->Initialize(chain.names, chain.descs, chain.params,
+				effectInput, &chain.output, &chain.outputRect, &chain.virtualOutputRect)) {
+				Logger::Get().Error("初始化分块执行失败，将不分块执行");
+				chain.tiled.reset();
+			}
+		}
+	}
+
+	if (chain.drawers.empty() && !chain.tiled) {
+		const UINT effectCount = (UINT)chain.descs.size();
+		ID3D11Texture2D* effectInput = App::Get().GetFrameSource().GetOutput();
+		chain.drawers.resize(effectCount);
+
+		for (UINT i = 0; i < effectCount; ++i) {
+			bool isLastEffect = i == effectCount - 1;
+
+			chain.drawers[i].reset(new EffectDrawer());
+			if (!chain.drawers[i]->Initialize(
+				chain.descs[i], chain.params[i], effectInput, &effectInput,
+				isLastEffect ? &chain.outputRect : nullptr,
+				isLastEffect ? &chain.virtualOutputRect : nullptr
+			)) {
+				Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败", i, chain.names[i]));
+				chain.drawers.clear();
+				return false;
+			}
+		}
+
+		chain.output = effectInput;
+	}
+
+	_curEffectChain = idx;
+
+	_tiledEffects = chain.tiled.get();
+
+	_effects.clear();
+	_hasDynamicEffect = false;
+	for (const auto& drawer : chain.tiled ? chain.tiled->GetEffects() : chain.drawers) {
+		_effects.push_back(drawer.get());
+		if (drawer->IsUseDynamic()) {
+			_hasDynamicEffect = true;
 		}
 	}
 
+	_effectsOutput = chain.output;
+	_outputRect = chain.outputRect;
+	_virtualOutputRect = chain.virtualOutputRect;
+
+	// 新效果链的中间纹理中是过时的内容
+	_isFullFrameNeeded = true;
+
+	if (_cursorDrawer) {
+		_cursorDrawer->SetEffectsOutput(_effectsOutput, _outputRect, _virtualOutputRect);
+	}
+	if (_overlayDrawer) {
+		_overlayDrawer->OnEffectsChanged();
+	}
+
 	return true;
 }
 
+void Renderer::_UpdateQualityLevel() {
+	if (_qualityGovernor.GetLevelCount() <= 1) {
+		return;
+	}
+
+	const float effectsTime = _gpuTimer->ConsumeEffectsTime();
+	if (effectsTime <= 0.0f) {
+		return;
+	}
+
+	const float smoothedTime = _qualityGovernor.GetSmoothedTime();
+	const UINT level = _qualityGovernor.OnSample(effectsTime);
+	if (level == _curEffectChain) {
+		return;
+	}
+
+	Logger::Get().Info(fmt::format("渲染用时 {:.2f} 毫秒，预算 {:.2f} 毫秒，切换到效果链#{}",
+		smoothedTime, _qualityGovernor.GetOptions().budget, level));
+
+	if (!_SetEffectChain(level)) {
+		Logger::Get().Error(fmt::format("切换到效果链#{}失败", level));
+		// 不再调整
+		_qualityGovernor = QualityGovernor();
+		_SetEffectChain(0);
+	}
+
+	_UpdateProfiling();
+}
+
+void Renderer::_UpdateProfiling() {
+	const bool isUIVisible = _overlayDrawer && _overlayDrawer->IsUIVisiable();
+	if (!isUIVisible && _qualityGovernor.GetLevelCount() <= 1) {
+		if (_gpuTimer->IsProfiling()) {
+			_gpuTimer->StopProfiling();
+		}
+		return;
+	}
+
+	UINT passCount = 0;
+	for (const EffectDrawer* effect : _effects) {
+		passCount += (UINT)effect->GetDesc().passes.size();
+	}
+
+	// 效果链切换后通道数改变，重新开始统计
+	_gpuTimer->StartProfiling(std::chrono::milliseconds(500), passCount);
+}
+
 bool Renderer::_UpdateDynamicConstants() {
 	// cbuffer __CB1 : register(b0) {
-	//     int4 __cursorRect;
-	//     float2 __cursorPt;
 	//     uint2 __cursorPos;
-	//     uint __cursorType;
 	//     uint __frameCount;
 	// };
 
 	CursorManager& cursorManager = App::Get().GetCursorManager();
 	if (cursorManager.HasCursor() && !(App::Get().GetConfig().Is3DMode() && IsUIVisiable())) {
 		const POINT* pos = cursorManager.GetCursorPos();
-		const CursorManager::CursorInfo* ci = cursorManager.GetCursorInfo();
-
-		ID3D11Texture2D* cursorTex;
-		CursorManager::CursorType cursorType = CursorManager::CursorType::Color;
-		if (!cursorManager.GetCursorTexture(&cursorTex, cursorType)) {
-			Logger::Get().Error("GetCursorTexture 失败");
-		}
-		assert(pos && ci);
-
-		float cursorZoomFactor = App::Get().GetConfig().GetCursorZoomFactor();
-		if (cursorZoomFactor < 1e-5) {
-			SIZE srcFrameSize = Utils::GetSizeOfRect(App::Get().GetFrameSource().GetSrcFrameRect());
-			SIZE virtualOutputSize = Utils::GetSizeOfRect(_virtualOutputRect);
-			cursorZoomFactor = (((float)virtualOutputSize.cx / srcFrameSize.cx) 
-				+ ((float)virtualOutputSize.cy / srcFrameSize.cy)) / 2;
-		}
-
-		SIZE cursorSize = {
-			std::lroundf(ci->size.cx * cursorZoomFactor),
-			std::lroundf(ci->size.cy * cursorZoomFactor)
-		};
-
-		_dynamicConstants[0].intVal = pos->x - std::lroundf(ci->hotSpot.x * cursorZoomFactor);
-		_dynamicConstants[1].intVal = pos->y - std::lroundf(ci->hotSpot.y * cursorZoomFactor);
-		_dynamicConstants[2].intVal = _dynamicConstants[0].intVal + cursorSize.cx;
-		_dynamicConstants[3].intVal = _dynamicConstants[1].intVal + cursorSize.cy;
-
-		_dynamicConstants[4].floatVal = 1.0f / cursorSize.cx;
-		_dynamicConstants[5].floatVal = 1.0f / cursorSize.cy;
-
-		_dynamicConstants[6].uintVal = pos->x;
-		_dynamicConstants[7].uintVal = pos->y;
+		assert(pos);
 
-		_dynamicConstants[8].uintVal = (UINT)cursorType;
+		_dynamicConstants[0].uintVal = pos->x;
+		_dynamicConstants[1].uintVal = pos->y;
 	} else {
-		_dynamicConstants[0].intVal = INT_MAX;
-		_dynamicConstants[1].intVal = INT_MAX;
-		_dynamicConstants[2].intVal = INT_MAX;
-		_dynamicConstants[3].intVal = INT_MAX;
-		_dynamicConstants[6].uintVal = UINT_MAX;
-		_dynamicConstants[7].uintVal = UINT_MAX;
+		_dynamicConstants[0].uintVal = UINT_MAX;
+		_dynamicConstants[1].uintVal = UINT_MAX;
 	}
 
-	_dynamicConstants[9].uintVal = _gpuTimer->GetFrameCount();
+	_dynamicConstants[2].uintVal = _gpuTimer->GetFrameCount();
 
 	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
 
@@ -1,10 +1,14 @@
 #pragma once
 #include "pch.h"
 #include "EffectDesc.h"
+#include "FrameScheduler.h"
+#include "QualityGovernor.h"
 
 class EffectDrawer;
+class TiledEffectChain;
 class GPUTimer;
 class OverlayDrawer;
+class CursorDrawer;
 class CursorManager;
 
 
@@ -16,21 +20,57 @@ public:
 
 	~Renderer();
 
-	bool Initialize(const std::string& effectsJson);
+	// 已编译的效果链，可能是缩放结束后保留的，此时其中的效果已经创建
+	struct EffectChainCache;
 
+	// 解析缩放配置并编译其中所有效果链，只依赖 Config，可以在其他线程中执行
+	static std::unique_ptr<EffectChainCache> CompileEffectChains(const std::string& effectsJson);
+
+	// effectChains 为空时编译 effectsJson
+	// 已创建的效果只有在输入纹理的尺寸和格式不变时才能复用，否则重新编译
+	bool Initialize(const std::string& effectsJson, std::unique_ptr<EffectChainCache> effectChains = nullptr);
+
+	// 缩放结束时调用，之后只能销毁此对象
+	std::unique_ptr<EffectChainCache> DetachEffectChains();
+
+	// 画面和光标都没有变化时不呈现新帧
 	void Render();
 
+	// 为真时每帧都需要渲染，渲染线程不应等待新帧
+	bool IsAnimated() const noexcept;
+
+	// 多个会话共享渲染线程时不在交换链上阻塞，为真时渲染线程应稍后重试
+	bool IsWaitingForSwapChain() const noexcept {
+		return _isWaitingForSwapChain;
+	}
+
+	const FrameScheduler& GetFrameScheduler() const noexcept {
+		return _frameScheduler;
+	}
+
+	// 缩放配置中没有备选效果链时只有一个等级
+	const QualityGovernor& GetQualityGovernor() const noexcept {
+		return _qualityGovernor;
+	}
+
 	GPUTimer& GetGPUTimer() {
 		return *_gpuTimer;
 	}
 
+	// __CB1，所有效果共用
+	ID3D11Buffer* GetDynamicConstantBuffer() const noexcept {
+		return _dynamicCB.get();
+	}
+
 	// 可能为空
 	OverlayDrawer* GetOverlayDrawer() {
 		return _overlayDrawer.get();
 	}
 
+	// 可以在任何线程中调用
 	bool IsUIVisiable() const noexcept;
 
+	// 只能在渲染线程中调用
 	void SetUIVisibility(bool value);
 
 	const RECT& GetOutputRect() const noexcept {
@@ -50,7 +90,22 @@ public:
 private:
 	bool _CheckSrcState();
 
-	bool _ResolveEffectsJson(const std::string& effectsJson);
+	// 配置了显存预算时检查效果链预计的显存占用，无法满足时设置错误消息并返回 false
+	bool _CheckMemoryBudget(const EffectChainCache& effectChains);
+
+	// 将已创建的效果绑定到新的输入纹理，然后切换到第一条效果链
+	bool _AdoptEffectChains(EffectChainCache& effectChains);
+
+	bool _RebindEffectChains(EffectChainCache& effectChains);
+
+	// 切换到 _effectChains 中的某条效果链，首次使用时创建它的 EffectDrawer
+	bool _SetEffectChain(UINT idx);
+
+	// 根据上一帧的渲染用时调整效果链
+	void _UpdateQualityLevel();
+
+	// 覆盖层可见或需要调整效果链时统计渲染用时
+	void _UpdateProfiling();
 
 	bool _UpdateDynamicConstants();
 
@@ -59,13 +114,61 @@ private:
 	// 尺寸可能大于主窗口
 	RECT _virtualOutputRect{};
 
-	bool _waitingForNextFrame = false;
+	// 已等待交换链并开始新的一帧，但尚未呈现
+	bool _isFrameBegun = false;
+	bool _isWaitingForSource = false;
+	bool _isWaitingForSwapChain = false;
+
+	FrameScheduler _frameScheduler;
+
+	struct _EffectChain {
+		std::vector<std::string> names;
+		std::vector<EffectDesc> descs;
+		std::vector<EffectParams> params;
+		// 首次使用时创建，之后一直保留以便再次切换
+		std::vector<std::unique_ptr<EffectDrawer>> drawers;
+		// 显存占用过多或输出大部分不可见时分块执行，此时 drawers 为空
+		std::unique_ptr<TiledEffectChain> tiled;
+		ID3D11Texture2D* output = nullptr;
+		RECT outputRect{};
+		RECT virtualOutputRect{};
+	};
+	// 第一个为缩放配置中的效果链，之后是越来越轻量的备选效果链
+	std::vector<_EffectChain> _effectChains;
+
+public:
+	struct EffectChainCache {
+		~EffectChainCache();
 
-	std::vector<std::unique_ptr<EffectDrawer>> _effects;
-	std::array<EffectConstant32, 12> _dynamicConstants;
+		std::vector<_EffectChain> chains;
+		// 已创建的效果的输入，即源的输出纹理
+		UINT inputWidth = 0;
+		UINT inputHeight = 0;
+		DXGI_FORMAT inputFormat = DXGI_FORMAT_UNKNOWN;
+	};
+
+private:
+	UINT _curEffectChain = 0;
+	// 下一帧必须完整渲染所有效果，如刚切换效果链时
+	bool _isFullFrameNeeded = false;
+	QualityGovernor _qualityGovernor;
+
+	// 当前效果链中的效果
+	std::vector<EffectDrawer*> _effects;
+	// 当前效果链分块执行时非空
+	TiledEffectChain* _tiledEffects = nullptr;
+	// 存在使用动态常量的效果
+	bool _hasDynamicEffect = false;
+	// 最后一个效果的输出
+	ID3D11Texture2D* _effectsOutput = nullptr;
+
+	std::array<EffectConstant32, 4> _dynamicConstants;
 	winrt::com_ptr<ID3D11Buffer> _dynamicCB;
 
+	std::unique_ptr<CursorDrawer> _cursorDrawer;
 	std::unique_ptr<OverlayDrawer> _overlayDrawer;
+	// UI 线程也需要获知覆盖层是否可见
+	std::atomic<bool> _isUIVisible = false;
 	UINT _handlerID = 0;
 
 	std::unique_ptr<GPUTimer> _gpuTimer;
@@ -0,0 +1,81 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+
+// 单生产者单消费者的无锁环形队列
+// 同一时刻只能有一个线程调用 TryPush，一个线程调用 TryPop
+template <typename T, size_t Capacity>
+class SPSCQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity 必须为 2 的幂");
+
+public:
+	SPSCQueue() = default;
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue(SPSCQueue&&) = delete;
+
+	// 只能在生产者线程中调用
+	// 队列已满时返回 false，此时 value 不会被移动
+	bool TryPush(T&& value) {
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+
+		if (tail - _cachedHead == Capacity) {
+			// 缓存的位置已过时才读取消费者的位置，以减少缓存行的争用
+			_cachedHead = _head.load(std::memory_order_acquire);
+			if (tail - _cachedHead == Capacity) {
+				return false;
+			}
+		}
+
+		_slots[tail & _MASK] = std::move(value);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 只能在消费者线程中调用
+	// 队列为空时返回 false
+	bool TryPop(T& value) {
+		const size_t head = _head.load(std::memory_order_relaxed);
+
+		if (head == _cachedTail) {
+			_cachedTail = _tail.load(std::memory_order_acquire);
+			if (head == _cachedTail) {
+				return false;
+			}
+		}
+
+		T& slot = _slots[head & _MASK];
+		value = std::move(slot);
+		// 立即释放元素持有的资源，而不是等到被覆盖时
+		slot = T();
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 在其他线程中调用时结果可能立即过时
+	bool IsEmpty() const noexcept {
+		return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+	}
+
+	static constexpr size_t GetCapacity() noexcept {
+		return Capacity;
+	}
+
+private:
+	static constexpr size_t _MASK = Capacity - 1;
+
+	// 生产者和消费者修改的变量位于不同的缓存行，避免伪共享
+
+	// 消费者拥有
+	alignas(64) std::atomic<size_t> _head = 0;
+	size_t _cachedTail = 0;
+
+	// 生产者拥有
+	alignas(64) std::atomic<size_t> _tail = 0;
+	size_t _cachedHead = 0;
+
+	alignas(64) std::array<T, Capacity> _slots{};
+};
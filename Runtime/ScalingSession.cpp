@@ -0,0 +1,726 @@
+#include "pch.h"
+#include "ScalingSession.h"
+#include "App.h"
+#include "Utils.h"
+#include "GraphicsCaptureFrameSource.h"
+#include "GDIFrameSource.h"
+#include "DwmSharedSurfaceFrameSource.h"
+#include "DesktopDuplicationFrameSource.h"
+#include "ExclModeHack.h"
+#include "Renderer.h"
+#include "DeviceResources.h"
+#include "GraphicsDevice.h"
+#include "GPUTimer.h"
+#include "Logger.h"
+#include "CursorManager.h"
+#include "Config.h"
+#include "StrUtils.h"
+#include "WindowsMessages.h"
+#include "GPUMemoryTracker.h"
+#include <future>
+
+
+static constexpr const wchar_t* HOST_WINDOW_CLASS_NAME = L"Window_Magpie_967EB565-6F73-4E94-AE53-00CC42592A22";
+static constexpr const wchar_t* DDF_WINDOW_CLASS_NAME = L"Window_Magpie_C322D752-C866-4630-91F5-32CB242A8930";
+static constexpr const wchar_t* HOST_WINDOW_TITLE = L"Magpie_Host";
+
+static bool CalcHostWndRect(HWND hWnd, UINT multiMonitorMode, RECT& result);
+
+
+ScalingSession::ScalingSession() {}
+
+ScalingSession::~ScalingSession() {}
+
+bool ScalingSession::Run(
+	HWND hwndSrc,
+	const std::string& effectsJson,
+	UINT captureMode,
+	float cursorZoomFactor,
+	UINT cursorInterpolationMode,
+	int adapterIdx,
+	UINT multiMonitorUsage,
+	const RECT& cropBorders,
+	UINT flags
+) {
+	const auto startTime = std::chrono::steady_clock::now();
+
+	_hwndSrc = hwndSrc;
+	_uiThreadId = GetCurrentThreadId();
+	_config.reset(new Config());
+	_config->Initialize(cursorZoomFactor, cursorInterpolationMode, adapterIdx, multiMonitorUsage, cropBorders, flags);
+	
+	SetErrorMsg(ErrorMessages::GENERIC);
+
+	if (!CalcHostWndRect(_hwndSrc, _config->GetMultiMonitorUsage(), _hostWndRect)) {
+		Logger::Get().Critical("CalcHostWndRect 失败");
+		_OnQuit();
+		return false;
+	}
+
+	WarmSession::Key warmSessionKey{
+		adapterIdx,
+		flags,
+		Utils::GetSizeOfRect(_hostWndRect),
+		effectsJson
+	};
+
+	// 配置不变时复用上次缩放的设备和效果链，否则尽量和其他会话共享设备
+	std::shared_ptr<GraphicsDevice> device;
+	std::unique_ptr<Renderer::EffectChainCache> effectChains;
+	const bool isWarm = WarmSession::Get().Take(warmSessionKey, device, effectChains);
+	if (isWarm) {
+		Logger::Get().Info("复用上次缩放的 D3D 设备");
+	} else {
+		device = App::Get().GetSharedDevice(adapterIdx);
+		if (device) {
+			Logger::Get().Info("和其他缩放共享 D3D 设备");
+		}
+	}
+
+	// 启动过程是一个依赖图，只在需要时等待前面的阶段：
+	// 编译效果 ─────────────────────────────────────┐
+	// 创建设备 ─┬─ 创建交换链 ─ 初始化 FrameSource ─┴─ 初始化 Renderer ─ 初始化 CursorManager
+	// 创建主窗口 ┘
+	// 编译效果和创建设备在后台线程中执行，主窗口必须在此线程中创建
+	// 其他会话已编译过的效果在 EffectCacheManager 的内存缓存中，编译几乎没有开销
+	// 以下时间的单位均为微秒
+	int compileTime = 0;
+	int deviceTime = 0;
+	std::future<std::unique_ptr<Renderer::EffectChainCache>> compileFuture;
+	std::future<std::shared_ptr<GraphicsDevice>> deviceFuture;
+	if (!isWarm) {
+		compileFuture = std::async(std::launch::async, [&]() {
+			App::SessionScope scope(this);
+
+			std::unique_ptr<Renderer::EffectChainCache> result;
+			compileTime = Utils::Measure([&]() {
+				result = Renderer::CompileEffectChains(effectsJson);
+			});
+			return result;
+		});
+	}
+	if (!device) {
+		deviceFuture = std::async(std::launch::async, [&]() {
+			App::SessionScope scope(this);
+
+			std::shared_ptr<GraphicsDevice> result = std::make_shared<GraphicsDevice>();
+			deviceTime = Utils::Measure([&]() {
+				if (!result->Initialize(adapterIdx)) {
+					result = nullptr;
+				}
+			});
+			return result;
+		});
+	}
+
+	// 失败时等待后台线程，之后 _OnQuit 才能释放它们使用的资源
+	const auto waitForTasks = [&]() {
+		if (compileFuture.valid()) {
+			compileFuture.wait();
+		}
+		if (deviceFuture.valid()) {
+			deviceFuture.wait();
+		}
+	};
+
+	// 模拟独占全屏
+	// 必须在主窗口创建前，否则 SHQueryUserNotificationState 可能返回 QUNS_BUSY 而不是 QUNS_RUNNING_D3D_FULL_SCREEN
+	ExclModeHack exclMode;
+
+	bool success = true;
+	int hostWndTime = Utils::Measure([&]() {
+		success = _CreateHostWnd();
+	});
+	if (!success) {
+		Logger::Get().Critical("创建主窗口失败");
+		waitForTasks();
+		_OnQuit();
+		return false;
+	}
+
+	int deviceWaitTime = 0;
+	if (deviceFuture.valid()) {
+		deviceWaitTime = Utils::Measure([&]() {
+			device = deviceFuture.get();
+		});
+		if (!device) {
+			Logger::Get().Critical("初始化 GraphicsDevice 失败");
+			waitForTasks();
+			Quit();
+			_RunMessageLoop();
+			return false;
+		}
+	}
+
+	// 之后开始的缩放可以共享此设备
+	App::Get().SetSharedDevice(device);
+
+	_deviceResources.reset(new DeviceResources());
+	if (!_deviceResources->Initialize(std::move(device))) {
+		Logger::Get().Critical("初始化 DeviceResources 失败");
+		waitForTasks();
+		Quit();
+		_RunMessageLoop();
+		return false;
+	}
+
+	// 其他会话可能正在渲染线程中使用设备上下文，每个阶段分别持有锁，等待编译时不阻塞渲染
+	Utils::CSMutex& contextLock = _deviceResources->GetDevice().GetContextLock();
+
+	int swapChainTime = Utils::Measure([&]() {
+		std::scoped_lock lk(contextLock);
+		success = _deviceResources->CreateSwapChain();
+	});
+	if (!success) {
+		Logger::Get().Critical("CreateSwapChain 失败");
+		waitForTasks();
+		Quit();
+		_RunMessageLoop();
+		return false;
+	}
+	
+	int frameSourceTime = Utils::Measure([&]() {
+		std::scoped_lock lk(contextLock);
+		success = _InitFrameSource(captureMode);
+	});
+	if (!success) {
+		Logger::Get().Critical("_InitFrameSource 失败");
+		waitForTasks();
+		Quit();
+		_RunMessageLoop();
+		return false;
+	}
+
+	// 创建 EffectDrawer 需要源的输出尺寸，此时才等待编译完成
+	int compileWaitTime = 0;
+	if (compileFuture.valid()) {
+		compileWaitTime = Utils::Measure([&]() {
+			effectChains = compileFuture.get();
+		});
+		if (!effectChains) {
+			Logger::Get().Critical("编译效果链失败");
+			Quit();
+			_RunMessageLoop();
+			return false;
+		}
+	}
+
+	_renderer.reset(new Renderer());
+	int rendererTime = Utils::Measure([&]() {
+		std::scoped_lock lk(contextLock);
+		success = _renderer->Initialize(effectsJson, std::move(effectChains));
+	});
+	if (!success) {
+		Logger::Get().Critical("初始化 Renderer 失败");
+		Quit();
+		_RunMessageLoop();
+		return false;
+	}
+
+	_cursorManager.reset(new CursorManager());
+	{
+		std::scoped_lock lk(contextLock);
+		success = _cursorManager->Initialize();
+	}
+	if (!success) {
+		Logger::Get().Critical("初始化 CursorManager 失败");
+		Quit();
+		_RunMessageLoop();
+		return false;
+	}
+
+	if (_config->IsDisableDirectFlip() && !_config->IsBreakpointMode()) {
+		// 在此处创建的 DDF 窗口不会立刻显示
+		if (!_DisableDirectFlip()) {
+			Logger::Get().Error("_DisableDirectFlip 失败");
+		}
+	}
+
+	ShowWindow(_hwndHost, SW_NORMAL);
+
+	if (!App::Get().AddSession(*this)) {
+		Logger::Get().Critical("AddSession 失败");
+		Quit();
+		_RunMessageLoop();
+		return false;
+	}
+
+	Logger::Get().Info(fmt::format(
+		"启动用时 {:.2f} 毫秒\n\t编译效果：{:.2f}（等待 {:.2f}）\n\t创建设备：{:.2f}（等待 {:.2f}）\n"
+		"\t创建主窗口：{:.2f}\n\t创建交换链：{:.2f}\n\t初始化 FrameSource：{:.2f}\n\t初始化 Renderer：{:.2f}",
+		std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count(),
+		compileTime / 1000.0f, compileWaitTime / 1000.0f, deviceTime / 1000.0f, deviceWaitTime / 1000.0f,
+		hostWndTime / 1000.0f, swapChainTime / 1000.0f, frameSourceTime / 1000.0f, rendererTime / 1000.0f
+	));
+
+	_warmSessionKey = std::move(warmSessionKey);
+
+	_RunMessageLoop();
+
+	return true;
+}
+
+void ScalingSession::_RunMessageLoop() {
+	Logger::Get().Info("开始接收窗口消息");
+
+	// 渲染在共享的渲染线程中进行，处理消息不会推迟帧的呈现
+	MSG msg;
+	while (GetMessage(&msg, nullptr, 0, 0) > 0) {
+		TranslateMessage(&msg);
+		DispatchMessage(&msg);
+	}
+
+	_OnQuit();
+}
+
+void ScalingSession::RenderFrame() {
+	if (_isQuitting.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	// 在帧的边界执行 UI 线程发送的命令
+	std::function<void()> command;
+	while (_renderCommands.TryPop(command)) {
+		command();
+	}
+
+	// 受帧率限制时只处理命令
+	if (FrameScheduler::Clock::now() >= _renderer->GetFrameScheduler().GetEarliestFrameTime()) {
+		_renderer->Render();
+	}
+
+	// 第二帧（等待时或完成后）显示 DDF 窗口
+	// 如果在 Run 中创建会有短暂的灰屏
+	// 选择第二帧的原因：当 GetFrameCount() 返回 1 时第一帧可能处于等待状态而没有渲染，见 Renderer::Render()
+	// DDF 窗口属于 UI 线程，因此使用异步的版本
+	if (!_isDDFShown && _hwndDDF && _renderer->GetGPUTimer().GetFrameCount() >= 2) {
+		_isDDFShown = true;
+		ShowWindowAsync(_hwndDDF, SW_NORMAL);
+
+		if (!SetWindowPos(_hwndDDF, _hwndHost, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOMOVE | SWP_NOREDRAW | SWP_ASYNCWINDOWPOS)) {
+			Logger::Get().Win32Error("SetWindowPos 失败");
+		}
+	}
+}
+
+FrameScheduler::TimePoint ScalingSession::GetWakeTime(FrameScheduler::TimePoint now, HANDLE& hNewFrameEvent) const {
+	hNewFrameEvent = NULL;
+
+	if (_isQuitting.load(std::memory_order_acquire)) {
+		return FrameScheduler::TimePoint::max();
+	}
+
+	if (_renderer->IsWaitingForSwapChain()) {
+		// 交换链未就绪，稍后重试
+		return now + std::chrono::milliseconds(1);
+	}
+
+	const FrameScheduler& scheduler = _renderer->GetFrameScheduler();
+	const FrameScheduler::TimePoint wakeTime = scheduler.GetWakeTime(now, _renderer->IsAnimated());
+
+	// 受帧率限制时新帧到达也不会渲染，此时不等待新帧，事件保持触发状态
+	if (wakeTime > now && now >= scheduler.GetEarliestFrameTime()) {
+		hNewFrameEvent = _frameSource->GetNewFrameEvent();
+	}
+
+	return wakeTime;
+}
+
+UINT ScalingSession::RegisterWndProcHandler(std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)> handler) {
+	std::scoped_lock lk(_wndProcHandlersLock);
+
+	auto handlers = _wndProcHandlers
+		? std::make_shared<_WndProcHandlerMap>(*_wndProcHandlers)
+		: std::make_shared<_WndProcHandlerMap>();
+
+	UINT id = _nextWndProcHandlerID++;
+	if (!handlers->emplace(id, std::move(handler)).second) {
+		return 0;
+	}
+
+	_wndProcHandlers = std::move(handlers);
+	return id;
+}
+
+void ScalingSession::UnregisterWndProcHandler(UINT id) {
+	std::scoped_lock lk(_wndProcHandlersLock);
+
+	if (!_wndProcHandlers || !_wndProcHandlers->contains(id)) {
+		return;
+	}
+
+	auto handlers = std::make_shared<_WndProcHandlerMap>(*_wndProcHandlers);
+	handlers->erase(id);
+	_wndProcHandlers = std::move(handlers);
+}
+
+void ScalingSession::PostToRenderThread(std::function<void()> command) {
+	assert(GetCurrentThreadId() == _uiThreadId);
+
+	while (!_renderCommands.TryPush(std::move(command))) {
+		if (_isQuitting.load(std::memory_order_acquire)) {
+			return;
+		}
+
+		// 队列已满，等待渲染线程处理
+		Sleep(1);
+	}
+
+	App::Get().WakeRenderThread();
+}
+
+LRESULT DDFWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	if (msg == WM_DESTROY) {
+		return 0;
+	}
+
+	return DefWindowProc(hWnd, msg, wParam, lParam);
+}
+
+void ScalingSession::RegisterWndClasses(HINSTANCE hInst) {
+	WNDCLASSEX wcex = {};
+	wcex.cbSize = sizeof(WNDCLASSEX);
+	wcex.lpfnWndProc = HostWndProc;
+	wcex.hInstance = hInst;
+	wcex.hCursor = LoadCursor(NULL, IDC_ARROW);
+	wcex.lpszClassName = HOST_WINDOW_CLASS_NAME;
+
+	if (!RegisterClassEx(&wcex)) {
+		// 忽略此错误，因为可能是重复注册产生的错误
+		Logger::Get().Win32Error("注册主窗口类失败");
+	} else {
+		Logger::Get().Info("已注册主窗口类");
+	}
+
+	wcex.lpfnWndProc = DDFWndProc;
+	wcex.hbrBackground = (HBRUSH)GetStockObject(GRAY_BRUSH);
+	wcex.lpszClassName = DDF_WINDOW_CLASS_NAME;
+
+	if (!RegisterClassEx(&wcex)) {
+		Logger::Get().Win32Error("注册 DDF 窗口类失败");
+	} else {
+		Logger::Get().Info("已注册 DDF 窗口类");
+	}
+}
+
+static BOOL CALLBACK MonitorEnumProc(HMONITOR, HDC, LPRECT monitorRect, LPARAM data) {
+	RECT* params = (RECT*)data;
+
+	if (Utils::CheckOverlap(params[0], *monitorRect)) {
+		UnionRect(&params[1], monitorRect, &params[1]);
+	}
+	
+	return TRUE;
+}
+
+static bool CalcHostWndRect(HWND hWnd, UINT multiMonitorMode, RECT& result) {
+	switch (multiMonitorMode) {
+	case 0:
+	{
+		// 使用距离源窗口最近的显示器
+		HMONITOR hMonitor = MonitorFromWindow(hWnd, MONITOR_DEFAULTTONEAREST);
+		if (!hMonitor) {
+			Logger::Get().Win32Error("MonitorFromWindow 失败");
+			return false;
+		}
+
+		MONITORINFO mi{};
+		mi.cbSize = sizeof(mi);
+		if (!GetMonitorInfo(hMonitor, &mi)) {
+			Logger::Get().Win32Error("GetMonitorInfo 失败");
+			return false;
+		}
+		result = mi.rcMonitor;
+
+		break;
+	}
+	case 1:
+	{
+		// 使用源窗口跨越的所有显示器
+
+		// [0] 存储源窗口坐标，[1] 存储计算结果
+		RECT params[2]{};
+
+		if (!Utils::GetWindowFrameRect(hWnd, params[0])) {
+			Logger::Get().Error("GetWindowFrameRect 失败");
+			return false;
+		}
+		
+		if (!EnumDisplayMonitors(NULL, NULL, MonitorEnumProc, (LPARAM)&params)) {
+			Logger::Get().Win32Error("EnumDisplayMonitors 失败");
+			return false;
+		}
+		
+		result = params[1];
+		if (result.right - result.left <= 0 || result.bottom - result.top <= 0) {
+			Logger::Get().Error("计算主窗口坐标失败");
+			return false;
+		}
+
+		break;
+	}
+	case 2:
+	{
+		// 使用所有显示器（Virtual Screen）
+		int vsWidth = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+		int vsHeight = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+		int vsX = GetSystemMetrics(SM_XVIRTUALSCREEN);
+		int vsY = GetSystemMetrics(SM_YVIRTUALSCREEN);
+		result = { vsX, vsY, vsX + vsWidth, vsY + vsHeight };
+
+		break;
+	}
+	default:
+		return false;
+	}
+	
+	return true;
+}
+
+bool ScalingSession::_CreateHostWnd() {
+	_hwndHost = CreateWindowEx(
+		(_config->IsBreakpointMode() ? 0 : WS_EX_TOPMOST) | WS_EX_NOACTIVATE | WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOOLWINDOW,
+		HOST_WINDOW_CLASS_NAME,
+		HOST_WINDOW_TITLE,
+		WS_POPUP,
+		_hostWndRect.left,
+		_hostWndRect.top,
+		_hostWndRect.right - _hostWndRect.left,
+		_hostWndRect.bottom - _hostWndRect.top,
+		NULL,
+		NULL,
+		App::Get().GetHInstance(),
+		this
+	);
+	if (!_hwndHost) {
+		Logger::Get().Win32Error("创建主窗口失败");
+		return false;
+	}
+
+	Logger::Get().Info(fmt::format("主窗口尺寸：{}x{}",
+		_hostWndRect.right - _hostWndRect.left, _hostWndRect.bottom - _hostWndRect.top));
+
+	// 设置窗口不透明
+	// 不完全透明时可关闭 DirectFlip
+	if (!SetLayeredWindowAttributes(_hwndHost, 0, _config->IsDisableDirectFlip() ? 254 : 255, LWA_ALPHA)) {
+		Logger::Get().Win32Error("SetLayeredWindowAttributes 失败");
+	}
+
+	Logger::Get().Info("已创建主窗口");
+	return true;
+}
+
+bool ScalingSession::_InitFrameSource(int captureMode) {
+	switch (captureMode) {
+	case 0:
+		_frameSource.reset(new GraphicsCaptureFrameSource());
+		break;
+	case 1:
+		_frameSource.reset(new DesktopDuplicationFrameSource());
+		break;
+	case 2:
+		_frameSource.reset(new GDIFrameSource());
+		break;
+	case 3:
+		_frameSource.reset(new DwmSharedSurfaceFrameSource());
+		break;
+	default:
+		Logger::Get().Critical("未知的捕获模式");
+		return false;
+	}
+
+	Logger::Get().Info(StrUtils::Concat("当前捕获模式：", _frameSource->GetName()));
+
+	if (!_frameSource->Initialize()) {
+		Logger::Get().Critical("初始化 FrameSource 失败");
+		return false;
+	}
+
+	const RECT& frameRect = _frameSource->GetSrcFrameRect();
+	Logger::Get().Info(fmt::format("源窗口尺寸：{}x{}",
+		frameRect.right - frameRect.left, frameRect.bottom - frameRect.top));
+
+	return true;
+}
+
+bool ScalingSession::_DisableDirectFlip() {
+	// 没有显式关闭 DirectFlip 的方法
+	// 将全屏窗口设为稍微透明，以灰色全屏窗口为背景
+	_hwndDDF = CreateWindowEx(
+		WS_EX_NOACTIVATE | WS_EX_LAYERED | WS_EX_TRANSPARENT,
+		DDF_WINDOW_CLASS_NAME,
+		NULL,
+		WS_POPUP,
+		_hostWndRect.left,
+		_hostWndRect.top,
+		_hostWndRect.right - _hostWndRect.left,
+		_hostWndRect.bottom - _hostWndRect.top,
+		NULL,
+		NULL,
+		App::Get().GetHInstance(),
+		NULL
+	);
+
+	if (!_hwndDDF) {
+		Logger::Get().Win32Error("创建 DDF 窗口失败");
+		return false;
+	}
+
+	// 设置窗口不透明
+	if (!SetLayeredWindowAttributes(_hwndDDF, 0, 255, LWA_ALPHA)) {
+		Logger::Get().Win32Error("SetLayeredWindowAttributes 失败");
+	}
+
+	if (_frameSource->IsScreenCapture()) {
+		const RTL_OSVERSIONINFOW& version = Utils::GetOSVersion();
+		if (Utils::CompareVersion(version.dwMajorVersion, version.dwMinorVersion, version.dwBuildNumber, 10, 0, 19041) >= 0) {
+			// 使 DDF 窗口无法被捕获到
+			if (!SetWindowDisplayAffinity(_hwndDDF, WDA_EXCLUDEFROMCAPTURE)) {
+				Logger::Get().Win32Error("SetWindowDisplayAffinity 失败");
+			}
+		}
+	}
+
+	Logger::Get().Info("已创建 DDF 主窗口");
+	return true;
+}
+
+LRESULT ScalingSession::HostWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+	if (msg == WM_NCCREATE) {
+		// 主窗口属于创建它的会话
+		SetWindowLongPtr(hWnd, GWLP_USERDATA, (LONG_PTR)((CREATESTRUCT*)lParam)->lpCreateParams);
+	}
+
+	ScalingSession* that = (ScalingSession*)GetWindowLongPtr(hWnd, GWLP_USERDATA);
+	if (!that) {
+		return DefWindowProc(hWnd, msg, wParam, lParam);
+	}
+
+	return that->_HostWndProc(hWnd, msg, wParam, lParam);
+}
+
+LRESULT ScalingSession::_HostWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+	std::shared_ptr<const _WndProcHandlerMap> handlers;
+	{
+		std::scoped_lock lk(_wndProcHandlersLock);
+		handlers = _wndProcHandlers;
+	}
+
+	if (handlers) {
+		// 以反向调用回调
+		for (auto it = handlers->rbegin(); it != handlers->rend(); ++it) {
+			const auto& result = it->second(hWnd, message, wParam, lParam);
+			if (result.has_value()) {
+				return result.value();
+			}
+		}
+	}
+
+	if (message == WindowsMessages::WM_DESTORYHOST) {
+		Logger::Get().Info("收到 MAGPIE_WM_DESTORYHOST 消息，即将销毁主窗口");
+		Quit();
+		return 0;
+	}
+
+	switch (message) {
+	case WM_DESTROY:
+		// 有两个退出路径：
+		// 1. 前台窗口发生改变
+		// 2. 收到_WM_DESTORYMAG 消息
+		// 先停止渲染，渲染线程不能使用已销毁的窗口
+		App::Get().RemoveSession(*this);
+		PostQuitMessage(0);
+		return 0;
+	}
+
+	return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+void ScalingSession::_OnQuit() {
+	App::Get().RemoveSession(*this);
+
+	// 渲染线程已不再访问此会话，此线程成为唯一的消费者
+	std::function<void()> command;
+	while (_renderCommands.TryPop(command)) {}
+
+	// 设备可能正被其他会话使用，释放此会话的资源时需持有上下文的锁
+	// 在锁外释放对设备的引用，否则锁可能随设备一起被销毁
+	std::shared_ptr<GraphicsDevice> device;
+	std::unique_ptr<Renderer::EffectChainCache> effectChains;
+	{
+		std::unique_lock<Utils::CSMutex> lk;
+		if (_deviceResources) {
+			device = _deviceResources->GetSharedDevice();
+			lk = std::unique_lock<Utils::CSMutex>(device->GetContextLock());
+		}
+
+		// 缩放正常结束时保留效果链，设备在其他资源释放后保留
+		if (_warmSessionKey && WarmSession::Get().GetTimeout() > 0) {
+			effectChains = _renderer->DetachEffectChains();
+		}
+
+		// 释放资源
+		_cursorManager = nullptr;
+		_renderer = nullptr;
+		_frameSource = nullptr;
+		_deviceResources = nullptr;
+	}
+
+	if (effectChains) {
+		WarmSession::Get().Store(std::move(*_warmSessionKey), device, std::move(effectChains));
+	}
+	_warmSessionKey.reset();
+
+	// 其他会话仍在使用时设备不会被释放
+	device = nullptr;
+	_config = nullptr;
+
+	std::scoped_lock lk(_wndProcHandlersLock);
+	_nextWndProcHandlerID = 1;
+	_wndProcHandlers.reset();
+}
+
+bool ScalingSession::EstimateGPUMemory(
+	const std::string& effectsJson,
+	UINT flags,
+	SIZE inputSize,
+	SIZE hostSize,
+	std::vector<std::string>& effectNames,
+	std::vector<uint64_t>& effectBytes
+) {
+	// 编译效果只使用配置中的标志
+	_config.reset(new Config());
+	_config->Initialize(1.0f, 0, 0, 0, RECT{}, flags);
+
+	std::unique_ptr<Renderer::EffectChainCache> effectChains = Renderer::CompileEffectChains(effectsJson);
+	if (!effectChains) {
+		Logger::Get().Error("CompileEffectChains 失败");
+		return false;
+	}
+
+	const auto& chain = effectChains->chains[0];
+	SIZE outputSize{};
+	if (!GPUMemoryTracker::EstimateEffectChain(chain.descs, chain.params, inputSize, hostSize, effectBytes, outputSize)) {
+		Logger::Get().Error("估计显存占用失败");
+		return false;
+	}
+
+	effectNames = chain.names;
+	return true;
+}
+
+void ScalingSession::Quit() {
+	if (GetCurrentThreadId() != _uiThreadId) {
+		// 窗口只能由创建它的线程销毁，渲染线程在此之后不再渲染此会话的新帧
+		_isQuitting.store(true, std::memory_order_release);
+		PostMessage(_hwndHost, WindowsMessages::WM_DESTORYHOST, 0, 0);
+		return;
+	}
+
+	if (_hwndDDF) {
+		DestroyWindow(_hwndDDF);
+	}
+	if (_hwndHost) {
+		DestroyWindow(_hwndHost);
+	}
+}
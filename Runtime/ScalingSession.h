@@ -0,0 +1,162 @@
+#pragma once
+#include "pch.h"
+#include "ErrorMessages.h"
+#include "SPSCQueue.h"
+#include "Utils.h"
+#include "FrameScheduler.h"
+#include "WarmSession.h"
+
+
+class DeviceResources;
+class Renderer;
+class FrameSourceBase;
+class CursorManager;
+class Config;
+
+
+// 一个源窗口的缩放，拥有源、主窗口、Renderer 和光标状态
+// 窗口消息在调用 Run 的线程（UI 线程）中处理，渲染在 App 的渲染线程中和其他会话轮流进行
+// 所有会话共享 D3D 设备、效果缓存和着色器对象，见 GraphicsDevice
+class ScalingSession {
+public:
+	ScalingSession();
+	ScalingSession(const ScalingSession&) = delete;
+	ScalingSession(ScalingSession&&) = delete;
+
+	~ScalingSession();
+
+	// 缩放结束后返回，初始化失败时返回 false
+	bool Run(
+		HWND hwndSrc,
+		const std::string& effectsJson,
+		UINT captureMode,
+		float cursorZoomFactor,
+		UINT cursorInterpolationMode,
+		int adapterIdx,
+		UINT multiMonitorUsage,
+		const RECT& cropBorders,
+		UINT flags
+	);
+
+	// 只编译效果链并估计第一条效果链占用的显存，不开始缩放，之后只能销毁此对象
+	// 此会话应为调用线程的当前会话，见 App::EstimateGPUMemory
+	bool EstimateGPUMemory(
+		const std::string& effectsJson,
+		UINT flags,
+		SIZE inputSize,
+		SIZE hostSize,
+		std::vector<std::string>& effectNames,
+		std::vector<uint64_t>& effectBytes
+	);
+
+	// 可以在任何线程中调用
+	void Quit();
+
+	HWND GetHwndSrc() const noexcept {
+		return _hwndSrc;
+	}
+
+	HWND GetHwndHost() const noexcept {
+		return _hwndHost;
+	}
+
+	const RECT& GetHostWndRect() const noexcept {
+		return _hostWndRect;
+	}
+
+	DeviceResources& GetDeviceResources() noexcept {
+		return *_deviceResources;
+	}
+
+	Renderer& GetRenderer() noexcept {
+		return *_renderer;
+	}
+
+	FrameSourceBase& GetFrameSource() noexcept {
+		return *_frameSource;
+	}
+
+	CursorManager& GetCursorManager() noexcept {
+		return *_cursorManager;
+	}
+
+	Config& GetConfig() noexcept {
+		return *_config;
+	}
+
+	const char* GetErrorMsg() const noexcept {
+		return _errorMsg;
+	}
+
+	void SetErrorMsg(const char* errorMsg) noexcept {
+		_errorMsg = errorMsg;
+	}
+
+	// 见 App::RegisterWndProcHandler
+	UINT RegisterWndProcHandler(std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)> handler);
+	void UnregisterWndProcHandler(UINT id);
+
+	// 见 App::PostToRenderThread
+	void PostToRenderThread(std::function<void()> command);
+
+	// 以下两个函数在渲染线程中调用
+
+	// 执行 UI 线程发送的命令，受帧率限制时不渲染
+	void RenderFrame();
+
+	// 下次需要调用 RenderFrame 的时间。hNewFrameEvent 为新帧到达时触发的事件，不需要等待新帧时为空
+	FrameScheduler::TimePoint GetWakeTime(FrameScheduler::TimePoint now, HANDLE& hNewFrameEvent) const;
+
+	// 注册主窗口和 DDF 窗口的窗口类
+	static void RegisterWndClasses(HINSTANCE hInst);
+
+private:
+	static LRESULT CALLBACK HostWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+
+	void _RunMessageLoop();
+
+	// 创建主窗口，_hostWndRect 应已计算
+	bool _CreateHostWnd();
+
+	bool _InitFrameSource(int captureMode);
+
+	bool _DisableDirectFlip();
+
+	LRESULT _HostWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+
+	void _OnQuit();
+
+	const char* _errorMsg = ErrorMessages::GENERIC;
+
+	HWND _hwndSrc = NULL;
+	HWND _hwndHost = NULL;
+
+	// 关闭 DirectFlip 时的背景全屏窗口
+	HWND _hwndDDF = NULL;
+	bool _isDDFShown = false;
+
+	RECT _hostWndRect{};
+
+	std::unique_ptr<DeviceResources> _deviceResources;
+	std::unique_ptr<Renderer> _renderer;
+	std::unique_ptr<FrameSourceBase> _frameSource;
+	std::unique_ptr<CursorManager> _cursorManager;
+	std::unique_ptr<Config> _config;
+
+	// 缩放成功开始后设置，结束时以此保留设备和效果链
+	std::optional<WarmSession::Key> _warmSessionKey;
+
+	using _WndProcHandlerMap = std::map<UINT, std::function<std::optional<LRESULT>(HWND, UINT, WPARAM, LPARAM)>>;
+	// 渲染线程中也可能注册回调，因此修改时复制一份，执行回调时不必持有锁
+	std::shared_ptr<const _WndProcHandlerMap> _wndProcHandlers;
+	UINT _nextWndProcHandlerID = 1;
+	Utils::CSMutex _wndProcHandlersLock;
+
+	// 创建主窗口的线程，负责处理窗口消息
+	DWORD _uiThreadId = 0;
+
+	// 调用 Quit 后渲染线程不再渲染此会话的新帧
+	std::atomic<bool> _isQuitting = false;
+	// UI 线程向渲染线程发送的命令
+	SPSCQueue<std::function<void()>, 256> _renderCommands;
+};
@@ -0,0 +1,37 @@
+#include "ShaderHash.h"
+
+
+static void UpdateSource(Hasher& hasher, std::string_view source) noexcept {
+	hasher.Update(std::span((const uint8_t*)source.data(), source.size()));
+}
+
+std::array<uint8_t, Hasher::HASH_LENGTH> ShaderHash::Compute(
+	std::string_view preprocessedSource,
+	uint32_t cacheVersion,
+	uint32_t compileFlags
+) noexcept {
+	Hasher hasher;
+
+	// 逐行查找 #line 指令，两个指令之间的部分一次写入
+	size_t runStart = 0;
+	size_t lineStart = 0;
+	while (lineStart < preprocessedSource.size()) {
+		size_t lineEnd = preprocessedSource.find('\n', lineStart);
+		lineEnd = lineEnd == std::string_view::npos ? preprocessedSource.size() : lineEnd + 1;
+
+		std::string_view line = preprocessedSource.substr(lineStart, lineEnd - lineStart);
+		const size_t first = line.find_first_not_of(" \t");
+		if (first != std::string_view::npos && line.substr(first).starts_with("#line")) {
+			UpdateSource(hasher, preprocessedSource.substr(runStart, lineStart - runStart));
+			runStart = lineEnd;
+		}
+
+		lineStart = lineEnd;
+	}
+	UpdateSource(hasher, preprocessedSource.substr(runStart));
+
+	hasher.UpdateValue(cacheVersion);
+	hasher.UpdateValue(compileFlags);
+
+	return hasher.Digest();
+}
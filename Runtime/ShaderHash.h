@@ -0,0 +1,17 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include "Hasher.h"
+
+
+// 着色器字节码缓存的键
+class ShaderHash {
+public:
+	// 预处理后的源码、缓存版本和编译标志的哈希
+	// 跳过 #line 指令，它们包含源文件名（即效果名和通道序号），不影响生成的代码
+	// 因此不同效果生成的相同通道有相同的哈希，可以共用字节码
+	static std::array<uint8_t, Hasher::HASH_LENGTH> Compute(
+		std::string_view preprocessedSource,
+		uint32_t cacheVersion,
+		uint32_t compileFlags
+	) noexcept;
+};
@@ -0,0 +1,184 @@
+#include "TilePlanner.h"
+#include <algorithm>
+#include <numeric>
+
+
+namespace {
+
+// 一个方向上的分块结果
+struct AxisPlan {
+	uint32_t cropLength = 0;
+
+	struct Segment {
+		// 裁剪区域在第一个效果输入上的起点
+		uint32_t cropStart = 0;
+		// 负责的最终输出区间
+		uint32_t outputStart = 0;
+		uint32_t outputEnd = 0;
+	};
+	std::vector<Segment> segments;
+};
+
+}
+
+static void PlanAxis(
+	const std::vector<TilePlanner::Stage>& stages,
+	uint32_t TilePlanner::Size::* dim,
+	uint32_t roiStart,
+	uint32_t roiEnd,
+	uint32_t tileLength,
+	AxisPlan& result
+) {
+	const uint64_t inputLength = stages.front().inputSize.*dim;
+	const uint64_t outputLength = stages.back().outputSize.*dim;
+
+	// 裁剪区域的边界必须是 unit 的倍数，这样映射到每个纹理上都是整像素
+	// unit 是所有 inputLength / gcd(inputLength, size) 的最小公倍数，因此总是 inputLength 的约数
+	uint64_t unit = 1;
+	const auto addSize = [&](uint64_t size) {
+		unit = std::lcm(unit, inputLength / std::gcd(inputLength, size));
+	};
+	for (const TilePlanner::Stage& stage : stages) {
+		addSize(stage.inputSize.*dim);
+		for (const TilePlanner::Size& size : stage.textureSizes) {
+			if (size.*dim > 0) {
+				addSize(size.*dim);
+			}
+		}
+	}
+	addSize(outputLength);
+
+	tileLength = (uint32_t)std::clamp<uint64_t>(tileLength, 1, roiEnd - roiStart);
+
+	result.segments.clear();
+	uint64_t cropLength = 0;
+
+	// 只有 [roiStart, roiEnd) 内的输出需要计算
+	for (uint64_t outputStart = roiStart; outputStart < roiEnd; outputStart += tileLength) {
+		const uint64_t outputEnd = std::min<uint64_t>(outputStart + tileLength, roiEnd);
+
+		// 从最后一个效果开始反向求出依赖的输入区间
+		int64_t start = (int64_t)outputStart;
+		int64_t end = (int64_t)outputEnd;
+		for (size_t i = stages.size(); i-- > 0;) {
+			const uint64_t in = stages[i].inputSize.*dim;
+			const uint64_t out = stages[i].outputSize.*dim;
+			// 额外扩大一个像素以覆盖采样位置的舍入误差
+			const int64_t inflate = (int64_t)stages[i].halo + 1;
+
+			start = int64_t(uint64_t(start) * in / out) - inflate;
+			end = int64_t((uint64_t(end) * in + out - 1) / out) + inflate;
+
+			start = std::max<int64_t>(start, 0);
+			end = std::min<int64_t>(end, (int64_t)in);
+		}
+
+		const uint64_t cropStart = uint64_t(start) / unit * unit;
+		const uint64_t cropEnd = std::min((uint64_t(end) + unit - 1) / unit * unit, inputLength);
+		cropLength = std::max(cropLength, cropEnd - cropStart);
+
+		result.segments.push_back({ (uint32_t)cropStart, (uint32_t)outputStart, (uint32_t)outputEnd });
+	}
+
+	if (cropLength >= inputLength) {
+		// 此方向上分块没有意义
+		result.cropLength = (uint32_t)inputLength;
+		result.segments = { { 0, roiStart, roiEnd } };
+		return;
+	}
+
+	// 所有裁剪区域使用相同的尺寸，靠近边缘的向内移动。起点和 inputLength - cropLength 都是 unit 的倍数
+	result.cropLength = (uint32_t)cropLength;
+	for (AxisPlan::Segment& segment : result.segments) {
+		segment.cropStart = std::min(segment.cropStart, uint32_t(inputLength - cropLength));
+	}
+}
+
+bool TilePlanner::Plan(const std::vector<Stage>& stages, Size tileSize) {
+	if (stages.empty()) {
+		_tiles.clear();
+		_cropSizes.clear();
+		return false;
+	}
+
+	const Size& outputSize = stages.back().outputSize;
+	return Plan(stages, tileSize, Rect{ 0, 0, (int32_t)outputSize.width, (int32_t)outputSize.height });
+}
+
+bool TilePlanner::Plan(const std::vector<Stage>& stages, Size tileSize, const Rect& roi) {
+	_tiles.clear();
+	_cropSizes.clear();
+
+	if (stages.empty()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < stages.size(); ++i) {
+		const Stage& stage = stages[i];
+		if (stage.inputSize.width == 0 || stage.inputSize.height == 0
+			|| stage.outputSize.width == 0 || stage.outputSize.height == 0) {
+			return false;
+		}
+
+		if (i + 1 < stages.size() && stage.outputSize != stages[i + 1].inputSize) {
+			return false;
+		}
+	}
+
+	const Size& outputSize = stages.back().outputSize;
+	if (roi.IsEmpty() || roi.left < 0 || roi.top < 0
+		|| roi.right > (int32_t)outputSize.width || roi.bottom > (int32_t)outputSize.height) {
+		return false;
+	}
+
+	AxisPlan xPlan;
+	AxisPlan yPlan;
+	PlanAxis(stages, &Size::width, (uint32_t)roi.left, (uint32_t)roi.right, tileSize.width, xPlan);
+	PlanAxis(stages, &Size::height, (uint32_t)roi.top, (uint32_t)roi.bottom, tileSize.height, yPlan);
+
+	const Size inputSize = stages.front().inputSize;
+	if (xPlan.cropLength == inputSize.width && yPlan.cropLength == inputSize.height) {
+		return false;
+	}
+
+	const auto scaleCrop = [&](Size size) {
+		// 裁剪区域的边界已对齐，结果总是整数
+		return Size{
+			uint32_t(uint64_t(xPlan.cropLength) * size.width / inputSize.width),
+			uint32_t(uint64_t(yPlan.cropLength) * size.height / inputSize.height)
+		};
+	};
+
+	_cropSizes.reserve(stages.size() + 1);
+	for (const Stage& stage : stages) {
+		_cropSizes.push_back(scaleCrop(stage.inputSize));
+	}
+	_cropSizes.push_back(scaleCrop(outputSize));
+
+	_tiles.reserve(xPlan.segments.size() * yPlan.segments.size());
+	for (const AxisPlan::Segment& y : yPlan.segments) {
+		for (const AxisPlan::Segment& x : xPlan.segments) {
+			Tile& tile = _tiles.emplace_back();
+			tile.crop = Rect{
+				(int32_t)x.cropStart,
+				(int32_t)y.cropStart,
+				int32_t(x.cropStart + xPlan.cropLength),
+				int32_t(y.cropStart + yPlan.cropLength)
+			};
+			tile.cropOutput = Rect{
+				int32_t(uint64_t(x.cropStart) * outputSize.width / inputSize.width),
+				int32_t(uint64_t(y.cropStart) * outputSize.height / inputSize.height),
+				int32_t(uint64_t(x.cropStart + xPlan.cropLength) * outputSize.width / inputSize.width),
+				int32_t(uint64_t(y.cropStart + yPlan.cropLength) * outputSize.height / inputSize.height)
+			};
+			tile.output = Rect{
+				(int32_t)x.outputStart,
+				(int32_t)y.outputStart,
+				(int32_t)x.outputEnd,
+				(int32_t)y.outputEnd
+			};
+		}
+	}
+
+	return true;
+}
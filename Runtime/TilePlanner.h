@@ -0,0 +1,62 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include "DirtyRegion.h"
+
+
+// 将效果链的输出分割为图块，每个图块在第一个效果输入的一部分上独立运行整个效果链
+// 中间纹理因此只需裁剪区域的尺寸，显存占用取决于图块尺寸而不是分辨率
+// 裁剪区域向外扩大了各效果的采样范围，且边界在所有纹理上都是整像素，因此图块内的结果和不分块时完全相同
+class TilePlanner {
+public:
+	using Rect = DirtyRegion::Rect;
+
+	struct Size {
+		uint32_t width = 0;
+		uint32_t height = 0;
+
+		bool operator==(const Size&) const noexcept = default;
+	};
+
+	// 效果链中的一个效果
+	struct Stage {
+		Size inputSize;
+		Size outputSize;
+		// 以输入的像素为单位，效果中所有通道的采样范围之和
+		uint32_t halo = 0;
+		// 效果内中间纹理的尺寸，裁剪区域的边界在它们上也必须是整像素
+		std::vector<Size> textureSizes;
+	};
+
+	struct Tile {
+		// 第一个效果的输入中裁剪的区域，尺寸总为 GetCropSize(0)
+		Rect crop;
+		// crop 映射到最终输出上的区域
+		Rect cropOutput;
+		// 此图块负责的最终输出区域，包含在 cropOutput 和 roi 中
+		Rect output;
+	};
+
+	TilePlanner() noexcept = default;
+
+	// tileSize 为期望的图块在最终输出上的尺寸
+	// 各效果的尺寸不衔接，或者分块后裁剪区域不比原始输入小时返回 false
+	bool Plan(const std::vector<Stage>& stages, Size tileSize);
+
+	// 只有最终输出中 roi 内的部分需要计算，如只有一部分在主窗口中可见
+	// 图块只覆盖 roi，反向映射到各效果上的区域之外不会被计算
+	bool Plan(const std::vector<Stage>& stages, Size tileSize, const Rect& roi);
+
+	const std::vector<Tile>& GetTiles() const noexcept {
+		return _tiles;
+	}
+
+	// 裁剪区域映射到第 idx 个效果的输入上的尺寸，idx 等于效果数时为最终输出上的尺寸
+	// 所有图块的裁剪区域尺寸相同，因此每个效果只需一组图块尺寸的纹理
+	Size GetCropSize(size_t idx) const noexcept {
+		return idx < _cropSizes.size() ? _cropSizes[idx] : Size{};
+	}
+
+private:
+	std::vector<Tile> _tiles;
+	std::vector<Size> _cropSizes;
+};
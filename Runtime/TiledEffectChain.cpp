@@ -0,0 +1,416 @@
+#include "pch.h"
+#include "TiledEffectChain.h"
+#include "App.h"
+#include "DeviceResources.h"
+#include "EffectDrawer.h"
+#include "EffectCompiler.h"
+#include "Renderer.h"
+#include "GPUTimer.h"
+#include "GPUMemoryTracker.h"
+#include "Logger.h"
+#include "Utils.h"
+
+
+// 图块在最终输出上的期望尺寸
+static constexpr TilePlanner::Size TILE_SIZE{ 1024, 1024 };
+// 不分块时中间纹理显存占用的上限，实际还不超过显存的一半
+static constexpr uint64_t MAX_UNTILED_TEXTURE_BYTES = 1ull << 30;
+// 可见部分占输出的比例低于此值时只计算可见部分
+static constexpr double MAX_VISIBLE_RATIO = 0.75;
+
+static uint64_t GetMaxUntiledTextureBytes() {
+	uint64_t result = MAX_UNTILED_TEXTURE_BYTES;
+
+	// 配置了显存预算时超出预算的效果链也分块执行
+	if (const uint64_t budget = GPUMemoryTracker::Get().GetBudget(); budget > 0) {
+		result = std::min(result, budget);
+	}
+
+	DXGI_ADAPTER_DESC1 desc{};
+	HRESULT hr = App::Get().GetDeviceResources().GetGraphicsAdapter()->GetDesc1(&desc);
+	if (SUCCEEDED(hr) && desc.DedicatedVideoMemory > 0) {
+		result = std::min<uint64_t>(result, desc.DedicatedVideoMemory / 2);
+	}
+
+	return result;
+}
+
+// 以输入的像素为单位，效果中所有通道的采样范围之和
+static uint32_t CalcHalo(const EffectDesc& desc, SIZE inputSize, const std::vector<SIZE>& texSizes) {
+	uint32_t result = 0;
+
+	for (const EffectPassDesc& passDesc : desc.passes) {
+		double passHalo = 0;
+
+		for (UINT input : passDesc.inputs) {
+			if (input >= texSizes.size()) {
+				continue;
+			}
+
+			const SIZE& texSize = texSizes[input];
+			if (texSize.cx == 0 || texSize.cy == 0) {
+				// 从文件加载的纹理和输出位置无关
+				continue;
+			}
+
+			// 换算为输入的像素，额外扩大一个像素以覆盖采样位置的舍入误差
+			const double ratio = std::max((double)inputSize.cx / texSize.cx, (double)inputSize.cy / texSize.cy);
+			passHalo = std::max(passHalo, (passDesc.halo + 1) * ratio);
+		}
+
+		result += (uint32_t)std::ceil(passHalo);
+	}
+
+	return result;
+}
+
+// 效果链的中间纹理和输出纹理预计占用的显存
+static bool CalcTextureBytes(
+	const std::vector<EffectDesc>& descs,
+	const std::vector<EffectParams>& params,
+	SIZE inputSize,
+	SIZE& outputSize,
+	uint64_t& result
+) {
+	std::vector<uint64_t> effectBytes;
+	if (!GPUMemoryTracker::EstimateEffectChain(descs, params, inputSize,
+		Utils::GetSizeOfRect(App::Get().GetHostWndRect()), effectBytes, outputSize)) {
+		return false;
+	}
+
+	result = 0;
+	for (uint64_t bytes : effectBytes) {
+		result += bytes;
+	}
+	return true;
+}
+
+// 和 EffectDrawer 中最后一个效果的计算方式相同，输出居中，尺寸可能比主窗口更大
+static RECT CalcVirtualOutputRect(SIZE outputSize) {
+	const SIZE hostSize = Utils::GetSizeOfRect(App::Get().GetHostWndRect());
+
+	RECT result;
+	result.left = (hostSize.cx - outputSize.cx) / 2;
+	result.top = (hostSize.cy - outputSize.cy) / 2;
+	result.right = result.left + outputSize.cx;
+	result.bottom = result.top + outputSize.cy;
+	return result;
+}
+
+// 输出中在主窗口内可见的部分，以输出的像素为单位
+static TilePlanner::Rect CalcVisibleRect(SIZE outputSize) {
+	const SIZE hostSize = Utils::GetSizeOfRect(App::Get().GetHostWndRect());
+	const RECT virtualOutputRect = CalcVirtualOutputRect(outputSize);
+
+	return TilePlanner::Rect{
+		(int32_t)std::max(0L, -virtualOutputRect.left),
+		(int32_t)std::max(0L, -virtualOutputRect.top),
+		(int32_t)std::min(outputSize.cx, hostSize.cx - virtualOutputRect.left),
+		(int32_t)std::min(outputSize.cy, hostSize.cy - virtualOutputRect.top)
+	};
+}
+
+static bool IsTileDirty(const DirtyRegion& region, const TilePlanner::Rect& rect) {
+	if (region.IsFull()) {
+		return true;
+	}
+
+	for (const DirtyRegion::Rect& dirtyRect : region.GetRects()) {
+		if (dirtyRect.IsOverlapped(rect)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+TiledEffectChain::TiledEffectChain() {}
+
+TiledEffectChain::~TiledEffectChain() {}
+
+bool TiledEffectChain::IsPreferred(const std::vector<EffectDesc>& descs, const std::vector<EffectParams>& params, SIZE inputSize) {
+	for (const EffectDesc& desc : descs) {
+		if (!EffectDrawer::CheckTileable(desc)) {
+			return false;
+		}
+	}
+
+	SIZE outputSize{};
+	uint64_t totalBytes = 0;
+	if (!CalcTextureBytes(descs, params, inputSize, outputSize, totalBytes)) {
+		return false;
+	}
+
+	const uint64_t maxBytes = GetMaxUntiledTextureBytes();
+	if (totalBytes > maxBytes) {
+		Logger::Get().Info(fmt::format("中间纹理预计占用 {} MiB 显存，超过上限 {} MiB",
+			totalBytes >> 20, maxBytes >> 20));
+		return true;
+	}
+
+	// 放大后的输出比主窗口更大时只有中间部分可见，没有必要计算其他部分
+	const double visibleRatio = (double)CalcVisibleRect(outputSize).GetArea() / (uint64_t(outputSize.cx) * outputSize.cy);
+	if (visibleRatio < MAX_VISIBLE_RATIO) {
+		Logger::Get().Info(fmt::format("输出只有 {:.0f}% 可见", visibleRatio * 100));
+		return true;
+	}
+
+	return false;
+}
+
+bool TiledEffectChain::Initialize(
+	const std::vector<std::string>& names,
+	const std::vector<EffectDesc>& descs,
+	const std::vector<EffectParams>& params,
+	ID3D11Texture2D* inputTex,
+	ID3D11Texture2D** outputTex,
+	RECT* outputRect,
+	RECT* virtualOutputRect
+) {
+	_input = inputTex;
+
+	D3D11_TEXTURE2D_DESC inputDesc;
+	inputTex->GetDesc(&inputDesc);
+
+	const size_t effectCount = descs.size();
+	const SIZE hostSize = Utils::GetSizeOfRect(App::Get().GetHostWndRect());
+
+	// 不分块时各效果的尺寸
+	_stages.resize(effectCount);
+	std::vector<std::vector<SIZE>> fullTexSizes(effectCount);
+	SIZE curSize{ (LONG)inputDesc.Width, (LONG)inputDesc.Height };
+	for (size_t i = 0; i < effectCount; ++i) {
+		SIZE outputSize{};
+		if (!EffectDrawer::CalcTextureSizes(descs[i], params[i], curSize, hostSize, outputSize, fullTexSizes[i])) {
+			Logger::Get().Error(fmt::format("计算效果#{} ({}) 的纹理尺寸失败", i, names[i]));
+			return false;
+		}
+
+		TilePlanner::Stage& stage = _stages[i];
+		stage.inputSize = { (uint32_t)curSize.cx, (uint32_t)curSize.cy };
+		stage.outputSize = { (uint32_t)outputSize.cx, (uint32_t)outputSize.cy };
+		stage.halo = CalcHalo(descs[i], curSize, fullTexSizes[i]);
+		for (size_t j = 1; j < fullTexSizes[i].size(); ++j) {
+			if (fullTexSizes[i][j].cx > 0) {
+				stage.textureSizes.push_back({ (uint32_t)fullTexSizes[i][j].cx, (uint32_t)fullTexSizes[i][j].cy });
+			}
+		}
+
+		curSize = outputSize;
+	}
+
+	const SIZE fullOutputSize = curSize;
+	const TilePlanner::Rect visibleRect = CalcVisibleRect(fullOutputSize);
+
+	// 显存充足时可见部分作为一个图块
+	TilePlanner::Size tileSize{
+		uint32_t(visibleRect.right - visibleRect.left),
+		uint32_t(visibleRect.bottom - visibleRect.top)
+	};
+	SIZE estimatedOutputSize{};
+	uint64_t totalBytes = 0;
+	if (!CalcTextureBytes(descs, params, SIZE{ (LONG)inputDesc.Width, (LONG)inputDesc.Height }, estimatedOutputSize, totalBytes)
+		|| totalBytes > GetMaxUntiledTextureBytes()) {
+		tileSize = TILE_SIZE;
+	}
+
+	if (!_planner.Plan(_stages, tileSize, visibleRect)) {
+		Logger::Get().Error("无法将效果链分块");
+		return false;
+	}
+
+	DeviceResources& dr = App::Get().GetDeviceResources();
+
+	const TilePlanner::Size cropSize = _planner.GetCropSize(0);
+	_cropTexture = dr.CreateTexture2D(inputDesc.Format, cropSize.width, cropSize.height, D3D11_BIND_SHADER_RESOURCE);
+	if (!_cropTexture) {
+		Logger::Get().Error("创建纹理失败");
+		return false;
+	}
+	GPUMemoryTracker::Get().Track(_cropTexture.get(), GPUMemoryTracker::Owner::Effect);
+
+	// 创建在图块上运行的效果
+	ID3D11Texture2D* effectInput = _cropTexture.get();
+	_effects.resize(effectCount);
+	for (size_t i = 0; i < effectCount; ++i) {
+		const TilePlanner::Stage& stage = _stages[i];
+
+		EffectDesc desc;
+		if (descs[i].flags & EFFECT_FLAG_LAST_EFFECT) {
+			// 最后一个效果输出到图块尺寸的纹理，再由 Draw 复制有效的部分
+			if (EffectCompiler::Compile(names[i], descs[i].flags & ~EFFECT_FLAG_LAST_EFFECT, params[i].params, desc)) {
+				Logger::Get().Error(fmt::format("编译效果#{} ({}) 失败", i, names[i]));
+				return false;
+			}
+		} else {
+			desc = descs[i];
+		}
+
+		// 缩放到主窗口的比例取决于输入尺寸，图块上需使用和不分块时相同的缩放比例
+		EffectParams tileParams = params[i];
+		if (tileParams.scale.has_value()) {
+			tileParams.scale = std::make_pair(
+				(float)stage.outputSize.width / stage.inputSize.width,
+				(float)stage.outputSize.height / stage.inputSize.height
+			);
+		}
+
+		// 图块上所有纹理的尺寸必须和不分块时成比例，否则结果不同
+		const TilePlanner::Size tileInputSize = _planner.GetCropSize(i);
+		const TilePlanner::Size tileOutputSize = _planner.GetCropSize(i + 1);
+		SIZE outputSize{};
+		std::vector<SIZE> texSizes;
+		if (!EffectDrawer::CalcTextureSizes(desc, tileParams, SIZE{ (LONG)tileInputSize.width, (LONG)tileInputSize.height }, hostSize, outputSize, texSizes)) {
+			Logger::Get().Error(fmt::format("计算效果#{} ({}) 的纹理尺寸失败", i, names[i]));
+			return false;
+		}
+
+		bool isProportional = outputSize.cx == (LONG)tileOutputSize.width && outputSize.cy == (LONG)tileOutputSize.height;
+		for (size_t j = 1; j < texSizes.size() && isProportional; ++j) {
+			const SIZE& fullTexSize = fullTexSizes[i][j];
+			isProportional = uint64_t(texSizes[j].cx) * stage.inputSize.width == uint64_t(fullTexSize.cx) * tileInputSize.width
+				&& uint64_t(texSizes[j].cy) * stage.inputSize.height == uint64_t(fullTexSize.cy) * tileInputSize.height;
+		}
+		if (!isProportional) {
+			Logger::Get().Error(fmt::format("效果#{} ({}) 的纹理尺寸和输入尺寸不成比例", i, names[i]));
+			return false;
+		}
+
+		_effects[i].reset(new EffectDrawer());
+		if (!_effects[i]->Initialize(desc, tileParams, effectInput, &effectInput)) {
+			Logger::Get().Error(fmt::format("初始化效果#{} ({}) 失败", i, names[i]));
+			return false;
+		}
+	}
+
+	_tileOutput = effectInput;
+
+	_virtualOutputRect = CalcVirtualOutputRect(fullOutputSize);
+
+	_outputRect = RECT{
+		std::max(0L, _virtualOutputRect.left),
+		std::max(0L, _virtualOutputRect.top),
+		std::min(hostSize.cx, _virtualOutputRect.right),
+		std::min(hostSize.cy, _virtualOutputRect.bottom)
+	};
+
+	_output = dr.CreateTexture2D(DXGI_FORMAT_R8G8B8A8_UNORM, hostSize.cx, hostSize.cy, D3D11_BIND_SHADER_RESOURCE);
+	if (!_output) {
+		Logger::Get().Error("创建纹理失败");
+		return false;
+	}
+	GPUMemoryTracker::Get().Track(_output.get(), GPUMemoryTracker::Owner::Effect);
+
+	*outputTex = _output.get();
+	if (outputRect) {
+		*outputRect = _outputRect;
+	}
+	if (virtualOutputRect) {
+		*virtualOutputRect = _virtualOutputRect;
+	}
+
+	Logger::Get().Info(fmt::format("分块执行效果链：共 {} 个图块，裁剪尺寸为 {}x{}",
+		_planner.GetTiles().size(), cropSize.width, cropSize.height));
+
+	return true;
+}
+
+bool TiledEffectChain::Rebind(ID3D11Texture2D* inputTex) {
+	_input = inputTex;
+
+	// 图块上的效果的输入不变，但视图需要重新获取
+	ID3D11Texture2D* effectInput = _cropTexture.get();
+	for (const auto& effect : _effects) {
+		if (!effect->Rebind(effectInput)) {
+			return false;
+		}
+		effectInput = effect->GetOutput();
+	}
+
+	return true;
+}
+
+void TiledEffectChain::Draw(UINT& idx, const DirtyRegion* dirtyRegion) {
+	// 将输入中变化的区域传播到最终输出上，只渲染和它相交的图块
+	std::optional<DirtyRegion> outputRegion;
+	if (dirtyRegion && !dirtyRegion->IsFull()
+		&& dirtyRegion->GetWidth() == _stages[0].inputSize.width
+		&& dirtyRegion->GetHeight() == _stages[0].inputSize.height
+	) {
+		DirtyRegion region = *dirtyRegion;
+		region.DropMove();
+		for (const TilePlanner::Stage& stage : _stages) {
+			region = region.Propagate(stage.outputSize.width, stage.outputSize.height, stage.halo);
+		}
+		outputRegion = std::move(region);
+	}
+
+	auto d3dDC = App::Get().GetDeviceResources().GetD3DDC();
+
+	UINT passCount = 0;
+	for (const auto& effect : _effects) {
+		passCount += (UINT)effect->GetDesc().passes.size();
+	}
+
+	const UINT startIdx = idx;
+	bool isDrawn = false;
+
+	for (const TilePlanner::Tile& tile : _planner.GetTiles()) {
+		if (outputRegion && !IsTileDirty(*outputRegion, tile.output)) {
+			continue;
+		}
+
+		// 此图块负责的输出在主窗口尺寸的纹理上的位置
+		const RECT tileRect{
+			tile.output.left + _virtualOutputRect.left,
+			tile.output.top + _virtualOutputRect.top,
+			tile.output.right + _virtualOutputRect.left,
+			tile.output.bottom + _virtualOutputRect.top
+		};
+		RECT destRect;
+		if (!IntersectRect(&destRect, &tileRect, &_outputRect)) {
+			continue;
+		}
+
+		D3D11_BOX cropBox{
+			(UINT)tile.crop.left,
+			(UINT)tile.crop.top,
+			0,
+			(UINT)tile.crop.right,
+			(UINT)tile.crop.bottom,
+			1
+		};
+		d3dDC->CopySubresourceRegion(_cropTexture.get(), 0, 0, 0, 0, _input, 0, &cropBox);
+
+		// 每个图块都在 GPUTimer 中记录，保留的是最后一个图块的时间戳
+		// 因此第一个通道的用时包含之前所有图块，但总用时是准确的
+		idx = startIdx;
+		for (const auto& effect : _effects) {
+			effect->Draw(idx);
+		}
+
+		const UINT srcLeft = UINT(destRect.left - _virtualOutputRect.left - tile.cropOutput.left);
+		const UINT srcTop = UINT(destRect.top - _virtualOutputRect.top - tile.cropOutput.top);
+		D3D11_BOX srcBox{
+			srcLeft,
+			srcTop,
+			0,
+			srcLeft + UINT(destRect.right - destRect.left),
+			srcTop + UINT(destRect.bottom - destRect.top),
+			1
+		};
+		d3dDC->CopySubresourceRegion(_output.get(), 0, destRect.left, destRect.top, 0, _tileOutput, 0, &srcBox);
+
+		isDrawn = true;
+	}
+
+	if (!isDrawn) {
+		// 不渲染的通道也在 GPUTimer 中记录
+		GPUTimer& gpuTimer = App::Get().GetRenderer().GetGPUTimer();
+		for (idx = startIdx; idx < startIdx + passCount;) {
+			gpuTimer.OnEndPass(idx++);
+		}
+	}
+
+	idx = startIdx + passCount;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "pch.h"
+#include "EffectDesc.h"
+#include "TilePlanner.h"
+
+class EffectDrawer;
+class DirtyRegion;
+
+
+// 分块执行整个效果链，用于 8K 或跨越多个显示器等中间纹理占用显存过多的情况
+// 每个图块从输入中裁剪一部分，在其上运行图块尺寸的效果链，再将有效部分复制到输出
+// 输出比主窗口更大时图块只覆盖可见部分，各效果只计算可见部分依赖的区域
+class TiledEffectChain {
+public:
+	TiledEffectChain();
+	TiledEffectChain(const TiledEffectChain&) = delete;
+	TiledEffectChain(TiledEffectChain&&) = delete;
+
+	~TiledEffectChain();
+
+	// 所有效果都可以分块，且不分块时中间纹理的显存占用超过上限或者输出大部分不可见时返回 true
+	static bool IsPreferred(const std::vector<EffectDesc>& descs, const std::vector<EffectParams>& params, SIZE inputSize);
+
+	// 参数和 EffectDrawer::Initialize 相同，descs 中最后一个效果应带有 EFFECT_FLAG_LAST_EFFECT
+	bool Initialize(
+		const std::vector<std::string>& names,
+		const std::vector<EffectDesc>& descs,
+		const std::vector<EffectParams>& params,
+		ID3D11Texture2D* inputTex,
+		ID3D11Texture2D** outputTex,
+		RECT* outputRect,
+		RECT* virtualOutputRect
+	);
+
+	// 见 EffectDrawer::Rebind
+	bool Rebind(ID3D11Texture2D* inputTex);
+
+	// dirtyRegion 非空时为输入中变化的区域，只重新渲染受影响的图块
+	void Draw(UINT& idx, const DirtyRegion* dirtyRegion = nullptr);
+
+	// 在图块上运行的效果，用于查询效果的描述
+	const std::vector<std::unique_ptr<EffectDrawer>>& GetEffects() const noexcept {
+		return _effects;
+	}
+
+	size_t GetTileCount() const noexcept {
+		return _planner.GetTiles().size();
+	}
+
+private:
+	std::vector<TilePlanner::Stage> _stages;
+	TilePlanner _planner;
+
+	ID3D11Texture2D* _input = nullptr;
+	// 从输入中裁剪出的图块
+	winrt::com_ptr<ID3D11Texture2D> _cropTexture;
+	std::vector<std::unique_ptr<EffectDrawer>> _effects;
+	ID3D11Texture2D* _tileOutput = nullptr;
+
+	// 和不分块时最后一个效果的输出相同，尺寸和主窗口相同
+	winrt::com_ptr<ID3D11Texture2D> _output;
+	RECT _outputRect{};
+	RECT _virtualOutputRect{};
+};
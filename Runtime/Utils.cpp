@@ -119,6 +119,33 @@ bool Utils::WriteFile(const wchar_t* fileName, const void* buffer, size_t buffer
 	return true;
 }
 
+bool Utils::WriteFileAtomic(const wchar_t* fileName, const void* buffer, size_t bufferSize) {
+	// 进程和线程 ID 保证临时文件名不会冲突
+	std::wstring tempFileName = fmt::format(L"{}.{}.{}.tmp", fileName, GetCurrentProcessId(), GetCurrentThreadId());
+
+	FILE* hFile;
+	if (_wfopen_s(&hFile, tempFileName.c_str(), L"wb") || !hFile) {
+		Logger::Get().Error(StrUtils::Concat("打开文件 ", StrUtils::UTF16ToUTF8(tempFileName), " 失败"));
+		return false;
+	}
+
+	size_t writed = fwrite(buffer, 1, bufferSize, hFile);
+	bool success = fclose(hFile) == 0 && writed == bufferSize;
+	if (!success) {
+		Logger::Get().Error(StrUtils::Concat("写入文件 ", StrUtils::UTF16ToUTF8(tempFileName), " 失败"));
+		DeleteFile(tempFileName.c_str());
+		return false;
+	}
+
+	if (!MoveFileEx(tempFileName.c_str(), fileName, MOVEFILE_REPLACE_EXISTING)) {
+		Logger::Get().Win32Error(StrUtils::Concat("替换文件 ", StrUtils::UTF16ToUTF8(fileName), " 失败"));
+		DeleteFile(tempFileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
 RTL_OSVERSIONINFOW _GetOSVersion() noexcept {
 	HMODULE hNtDll = GetModuleHandle(L"ntdll.dll");
 	if (!hNtDll) {
@@ -216,28 +243,60 @@ void Utils::RunParallel(std::function<void(UINT)> func, UINT times) {
 #endif // _DEBUG
 }
 
-bool Utils::ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel) {
-	dest.resize(ZSTD_compressBound(src.size()));
-	size_t size = ZSTD_compress(dest.data(), dest.size(), src.data(), src.size(), compressionLevel);
+struct ZstdCCtxDeleter { void operator()(ZSTD_CCtx* cctx) noexcept { ZSTD_freeCCtx(cctx); } };
+struct ZstdDCtxDeleter { void operator()(ZSTD_DCtx* dctx) noexcept { ZSTD_freeDCtx(dctx); } };
+
+// 创建上下文的开销远大于压缩一个缓存文件，因此每个线程只创建一次
+static ZSTD_CCtx* GetThreadCCtx() {
+	thread_local std::unique_ptr<ZSTD_CCtx, ZstdCCtxDeleter> cctx(ZSTD_createCCtx());
+	return cctx.get();
+}
+
+static ZSTD_DCtx* GetThreadDCtx() {
+	thread_local std::unique_ptr<ZSTD_DCtx, ZstdDCtxDeleter> dctx(ZSTD_createDCtx());
+	return dctx.get();
+}
+
+bool Utils::ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel, const ZSTD_CDict* cdict) {
+	ZSTD_CCtx* cctx = GetThreadCCtx();
+	if (!cctx) {
+		Logger::Get().Error("ZSTD_createCCtx 失败");
+		return false;
+	}
+
+	size_t offset = dest.size();
+	dest.resize(offset + ZSTD_compressBound(src.size()));
+
+	size_t size = cdict
+		? ZSTD_compress_usingCDict(cctx, dest.data() + offset, dest.size() - offset, src.data(), src.size(), cdict)
+		: ZSTD_compressCCtx(cctx, dest.data() + offset, dest.size() - offset, src.data(), src.size(), compressionLevel);
 
 	if (ZSTD_isError(size)) {
 		Logger::Get().Error(StrUtils::Concat("压缩失败：", ZSTD_getErrorName(size)));
 		return false;
 	}
 
-	dest.resize(size);
+	dest.resize(offset + size);
 	return true;
 }
 
-bool Utils::ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest) {
+bool Utils::ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest, const ZSTD_DDict* ddict) {
 	auto size = ZSTD_getFrameContentSize(src.data(), src.size());
 	if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
 		Logger::Get().Error("ZSTD_getFrameContentSize 失败");
 		return false;
 	}
 
+	ZSTD_DCtx* dctx = GetThreadDCtx();
+	if (!dctx) {
+		Logger::Get().Error("ZSTD_createDCtx 失败");
+		return false;
+	}
+
 	dest.resize(size);
-	size = ZSTD_decompress(dest.data(), dest.size(), src.data(), src.size());
+	size = ddict
+		? ZSTD_decompress_usingDDict(dctx, dest.data(), dest.size(), src.data(), src.size(), ddict)
+		: ZSTD_decompressDCtx(dctx, dest.data(), dest.size(), src.data(), src.size());
 	if (ZSTD_isError(size)) {
 		Logger::Get().Error(StrUtils::Concat("解压失败：", ZSTD_getErrorName(size)));
 		return false;
@@ -349,73 +408,3 @@ bool Utils::ShowSystemCursor(bool value) {
 	}
 	return result;
 }
-
-Utils::Hasher::~Hasher() {
-	if (_hAlg) {
-		BCryptCloseAlgorithmProvider(_hAlg, 0);
-	}
-	if (_hashObj) {
-		HeapFree(GetProcessHeap(), 0, _hashObj);
-	}
-	if (_hHash) {
-		BCryptDestroyHash(_hHash);
-	}
-}
-
-bool Utils::Hasher::Initialize() {
-	NTSTATUS status = BCryptOpenAlgorithmProvider(&_hAlg, BCRYPT_SHA1_ALGORITHM, NULL, 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptOpenAlgorithmProvider 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	ULONG result;
-
-	status = BCryptGetProperty(_hAlg, BCRYPT_OBJECT_LENGTH, (PBYTE)&_hashObjLen, sizeof(_hashObjLen), &result, 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptGetProperty 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	_hashObj = HeapAlloc(GetProcessHeap(), 0, _hashObjLen);
-	if (!_hashObj) {
-		Logger::Get().Error("HeapAlloc 失败");
-		return false;
-	}
-
-	status = BCryptGetProperty(_hAlg, BCRYPT_HASH_LENGTH, (PBYTE)&_hashLen, sizeof(_hashLen), &result, 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptGetProperty 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	status = BCryptCreateHash(_hAlg, &_hHash, (PUCHAR)_hashObj, _hashObjLen, NULL, 0, BCRYPT_HASH_REUSABLE_FLAG);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptCreateHash 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	Logger::Get().Info("Utils::Hasher 初始化成功");
-	return true;
-}
-
-bool Utils::Hasher::Hash(std::span<const BYTE> data, std::vector<BYTE>& result) {
-	// BCrypt API 内部保存状态，因此需要同步对它们访问
-	std::scoped_lock lk(_cs);
-
-	result.resize(_hashLen);
-
-	NTSTATUS status = BCryptHashData(_hHash, (PUCHAR)data.data(), (ULONG)data.size(), 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptCreateHash 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	status = BCryptFinishHash(_hHash, result.data(), (ULONG)result.size(), 0);
-	if (!NT_SUCCESS(status)) {
-		Logger::Get().Error(fmt::format("BCryptFinishHash 失败\n\tNTSTATUS={}", status));
-		return false;
-	}
-
-	return true;
-}
@@ -1,8 +1,11 @@
 #pragma once
 #include "pch.h"
-#include <bcrypt.h>
+#include "Hasher.h"
 
 
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
 struct Utils {
 	static UINT GetWindowShowCmd(HWND hwnd);
 
@@ -36,6 +39,9 @@ struct Utils {
 
 	static bool WriteFile(const wchar_t* fileName, const void* buffer, size_t bufferSize);
 
+	// 先写入同目录的临时文件再替换目标文件，其他进程不会读到写了一半的文件
+	static bool WriteFileAtomic(const wchar_t* fileName, const void* buffer, size_t bufferSize);
+
 	static bool FileExists(const wchar_t* fileName) noexcept {
 		DWORD attrs = GetFileAttributes(fileName);
 		// 排除文件夹
@@ -90,31 +96,10 @@ struct Utils {
 		CRITICAL_SECTION _cs{};
 	};
 
-	class Hasher {
-	public:
-		static Hasher& Get() noexcept {
-			static Hasher instance;
-			return instance;
-		}
-
-		bool Initialize();
-
-		bool Hash(std::span<const BYTE> data, std::vector<BYTE>& result);
-
-		DWORD GetHashLength() noexcept {
-			return _hashLen;
-		}
-	private:
-		~Hasher();
-
-		CSMutex _cs;	// 同步对 Hash() 的访问
-
-		BCRYPT_ALG_HANDLE _hAlg = NULL;
-		DWORD _hashObjLen = 0;		// hash 对象的大小
-		void* _hashObj = nullptr;	// 存储 hash 对象
-		DWORD _hashLen = 0;			// 哈希结果的大小
-		BCRYPT_HASH_HANDLE _hHash = NULL;
-	};
+	// 流式计算 XXH3-128 哈希，用于生成缓存的键
+	// 每个实例独立保存状态，因此可以在多个线程中同时使用不同的实例
+	// 可在其他平台编译，见 Hasher.h
+	using Hasher = ::Hasher;
 
 	template<typename T>
 	class ScopeExit {
@@ -139,8 +124,12 @@ struct Utils {
 	// 执行完毕后返回
 	static void RunParallel(std::function<void(UINT)> func, UINT times);
 
-	static bool ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel);
-	static bool ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest);
+	// 每个线程复用同一个压缩/解压上下文
+	// cdict 不为空时使用字典压缩，此时压缩等级由 cdict 决定，compressionLevel 被忽略
+	// dest 中已有的数据会被保留，压缩结果追加在其后
+	static bool ZstdCompress(std::span<const BYTE> src, std::vector<BYTE>& dest, int compressionLevel, const ZSTD_CDict_s* cdict = nullptr);
+	// 使用字典压缩的数据必须传入相同的 ddict 解压
+	static bool ZstdDecompress(std::span<const BYTE> src, std::vector<BYTE>& dest, const ZSTD_DDict_s* ddict = nullptr);
 
 	static bool IsStartMenu(HWND hwnd);
 
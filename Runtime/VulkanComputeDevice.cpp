@@ -0,0 +1,964 @@
+#include "VulkanComputeDevice.h"
+#include <algorithm>
+#include <cstring>
+
+
+// 和 CpuComputeDevice 相同，即 D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+static constexpr uint32_t MAX_TEXTURE_DIMENSION = 16384;
+// 一批命令最多使用的描述符集，超出时提交
+static constexpr uint32_t MAX_DESCRIPTOR_SETS = 256;
+// 一批命令最多的调度次数，超出时提交
+static constexpr uint32_t MAX_BLOCK_OFFSETS = 4096;
+static constexpr uint32_t MAX_TIMESTAMPS = 1024;
+
+struct FormatDesc {
+	// DXGI_FORMAT 的值
+	uint32_t format;
+	VkFormat vkFormat;
+	uint32_t byteSize;
+};
+
+// EffectIntermediateTextureFormat 中的格式
+static constexpr FormatDesc FORMAT_DESCS[] = {
+	{ 2, VK_FORMAT_R32G32B32A32_SFLOAT, 16 },
+	{ 10, VK_FORMAT_R16G16B16A16_SFLOAT, 8 },
+	{ 11, VK_FORMAT_R16G16B16A16_UNORM, 8 },
+	{ 13, VK_FORMAT_R16G16B16A16_SNORM, 8 },
+	{ 16, VK_FORMAT_R32G32_SFLOAT, 8 },
+	// DXGI 的格式名从低位开始，Vulkan 的打包格式从高位开始
+	{ 24, VK_FORMAT_A2B10G10R10_UNORM_PACK32, 4 },
+	{ 26, VK_FORMAT_B10G11R11_UFLOAT_PACK32, 4 },
+	{ 28, VK_FORMAT_R8G8B8A8_UNORM, 4 },
+	{ 31, VK_FORMAT_R8G8B8A8_SNORM, 4 },
+	{ 34, VK_FORMAT_R16G16_SFLOAT, 4 },
+	{ 35, VK_FORMAT_R16G16_UNORM, 4 },
+	{ 37, VK_FORMAT_R16G16_SNORM, 4 },
+	{ 41, VK_FORMAT_R32_SFLOAT, 4 },
+	{ 49, VK_FORMAT_R8G8_UNORM, 2 },
+	{ 51, VK_FORMAT_R8G8_SNORM, 2 },
+	{ 54, VK_FORMAT_R16_SFLOAT, 2 },
+	{ 56, VK_FORMAT_R16_UNORM, 2 },
+	{ 58, VK_FORMAT_R16_SNORM, 2 },
+	{ 61, VK_FORMAT_R8_UNORM, 1 },
+	{ 63, VK_FORMAT_R8_SNORM, 1 }
+};
+
+static const FormatDesc* FindFormat(uint32_t format) noexcept {
+	auto it = std::find_if(std::begin(FORMAT_DESCS), std::end(FORMAT_DESCS),
+		[format](const FormatDesc& desc) { return desc.format == format; });
+	return it == std::end(FORMAT_DESCS) ? nullptr : &*it;
+}
+
+static VkDescriptorType GetDescriptorType(EffectPassPlan::BindingType type) noexcept {
+	switch (type) {
+	case EffectPassPlan::BindingType::ConstantBuffer:
+		return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	case EffectPassPlan::BindingType::Sampler:
+		return VK_DESCRIPTOR_TYPE_SAMPLER;
+	case EffectPassPlan::BindingType::SampledTexture:
+		return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	default:
+		return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	}
+}
+
+// 之前的调度和复制写入的数据对之后的调度和复制可见
+static void AddBarrier(
+	VkCommandBuffer commandBuffer,
+	VkPipelineStageFlags srcStage,
+	VkAccessFlags srcAccess,
+	VkPipelineStageFlags dstStage,
+	VkAccessFlags dstAccess
+) noexcept {
+	VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+VulkanComputeDevice::~VulkanComputeDevice() {
+	if (!_device) {
+		if (_instance) {
+			vkDestroyInstance(_instance, nullptr);
+		}
+		return;
+	}
+
+	Flush();
+	vkDeviceWaitIdle(_device);
+
+	for (auto& [handle, resource] : _resources) {
+		_DestroyResource(resource);
+	}
+	_resources.clear();
+
+	_DestroyHostBuffer(_blockOffsetBuffer, _blockOffsetMemory);
+	vkDestroyQueryPool(_device, _queryPool, nullptr);
+	vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+	vkDestroyFence(_device, _fence, nullptr);
+	vkDestroyCommandPool(_device, _commandPool, nullptr);
+	vkDestroyDevice(_device, nullptr);
+	vkDestroyInstance(_instance, nullptr);
+}
+
+bool VulkanComputeDevice::Initialize(const char* deviceName) {
+	if (_instance) {
+		return _Fail("已初始化");
+	}
+
+	VkApplicationInfo appInfo{ VK_STRUCTURE_TYPE_APPLICATION_INFO };
+	appInfo.pApplicationName = "Magpie";
+	appInfo.apiVersion = VK_API_VERSION_1_1;
+
+	VkInstanceCreateInfo instanceInfo{ VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+	instanceInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instanceInfo, nullptr, &_instance) != VK_SUCCESS) {
+		_instance = VK_NULL_HANDLE;
+		return _Fail("vkCreateInstance 失败");
+	}
+
+	uint32_t physicalDeviceCount = 0;
+	vkEnumeratePhysicalDevices(_instance, &physicalDeviceCount, nullptr);
+	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
+	vkEnumeratePhysicalDevices(_instance, &physicalDeviceCount, physicalDevices.data());
+
+	// 选择第一个有支持时间戳的计算队列的设备
+	uint32_t queueFamily = 0;
+	VkPhysicalDeviceProperties properties{};
+	for (VkPhysicalDevice physicalDevice : physicalDevices) {
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		if (deviceName && !std::strstr(properties.deviceName, deviceName)) {
+			continue;
+		}
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		for (uint32_t i = 0; i < queueFamilyCount; ++i) {
+			if ((queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && queueFamilies[i].timestampValidBits > 0) {
+				_physicalDevice = physicalDevice;
+				queueFamily = i;
+				_timestampMask = queueFamilies[i].timestampValidBits >= 64
+					? ~uint64_t(0) : (uint64_t(1) << queueFamilies[i].timestampValidBits) - 1;
+				break;
+			}
+		}
+
+		if (_physicalDevice) {
+			break;
+		}
+	}
+
+	if (!_physicalDevice) {
+		return _Fail("没有支持计算和时间戳的设备");
+	}
+
+	std::memcpy(_deviceName, properties.deviceName, sizeof(_deviceName));
+	_timestampPeriod = properties.limits.timestampPeriod;
+	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+	// UAV 的格式由 HLSL 中的类型决定，如 unorm float4，SPIR-V 中为未知格式，需要无格式读写
+	VkPhysicalDeviceFeatures supportedFeatures{};
+	vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+	if (!supportedFeatures.shaderStorageImageWriteWithoutFormat) {
+		return _Fail("设备不支持无格式写入存储图像");
+	}
+
+	VkPhysicalDeviceFeatures features{};
+	features.shaderStorageImageWriteWithoutFormat = VK_TRUE;
+	features.shaderStorageImageReadWithoutFormat = supportedFeatures.shaderStorageImageReadWithoutFormat;
+
+	const float queuePriority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo{ VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+	queueInfo.queueFamilyIndex = queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &queuePriority;
+
+	VkDeviceCreateInfo deviceInfo{ VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	deviceInfo.pEnabledFeatures = &features;
+	if (vkCreateDevice(_physicalDevice, &deviceInfo, nullptr, &_device) != VK_SUCCESS) {
+		_device = VK_NULL_HANDLE;
+		return _Fail("vkCreateDevice 失败");
+	}
+
+	vkGetDeviceQueue(_device, queueFamily, 0, &_queue);
+
+	VkCommandPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	if (vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
+		return _Fail("vkCreateCommandPool 失败");
+	}
+
+	VkCommandBufferAllocateInfo commandBufferInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	commandBufferInfo.commandPool = _commandPool;
+	commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferInfo.commandBufferCount = 1;
+	if (vkAllocateCommandBuffers(_device, &commandBufferInfo, &_commandBuffer) != VK_SUCCESS) {
+		return _Fail("vkAllocateCommandBuffers 失败");
+	}
+
+	VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	if (vkCreateFence(_device, &fenceInfo, nullptr, &_fence) != VK_SUCCESS) {
+		return _Fail("vkCreateFence 失败");
+	}
+
+	// 每个描述符集最多有 3 个常量缓冲区以及 cs_5_0 允许的采样器和纹理
+	const VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, EffectPassPlan::CONSTANT_BUFFER_COUNT * MAX_DESCRIPTOR_SETS },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, EffectPassPlan::MAX_SAMPLERS * MAX_DESCRIPTOR_SETS },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, EffectPassPlan::MAX_INPUTS * MAX_DESCRIPTOR_SETS },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, EffectPassPlan::MAX_OUTPUTS * MAX_DESCRIPTOR_SETS }
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	descriptorPoolInfo.maxSets = MAX_DESCRIPTOR_SETS;
+	descriptorPoolInfo.poolSizeCount = (uint32_t)std::size(poolSizes);
+	descriptorPoolInfo.pPoolSizes = poolSizes;
+	if (vkCreateDescriptorPool(_device, &descriptorPoolInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
+		return _Fail("vkCreateDescriptorPool 失败");
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = MAX_TIMESTAMPS;
+	if (vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &_queryPool) != VK_SUCCESS) {
+		return _Fail("vkCreateQueryPool 失败");
+	}
+
+	// 常量缓冲区的偏移需要对齐
+	_blockOffsetStride = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+	void* blockOffsetData = nullptr;
+	if (!_CreateHostBuffer(_blockOffsetStride * MAX_BLOCK_OFFSETS, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		_blockOffsetBuffer, _blockOffsetMemory, blockOffsetData)) {
+		return false;
+	}
+	_blockOffsetData = (uint8_t*)blockOffsetData;
+
+	return true;
+}
+
+ComputeDevice::Handle VulkanComputeDevice::RegisterKernel(std::span<const uint32_t> spirv) {
+	if (!_device) {
+		_Fail("尚未初始化");
+		return INVALID_HANDLE;
+	}
+
+	if (spirv.empty()) {
+		_Fail("SPIR-V 为空");
+		return INVALID_HANDLE;
+	}
+
+	VkShaderModuleCreateInfo moduleInfo{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+	moduleInfo.codeSize = spirv.size_bytes();
+	moduleInfo.pCode = spirv.data();
+
+	_Kernel kernel;
+	if (vkCreateShaderModule(_device, &moduleInfo, nullptr, &kernel.shaderModule) != VK_SUCCESS) {
+		_Fail("vkCreateShaderModule 失败");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::move(kernel));
+}
+
+bool VulkanComputeDevice::WriteTexture(Handle texture, std::span<const uint8_t> texels) {
+	const _Texture* tex = _Find<_Texture>(texture);
+	if (!tex) {
+		return _Fail("纹理不存在");
+	}
+
+	const VkDeviceSize byteSize = VkDeviceSize(tex->width) * tex->height * GetFormatByteSize(tex->format);
+	if (texels.size() != byteSize) {
+		return _Fail("数据的大小和纹理不符");
+	}
+
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	void* data;
+	if (!_CreateHostBuffer(byteSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, buffer, memory, data)) {
+		return false;
+	}
+
+	std::memcpy(data, texels.data(), texels.size());
+	const bool success = _CopyTexture(*tex, buffer, true);
+	_DestroyHostBuffer(buffer, memory);
+	return success;
+}
+
+bool VulkanComputeDevice::ReadTexture(Handle texture, std::vector<uint8_t>& texels) {
+	const _Texture* tex = _Find<_Texture>(texture);
+	if (!tex) {
+		return _Fail("纹理不存在");
+	}
+
+	const VkDeviceSize byteSize = VkDeviceSize(tex->width) * tex->height * GetFormatByteSize(tex->format);
+
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	void* data;
+	if (!_CreateHostBuffer(byteSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer, memory, data)) {
+		return false;
+	}
+
+	const bool success = _CopyTexture(*tex, buffer, false);
+	if (success) {
+		texels.resize(byteSize);
+		std::memcpy(texels.data(), data, byteSize);
+	}
+
+	_DestroyHostBuffer(buffer, memory);
+	return success;
+}
+
+uint32_t VulkanComputeDevice::GetFormatByteSize(uint32_t format) noexcept {
+	const FormatDesc* desc = FindFormat(format);
+	return desc ? desc->byteSize : 0;
+}
+
+bool VulkanComputeDevice::Flush() {
+	if (!_isRecording) {
+		return true;
+	}
+
+	_isRecording = false;
+	++_batchId;
+	_blockOffsetCount = 0;
+
+	bool success = vkEndCommandBuffer(_commandBuffer) == VK_SUCCESS;
+	if (success) {
+		VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &_commandBuffer;
+		success = vkQueueSubmit(_queue, 1, &submitInfo, _fence) == VK_SUCCESS
+			&& vkWaitForFences(_device, 1, &_fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+		vkResetFences(_device, 1, &_fence);
+	}
+
+	// 即使失败描述符集也不再使用
+	vkResetDescriptorPool(_device, _descriptorPool, 0);
+
+	return success ? true : _Fail("提交命令失败");
+}
+
+ComputeDevice::Handle VulkanComputeDevice::CreateTexture(uint32_t width, uint32_t height, uint32_t format) {
+	if (!_device) {
+		_Fail("尚未初始化");
+		return INVALID_HANDLE;
+	}
+
+	if (width == 0 || height == 0 || width > MAX_TEXTURE_DIMENSION || height > MAX_TEXTURE_DIMENSION) {
+		_Fail("纹理尺寸无效");
+		return INVALID_HANDLE;
+	}
+
+	const FormatDesc* formatDesc = FindFormat(format);
+	if (!formatDesc) {
+		_Fail("不支持的纹理格式");
+		return INVALID_HANDLE;
+	}
+
+	// 所有纹理既可以作为输入也可以作为输出
+	constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+		| VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+	VkFormatProperties formatProperties{};
+	vkGetPhysicalDeviceFormatProperties(_physicalDevice, formatDesc->vkFormat, &formatProperties);
+	if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures) {
+		_Fail("设备不支持将此格式用作存储图像");
+		return INVALID_HANDLE;
+	}
+
+	_Texture texture;
+	texture.vkFormat = formatDesc->vkFormat;
+	texture.format = format;
+	texture.width = width;
+	texture.height = height;
+
+	VkImageCreateInfo imageInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = texture.vkFormat;
+	imageInfo.extent = { width, height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT
+		| VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(_device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS) {
+		_Fail("vkCreateImage 失败");
+		return INVALID_HANDLE;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(_device, texture.image, &requirements);
+
+	VkMemoryAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocInfo.allocationSize = requirements.size;
+	if (!_FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, allocInfo.memoryTypeIndex)
+		|| vkAllocateMemory(_device, &allocInfo, nullptr, &texture.memory) != VK_SUCCESS) {
+		vkDestroyImage(_device, texture.image, nullptr);
+		_Fail("分配纹理的内存失败");
+		return INVALID_HANDLE;
+	}
+
+	if (vkBindImageMemory(_device, texture.image, texture.memory, 0) != VK_SUCCESS || !_BeginCommands()) {
+		vkDestroyImage(_device, texture.image, nullptr);
+		vkFreeMemory(_device, texture.memory, nullptr);
+		_Fail("vkBindImageMemory 失败");
+		return INVALID_HANDLE;
+	}
+
+	// 始终使用 GENERAL 布局，调度和复制时不需要转换
+	VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+		| VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture.image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	return _Add(std::move(texture));
+}
+
+ComputeDevice::Handle VulkanComputeDevice::CreateView(Handle texture, ViewType type) {
+	const _Texture* tex = _Find<_Texture>(texture);
+	if (!tex) {
+		_Fail("纹理不存在");
+		return INVALID_HANDLE;
+	}
+
+	VkImageViewCreateInfo viewInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewInfo.image = tex->image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = tex->vkFormat;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	_View view;
+	view.texture = texture;
+	view.type = type;
+	if (vkCreateImageView(_device, &viewInfo, nullptr, &view.view) != VK_SUCCESS) {
+		_Fail("vkCreateImageView 失败");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::move(view));
+}
+
+ComputeDevice::Handle VulkanComputeDevice::CreateSampler(SamplerFilter filter, SamplerAddress address) {
+	if (!_device) {
+		_Fail("尚未初始化");
+		return INVALID_HANDLE;
+	}
+
+	const VkFilter vkFilter = filter == SamplerFilter::Linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+	const VkSamplerAddressMode addressMode = address == SamplerAddress::Clamp
+		? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+	VkSamplerCreateInfo samplerInfo{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+	samplerInfo.magFilter = vkFilter;
+	samplerInfo.minFilter = vkFilter;
+	samplerInfo.mipmapMode = filter == SamplerFilter::Linear
+		? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = addressMode;
+	samplerInfo.addressModeV = addressMode;
+	samplerInfo.addressModeW = addressMode;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	_Sampler sampler;
+	if (vkCreateSampler(_device, &samplerInfo, nullptr, &sampler.sampler) != VK_SUCCESS) {
+		_Fail("vkCreateSampler 失败");
+		return INVALID_HANDLE;
+	}
+
+	return _Add(std::move(sampler));
+}
+
+ComputeDevice::Handle VulkanComputeDevice::CreateConstantBuffer(uint32_t byteSize) {
+	if (!_device) {
+		_Fail("尚未初始化");
+		return INVALID_HANDLE;
+	}
+
+	if (byteSize == 0 || byteSize % 16 != 0) {
+		_Fail("常量缓冲区的尺寸必须为 16 的倍数");
+		return INVALID_HANDLE;
+	}
+
+	_ConstantBuffer buffer;
+	buffer.byteSize = byteSize;
+	if (!_CreateHostBuffer(byteSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, buffer.buffer, buffer.memory, buffer.data)) {
+		return INVALID_HANDLE;
+	}
+
+	std::memset(buffer.data, 0, byteSize);
+	return _Add(std::move(buffer));
+}
+
+bool VulkanComputeDevice::UpdateConstantBuffer(Handle buffer, const void* data, uint32_t byteSize) {
+	_ConstantBuffer* cb = _Find<_ConstantBuffer>(buffer);
+	if (!cb) {
+		return _Fail("常量缓冲区不存在");
+	}
+
+	if (byteSize > cb->byteSize) {
+		return _Fail("数据超出常量缓冲区");
+	}
+
+	// 缓冲区直接映射到内存，不能修改尚未执行的调度使用的内容
+	if (_isRecording && cb->batchId == _batchId && !Flush()) {
+		return false;
+	}
+
+	std::memcpy(cb->data, data, byteSize);
+	return true;
+}
+
+void VulkanComputeDevice::Release(Handle handle) {
+	auto it = _resources.find(handle);
+	if (it == _resources.end()) {
+		return;
+	}
+
+	// 资源可能被尚未执行的命令使用
+	Flush();
+
+	_DestroyResource(it->second);
+	_resources.erase(it);
+}
+
+bool VulkanComputeDevice::Dispatch(
+	Handle kernel,
+	const EffectPassPlan::Pass& pass,
+	std::span<const Handle> bindings,
+	EffectPassPlan::Size groupOffset,
+	EffectPassPlan::Size groups
+) {
+	_Kernel* kernelObj = _Find<_Kernel>(kernel);
+	if (!kernelObj) {
+		return _Fail("内核不存在");
+	}
+
+	if (groups.width == 0 || groups.height == 0) {
+		return _Fail("调度尺寸为 0");
+	}
+
+	if (groups.width > EffectPassPlan::MAX_GROUPS_PER_DIMENSION || groups.height > EffectPassPlan::MAX_GROUPS_PER_DIMENSION
+		|| uint64_t(groupOffset.width) + groups.width > pass.groups.width
+		|| uint64_t(groupOffset.height) + groups.height > pass.groups.height) {
+		return _Fail("调度超出通道的范围");
+	}
+
+	if (bindings.size() != pass.bindings.size()) {
+		return _Fail("绑定的数量和通道不符");
+	}
+
+	if (!_CreatePipeline(*kernelObj, pass)) {
+		return false;
+	}
+
+	// 环形缓冲区已满时会提交，因此在分配描述符集之前写入
+	VkDeviceSize blockOffset = 0;
+	if (!_WriteBlockOffset(groupOffset, blockOffset)) {
+		return false;
+	}
+
+	// 预先分配，保证写入描述符时指针有效
+	std::vector<VkDescriptorBufferInfo> bufferInfos;
+	bufferInfos.reserve(EffectPassPlan::CONSTANT_BUFFER_COUNT);
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	imageInfos.reserve(bindings.size());
+	std::vector<VkWriteDescriptorSet> writes(bindings.size(), VkWriteDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
+
+	// 用于检查读写冲突
+	std::vector<Handle> inputTextures;
+	std::vector<Handle> outputTextures;
+	std::vector<_ConstantBuffer*> usedBuffers;
+
+	for (size_t i = 0; i < bindings.size(); ++i) {
+		const EffectPassPlan::Binding& binding = pass.bindings[i];
+		VkWriteDescriptorSet& write = writes[i];
+		write.dstBinding = binding.binding;
+		write.descriptorCount = 1;
+		write.descriptorType = GetDescriptorType(binding.type);
+
+		switch (binding.type) {
+		case EffectPassPlan::BindingType::ConstantBuffer:
+		{
+			_ConstantBuffer* cb = _Find<_ConstantBuffer>(bindings[i]);
+			if (!cb || bufferInfos.size() == EffectPassPlan::CONSTANT_BUFFER_COUNT) {
+				return _Fail("常量缓冲区绑定无效");
+			}
+
+			if (binding.slot == 2) {
+				// __CB3 使用环形缓冲区
+				bufferInfos.push_back({ _blockOffsetBuffer, blockOffset, 16 });
+			} else {
+				bufferInfos.push_back({ cb->buffer, 0, cb->byteSize });
+				usedBuffers.push_back(cb);
+			}
+			write.pBufferInfo = &bufferInfos.back();
+			break;
+		}
+		case EffectPassPlan::BindingType::Sampler:
+		{
+			const _Sampler* sampler = _Find<_Sampler>(bindings[i]);
+			if (!sampler) {
+				return _Fail("采样器绑定无效");
+			}
+
+			imageInfos.push_back({ sampler->sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED });
+			write.pImageInfo = &imageInfos.back();
+			break;
+		}
+		case EffectPassPlan::BindingType::SampledTexture:
+		case EffectPassPlan::BindingType::StorageTexture:
+		{
+			const bool isOutput = binding.type == EffectPassPlan::BindingType::StorageTexture;
+
+			const _View* view = _Find<_View>(bindings[i]);
+			if (!view || view->type != (isOutput ? ViewType::UnorderedAccess : ViewType::ShaderResource)) {
+				return _Fail("视图绑定无效或类型不符");
+			}
+
+			if (!_Find<_Texture>(view->texture)) {
+				return _Fail("视图的纹理已被释放");
+			}
+
+			(isOutput ? outputTextures : inputTextures).push_back(view->texture);
+			imageInfos.push_back({ VK_NULL_HANDLE, view->view, VK_IMAGE_LAYOUT_GENERAL });
+			write.pImageInfo = &imageInfos.back();
+			break;
+		}
+		}
+	}
+
+	std::sort(outputTextures.begin(), outputTextures.end());
+	if (std::adjacent_find(outputTextures.begin(), outputTextures.end()) != outputTextures.end()) {
+		return _Fail("纹理被多次作为输出");
+	}
+	for (Handle input : inputTextures) {
+		if (std::binary_search(outputTextures.begin(), outputTextures.end(), input)) {
+			return _Fail("纹理同时作为输入和输出");
+		}
+	}
+
+	// 描述符池已满时会提交，之后重新写入起始线程组
+	const uint64_t batchId = _batchId;
+	VkDescriptorSet descriptorSet;
+	if (!_AllocateDescriptorSet(kernelObj->setLayout, descriptorSet)) {
+		return false;
+	}
+	if (batchId != _batchId) {
+		if (!_WriteBlockOffset(groupOffset, blockOffset)) {
+			return false;
+		}
+		for (VkDescriptorBufferInfo& info : bufferInfos) {
+			if (info.buffer == _blockOffsetBuffer) {
+				info.offset = blockOffset;
+			}
+		}
+	}
+
+	for (VkWriteDescriptorSet& write : writes) {
+		write.dstSet = descriptorSet;
+	}
+	vkUpdateDescriptorSets(_device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+
+	if (!_BeginCommands()) {
+		return false;
+	}
+
+	for (_ConstantBuffer* cb : usedBuffers) {
+		cb->batchId = _batchId;
+	}
+
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, kernelObj->pipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+		kernelObj->pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdDispatch(_commandBuffer, groups.width, groups.height, 1);
+
+	// 下一个通道可能读取这个通道的输出，也可能写入这个通道的输入
+	AddBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	return true;
+}
+
+uint32_t VulkanComputeDevice::WriteTimestamp() {
+	if (_timestampCount >= MAX_TIMESTAMPS) {
+		_isTimestampOverflow = true;
+		return _timestampCount++;
+	}
+
+	if (!_BeginCommands()) {
+		_isTimestampOverflow = true;
+		return _timestampCount++;
+	}
+
+	if (!_isQueryPoolReset) {
+		vkCmdResetQueryPool(_commandBuffer, _queryPool, 0, MAX_TIMESTAMPS);
+		_isQueryPoolReset = true;
+	}
+
+	vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, _timestampCount);
+	return _timestampCount++;
+}
+
+bool VulkanComputeDevice::ResolveTimestamps(std::vector<uint64_t>& timestamps) {
+	timestamps.clear();
+
+	const uint32_t count = _timestampCount;
+	const bool isOverflow = _isTimestampOverflow;
+	_timestampCount = 0;
+	_isTimestampOverflow = false;
+
+	if (!Flush()) {
+		return false;
+	}
+
+	// 查询池在下次使用前重置
+	_isQueryPoolReset = false;
+
+	if (isOverflow) {
+		return _Fail("时间戳过多");
+	}
+
+	if (count == 0) {
+		return true;
+	}
+
+	timestamps.resize(count);
+	if (vkGetQueryPoolResults(_device, _queryPool, 0, count, count * sizeof(uint64_t), timestamps.data(),
+		sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+		timestamps.clear();
+		return _Fail("vkGetQueryPoolResults 失败");
+	}
+
+	// 转换为纳秒
+	for (uint64_t& timestamp : timestamps) {
+		timestamp = uint64_t(double(timestamp & _timestampMask) * _timestampPeriod);
+	}
+
+	return true;
+}
+
+ComputeDevice::Handle VulkanComputeDevice::_Add(_Resource&& resource) {
+	const Handle handle = _nextHandle++;
+	_resources.emplace(handle, std::move(resource));
+	return handle;
+}
+
+bool VulkanComputeDevice::_FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& typeIndex) const noexcept {
+	for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; ++i) {
+		if ((typeBits & (1u << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			typeIndex = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool VulkanComputeDevice::_CreateHostBuffer(
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	VkBuffer& buffer,
+	VkDeviceMemory& memory,
+	void*& data
+) {
+	VkBufferCreateInfo bufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		return _Fail("vkCreateBuffer 失败");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(_device, buffer, &requirements);
+
+	// 不需要刷新映射的内存
+	VkMemoryAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocInfo.allocationSize = requirements.size;
+	if (!_FindMemoryType(requirements.memoryTypeBits,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, allocInfo.memoryTypeIndex)
+		|| vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+		vkDestroyBuffer(_device, buffer, nullptr);
+		return _Fail("分配缓冲区的内存失败");
+	}
+
+	if (vkBindBufferMemory(_device, buffer, memory, 0) != VK_SUCCESS
+		|| vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+		vkDestroyBuffer(_device, buffer, nullptr);
+		vkFreeMemory(_device, memory, nullptr);
+		return _Fail("映射缓冲区失败");
+	}
+
+	return true;
+}
+
+void VulkanComputeDevice::_DestroyHostBuffer(VkBuffer buffer, VkDeviceMemory memory) noexcept {
+	// 释放内存时自动取消映射
+	vkDestroyBuffer(_device, buffer, nullptr);
+	vkFreeMemory(_device, memory, nullptr);
+}
+
+void VulkanComputeDevice::_DestroyResource(_Resource& resource) noexcept {
+	if (_Kernel* kernel = std::get_if<_Kernel>(&resource)) {
+		vkDestroyPipeline(_device, kernel->pipeline, nullptr);
+		vkDestroyPipelineLayout(_device, kernel->pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(_device, kernel->setLayout, nullptr);
+		vkDestroyShaderModule(_device, kernel->shaderModule, nullptr);
+	} else if (_Texture* texture = std::get_if<_Texture>(&resource)) {
+		vkDestroyImage(_device, texture->image, nullptr);
+		vkFreeMemory(_device, texture->memory, nullptr);
+	} else if (_View* view = std::get_if<_View>(&resource)) {
+		vkDestroyImageView(_device, view->view, nullptr);
+	} else if (_Sampler* sampler = std::get_if<_Sampler>(&resource)) {
+		vkDestroySampler(_device, sampler->sampler, nullptr);
+	} else if (_ConstantBuffer* buffer = std::get_if<_ConstantBuffer>(&resource)) {
+		_DestroyHostBuffer(buffer->buffer, buffer->memory);
+	}
+}
+
+bool VulkanComputeDevice::_BeginCommands() {
+	if (_isRecording) {
+		return true;
+	}
+
+	VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS) {
+		return _Fail("vkBeginCommandBuffer 失败");
+	}
+
+	_isRecording = true;
+	return true;
+}
+
+bool VulkanComputeDevice::_CreatePipeline(_Kernel& kernel, const EffectPassPlan::Pass& pass) {
+	if (kernel.pipeline) {
+		// 管线布局由第一次调度的通道决定
+		if (kernel.bindingTypes.size() != pass.bindings.size() || !std::equal(
+			kernel.bindingTypes.begin(), kernel.bindingTypes.end(), pass.bindings.begin(),
+			[](EffectPassPlan::BindingType type, const EffectPassPlan::Binding& binding) { return type == binding.type; }
+		)) {
+			return _Fail("内核已用于绑定不同的通道");
+		}
+		return true;
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings(pass.bindings.size());
+	for (size_t i = 0; i < pass.bindings.size(); ++i) {
+		layoutBindings[i].binding = pass.bindings[i].binding;
+		layoutBindings[i].descriptorType = GetDescriptorType(pass.bindings[i].type);
+		layoutBindings[i].descriptorCount = 1;
+		layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	setLayoutInfo.bindingCount = (uint32_t)layoutBindings.size();
+	setLayoutInfo.pBindings = layoutBindings.data();
+	if (vkCreateDescriptorSetLayout(_device, &setLayoutInfo, nullptr, &kernel.setLayout) != VK_SUCCESS) {
+		kernel.setLayout = VK_NULL_HANDLE;
+		return _Fail("vkCreateDescriptorSetLayout 失败");
+	}
+
+	VkPipelineLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &kernel.setLayout;
+	if (vkCreatePipelineLayout(_device, &layoutInfo, nullptr, &kernel.pipelineLayout) != VK_SUCCESS) {
+		kernel.pipelineLayout = VK_NULL_HANDLE;
+		return _Fail("vkCreatePipelineLayout 失败");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = kernel.shaderModule;
+	pipelineInfo.stage.pName = "__M";
+	pipelineInfo.layout = kernel.pipelineLayout;
+	if (vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &kernel.pipeline) != VK_SUCCESS) {
+		kernel.pipeline = VK_NULL_HANDLE;
+		return _Fail("vkCreateComputePipelines 失败");
+	}
+
+	kernel.bindingTypes.resize(pass.bindings.size());
+	for (size_t i = 0; i < pass.bindings.size(); ++i) {
+		kernel.bindingTypes[i] = pass.bindings[i].type;
+	}
+
+	return true;
+}
+
+bool VulkanComputeDevice::_AllocateDescriptorSet(VkDescriptorSetLayout setLayout, VkDescriptorSet& set) {
+	VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocInfo.descriptorPool = _descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+	if (vkAllocateDescriptorSets(_device, &allocInfo, &set) == VK_SUCCESS) {
+		return true;
+	}
+
+	// 描述符池已满，提交后重置
+	if (!Flush()) {
+		return false;
+	}
+
+	if (vkAllocateDescriptorSets(_device, &allocInfo, &set) != VK_SUCCESS) {
+		return _Fail("vkAllocateDescriptorSets 失败");
+	}
+
+	return true;
+}
+
+bool VulkanComputeDevice::_WriteBlockOffset(EffectPassPlan::Size blockOffset, VkDeviceSize& offset) {
+	if (_blockOffsetCount == MAX_BLOCK_OFFSETS && !Flush()) {
+		return false;
+	}
+
+	offset = _blockOffsetStride * _blockOffsetCount++;
+
+	// cbuffer __CB3 : register(b2) {
+	//     uint2 __blockOffset;
+	// };
+	const uint32_t data[4] = { blockOffset.width, blockOffset.height };
+	std::memcpy(_blockOffsetData + offset, data, sizeof(data));
+	return true;
+}
+
+bool VulkanComputeDevice::_CopyTexture(const _Texture& texture, VkBuffer buffer, bool toTexture) {
+	if (!_BeginCommands()) {
+		return false;
+	}
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { texture.width, texture.height, 1 };
+
+	if (toTexture) {
+		AddBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+		vkCmdCopyBufferToImage(_commandBuffer, buffer, texture.image, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+		AddBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	} else {
+		AddBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+		vkCmdCopyImageToBuffer(_commandBuffer, texture.image, VK_IMAGE_LAYOUT_GENERAL, buffer, 1, &region);
+		AddBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+	}
+
+	return Flush();
+}
@@ -0,0 +1,193 @@
+#pragma once
+// 此文件不依赖 Windows API 和预编译头，可以在其他平台编译
+#include "ComputeDevice.h"
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <variant>
+
+
+// ComputeDevice 的 Vulkan 实现，内核为 SPIR-V 计算着色器，可以在 Mesa lavapipe 等软件实现上运行，不需要 GPU
+// 需要 Vulkan SDK，目前只由 Tests/CMakeLists.txt 构建，不属于 Runtime.vcxproj
+// 描述符的 binding 即 EffectPassPlan 中的 binding，SPIR-V 应由 EffectSpirvCompiler 编译，使寄存器映射到这些 binding
+// 调度录制在命令缓冲区中，Flush、ResolveTimestamps、读写纹理、释放资源或更新仍被使用的常量缓冲区时提交并等待完成
+// 和 D3D11ComputeDevice 相同，__CB3（slot 2）保存起始线程组。每次调度写入内部环形缓冲区的不同位置，绑定的句柄只用于检查
+class VulkanComputeDevice : public ComputeDevice {
+public:
+	VulkanComputeDevice() = default;
+	VulkanComputeDevice(const VulkanComputeDevice&) = delete;
+	VulkanComputeDevice(VulkanComputeDevice&&) = delete;
+
+	~VulkanComputeDevice() override;
+
+	// 创建实例和逻辑设备，使用第一个支持计算和时间戳的物理设备
+	// deviceName 非空时只使用名称包含它的设备，如 lavapipe 的名称包含 "llvmpipe"
+	bool Initialize(const char* deviceName = nullptr);
+
+	const char* GetDeviceName() const noexcept {
+		return _deviceName;
+	}
+
+	// 入口点为 __M。管线在第一次调度时根据通道的绑定创建，之后只能用于绑定类型相同的通道
+	Handle RegisterKernel(std::span<const uint32_t> spirv);
+
+	// texels 按行紧密排列，每像素的字节数由 GetFormatByteSize 决定
+	bool WriteTexture(Handle texture, std::span<const uint8_t> texels);
+
+	bool ReadTexture(Handle texture, std::vector<uint8_t>& texels);
+
+	// format 的取值和 DXGI_FORMAT 相同，只支持 EffectIntermediateTextureFormat 中的格式，不支持的格式返回 0
+	static uint32_t GetFormatByteSize(uint32_t format) noexcept;
+
+	// 提交已录制的命令并等待完成
+	bool Flush();
+
+	Handle CreateTexture(uint32_t width, uint32_t height, uint32_t format) override;
+
+	Handle CreateView(Handle texture, ViewType type) override;
+
+	Handle CreateSampler(SamplerFilter filter, SamplerAddress address) override;
+
+	Handle CreateConstantBuffer(uint32_t byteSize) override;
+
+	// 缓冲区被尚未提交的调度使用时先提交并等待完成
+	bool UpdateConstantBuffer(Handle buffer, const void* data, uint32_t byteSize) override;
+
+	// 有尚未提交的命令时先提交并等待完成
+	void Release(Handle handle) override;
+
+	bool Dispatch(
+		Handle kernel,
+		const EffectPassPlan::Pass& pass,
+		std::span<const Handle> bindings,
+		EffectPassPlan::Size groupOffset,
+		EffectPassPlan::Size groups
+	) override;
+
+	// 在之前录制的命令完成后记录时间戳，查询池在 ResolveTimestamps 后复用
+	uint32_t WriteTimestamp() override;
+
+	// 提交并等待完成，然后取回所有时间戳
+	bool ResolveTimestamps(std::vector<uint64_t>& timestamps) override;
+
+	const char* GetError() const noexcept override {
+		return _error;
+	}
+
+private:
+	struct _Kernel {
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		// 以下在第一次调度时创建
+		VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		std::vector<EffectPassPlan::BindingType> bindingTypes;
+	};
+
+	struct _Texture {
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkFormat vkFormat = VK_FORMAT_UNDEFINED;
+		uint32_t format = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	struct _View {
+		VkImageView view = VK_NULL_HANDLE;
+		Handle texture = INVALID_HANDLE;
+		ViewType type = ViewType::ShaderResource;
+	};
+
+	struct _Sampler {
+		VkSampler sampler = VK_NULL_HANDLE;
+	};
+
+	struct _ConstantBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		// 始终映射
+		void* data = nullptr;
+		uint32_t byteSize = 0;
+		// 最后一次被哪一批命令使用，和 _batchId 相同时更新前需要提交
+		uint64_t batchId = 0;
+	};
+
+	using _Resource = std::variant<_Kernel, _Texture, _View, _Sampler, _ConstantBuffer>;
+
+	template <typename T>
+	T* _Find(Handle handle) noexcept {
+		auto it = _resources.find(handle);
+		return it == _resources.end() ? nullptr : std::get_if<T>(&it->second);
+	}
+
+	Handle _Add(_Resource&& resource);
+
+	bool _Fail(const char* error) noexcept {
+		_error = error;
+		return false;
+	}
+
+	bool _FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, uint32_t& typeIndex) const noexcept;
+
+	// 创建映射到内存的缓冲区
+	bool _CreateHostBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory, void*& data);
+
+	void _DestroyHostBuffer(VkBuffer buffer, VkDeviceMemory memory) noexcept;
+
+	void _DestroyResource(_Resource& resource) noexcept;
+
+	// 开始录制命令，已在录制时什么也不做
+	bool _BeginCommands();
+
+	// 同一内核的管线只创建一次
+	bool _CreatePipeline(_Kernel& kernel, const EffectPassPlan::Pass& pass);
+
+	// 从描述符池中分配，池已满时先提交
+	bool _AllocateDescriptorSet(VkDescriptorSetLayout setLayout, VkDescriptorSet& set);
+
+	// 写入起始线程组，返回在环形缓冲区中的偏移，环形缓冲区已满时先提交
+	bool _WriteBlockOffset(EffectPassPlan::Size blockOffset, VkDeviceSize& offset);
+
+	// 录制复制纹理的命令并提交，toTexture 为真时从 buffer 复制到纹理
+	bool _CopyTexture(const _Texture& texture, VkBuffer buffer, bool toTexture);
+
+	VkInstance _instance = VK_NULL_HANDLE;
+	VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+	VkDevice _device = VK_NULL_HANDLE;
+	VkQueue _queue = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties _memoryProperties{};
+	char _deviceName[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE]{};
+
+	VkCommandPool _commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+	VkFence _fence = VK_NULL_HANDLE;
+	// 正在录制的这一批命令的 ID，每次提交递增
+	uint64_t _batchId = 1;
+	bool _isRecording = false;
+
+	// 每批命令的描述符集从这里分配，提交后重置
+	VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+
+	// __CB3 的环形缓冲区，每次调度使用一个位置，提交后从头开始
+	VkBuffer _blockOffsetBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory _blockOffsetMemory = VK_NULL_HANDLE;
+	uint8_t* _blockOffsetData = nullptr;
+	VkDeviceSize _blockOffsetStride = 0;
+	uint32_t _blockOffsetCount = 0;
+
+	VkQueryPool _queryPool = VK_NULL_HANDLE;
+	// 时间戳的有效位数和单位，单位为纳秒
+	uint64_t _timestampMask = 0;
+	double _timestampPeriod = 1.0;
+	// 已记录的时间戳的数量
+	uint32_t _timestampCount = 0;
+	// 查询池在使用前需要在命令缓冲区中重置
+	bool _isQueryPoolReset = false;
+	// 超出查询池的容量时 ResolveTimestamps 失败
+	bool _isTimestampOverflow = false;
+
+	std::unordered_map<Handle, _Resource> _resources;
+	Handle _nextHandle = 1;
+
+	const char* _error = "";
+};
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "WarmSession.h"
+#include "GraphicsDevice.h"
+#include "Logger.h"
+
+
+WarmSession::~WarmSession() {
+	if (_timer) {
+		SetThreadpoolTimer(_timer, nullptr, 0, 0);
+		WaitForThreadpoolTimerCallbacks(_timer, TRUE);
+		CloseThreadpoolTimer(_timer);
+	}
+
+	// 进程退出时 D3D 可能已被卸载，不再释放保留的资源
+	(void)_effectChains.release();
+	if (_device) {
+		(void)new std::shared_ptr<GraphicsDevice>(std::move(_device));
+	}
+}
+
+void WarmSession::SetTimeout(UINT timeout) {
+	_timeout.store(timeout, std::memory_order_relaxed);
+
+	if (timeout == 0) {
+		Release();
+	}
+}
+
+void WarmSession::Store(
+	Key key,
+	std::shared_ptr<GraphicsDevice> device,
+	std::unique_ptr<Renderer::EffectChainCache> effectChains
+) {
+	const UINT timeout = GetTimeout();
+	if (timeout == 0) {
+		effectChains.reset();
+		device.reset();
+		Release();
+		return;
+	}
+
+	// 旧的资源在锁外释放
+	std::shared_ptr<GraphicsDevice> oldDevice;
+	std::unique_ptr<Renderer::EffectChainCache> oldEffectChains;
+
+	{
+		std::scoped_lock lk(_lock);
+
+		if (!_timer) {
+			_timer = CreateThreadpoolTimer(_TimerCallback, this, nullptr);
+			if (!_timer) {
+				Logger::Get().Win32Error("CreateThreadpoolTimer 失败");
+				effectChains.reset();
+				device.reset();
+				return;
+			}
+		}
+
+		_key = std::move(key);
+		oldEffectChains = std::exchange(_effectChains, std::move(effectChains));
+		oldDevice = std::exchange(_device, std::move(device));
+
+		// 负值表示相对时间，单位为 100ns
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -int64_t(timeout) * 10000;
+		FILETIME ft{ dueTime.LowPart, (DWORD)dueTime.HighPart };
+		SetThreadpoolTimer(_timer, &ft, 0, 0);
+	}
+
+	Logger::Get().Info(fmt::format("已保留 D3D 设备和效果链，{} 秒后释放", timeout / 1000));
+}
+
+bool WarmSession::Take(
+	const Key& key,
+	std::shared_ptr<GraphicsDevice>& device,
+	std::unique_ptr<Renderer::EffectChainCache>& effectChains
+) {
+	std::shared_ptr<GraphicsDevice> warmDevice;
+	std::unique_ptr<Renderer::EffectChainCache> chains;
+
+	{
+		std::scoped_lock lk(_lock);
+
+		if (!_device) {
+			return false;
+		}
+
+		if (_timer) {
+			SetThreadpoolTimer(_timer, nullptr, 0, 0);
+		}
+
+		warmDevice = std::move(_device);
+		chains = std::move(_effectChains);
+
+		if (!(_key == key)) {
+			Logger::Get().Info("配置已改变，释放保留的资源");
+			return false;
+		}
+	}
+
+	if (!warmDevice->IsValid()) {
+		Logger::Get().Info("保留的 D3D 设备已不可用");
+		return false;
+	}
+
+	device = std::move(warmDevice);
+	effectChains = std::move(chains);
+	return true;
+}
+
+void WarmSession::Release() {
+	std::shared_ptr<GraphicsDevice> warmDevice;
+	std::unique_ptr<Renderer::EffectChainCache> chains;
+
+	{
+		std::scoped_lock lk(_lock);
+
+		if (!_device) {
+			return;
+		}
+
+		// 效果链依赖设备，先于设备释放
+		chains = std::move(_effectChains);
+		warmDevice = std::move(_device);
+	}
+
+	chains.reset();
+	warmDevice.reset();
+
+	Logger::Get().Info("已释放保留的 D3D 设备和效果链");
+}
+
+void CALLBACK WarmSession::_TimerCallback(PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+	((WarmSession*)context)->Release();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "pch.h"
+#include "Utils.h"
+#include "Renderer.h"
+
+class GraphicsDevice;
+
+
+// 缩放结束后在一段时间内保留 D3D 设备和效果链（包括其中的纹理）
+// 以相同的配置再次缩放时只需重新绑定源和交换链，不必重新创建设备、编译效果和分配纹理
+class WarmSession {
+public:
+	static WarmSession& Get() noexcept {
+		static WarmSession instance;
+		return instance;
+	}
+
+	WarmSession(const WarmSession&) = delete;
+	WarmSession(WarmSession&&) = delete;
+
+	~WarmSession();
+
+	// 决定资源能否复用的配置
+	struct Key {
+		int adapterIdx = 0;
+		UINT flags = 0;
+		SIZE hostSize{};
+		std::string effectsJson;
+
+		bool operator==(const Key& other) const noexcept {
+			return adapterIdx == other.adapterIdx && flags == other.flags
+				&& hostSize.cx == other.hostSize.cx && hostSize.cy == other.hostSize.cy
+				&& effectsJson == other.effectsJson;
+		}
+	};
+
+	// 保留资源的时长，单位为毫秒，为 0 时不保留
+	void SetTimeout(UINT timeout);
+
+	UINT GetTimeout() const noexcept {
+		return _timeout.load(std::memory_order_relaxed);
+	}
+
+	static constexpr UINT DEFAULT_TIMEOUT = 120000;
+
+	// 缩放结束时调用，之前保留的资源被替换
+	// 设备可能仍在被其他会话使用，此时只保留效果链
+	void Store(Key key, std::shared_ptr<GraphicsDevice> device,
+		std::unique_ptr<Renderer::EffectChainCache> effectChains);
+
+	// 配置相同且设备仍可使用时取出保留的资源并返回 true，否则释放它们
+	bool Take(const Key& key, std::shared_ptr<GraphicsDevice>& device,
+		std::unique_ptr<Renderer::EffectChainCache>& effectChains);
+
+	// 可以在任何线程中调用
+	void Release();
+
+private:
+	WarmSession() = default;
+
+	static void CALLBACK _TimerCallback(PTP_CALLBACK_INSTANCE, PVOID, PTP_TIMER);
+
+	std::atomic<UINT> _timeout = DEFAULT_TIMEOUT;
+
+	// 超时后在线程池中释放资源，因此需要同步
+	Utils::CSMutex _lock;
+	Key _key;
+	std::shared_ptr<GraphicsDevice> _device;
+	std::unique_ptr<Renderer::EffectChainCache> _effectChains;
+
+	PTP_TIMER _timer = nullptr;
+};
@@ -9,4 +9,6 @@ struct WindowsMessages {
 	inline static const UINT WM_TOGGLE_OVERLAY = RegisterWindowMessage(L"MAGPIE_WM_TOGGLE_OVERLAY");
 
 	// 下面的消息内部使用
+	// 渲染线程请求 UI 线程释放鼠标捕获
+	static constexpr UINT WM_RELEASE_CAPTURE = WM_APP;
 };
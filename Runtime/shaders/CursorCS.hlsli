@@ -0,0 +1,28 @@
+// 将光标混合到后缓冲区
+// 只在光标所在的矩形（已裁剪到输出区域）上执行，其余部分直接从最终输出复制
+// 每种光标类型编译为单独的着色器，包含此文件前需定义 BlendCursor
+
+cbuffer CB : register(b0) {
+	// 光标在后缓冲区中的位置
+	int4 cursorRect;
+	// 需要绘制的区域
+	int2 drawOffset;
+	uint2 drawSize;
+	float2 cursorPt;
+};
+
+Texture2D<float4> finalOutput : register(t0);
+Texture2D<float4> cursorTex : register(t1);
+SamplerState cursorSampler : register(s0);
+RWTexture2D<unorm float4> backBuffer : register(u0);
+
+[numthreads(16, 16, 1)]
+void main(uint3 tid : SV_DispatchThreadID) {
+	if (tid.x >= drawSize.x || tid.y >= drawSize.y) {
+		return;
+	}
+
+	const int2 pos = drawOffset + (int2)tid.xy;
+	const float4 mask = cursorTex.SampleLevel(cursorSampler, (pos - cursorRect.xy + 0.5f) * cursorPt, 0);
+	backBuffer[pos] = float4(BlendCursor(finalOutput[pos].rgb, mask), 1);
+}
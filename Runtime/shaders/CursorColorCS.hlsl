@@ -0,0 +1,7 @@
+// 彩色光标，RGB 通道已预乘 A 通道，A 通道已预先取反
+
+float3 BlendCursor(float3 color, float4 mask) {
+	return color * mask.a + mask.rgb;
+}
+
+#include "CursorCS.hlsli"
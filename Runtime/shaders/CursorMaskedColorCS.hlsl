@@ -0,0 +1,12 @@
+// 彩色掩码光标，A 通道为 0 时 RGB 通道取代屏幕颜色，为 1 时和屏幕颜色进行异或操作
+
+float3 BlendCursor(float3 color, float4 mask) {
+	if (mask.a < 0.5f) {
+		return mask.rgb;
+	}
+
+	// 255.001953 的由来见 https://stackoverflow.com/questions/52103720/why-does-d3dcolortoubyte4-multiplies-components-by-255-001953f
+	return (uint3(round(color * 255.0f)) ^ uint3(mask.rgb * 255.001953f)) / 255.0f;
+}
+
+#include "CursorCS.hlsli"
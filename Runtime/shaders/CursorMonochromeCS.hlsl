@@ -0,0 +1,11 @@
+// 单色光标，R 通道为 AND 掩码，G 通道为 XOR 掩码
+
+float3 BlendCursor(float3 color, float4 mask) {
+	if (mask.x > 0.5f) {
+		return mask.y > 0.5f ? 1 - color : color;
+	} else {
+		return mask.y > 0.5f ? float3(1, 1, 1) : float3(0, 0, 0);
+	}
+}
+
+#include "CursorCS.hlsli"
@@ -0,0 +1,27 @@
+// 比较新帧和上一帧，记录每个 64x64 的块是否发生变化
+// 每个线程组处理一个块，每个线程处理 8x8 的像素
+
+Texture2D<float4> curFrame : register(t0);
+Texture2D<float4> prevFrame : register(t1);
+RWTexture2D<uint> tileFlags : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
+	const uint2 base = (gid.xy << 6u) + (tid.xy << 3u);
+
+	bool changed = false;
+
+	[unroll]
+	for (uint y = 0; y < 8; ++y) {
+		[unroll]
+		for (uint x = 0; x < 8; ++x) {
+			const uint2 pos = base + uint2(x, y);
+			// 超出纹理的读取返回 0，不会被视为变化
+			changed = changed || any(curFrame[pos] != prevFrame[pos]);
+		}
+	}
+
+	if (changed) {
+		tileFlags[gid.xy] = 1;
+	}
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include "ComputeDevice.h"
+#include <set>
+
+
+using Handle = ComputeDevice::Handle;
+using Rect = DirtyRegion::Rect;
+using Size = EffectPassPlan::Size;
+
+// 只记录调度的序列，和 D3D11ComputeDevice 一样检查调度是否在通道内
+class RecordingComputeDevice : public ComputeDevice {
+public:
+	struct DispatchRecord {
+		Handle kernel = INVALID_HANDLE;
+		std::vector<Handle> bindings;
+		Size groupOffset;
+		Size groups;
+	};
+
+	Handle CreateTexture(uint32_t, uint32_t, uint32_t) override { return INVALID_HANDLE; }
+	Handle CreateView(Handle, ViewType) override { return INVALID_HANDLE; }
+	Handle CreateSampler(SamplerFilter, SamplerAddress) override { return INVALID_HANDLE; }
+	Handle CreateConstantBuffer(uint32_t) override { return INVALID_HANDLE; }
+	bool UpdateConstantBuffer(Handle, const void*, uint32_t) override { return false; }
+	void Release(Handle) override {}
+
+	bool Dispatch(
+		Handle kernel,
+		const EffectPassPlan::Pass& pass,
+		std::span<const Handle> bindings,
+		Size groupOffset,
+		Size groups
+	) override {
+		records.push_back({ kernel, { bindings.begin(), bindings.end() }, groupOffset, groups });
+
+		if (records.size() == failAt) {
+			_error = "模拟失败";
+			return false;
+		}
+
+		if (groups.width == 0 || groups.height == 0
+			|| uint64_t(groupOffset.width) + groups.width > pass.groups.width
+			|| uint64_t(groupOffset.height) + groups.height > pass.groups.height) {
+			_error = "调度超出通道的范围";
+			return false;
+		}
+
+		return true;
+	}
+
+	uint32_t WriteTimestamp() override { return 0; }
+	bool ResolveTimestamps(std::vector<uint64_t>& timestamps) override {
+		timestamps.clear();
+		return true;
+	}
+
+	const char* GetError() const noexcept override { return _error; }
+
+	std::vector<DispatchRecord> records;
+	// 第几次调度失败，0 表示总是成功
+	size_t failAt = 0;
+
+private:
+	const char* _error = "";
+};
+
+class ComputeDeviceTests : public testing::Test {
+protected:
+	void SetUp() override {
+		// 100x100 的纹理，16x16 的块，共 7x7 个线程组
+		EffectPassPlan::PassDesc passDesc;
+		passDesc.inputs = { 0 };
+		passDesc.numThreads = { 64, 1, 1 };
+		passDesc.blockSize = { 16, 16 };
+		ASSERT_TRUE(_plan.Build({ passDesc }, { { 100, 100 }, { 100, 100 } }, { 100, 100 }, 0)) << _plan.GetError();
+		ASSERT_EQ(_Pass().groups.width, 7u);
+		ASSERT_EQ(_Pass().groups.height, 7u);
+	}
+
+	const EffectPassPlan::Pass& _Pass() const {
+		return _plan.GetPasses()[0];
+	}
+
+	EffectPassPlan _plan;
+	RecordingComputeDevice _device;
+	const Handle _kernel = 7;
+	const std::vector<Handle> _bindings{ 1, 2, 3, 4, 5 };
+};
+
+TEST_F(ComputeDeviceTests, DispatchBlocksSequence) {
+	const std::vector<Rect> blockRects{ { 0, 0, 2, 1 }, { 3, 1, 4, 3 }, { 6, 6, 7, 7 } };
+	ASSERT_TRUE(_device.DispatchBlocks(_kernel, _Pass(), _bindings, blockRects)) << _device.GetError();
+
+	// 每个矩形一次调度，顺序不变，起始线程组为矩形的左上角
+	ASSERT_EQ(_device.records.size(), blockRects.size());
+	for (size_t i = 0; i < blockRects.size(); ++i) {
+		SCOPED_TRACE(testing::Message() << "调度 " << i);
+		const RecordingComputeDevice::DispatchRecord& record = _device.records[i];
+		EXPECT_EQ(record.kernel, _kernel);
+		EXPECT_EQ(record.bindings, _bindings);
+		EXPECT_EQ(record.groupOffset.width, (uint32_t)blockRects[i].left);
+		EXPECT_EQ(record.groupOffset.height, (uint32_t)blockRects[i].top);
+		EXPECT_EQ(record.groups.width, uint32_t(blockRects[i].right - blockRects[i].left));
+		EXPECT_EQ(record.groups.height, uint32_t(blockRects[i].bottom - blockRects[i].top));
+	}
+}
+
+TEST_F(ComputeDeviceTests, DispatchBlocksEmpty) {
+	EXPECT_TRUE(_device.DispatchBlocks(_kernel, _Pass(), _bindings, {}));
+	EXPECT_TRUE(_device.records.empty());
+}
+
+TEST_F(ComputeDeviceTests, DispatchBlocksStopsOnFailure) {
+	_device.failAt = 2;
+
+	const std::vector<Rect> blockRects{ { 0, 0, 1, 1 }, { 1, 0, 2, 1 }, { 2, 0, 3, 1 } };
+	EXPECT_FALSE(_device.DispatchBlocks(_kernel, _Pass(), _bindings, blockRects));
+	EXPECT_EQ(_device.records.size(), 2u);
+	EXPECT_STREQ(_device.GetError(), "模拟失败");
+}
+
+TEST_F(ComputeDeviceTests, DispatchBlocksRejectsInvalidRects) {
+	// 空矩形和越界的矩形由后端的 Dispatch 拒绝
+	EXPECT_FALSE(_device.DispatchBlocks(_kernel, _Pass(), _bindings, std::vector<Rect>{ { 2, 2, 2, 3 } }));
+	EXPECT_FALSE(_device.DispatchBlocks(_kernel, _Pass(), _bindings, std::vector<Rect>{ { -1, 0, 1, 1 } }));
+	EXPECT_FALSE(_device.DispatchBlocks(_kernel, _Pass(), _bindings, std::vector<Rect>{ { 6, 6, 8, 7 } }));
+}
+
+// EffectDrawer 只计算变化的区域时，调度的线程组恰好覆盖和变化区域相交的块，且不重复
+TEST_F(ComputeDeviceTests, DispatchBlocksCoversDirtyRegion) {
+	const std::vector<Rect> dirtyRects{ { 10, 10, 20, 20 }, { 70, 40, 75, 90 }, { 95, 0, 100, 3 } };
+
+	DirtyRegion region(100, 100);
+	for (const Rect& rect : dirtyRects) {
+		region.Add(rect);
+	}
+
+	const std::vector<Rect> blockRects = region.GetBlockRects(_Pass().blockSize.width, _Pass().blockSize.height);
+	ASSERT_TRUE(_device.DispatchBlocks(_kernel, _Pass(), _bindings, blockRects)) << _device.GetError();
+
+	std::set<std::pair<uint32_t, uint32_t>> dispatched;
+	for (const RecordingComputeDevice::DispatchRecord& record : _device.records) {
+		for (uint32_t y = 0; y < record.groups.height; ++y) {
+			for (uint32_t x = 0; x < record.groups.width; ++x) {
+				EXPECT_TRUE(dispatched.emplace(record.groupOffset.width + x, record.groupOffset.height + y).second)
+					<< "线程组 (" << record.groupOffset.width + x << ", " << record.groupOffset.height + y << ") 重复";
+			}
+		}
+	}
+
+	std::set<std::pair<uint32_t, uint32_t>> expected;
+	for (uint32_t y = 0; y < _Pass().groups.height; ++y) {
+		for (uint32_t x = 0; x < _Pass().groups.width; ++x) {
+			const Rect block{ int32_t(x * 16), int32_t(y * 16), int32_t(x * 16 + 16), int32_t(y * 16 + 16) };
+			for (const Rect& rect : region.GetRects()) {
+				if (block.IsOverlapped(rect)) {
+					expected.emplace(x, y);
+					break;
+				}
+			}
+		}
+	}
+
+	EXPECT_EQ(dispatched, expected);
+}
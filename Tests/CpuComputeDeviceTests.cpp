@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include "CpuComputeDevice.h"
+#include <cstring>
+
+
+using Handle = ComputeDevice::Handle;
+using Texel = CpuComputeDevice::Texel;
+
+static constexpr uint32_t FORMAT_R8G8B8A8_UNORM = 28;
+static constexpr uint32_t BLOCK_SIZE = 8;
+
+// 2 倍放大，一个通道，INPUT 为 8x8，OUTPUT 为 16x16
+class CpuComputeDeviceTests : public testing::Test {
+protected:
+	void SetUp() override {
+		EffectPassPlan::PassDesc passDesc;
+		passDesc.inputs = { 0 };
+		passDesc.numThreads = { BLOCK_SIZE, BLOCK_SIZE, 1 };
+		passDesc.blockSize = { BLOCK_SIZE, BLOCK_SIZE };
+		ASSERT_TRUE(_plan.Build({ passDesc }, { { 8, 8 }, { 16, 16 } }, { 16, 16 }, 1)) << _plan.GetError();
+
+		_input = _device.CreateTexture(8, 8, FORMAT_R8G8B8A8_UNORM);
+		_output = _device.CreateTexture(16, 16, FORMAT_R8G8B8A8_UNORM);
+		ASSERT_NE(_input, ComputeDevice::INVALID_HANDLE);
+		ASSERT_NE(_output, ComputeDevice::INVALID_HANDLE);
+
+		CpuComputeDevice::Texture* input = _device.GetTexture(_input);
+		for (uint32_t y = 0; y < 8; ++y) {
+			for (uint32_t x = 0; x < 8; ++x) {
+				input->Store(x, y, { float(x), float(y), 0.0f, 1.0f });
+			}
+		}
+
+		// __CB2 中只有一个 float 参数
+		_constantBuffer = _device.CreateConstantBuffer(16);
+		ASSERT_NE(_constantBuffer, ComputeDevice::INVALID_HANDLE);
+		const float scale[4] = { 2.0f };
+		ASSERT_TRUE(_device.UpdateConstantBuffer(_constantBuffer, scale, sizeof(scale)));
+
+		_sampler = _device.CreateSampler(ComputeDevice::SamplerFilter::Point, ComputeDevice::SamplerAddress::Clamp);
+		_srv = _device.CreateView(_input, ComputeDevice::ViewType::ShaderResource);
+		_uav = _device.CreateView(_output, ComputeDevice::ViewType::UnorderedAccess);
+
+		// 每个线程组计算 8x8 的块，用点采样放大并乘以参数
+		_kernel = _device.RegisterKernel([](const CpuComputeDevice::KernelContext& context, uint32_t groupX, uint32_t groupY) {
+			float scale;
+			std::memcpy(&scale, context.GetConstantBuffer(1), sizeof(scale));
+
+			const CpuComputeDevice::Texture& input = context.GetInput(0);
+			CpuComputeDevice::Texture& output = context.GetOutput(0);
+			for (uint32_t ty = 0; ty < BLOCK_SIZE; ++ty) {
+				for (uint32_t tx = 0; tx < BLOCK_SIZE; ++tx) {
+					const uint32_t x = groupX * BLOCK_SIZE + tx;
+					const uint32_t y = groupY * BLOCK_SIZE + ty;
+					Texel texel = context.GetSampler(0).Sample(input,
+						(x + 0.5f) / output.GetWidth(), (y + 0.5f) / output.GetHeight());
+					for (float& c : texel) {
+						c *= scale;
+					}
+					output.Store(x, y, texel);
+				}
+			}
+		});
+		ASSERT_NE(_kernel, ComputeDevice::INVALID_HANDLE);
+	}
+
+	std::vector<Handle> _Bindings() const {
+		return { _constantBuffer, _constantBuffer, _constantBuffer, _sampler, _srv, _uav };
+	}
+
+	const EffectPassPlan::Pass& _Pass() const {
+		return _plan.GetPasses()[0];
+	}
+
+	CpuComputeDevice _device{ 4 };
+	EffectPassPlan _plan;
+	Handle _input = ComputeDevice::INVALID_HANDLE;
+	Handle _output = ComputeDevice::INVALID_HANDLE;
+	Handle _constantBuffer = ComputeDevice::INVALID_HANDLE;
+	Handle _sampler = ComputeDevice::INVALID_HANDLE;
+	Handle _srv = ComputeDevice::INVALID_HANDLE;
+	Handle _uav = ComputeDevice::INVALID_HANDLE;
+	Handle _kernel = ComputeDevice::INVALID_HANDLE;
+};
+
+TEST_F(CpuComputeDeviceTests, OnePassOutput) {
+	EXPECT_EQ(_device.GetThreadCount(), 4u);
+	ASSERT_EQ(_Pass().groups.width, 2u);
+	ASSERT_EQ(_Pass().groups.height, 2u);
+
+	const std::vector<Handle> bindings = _Bindings();
+	ASSERT_TRUE(_device.Dispatch(_kernel, _Pass(), bindings, {}, _Pass().groups)) << _device.GetError();
+
+	const CpuComputeDevice::Texture* output = _device.GetTexture(_output);
+	for (uint32_t y = 0; y < 16; ++y) {
+		for (uint32_t x = 0; x < 16; ++x) {
+			const Texel expected{ float(x / 2) * 2, float(y / 2) * 2, 0.0f, 2.0f };
+			ASSERT_EQ(output->Load(x, y), expected) << "(" << x << ", " << y << ")";
+		}
+	}
+}
+
+TEST_F(CpuComputeDeviceTests, PartialDispatch) {
+	// 只执行右上角的线程组
+	const std::vector<Handle> bindings = _Bindings();
+	ASSERT_TRUE(_device.Dispatch(_kernel, _Pass(), bindings, { 1, 0 }, { 1, 1 })) << _device.GetError();
+
+	const CpuComputeDevice::Texture* output = _device.GetTexture(_output);
+	for (uint32_t y = 0; y < 16; ++y) {
+		for (uint32_t x = 0; x < 16; ++x) {
+			const bool isWritten = x >= BLOCK_SIZE && y < BLOCK_SIZE;
+			EXPECT_EQ(output->Load(x, y)[3], isWritten ? 2.0f : 0.0f) << "(" << x << ", " << y << ")";
+		}
+	}
+}
+
+TEST_F(CpuComputeDeviceTests, DispatchOutOfPass) {
+	const std::vector<Handle> bindings = _Bindings();
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), bindings, { 1, 1 }, { 2, 1 }));
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), bindings, {}, { 0, 1 }));
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), bindings, {}, { 3, 2 }));
+	EXPECT_STRNE(_device.GetError(), "");
+}
+
+TEST_F(CpuComputeDeviceTests, InvalidBindings) {
+	std::vector<Handle> bindings = _Bindings();
+
+	// 数量不符
+	bindings.pop_back();
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), bindings, {}, _Pass().groups));
+
+	// 视图类型不符
+	bindings = _Bindings();
+	bindings[5] = _device.CreateView(_output, ComputeDevice::ViewType::ShaderResource);
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), bindings, {}, _Pass().groups));
+
+	// 资源类型不符
+	bindings = _Bindings();
+	bindings[3] = _constantBuffer;
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), bindings, {}, _Pass().groups));
+
+	// 同一纹理同时作为输入和输出
+	bindings = _Bindings();
+	bindings[4] = _device.CreateView(_output, ComputeDevice::ViewType::ShaderResource);
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), bindings, {}, _Pass().groups));
+
+	// 内核不存在
+	EXPECT_FALSE(_device.Dispatch(_uav, _Pass(), _Bindings(), {}, _Pass().groups));
+
+	// 失败时不执行任何线程组
+	const CpuComputeDevice::Texture* output = _device.GetTexture(_output);
+	for (uint32_t y = 0; y < 16; ++y) {
+		for (uint32_t x = 0; x < 16; ++x) {
+			ASSERT_EQ(output->Load(x, y), Texel{});
+		}
+	}
+}
+
+TEST_F(CpuComputeDeviceTests, ReleasedTexture) {
+	_device.Release(_input);
+	EXPECT_EQ(_device.GetTexture(_input), nullptr);
+	EXPECT_FALSE(_device.Dispatch(_kernel, _Pass(), _Bindings(), {}, _Pass().groups));
+}
+
+TEST_F(CpuComputeDeviceTests, InvalidResources) {
+	EXPECT_EQ(_device.CreateTexture(0, 16, FORMAT_R8G8B8A8_UNORM), ComputeDevice::INVALID_HANDLE);
+	EXPECT_EQ(_device.CreateTexture(16385, 16, FORMAT_R8G8B8A8_UNORM), ComputeDevice::INVALID_HANDLE);
+	EXPECT_EQ(_device.CreateConstantBuffer(12), ComputeDevice::INVALID_HANDLE);
+	EXPECT_EQ(_device.CreateView(_constantBuffer, ComputeDevice::ViewType::ShaderResource), ComputeDevice::INVALID_HANDLE);
+	EXPECT_EQ(_device.RegisterKernel(nullptr), ComputeDevice::INVALID_HANDLE);
+
+	const float data[8]{};
+	EXPECT_FALSE(_device.UpdateConstantBuffer(_constantBuffer, data, sizeof(data)));
+	EXPECT_FALSE(_device.UpdateConstantBuffer(_srv, data, 16));
+}
+
+TEST(CpuComputeDeviceSamplerTests, Linear) {
+	CpuComputeDevice::Texture texture(2, 1, FORMAT_R8G8B8A8_UNORM);
+	texture.Store(0, 0, { 0.0f, 0.0f, 0.0f, 0.0f });
+	texture.Store(1, 0, { 1.0f, 2.0f, 3.0f, 4.0f });
+
+	const CpuComputeDevice::Sampler clamp{ ComputeDevice::SamplerFilter::Linear, ComputeDevice::SamplerAddress::Clamp };
+	// 两个像素中心之间
+	EXPECT_EQ(clamp.Sample(texture, 0.5f, 0.5f), (Texel{ 0.5f, 1.0f, 1.5f, 2.0f }));
+	// 边缘外被钳位
+	EXPECT_EQ(clamp.Sample(texture, 0.0f, 0.5f), (Texel{}));
+	EXPECT_EQ(clamp.Sample(texture, 1.0f, 0.5f), (Texel{ 1.0f, 2.0f, 3.0f, 4.0f }));
+
+	// 重复寻址时左边缘混合右侧的像素
+	const CpuComputeDevice::Sampler wrap{ ComputeDevice::SamplerFilter::Linear, ComputeDevice::SamplerAddress::Wrap };
+	EXPECT_EQ(wrap.Sample(texture, 0.0f, 0.5f), (Texel{ 0.5f, 1.0f, 1.5f, 2.0f }));
+}
+
+TEST(CpuComputeDeviceSamplerTests, Point) {
+	CpuComputeDevice::Texture texture(2, 2, FORMAT_R8G8B8A8_UNORM);
+	texture.Store(1, 1, { 1.0f, 1.0f, 1.0f, 1.0f });
+
+	const CpuComputeDevice::Sampler sampler{ ComputeDevice::SamplerFilter::Point, ComputeDevice::SamplerAddress::Clamp };
+	EXPECT_EQ(sampler.Sample(texture, 0.75f, 0.75f), (Texel{ 1.0f, 1.0f, 1.0f, 1.0f }));
+	EXPECT_EQ(sampler.Sample(texture, 0.25f, 0.75f), (Texel{}));
+	EXPECT_EQ(sampler.Sample(texture, 2.0f, 2.0f), (Texel{ 1.0f, 1.0f, 1.0f, 1.0f }));
+}
+
+TEST(CpuComputeDeviceTimestampTests, Monotonic) {
+	CpuComputeDevice device(1);
+	EXPECT_EQ(device.WriteTimestamp(), 0u);
+	EXPECT_EQ(device.WriteTimestamp(), 1u);
+
+	std::vector<uint64_t> timestamps;
+	ASSERT_TRUE(device.ResolveTimestamps(timestamps));
+	ASSERT_EQ(timestamps.size(), 2u);
+	EXPECT_LE(timestamps[0], timestamps[1]);
+
+	// 取得后清空
+	ASSERT_TRUE(device.ResolveTimestamps(timestamps));
+	EXPECT_TRUE(timestamps.empty());
+}
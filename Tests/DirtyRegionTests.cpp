@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include "DirtyRegion.h"
+
+
+using Rect = DirtyRegion::Rect;
+
+TEST(DirtyRegionTests, AddClipsToTexture) {
+	DirtyRegion region(100, 80);
+
+	region.Add(Rect{ -5, -5, 10, 10 });
+	region.Add(Rect{ 90, 70, 120, 100 });
+	// 完全位于纹理外
+	region.Add(Rect{ 100, 0, 110, 10 });
+	region.Add(Rect{ 20, 20, 20, 30 });
+
+	ASSERT_EQ(region.GetRects().size(), 2u);
+	EXPECT_EQ(region.GetRects()[0], (Rect{ 0, 0, 10, 10 }));
+	EXPECT_EQ(region.GetRects()[1], (Rect{ 90, 70, 100, 80 }));
+	EXPECT_EQ(region.GetArea(), 200u);
+}
+
+TEST(DirtyRegionTests, AddMergesOverlapping) {
+	DirtyRegion region(100, 100);
+
+	region.Add(Rect{ 0, 0, 10, 10 });
+	region.Add(Rect{ 20, 0, 30, 10 });
+	// 相邻不合并
+	region.Add(Rect{ 10, 0, 20, 5 });
+	EXPECT_EQ(region.GetRects().size(), 3u);
+
+	// 和前两个矩形都重叠
+	region.Add(Rect{ 5, 5, 25, 8 });
+	ASSERT_EQ(region.GetRects().size(), 1u);
+	EXPECT_EQ(region.GetRects()[0], (Rect{ 0, 0, 30, 10 }));
+}
+
+TEST(DirtyRegionTests, AddBecomesFull) {
+	DirtyRegion region(100, 100);
+	region.Add(Rect{ 0, 0, 100, 60 });
+	EXPECT_FALSE(region.IsFull());
+
+	region.Add(Rect{ 0, 50, 100, 100 });
+	EXPECT_TRUE(region.IsFull());
+	EXPECT_TRUE(region.GetRects().empty());
+	EXPECT_EQ(region.GetArea(), 10000u);
+}
+
+TEST(DirtyRegionTests, CollapsesTooManyRects) {
+	DirtyRegion region(1000, 100);
+	for (int32_t i = 0; i <= (int32_t)DirtyRegion::MAX_RECTS; ++i) {
+		region.Add(Rect{ i * 20, 10, i * 20 + 10, 20 });
+	}
+
+	ASSERT_EQ(region.GetRects().size(), 1u);
+	EXPECT_EQ(region.GetRects()[0], (Rect{ 0, 10, int32_t(DirtyRegion::MAX_RECTS) * 20 + 10, 20 }));
+}
+
+TEST(DirtyRegionTests, PropagateAddsHalo) {
+	DirtyRegion region(100, 100);
+	region.Add(Rect{ 10, 10, 20, 20 });
+
+	// 除了 halo 还额外扩大一个像素
+	DirtyRegion result = region.Propagate(100, 100, 2);
+	ASSERT_EQ(result.GetRects().size(), 1u);
+	EXPECT_EQ(result.GetRects()[0], (Rect{ 7, 7, 23, 23 }));
+
+	result = region.Propagate(100, 100, 0);
+	ASSERT_EQ(result.GetRects().size(), 1u);
+	EXPECT_EQ(result.GetRects()[0], (Rect{ 9, 9, 21, 21 }));
+}
+
+TEST(DirtyRegionTests, PropagateScalesOutward) {
+	DirtyRegion region(100, 100);
+	region.Add(Rect{ 10, 10, 20, 20 });
+
+	DirtyRegion result = region.Propagate(200, 200, 0);
+	EXPECT_EQ(result.GetWidth(), 200u);
+	ASSERT_EQ(result.GetRects().size(), 1u);
+	EXPECT_EQ(result.GetRects()[0], (Rect{ 18, 18, 42, 42 }));
+
+	// 非整数倍时向外取整
+	result = region.Propagate(150, 150, 0);
+	ASSERT_EQ(result.GetRects().size(), 1u);
+	EXPECT_EQ(result.GetRects()[0], (Rect{ 13, 13, 32, 32 }));
+
+	// 缩小
+	result = region.Propagate(30, 30, 0);
+	ASSERT_EQ(result.GetRects().size(), 1u);
+	EXPECT_EQ(result.GetRects()[0], (Rect{ 2, 2, 7, 7 }));
+}
+
+TEST(DirtyRegionTests, PropagateClampsHalo) {
+	DirtyRegion region(100, 100);
+	region.Add(Rect{ 0, 0, 5, 5 });
+	region.Add(Rect{ 97, 98, 100, 100 });
+
+	DirtyRegion result = region.Propagate(100, 100, 2);
+	ASSERT_EQ(result.GetRects().size(), 2u);
+	EXPECT_EQ(result.GetRects()[0], (Rect{ 0, 0, 8, 8 }));
+	EXPECT_EQ(result.GetRects()[1], (Rect{ 94, 95, 100, 100 }));
+
+	// 扩大后覆盖整个纹理
+	region.Clear();
+	region.Add(Rect{ 2, 2, 98, 98 });
+	EXPECT_TRUE(region.Propagate(100, 100, 2).IsFull());
+}
+
+TEST(DirtyRegionTests, PropagateFullAndEmpty) {
+	DirtyRegion region(100, 100);
+	EXPECT_TRUE(region.Propagate(200, 200, 4).IsEmpty());
+
+	region.SetFull();
+	EXPECT_TRUE(region.Propagate(200, 200, 4).IsFull());
+}
+
+TEST(DirtyRegionTests, AppendAccumulates) {
+	DirtyRegion region(100, 100);
+	region.Add(Rect{ 0, 0, 10, 10 });
+
+	DirtyRegion next(100, 100);
+	next.Add(Rect{ 50, 50, 60, 60 });
+	region.Append(next);
+	EXPECT_EQ(region.GetRects().size(), 2u);
+
+	next.SetFull();
+	region.Append(next);
+	EXPECT_TRUE(region.IsFull());
+}
+
+TEST(DirtyRegionTests, BlockRects) {
+	DirtyRegion region(100, 100);
+	region.Add(Rect{ 10, 10, 20, 20 });
+	// 对齐到线程组后和上一个矩形重叠
+	region.Add(Rect{ 30, 5, 40, 12 });
+	// 最后一个线程组只有部分位于纹理内
+	region.Add(Rect{ 97, 97, 100, 100 });
+
+	const std::vector<Rect> blocks = region.GetBlockRects(16, 16);
+	ASSERT_EQ(blocks.size(), 2u);
+	EXPECT_EQ(blocks[0], (Rect{ 0, 0, 3, 2 }));
+	EXPECT_EQ(blocks[1], (Rect{ 6, 6, 7, 7 }));
+
+	region.SetFull();
+	const std::vector<Rect> full = region.GetBlockRects(16, 16);
+	ASSERT_EQ(full.size(), 1u);
+	EXPECT_EQ(full[0], (Rect{ 0, 0, 7, 7 }));
+}
+
+TEST(DirtyRegionTests, SetMoveClipsToTexture) {
+	DirtyRegion region(100, 100);
+	region.SetMove({ Rect{ 80, 0, 100, 10 }, 10, 0 });
+
+	// 移出纹理的部分被丢弃
+	ASSERT_TRUE(region.GetMove());
+	EXPECT_EQ(*region.GetMove(), (DirtyRegion::Move{ Rect{ 80, 0, 90, 10 }, 10, 0 }));
+	EXPECT_TRUE(region.GetRects().empty());
+
+	// 源区域在纹理外的部分无法平移，目标区域中对应的部分作为变化区域
+	region.Clear();
+	region.SetMove({ Rect{ -10, 20, 30, 40 }, 20, 0 });
+	ASSERT_TRUE(region.GetMove());
+	EXPECT_EQ(*region.GetMove(), (DirtyRegion::Move{ Rect{ 0, 20, 30, 40 }, 20, 0 }));
+	ASSERT_EQ(region.GetRects().size(), 1u);
+	EXPECT_EQ(region.GetRects()[0], (Rect{ 10, 20, 20, 40 }));
+}
+
+TEST(DirtyRegionTests, SetMoveAfterRects) {
+	DirtyRegion region(100, 100);
+	region.Add(Rect{ 0, 0, 10, 10 });
+
+	// 平移必须在变化之前发生，否则目标区域作为变化区域
+	region.SetMove({ Rect{ 50, 50, 60, 60 }, 5, 5 });
+	EXPECT_FALSE(region.GetMove());
+	ASSERT_EQ(region.GetRects().size(), 2u);
+	EXPECT_EQ(region.GetRects()[1], (Rect{ 55, 55, 65, 65 }));
+
+	region.Clear();
+	region.SetMove({ Rect{ 50, 50, 60, 60 }, 5, 5 });
+	region.DropMove();
+	EXPECT_FALSE(region.GetMove());
+	ASSERT_EQ(region.GetRects().size(), 1u);
+	EXPECT_EQ(region.GetRects()[0], (Rect{ 55, 55, 65, 65 }));
+}
+
+TEST(DirtyRegionTests, PropagateTranslatesMove) {
+	DirtyRegion region(100, 100);
+	region.SetMove({ Rect{ 10, 10, 50, 50 }, 5, 0 });
+
+	// 源区域收缩 halo + 1 后缩放，平移量随之缩放
+	DirtyRegion result = region.Propagate(200, 200, 1);
+	ASSERT_TRUE(result.GetMove());
+	EXPECT_EQ(*result.GetMove(), (DirtyRegion::Move{ Rect{ 24, 24, 96, 96 }, 10, 0 }));
+
+	// 受目标区域影响的像素中无法平移的部分
+	const std::vector<Rect>& rects = result.GetRects();
+	ASSERT_EQ(rects.size(), 4u);
+	EXPECT_EQ(rects[0], (Rect{ 26, 16, 114, 24 }));
+	EXPECT_EQ(rects[1], (Rect{ 26, 96, 114, 104 }));
+	EXPECT_EQ(rects[2], (Rect{ 26, 24, 34, 96 }));
+	EXPECT_EQ(rects[3], (Rect{ 106, 24, 114, 96 }));
+}
+
+TEST(DirtyRegionTests, PropagateDropsFractionalMove) {
+	DirtyRegion region(100, 100);
+	region.SetMove({ Rect{ 10, 10, 50, 50 }, 5, 0 });
+
+	// 平移 7.5 像素无法用平移表示，受影响的区域全部重新计算
+	DirtyRegion result = region.Propagate(150, 150, 0);
+	EXPECT_FALSE(result.GetMove());
+	ASSERT_EQ(result.GetRects().size(), 1u);
+	EXPECT_EQ(result.GetRects()[0], (Rect{ 21, 13, 84, 77 }));
+}
+
+// 整行滚动：源区域的左右两侧平移前后都紧贴边缘，不必收缩
+// 底部平移后离开了边缘，之前采样边缘的像素必须重新计算
+TEST(DirtyRegionTests, PropagateMoveAtTextureEdge) {
+	DirtyRegion region(100, 100);
+	region.SetMove({ Rect{ 0, 10, 100, 100 }, 0, -10 });
+	ASSERT_TRUE(region.GetMove());
+
+	DirtyRegion result = region.Propagate(100, 100, 2);
+	ASSERT_TRUE(result.GetMove());
+	EXPECT_EQ(*result.GetMove(), (DirtyRegion::Move{ Rect{ 0, 13, 100, 97 }, 0, -10 }));
+
+	const std::vector<Rect>& rects = result.GetRects();
+	ASSERT_EQ(rects.size(), 2u);
+	EXPECT_EQ(rects[0], (Rect{ 0, 0, 100, 3 }));
+	EXPECT_EQ(rects[1], (Rect{ 0, 87, 100, 93 }));
+
+	// 水平平移时左侧离开边缘
+	region.Clear();
+	region.SetMove({ Rect{ 0, 0, 50, 100 }, 10, 0 });
+	result = region.Propagate(100, 100, 2);
+	ASSERT_TRUE(result.GetMove());
+	EXPECT_EQ(*result.GetMove(), (DirtyRegion::Move{ Rect{ 3, 0, 47, 100 }, 10, 0 }));
+}
@@ -0,0 +1,199 @@
+// 比较使用和不使用 EffectCacheDict 时缓存的压缩率和压缩、解压用时
+// 用法：EffectCacheDictBenchmark [目录]
+// 目录可以是 Magpie 的 cache 文件夹，其中未使用字典的缓存文件被解压后作为样本
+// 其他文件直接作为样本。省略时使用仓库中 Effects 文件夹的源码
+#include "EffectCacheDict.h"
+#include <zstd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// 和 EffectCacheManager 中缓存文件的头部相同
+struct CacheFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t dictId;
+	uint32_t reserved;
+};
+
+// 每个测量重复的次数，取总用时
+static constexpr int ITERATIONS = 20;
+
+static bool ReadSample(const std::filesystem::path& path, std::vector<uint8_t>& sample) {
+	std::ifstream file(path, std::ios::binary);
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (data.empty()) {
+		return false;
+	}
+
+	if (data.size() < sizeof(CacheFileHeader) || std::memcmp(data.data(), "MPEC", 4) != 0) {
+		sample = std::move(data);
+		return true;
+	}
+
+	CacheFileHeader header;
+	std::memcpy(&header, data.data(), sizeof(header));
+	if (header.dictId != 0) {
+		// 已使用字典压缩
+		return false;
+	}
+
+	const uint8_t* src = data.data() + sizeof(header);
+	const size_t srcSize = data.size() - sizeof(header);
+	const unsigned long long size = ZSTD_getFrameContentSize(src, srcSize);
+	if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
+		return false;
+	}
+
+	sample.resize(size);
+	return !ZSTD_isError(ZSTD_decompress(sample.data(), sample.size(), src, srcSize));
+}
+
+template<typename Fn>
+static double MeasureMs(const Fn& func) {
+	using namespace std::chrono;
+	auto t = steady_clock::now();
+	func();
+	return duration<double, std::milli>(steady_clock::now() - t).count();
+}
+
+struct Result {
+	size_t rawSize = 0;
+	size_t compressedSize = 0;
+	double compressMs = 0;
+	double decompressMs = 0;
+};
+
+static Result Run(const std::vector<std::vector<uint8_t>>& samples, const EffectCacheDict* dict) {
+	ZSTD_CCtx* cctx = ZSTD_createCCtx();
+	ZSTD_DCtx* dctx = ZSTD_createDCtx();
+
+	Result result;
+	std::vector<std::vector<uint8_t>> compressed(samples.size());
+
+	result.compressMs = MeasureMs([&]() {
+		for (int k = 0; k < ITERATIONS; ++k) {
+			for (size_t i = 0; i < samples.size(); ++i) {
+				const std::vector<uint8_t>& src = samples[i];
+				std::vector<uint8_t>& dest = compressed[i];
+				dest.resize(ZSTD_compressBound(src.size()));
+
+				// 和 Utils::ZstdCompress 相同
+				const size_t size = dict
+					? ZSTD_compress_usingCDict(cctx, dest.data(), dest.size(), src.data(), src.size(), dict->GetCDict())
+					: ZSTD_compressCCtx(cctx, dest.data(), dest.size(), src.data(), src.size(), EffectCacheDict::COMPRESSION_LEVEL);
+				dest.resize(ZSTD_isError(size) ? 0 : size);
+			}
+		}
+	}) / ITERATIONS;
+
+	std::vector<uint8_t> buf;
+	result.decompressMs = MeasureMs([&]() {
+		for (int k = 0; k < ITERATIONS; ++k) {
+			for (size_t i = 0; i < samples.size(); ++i) {
+				buf.resize(samples[i].size());
+				if (dict) {
+					ZSTD_decompress_usingDDict(dctx, buf.data(), buf.size(),
+						compressed[i].data(), compressed[i].size(), dict->GetDDict());
+				} else {
+					ZSTD_decompressDCtx(dctx, buf.data(), buf.size(), compressed[i].data(), compressed[i].size());
+				}
+			}
+		}
+	}) / ITERATIONS;
+
+	for (size_t i = 0; i < samples.size(); ++i) {
+		result.rawSize += samples[i].size();
+		result.compressedSize += compressed[i].size();
+	}
+
+	ZSTD_freeCCtx(cctx);
+	ZSTD_freeDCtx(dctx);
+	return result;
+}
+
+static void Print(const char* name, const Result& result) {
+	std::printf("  %-8s %10zu -> %10zu 字节  压缩率 %6.2f  压缩 %8.3f ms  解压 %8.3f ms\n",
+		name, result.rawSize, result.compressedSize,
+		result.compressedSize ? (double)result.rawSize / result.compressedSize : 0.0,
+		result.compressMs, result.decompressMs);
+}
+
+int main(int argc, char* argv[]) {
+	const std::filesystem::path dir = argc > 1 ? argv[1] : MAGPIE_EFFECTS_DIR;
+
+	std::vector<std::filesystem::path> paths;
+	for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+		if (entry.is_regular_file()) {
+			paths.push_back(entry.path());
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+
+	// 每 4 个样本留出一个不参与训练，用于检查字典对新效果的效果
+	std::vector<std::vector<uint8_t>> trainSamples;
+	std::vector<std::vector<uint8_t>> heldOutSamples;
+	for (const std::filesystem::path& path : paths) {
+		std::vector<uint8_t> sample;
+		if (ReadSample(path, sample)) {
+			((trainSamples.size() + heldOutSamples.size()) % 4 == 3 ? heldOutSamples : trainSamples).push_back(std::move(sample));
+		}
+	}
+
+	if (trainSamples.size() < EffectCacheDict::MIN_SAMPLES) {
+		std::fprintf(stderr, "样本过少：%zu，至少需要 %zu 个\n", trainSamples.size(), EffectCacheDict::MIN_SAMPLES);
+		return 1;
+	}
+
+	// 和 EffectCacheManager 相同，样本首尾相连且总大小有上限
+	std::vector<uint8_t> concatenated;
+	std::vector<size_t> sampleSizes;
+	for (const std::vector<uint8_t>& sample : trainSamples) {
+		if (concatenated.size() >= EffectCacheDict::MAX_SAMPLES_SIZE) {
+			break;
+		}
+		concatenated.insert(concatenated.end(), sample.begin(), sample.end());
+		sampleSizes.push_back(sample.size());
+	}
+
+	std::vector<uint8_t> dictData;
+	const char* error = "";
+	const double trainMs = MeasureMs([&]() {
+		dictData = EffectCacheDict::Train(concatenated, sampleSizes, error);
+	});
+	if (dictData.empty()) {
+		std::fprintf(stderr, "训练字典失败：%s\n", error);
+		return 1;
+	}
+
+	std::shared_ptr<const EffectCacheDict> dict;
+	const double createMs = MeasureMs([&]() {
+		dict = EffectCacheDict::Create(dictData);
+	});
+	if (!dict) {
+		std::fprintf(stderr, "创建字典失败\n");
+		return 1;
+	}
+
+	std::printf("样本：%s\n", dir.string().c_str());
+	std::printf("训练：%zu 个样本，%zu 字节，用时 %.1f ms；字典 %zu 字节，创建用时 %.3f ms\n",
+		sampleSizes.size(), concatenated.size(), trainMs, dictData.size(), createMs);
+
+	std::printf("训练集（%zu 个）：\n", trainSamples.size());
+	Print("无字典", Run(trainSamples, nullptr));
+	Print("字典", Run(trainSamples, dict.get()));
+
+	if (!heldOutSamples.empty()) {
+		std::printf("留出集（%zu 个）：\n", heldOutSamples.size());
+		Print("无字典", Run(heldOutSamples, nullptr));
+		Print("字典", Run(heldOutSamples, dict.get()));
+	}
+
+	return 0;
+}
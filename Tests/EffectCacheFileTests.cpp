@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <map>
+#include "EffectCacheFile.h"
+#include "EffectCacheIndex.h"
+
+
+using Status = EffectCacheFile::Status;
+
+static constexpr uint32_t VERSION = 12;
+
+static std::vector<uint8_t> MakeFile(std::vector<uint8_t> payload, uint32_t dictId = 0, uint32_t version = VERSION) {
+	std::vector<uint8_t> file;
+	EffectCacheFile::WriteHeader(file, version, dictId);
+	file.insert(file.end(), payload.begin(), payload.end());
+	return file;
+}
+
+TEST(EffectCacheFileTests, RoundTrip) {
+	const std::vector<uint8_t> file = MakeFile({ 1, 2, 3 });
+	ASSERT_EQ(file.size(), sizeof(EffectCacheFile::Header) + 3);
+
+	std::span<const uint8_t> payload;
+	ASSERT_EQ(EffectCacheFile::Check(file, VERSION, 0, payload), Status::Ok);
+	EXPECT_EQ(std::vector<uint8_t>(payload.begin(), payload.end()), (std::vector<uint8_t>{ 1, 2, 3 }));
+
+	uint32_t dictId = 1;
+	ASSERT_TRUE(EffectCacheFile::GetDictId(file, VERSION, dictId));
+	EXPECT_EQ(dictId, 0u);
+}
+
+TEST(EffectCacheFileTests, WriteHeaderReplaces) {
+	std::vector<uint8_t> file{ 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9 };
+	EffectCacheFile::WriteHeader(file, VERSION, 5);
+	EXPECT_EQ(file.size(), sizeof(EffectCacheFile::Header));
+
+	uint32_t dictId = 0;
+	ASSERT_TRUE(EffectCacheFile::GetDictId(file, VERSION, dictId));
+	EXPECT_EQ(dictId, 5u);
+}
+
+TEST(EffectCacheFileTests, Corrupt) {
+	std::span<const uint8_t> payload;
+	const std::vector<uint8_t> file = MakeFile({ 1, 2, 3 });
+
+	// 空文件和截断的文件头
+	EXPECT_EQ(EffectCacheFile::Check({}, VERSION, 0, payload), Status::Corrupt);
+	EXPECT_EQ(EffectCacheFile::Check(std::span(file).first(sizeof(EffectCacheFile::Header) - 1), VERSION, 0, payload), Status::Corrupt);
+
+	// 只有文件头
+	EXPECT_EQ(EffectCacheFile::Check(std::span(file).first(sizeof(EffectCacheFile::Header)), VERSION, 0, payload), Status::Corrupt);
+
+	std::vector<uint8_t> badMagic = file;
+	badMagic[0] = 'X';
+	EXPECT_EQ(EffectCacheFile::Check(badMagic, VERSION, 0, payload), Status::Corrupt);
+
+	// 旧版本的缓存
+	EXPECT_EQ(EffectCacheFile::Check(MakeFile({ 1 }, 0, VERSION - 1), VERSION, 0, payload), Status::Corrupt);
+}
+
+TEST(EffectCacheFileTests, DictMismatch) {
+	std::span<const uint8_t> payload;
+	const std::vector<uint8_t> file = MakeFile({ 1 }, 7);
+
+	EXPECT_EQ(EffectCacheFile::Check(file, VERSION, 7, payload), Status::Ok);
+	EXPECT_EQ(EffectCacheFile::Check(file, VERSION, 8, payload), Status::DictMismatch);
+	// 字典尚未加载或已被删除
+	EXPECT_EQ(EffectCacheFile::Check(file, VERSION, 0, payload), Status::DictMismatch);
+
+	// 没有使用字典的缓存始终可以读取
+	EXPECT_EQ(EffectCacheFile::Check(MakeFile({ 1 }), VERSION, 8, payload), Status::Ok);
+}
+
+// 按 EffectCacheManager 的方式读写内容寻址的字节码：索引中存在时不再写入，文件损坏或字典已失效时删除它并移出索引
+class BlobStore {
+public:
+	void Save(const std::string& key, const std::vector<uint8_t>& data) {
+		if (index.Find(key)) {
+			return;
+		}
+
+		files[key] = MakeFile(data, dictId);
+		index.Add(key, "blob", files[key].size());
+		++writeCount;
+	}
+
+	bool Load(const std::string& key, std::vector<uint8_t>& data) {
+		auto it = files.find(key);
+		if (it == files.end()) {
+			index.Remove(key);
+			return false;
+		}
+
+		std::span<const uint8_t> payload;
+		if (EffectCacheFile::Check(it->second, VERSION, dictId, payload) != Status::Ok) {
+			files.erase(it);
+			index.Remove(key);
+			return false;
+		}
+
+		data.assign(payload.begin(), payload.end());
+		return true;
+	}
+
+	std::map<std::string, std::vector<uint8_t>> files;
+	EffectCacheIndex index;
+	uint32_t dictId = 0;
+	uint32_t writeCount = 0;
+};
+
+TEST(EffectCacheFileTests, CorruptBlobRecovers) {
+	BlobStore store;
+	const std::vector<uint8_t> blob{ 1, 2, 3, 4 };
+
+	store.Save("blob_a", blob);
+	store.Save("blob_a", blob);
+	EXPECT_EQ(store.writeCount, 1u);
+
+	// 截断文件
+	store.files["blob_a"].resize(sizeof(EffectCacheFile::Header) / 2);
+
+	std::vector<uint8_t> data;
+	EXPECT_FALSE(store.Load("blob_a", data));
+	EXPECT_FALSE(store.files.contains("blob_a"));
+	EXPECT_EQ(store.index.Find("blob_a"), nullptr);
+
+	// 另一个使用相同字节码的效果编译后重新写入
+	store.Save("blob_a", blob);
+	EXPECT_EQ(store.writeCount, 2u);
+	ASSERT_TRUE(store.Load("blob_a", data));
+	EXPECT_EQ(data, blob);
+}
+
+TEST(EffectCacheFileTests, MissingBlobRecovers) {
+	BlobStore store;
+	const std::vector<uint8_t> blob{ 5, 6 };
+
+	store.Save("blob_b", blob);
+	store.files.erase("blob_b");
+
+	std::vector<uint8_t> data;
+	EXPECT_FALSE(store.Load("blob_b", data));
+	EXPECT_EQ(store.index.Find("blob_b"), nullptr);
+
+	store.Save("blob_b", blob);
+	ASSERT_TRUE(store.Load("blob_b", data));
+	EXPECT_EQ(data, blob);
+}
+
+TEST(EffectCacheFileTests, StaleDictBlobRecovers) {
+	BlobStore store;
+	const std::vector<uint8_t> blob{ 7, 8, 9 };
+
+	store.dictId = 1;
+	store.Save("blob_c", blob);
+
+	// 重新训练字典后旧文件失效
+	store.dictId = 2;
+	std::vector<uint8_t> data;
+	EXPECT_FALSE(store.Load("blob_c", data));
+	EXPECT_FALSE(store.files.contains("blob_c"));
+	EXPECT_EQ(store.index.Find("blob_c"), nullptr);
+
+	store.Save("blob_c", blob);
+	EXPECT_EQ(store.writeCount, 2u);
+
+	uint32_t dictId = 0;
+	ASSERT_TRUE(EffectCacheFile::GetDictId(store.files["blob_c"], VERSION, dictId));
+	EXPECT_EQ(dictId, 2u);
+	ASSERT_TRUE(store.Load("blob_c", data));
+	EXPECT_EQ(data, blob);
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include "EffectCacheIndex.h"
+
+
+static std::vector<std::string> GetKeys(const EffectCacheIndex& index) {
+	std::vector<std::string> result;
+	for (const auto& [fileName, entry] : index.GetEntriesByRecency()) {
+		result.push_back(fileName);
+	}
+	return result;
+}
+
+TEST(EffectCacheIndexTests, AddAndFind) {
+	EffectCacheIndex index;
+	index.Add("Bicubic_00abc", "Bicubic", 100);
+	index.Add("blob_123", "blob", 50);
+
+	EXPECT_EQ(index.GetCount(), 2u);
+	EXPECT_EQ(index.GetTotalSize(), 150u);
+	EXPECT_TRUE(index.IsDirty());
+
+	const EffectCacheIndex::Entry* entry = index.Find("Bicubic_00abc");
+	ASSERT_NE(entry, nullptr);
+	EXPECT_EQ(entry->effectName, "Bicubic");
+	EXPECT_EQ(entry->size, 100u);
+	EXPECT_EQ(index.Find("Lanczos_00abc"), nullptr);
+
+	// 再次添加时更新大小
+	index.Add("Bicubic_00abc", "Bicubic", 30);
+	EXPECT_EQ(index.GetCount(), 2u);
+	EXPECT_EQ(index.GetTotalSize(), 80u);
+
+	index.Remove("blob_123");
+	EXPECT_EQ(index.GetCount(), 1u);
+	EXPECT_EQ(index.GetTotalSize(), 30u);
+}
+
+TEST(EffectCacheIndexTests, RecencyOrder) {
+	EffectCacheIndex index;
+	index.Add("a_00", "a", 1);
+	index.Add("b_00", "b", 1);
+	index.Add("c_00", "c", 1);
+	EXPECT_EQ(GetKeys(index), (std::vector<std::string>{ "c_00", "b_00", "a_00" }));
+
+	EXPECT_TRUE(index.Touch("a_00"));
+	EXPECT_FALSE(index.Touch("d_00"));
+	EXPECT_EQ(GetKeys(index), (std::vector<std::string>{ "a_00", "c_00", "b_00" }));
+}
+
+TEST(EffectCacheIndexTests, EvictLeastRecentlyUsed) {
+	EffectCacheIndex index;
+	index.Add("a_00", "a", 100);
+	index.Add("b_00", "b", 100);
+	index.Add("c_00", "c", 100);
+	index.Add("d_00", "d", 100);
+	index.Touch("a_00");
+
+	// 预算之内不淘汰
+	EXPECT_TRUE(index.Evict(400).empty());
+	EXPECT_EQ(index.GetCount(), 4u);
+
+	// 最久未使用的是 b 和 c
+	EXPECT_EQ(index.Evict(250), (std::vector<std::string>{ "b_00", "c_00" }));
+	EXPECT_EQ(index.GetTotalSize(), 200u);
+	EXPECT_EQ(GetKeys(index), (std::vector<std::string>{ "a_00", "d_00" }));
+}
+
+TEST(EffectCacheIndexTests, EvictRespectsKeep) {
+	EffectCacheIndex index;
+	index.Add("a_00", "a", 100);
+	index.Add("b_00", "b", 100);
+	index.Add("c_00", "c", 100);
+
+	const std::string keep[] = { "a_00", "b_00" };
+	EXPECT_EQ(index.Evict(150, keep), (std::vector<std::string>{ "c_00" }));
+
+	// 即使超出预算也不淘汰 keep 中的条目
+	EXPECT_TRUE(index.Evict(0, keep).empty());
+	EXPECT_EQ(index.GetTotalSize(), 200u);
+
+	EXPECT_EQ(index.Evict(0).size(), 2u);
+	EXPECT_EQ(index.GetCount(), 0u);
+	EXPECT_EQ(index.GetTotalSize(), 0u);
+}
+
+TEST(EffectCacheIndexTests, RoundTrip) {
+	EffectCacheIndex index;
+	index.Add("Anime4K_Upscale_S_00abc", "Anime4K_Upscale_S", 12345);
+	index.Add("blob_ff00", "blob", 678);
+	index.Add("名称_01def", "名称", 1);
+	index.Touch("blob_ff00");
+
+	std::vector<uint8_t> buf;
+	index.Serialize(buf);
+
+	EffectCacheIndex loaded;
+	ASSERT_TRUE(loaded.Deserialize(buf));
+	EXPECT_FALSE(loaded.IsDirty());
+	EXPECT_EQ(loaded.GetCount(), index.GetCount());
+	EXPECT_EQ(loaded.GetTotalSize(), index.GetTotalSize());
+	EXPECT_EQ(GetKeys(loaded), GetKeys(index));
+
+	for (const auto& [fileName, entry] : index.GetEntriesByRecency()) {
+		const EffectCacheIndex::Entry* loadedEntry = loaded.Find(fileName);
+		ASSERT_NE(loadedEntry, nullptr);
+		EXPECT_EQ(loadedEntry->effectName, entry.effectName);
+		EXPECT_EQ(loadedEntry->size, entry.size);
+		EXPECT_EQ(loadedEntry->lastUse, entry.lastUse);
+	}
+
+	// 之后的时间戳仍然大于已有的
+	loaded.Add("new_00", "new", 1);
+	EXPECT_EQ(GetKeys(loaded)[0], "new_00");
+}
+
+TEST(EffectCacheIndexTests, RejectsCorruptData) {
+	EffectCacheIndex index;
+	index.Add("a_00", "a", 100);
+	index.Add("b_00", "b", 100);
+
+	std::vector<uint8_t> buf;
+	index.Serialize(buf);
+
+	EffectCacheIndex loaded;
+
+	// 截断
+	for (size_t len : { size_t(0), size_t(3), size_t(8), buf.size() - 1 }) {
+		EXPECT_FALSE(loaded.Deserialize(std::span(buf.data(), len))) << len;
+		EXPECT_EQ(loaded.GetCount(), 0u);
+	}
+
+	// 多余的数据
+	std::vector<uint8_t> extra = buf;
+	extra.push_back(0);
+	EXPECT_FALSE(loaded.Deserialize(extra));
+
+	// 版本不符
+	std::vector<uint8_t> badVersion = buf;
+	++badVersion[4];
+	EXPECT_FALSE(loaded.Deserialize(badVersion));
+
+	EXPECT_TRUE(loaded.Deserialize(buf));
+	EXPECT_EQ(loaded.GetCount(), 2u);
+}
+
+TEST(EffectCacheIndexTests, MergeKeepsNewerAndSkipsRemoved) {
+	EffectCacheIndex index;
+	index.Add("b_00", "b", 200);
+	index.Add("c_00", "c", 100);
+	index.Remove("c_00");
+
+	// 模拟其他会话的索引，时间戳以毫秒为单位，多次 Touch 使它的 b 更新
+	EffectCacheIndex other;
+	other.Add("a_00", "a", 100);
+	other.Add("b_00", "b", 50);
+	other.Add("c_00", "c", 300);
+	for (int i = 0; i < 1000; ++i) {
+		other.Touch("b_00");
+	}
+
+	index.Merge(other);
+
+	EXPECT_NE(index.Find("a_00"), nullptr);
+	EXPECT_EQ(index.Find("b_00")->size, 50u);
+	// 本会话删除的条目不会被重新加入
+	EXPECT_EQ(index.Find("c_00"), nullptr);
+	EXPECT_EQ(index.GetTotalSize(), 150u);
+
+	// 合并后本会话的时间戳大于 other 中的，因此再次合并时保留本会话的条目
+	index.Add("b_00", "b", 70);
+	index.Merge(other);
+	EXPECT_EQ(index.Find("b_00")->size, 70u);
+	EXPECT_EQ(index.GetTotalSize(), 170u);
+}
+
+TEST(EffectCacheIndexTests, EffectNameFromFileName) {
+	EXPECT_EQ(EffectCacheIndex::EffectNameFromFileName("Bicubic_00abc"), "Bicubic");
+	EXPECT_EQ(EffectCacheIndex::EffectNameFromFileName("Anime4K_Upscale_S_01def"), "Anime4K_Upscale_S");
+	EXPECT_EQ(EffectCacheIndex::EffectNameFromFileName("index"), "index");
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include "EffectChainRunner.h"
+#include "CpuComputeDevice.h"
+#include <atomic>
+#include <cstring>
+
+
+using Handle = ComputeDevice::Handle;
+using Texel = CpuComputeDevice::Texel;
+
+static constexpr uint32_t FORMAT_R16G16B16A16_FLOAT = 10;
+static constexpr uint32_t FORMAT_R8G8B8A8_UNORM = 28;
+static constexpr uint32_t BLOCK_SIZE = 8;
+
+static float LoadFloat(const void* buffer, uint32_t idx) {
+	float result;
+	std::memcpy(&result, (const uint8_t*)buffer + idx * 4, sizeof(result));
+	return result;
+}
+
+// 两个通道：Pass1 将 INPUT 乘以参数写入中间纹理，Pass2 用点采样放大到 OUTPUT，alpha 通道为 __frameCount
+// INPUT 为 8x8，OUTPUT 为 16x16
+class EffectChainRunnerTests : public testing::Test {
+protected:
+	void SetUp() override {
+		auto forEachPixel = [](uint32_t groupX, uint32_t groupY, const auto& func) {
+			for (uint32_t ty = 0; ty < BLOCK_SIZE; ++ty) {
+				for (uint32_t tx = 0; tx < BLOCK_SIZE; ++tx) {
+					func(groupX * BLOCK_SIZE + tx, groupY * BLOCK_SIZE + ty);
+				}
+			}
+		};
+
+		_kernels[0] = _device.RegisterKernel([=](const CpuComputeDevice::KernelContext& context, uint32_t groupX, uint32_t groupY) {
+			const float scale = LoadFloat(context.GetConstantBuffer(1), EffectChainRunner::BUILTIN_CONSTANT_COUNT);
+			forEachPixel(groupX, groupY, [&](uint32_t x, uint32_t y) {
+				Texel texel = context.GetInput(0).Load(x, y);
+				for (float& c : texel) {
+					c *= scale;
+				}
+				context.GetOutput(0).Store(x, y, texel);
+			});
+		});
+		_kernels[1] = _device.RegisterKernel([=](const CpuComputeDevice::KernelContext& context, uint32_t groupX, uint32_t groupY) {
+			uint32_t frameCount;
+			std::memcpy(&frameCount, (const uint8_t*)context.GetConstantBuffer(0) + 8, sizeof(frameCount));
+			// __outputPt
+			const float ptX = LoadFloat(context.GetConstantBuffer(1), 6);
+			const float ptY = LoadFloat(context.GetConstantBuffer(1), 7);
+
+			forEachPixel(groupX, groupY, [&](uint32_t x, uint32_t y) {
+				Texel texel = context.GetSampler(0).Sample(context.GetInput(0), (x + 0.5f) * ptX, (y + 0.5f) * ptY);
+				texel[3] = (float)frameCount;
+				context.GetOutput(0).Store(x, y, texel);
+			});
+		});
+		ASSERT_NE(_kernels[0], ComputeDevice::INVALID_HANDLE);
+		ASSERT_NE(_kernels[1], ComputeDevice::INVALID_HANDLE);
+
+		EffectPassPlan::PassDesc pass1;
+		pass1.inputs = { 0 };
+		pass1.outputs = { 1 };
+		pass1.numThreads = { BLOCK_SIZE, BLOCK_SIZE, 1 };
+		pass1.blockSize = { BLOCK_SIZE, BLOCK_SIZE };
+
+		EffectPassPlan::PassDesc pass2 = pass1;
+		pass2.inputs = { 1 };
+		pass2.outputs = {};
+
+		_desc.textures = {
+			{ { 8, 8 }, FORMAT_R8G8B8A8_UNORM },
+			{ { 8, 8 }, FORMAT_R16G16B16A16_FLOAT },
+			{ { 16, 16 }, FORMAT_R8G8B8A8_UNORM }
+		};
+		_desc.samplers = { { ComputeDevice::SamplerFilter::Point, ComputeDevice::SamplerAddress::Clamp } };
+		_desc.passes = { pass1, pass2 };
+		_desc.kernels = { _kernels[0], _kernels[1] };
+
+		const float scale = 0.5f;
+		_desc.constants.resize(1);
+		std::memcpy(_desc.constants.data(), &scale, sizeof(scale));
+	}
+
+	void _FillInput(EffectChainRunner& runner) {
+		CpuComputeDevice::Texture* input = _device.GetTexture(runner.GetTexture(0));
+		ASSERT_NE(input, nullptr);
+		for (uint32_t y = 0; y < 8; ++y) {
+			for (uint32_t x = 0; x < 8; ++x) {
+				input->Store(x, y, { float(x), float(y), 1.0f, 1.0f });
+			}
+		}
+	}
+
+	CpuComputeDevice _device{ 4 };
+	std::array<Handle, 2> _kernels{};
+	EffectChainRunner::Desc _desc;
+};
+
+TEST_F(EffectChainRunnerTests, Run) {
+	EffectChainRunner runner;
+	ASSERT_TRUE(runner.Initialize(_device, _desc)) << runner.GetError();
+	_FillInput(runner);
+
+	ASSERT_TRUE(runner.Run()) << runner.GetError();
+
+	const CpuComputeDevice::Texture* output = _device.GetTexture(runner.GetTexture(2));
+	ASSERT_NE(output, nullptr);
+	for (uint32_t y = 0; y < 16; ++y) {
+		for (uint32_t x = 0; x < 16; ++x) {
+			const Texel expected{ (x / 2) * 0.5f, (y / 2) * 0.5f, 0.5f, 1.0f };
+			ASSERT_EQ(output->Load(x, y), expected) << x << ", " << y;
+		}
+	}
+
+	// __frameCount 每次执行递增
+	ASSERT_TRUE(runner.Run());
+	EXPECT_EQ(output->Load(0, 0)[3], 2.0f);
+}
+
+TEST_F(EffectChainRunnerTests, BuiltinConstants) {
+	std::atomic<bool> isCalled = false;
+	const Handle kernel = _device.RegisterKernel([&](const CpuComputeDevice::KernelContext& context, uint32_t, uint32_t) {
+		const void* constants = context.GetConstantBuffer(1);
+		uint32_t sizes[4];
+		std::memcpy(sizes, constants, sizeof(sizes));
+		EXPECT_EQ(sizes[0], 8u);
+		EXPECT_EQ(sizes[1], 8u);
+		EXPECT_EQ(sizes[2], 16u);
+		EXPECT_EQ(sizes[3], 16u);
+		EXPECT_EQ(LoadFloat(constants, 4), 1.0f / 8);
+		EXPECT_EQ(LoadFloat(constants, 6), 1.0f / 16);
+		EXPECT_EQ(LoadFloat(constants, 8), 2.0f);
+		EXPECT_EQ(LoadFloat(constants, EffectChainRunner::BUILTIN_CONSTANT_COUNT), 0.5f);
+		isCalled = true;
+	});
+
+	_desc.passes.resize(1);
+	_desc.passes[0].outputs = {};
+	_desc.textures.erase(_desc.textures.begin() + 1);
+	_desc.kernels = { kernel };
+
+	EffectChainRunner runner;
+	ASSERT_TRUE(runner.Initialize(_device, _desc)) << runner.GetError();
+	ASSERT_TRUE(runner.Run()) << runner.GetError();
+	EXPECT_TRUE(isCalled);
+}
+
+TEST_F(EffectChainRunnerTests, PassTimes) {
+	EffectChainRunner runner;
+	ASSERT_TRUE(runner.Initialize(_device, _desc)) << runner.GetError();
+
+	// 没有统计的执行不记录时间戳
+	ASSERT_TRUE(runner.Run(false));
+	std::vector<double> passTimes;
+	EXPECT_FALSE(runner.GetPassTimes(passTimes));
+
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_TRUE(runner.Run(true)) << runner.GetError();
+	}
+	ASSERT_TRUE(runner.GetPassTimes(passTimes)) << runner.GetError();
+	ASSERT_EQ(passTimes.size(), 2u);
+	for (double time : passTimes) {
+		EXPECT_GE(time, 0.0);
+	}
+
+	// 时间戳已取回
+	EXPECT_FALSE(runner.GetPassTimes(passTimes));
+}
+
+TEST_F(EffectChainRunnerTests, InvalidDesc) {
+	EffectChainRunner runner;
+
+	EffectChainRunner::Desc desc = _desc;
+	desc.kernels.pop_back();
+	EXPECT_FALSE(runner.Initialize(_device, desc));
+
+	// 通道读写同一纹理，错误来自 EffectPassPlan
+	desc = _desc;
+	desc.passes[0].outputs = { 0 };
+	EXPECT_FALSE(runner.Initialize(_device, desc));
+	EXPECT_STRNE(runner.GetError(), "");
+
+	// 纹理尺寸无效，错误来自设备
+	desc = _desc;
+	desc.textures[1].size = { 20000, 8 };
+	EXPECT_FALSE(runner.Initialize(_device, desc));
+	EXPECT_FALSE(runner.Run());
+
+	// 失败后可以重新初始化
+	ASSERT_TRUE(runner.Initialize(_device, _desc)) << runner.GetError();
+	EXPECT_TRUE(runner.Run());
+}
+
+TEST_F(EffectChainRunnerTests, ReleasesResources) {
+	Handle input = ComputeDevice::INVALID_HANDLE;
+	{
+		EffectChainRunner runner;
+		ASSERT_TRUE(runner.Initialize(_device, _desc)) << runner.GetError();
+		input = runner.GetTexture(0);
+		EXPECT_NE(_device.GetTexture(input), nullptr);
+	}
+	EXPECT_EQ(_device.GetTexture(input), nullptr);
+}
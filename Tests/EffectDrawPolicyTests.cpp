@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include "EffectDrawPolicy.h"
+
+
+using FullDraw = EffectDrawPolicy::FullDraw;
+using PassDraw = EffectDrawPolicy::PassDraw;
+using Rect = DirtyRegion::Rect;
+
+// 16x16 的块，输出为 160x160 时有 10x10 个线程组
+static EffectPassPlan::Pass MakePass(uint32_t width = 160, uint32_t height = 160) {
+	EffectPassPlan::Pass pass;
+	pass.blockSize = { 16, 16 };
+	pass.groups = { (width + 15) / 16, (height + 15) / 16 };
+	return pass;
+}
+
+TEST(EffectDrawPolicyTests, RecordOnceThenReplay) {
+	EffectDrawPolicy policy;
+	policy.Initialize(false);
+
+	EXPECT_FALSE(policy.IsRecorded());
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Record);
+
+	policy.OnRecorded(true);
+	EXPECT_TRUE(policy.IsRecorded());
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Replay);
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Replay);
+}
+
+TEST(EffectDrawPolicyTests, InvalidateRerecords) {
+	EffectDrawPolicy policy;
+	policy.Initialize(false);
+	policy.OnRecorded(true);
+
+	// 重新绑定后视图改变
+	policy.Invalidate();
+	EXPECT_FALSE(policy.IsRecorded());
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Record);
+
+	policy.OnRecorded(true);
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Replay);
+}
+
+TEST(EffectDrawPolicyTests, RecordFailureFallsBack) {
+	EffectDrawPolicy policy;
+	policy.Initialize(false);
+
+	policy.OnRecorded(false);
+	EXPECT_FALSE(policy.IsRecorded());
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Direct);
+
+	// 重新绑定不会再次尝试录制
+	policy.Invalidate();
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Direct);
+
+	// 重新初始化后可以再次尝试
+	policy.Initialize(false);
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Record);
+}
+
+TEST(EffectDrawPolicyTests, ProfilingDrawsDirectly) {
+	EffectDrawPolicy policy;
+	policy.Initialize(false);
+
+	// 统计用时期间不录制，结束后再录制
+	EXPECT_EQ(policy.GetFullDraw(true), FullDraw::Direct);
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Record);
+
+	// 已录制的命令列表在统计结束后继续使用
+	policy.OnRecorded(true);
+	EXPECT_EQ(policy.GetFullDraw(true), FullDraw::Direct);
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Replay);
+}
+
+TEST(EffectDrawPolicyTests, DynamicNeverRecords) {
+	EffectDrawPolicy policy;
+	policy.Initialize(true);
+
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Direct);
+	policy.Invalidate();
+	EXPECT_EQ(policy.GetFullDraw(false), FullDraw::Direct);
+}
+
+TEST(EffectDrawPolicyTests, CanDrawDirtyRegion) {
+	DirtyRegion region(100, 50);
+	region.Add(Rect{ 0, 0, 10, 10 });
+
+	EXPECT_TRUE(EffectDrawPolicy::CanDrawDirtyRegion(&region, true, 100, 50));
+
+	EXPECT_FALSE(EffectDrawPolicy::CanDrawDirtyRegion(nullptr, true, 100, 50));
+	EXPECT_FALSE(EffectDrawPolicy::CanDrawDirtyRegion(&region, false, 100, 50));
+	EXPECT_FALSE(EffectDrawPolicy::CanDrawDirtyRegion(&region, true, 50, 100));
+
+	// 空区域仍可逐个通道跳过
+	DirtyRegion empty(100, 50);
+	EXPECT_TRUE(EffectDrawPolicy::CanDrawDirtyRegion(&empty, true, 100, 50));
+
+	region.SetFull();
+	EXPECT_FALSE(EffectDrawPolicy::CanDrawDirtyRegion(&region, true, 100, 50));
+}
+
+TEST(EffectDrawPolicyTests, PassDrawFullAndSkip) {
+	const EffectPassPlan::Pass pass = MakePass();
+	std::vector<Rect> blockRects{ Rect{ 0, 0, 1, 1 } };
+
+	DirtyRegion region(160, 160);
+	EXPECT_EQ(EffectDrawPolicy::GetPassDraw(region, pass, blockRects), PassDraw::Skip);
+	EXPECT_TRUE(blockRects.empty());
+
+	region.SetFull();
+	EXPECT_EQ(EffectDrawPolicy::GetPassDraw(region, pass, blockRects), PassDraw::Full);
+	EXPECT_TRUE(blockRects.empty());
+}
+
+TEST(EffectDrawPolicyTests, PassDrawBlocks) {
+	const EffectPassPlan::Pass pass = MakePass();
+
+	// 跨越 2x2 个块
+	DirtyRegion region(160, 160);
+	region.Add(Rect{ 10, 10, 20, 20 });
+
+	std::vector<Rect> blockRects;
+	ASSERT_EQ(EffectDrawPolicy::GetPassDraw(region, pass, blockRects), PassDraw::Blocks);
+	ASSERT_EQ(blockRects.size(), 1u);
+	EXPECT_EQ(blockRects[0], (Rect{ 0, 0, 2, 2 }));
+}
+
+TEST(EffectDrawPolicyTests, PassDrawThreshold) {
+	const EffectPassPlan::Pass pass = MakePass();
+	std::vector<Rect> blockRects;
+
+	// 74 个线程组，少于 3/4
+	DirtyRegion region(160, 160);
+	region.Add(Rect{ 0, 0, 160, 112 });
+	region.Add(Rect{ 0, 112, 64, 128 });
+	EXPECT_EQ(EffectDrawPolicy::GetPassDraw(region, pass, blockRects), PassDraw::Blocks);
+
+	uint64_t blockCount = 0;
+	for (const Rect& rect : blockRects) {
+		blockCount += rect.GetArea();
+	}
+	EXPECT_EQ(blockCount, 74u);
+
+	// 恰好 75 个线程组
+	region.Add(Rect{ 64, 112, 80, 128 });
+	EXPECT_EQ(EffectDrawPolicy::GetPassDraw(region, pass, blockRects), PassDraw::Full);
+	EXPECT_TRUE(blockRects.empty());
+}
+
+TEST(EffectDrawPolicyTests, PassDrawMoveOnly) {
+	const EffectPassPlan::Pass pass = MakePass();
+
+	// 只有平移时需要平移但不需要调度
+	DirtyRegion region(160, 160);
+	region.SetMove(DirtyRegion::Move{ Rect{ 0, 16, 160, 160 }, 0, -16 });
+	ASSERT_TRUE(region.GetMove().has_value());
+
+	std::vector<Rect> blockRects{ Rect{ 0, 0, 1, 1 } };
+	EXPECT_EQ(EffectDrawPolicy::GetPassDraw(region, pass, blockRects), PassDraw::Blocks);
+	EXPECT_TRUE(blockRects.empty());
+
+	// 平移和变化的矩形同时存在
+	region.Add(Rect{ 0, 144, 160, 160 });
+	EXPECT_EQ(EffectDrawPolicy::GetPassDraw(region, pass, blockRects), PassDraw::Blocks);
+	ASSERT_EQ(blockRects.size(), 1u);
+	EXPECT_EQ(blockRects[0], (Rect{ 0, 9, 10, 10 }));
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include "EffectPassPlan.h"
+
+
+using BindingType = EffectPassPlan::BindingType;
+using PassDesc = EffectPassPlan::PassDesc;
+using Size = EffectPassPlan::Size;
+
+static PassDesc MakePass(
+	std::vector<uint32_t> inputs,
+	std::vector<uint32_t> outputs,
+	std::array<uint32_t, 3> numThreads = { 64, 1, 1 },
+	Size blockSize = { 16, 16 }
+) {
+	return PassDesc{ std::move(inputs), std::move(outputs), numThreads, blockSize };
+}
+
+TEST(EffectPassPlanTests, Bindings) {
+	// 纹理：INPUT、tex1、tex2、OUTPUT
+	const std::vector<Size> textureSizes{ { 100, 100 }, { 100, 100 }, { 100, 100 }, { 200, 200 } };
+	const std::vector<PassDesc> passes{
+		MakePass({ 0 }, { 1, 2 }),
+		MakePass({ 0, 1, 2 }, {})
+	};
+
+	EffectPassPlan plan;
+	ASSERT_TRUE(plan.Build(passes, textureSizes, { 200, 200 }, 2)) << plan.GetError();
+	ASSERT_EQ(plan.GetPasses().size(), 2u);
+
+	// 顺序为常量缓冲区、采样器、输入、输出，binding 连续编号
+	const std::vector<EffectPassPlan::Binding>& bindings = plan.GetPasses()[0].bindings;
+	ASSERT_EQ(bindings.size(), 3u + 2 + 1 + 2);
+	const BindingType expectedTypes[] = {
+		BindingType::ConstantBuffer, BindingType::ConstantBuffer, BindingType::ConstantBuffer,
+		BindingType::Sampler, BindingType::Sampler,
+		BindingType::SampledTexture,
+		BindingType::StorageTexture, BindingType::StorageTexture
+	};
+	const uint32_t expectedSlots[] = { 0, 1, 2, 0, 1, 0, 0, 1 };
+	const uint32_t expectedResources[] = { 0, 1, 2, 0, 1, 0, 1, 2 };
+	for (uint32_t i = 0; i < bindings.size(); ++i) {
+		SCOPED_TRACE(testing::Message() << "绑定 " << i);
+		EXPECT_EQ(bindings[i].type, expectedTypes[i]);
+		EXPECT_EQ(bindings[i].slot, expectedSlots[i]);
+		EXPECT_EQ(bindings[i].binding, i);
+		EXPECT_EQ(bindings[i].resource, expectedResources[i]);
+	}
+
+	// OUTPUT 展开为最后一个纹理
+	const EffectPassPlan::Pass& outputPass = plan.GetPasses()[1];
+	EXPECT_EQ(outputPass.outputs, std::vector<uint32_t>{ 3 });
+	ASSERT_EQ(outputPass.bindings.size(), 3u + 2 + 3 + 1);
+	EXPECT_EQ(outputPass.bindings.back().type, BindingType::StorageTexture);
+	EXPECT_EQ(outputPass.bindings.back().resource, 3u);
+}
+
+TEST(EffectPassPlanTests, Groups) {
+	const std::vector<Size> textureSizes{ { 100, 100 }, { 100, 50 }, { 33, 17 } };
+	const std::vector<PassDesc> passes{
+		MakePass({ 0 }, { 1 }, { 8, 8, 1 }, { 8, 8 }),
+		MakePass({ 1 }, {}, { 64, 1, 1 }, { 16, 16 })
+	};
+
+	EffectPassPlan plan;
+	ASSERT_TRUE(plan.Build(passes, textureSizes, { 33, 17 }, 0)) << plan.GetError();
+
+	// 向上取整，由第一个输出的尺寸决定
+	EXPECT_EQ(plan.GetPasses()[0].groups.width, 13u);
+	EXPECT_EQ(plan.GetPasses()[0].groups.height, 7u);
+	EXPECT_EQ(plan.GetPasses()[1].groups.width, 3u);
+	EXPECT_EQ(plan.GetPasses()[1].groups.height, 2u);
+}
+
+TEST(EffectPassPlanTests, OutputClampedToOutputSize) {
+	// 最后一个效果的 OUTPUT 比输出尺寸大
+	const std::vector<Size> textureSizes{ { 100, 100 }, { 1920, 1080 } };
+	const std::vector<PassDesc> passes{ MakePass({ 0 }, {}, { 64, 1, 1 }, { 16, 16 }) };
+
+	EffectPassPlan plan;
+	ASSERT_TRUE(plan.Build(passes, textureSizes, { 200, 100 }, 0)) << plan.GetError();
+	EXPECT_EQ(plan.GetPasses()[0].groups.width, 13u);
+	EXPECT_EQ(plan.GetPasses()[0].groups.height, 7u);
+}
+
+TEST(EffectPassPlanTests, Rebuild) {
+	EffectPassPlan plan;
+	ASSERT_TRUE(plan.Build({ MakePass({ 0 }, {}) }, { { 16, 16 }, { 16, 16 } }, { 16, 16 }, 0));
+
+	// 失败时清空之前的结果
+	EXPECT_FALSE(plan.Build({}, { { 16, 16 }, { 16, 16 } }, { 16, 16 }, 0));
+	EXPECT_TRUE(plan.GetPasses().empty());
+	EXPECT_STRNE(plan.GetError(), "");
+
+	// 成功时清除错误
+	EXPECT_TRUE(plan.Build({ MakePass({ 0 }, {}) }, { { 16, 16 }, { 16, 16 } }, { 16, 16 }, 0));
+	EXPECT_STREQ(plan.GetError(), "");
+	EXPECT_EQ(plan.GetPasses().size(), 1u);
+}
+
+// 每种无效的输入都应失败
+static void ExpectFail(const std::vector<PassDesc>& passes, uint32_t samplerCount = 0) {
+	const std::vector<Size> textureSizes{ { 100, 100 }, { 100, 100 }, { 100, 100 } };
+
+	EffectPassPlan plan;
+	EXPECT_FALSE(plan.Build(passes, textureSizes, { 100, 100 }, samplerCount));
+	EXPECT_TRUE(plan.GetPasses().empty());
+	EXPECT_STRNE(plan.GetError(), "");
+}
+
+TEST(EffectPassPlanTests, OutputPassNotLast) {
+	ExpectFail({ MakePass({ 0 }, {}), MakePass({ 0 }, { 1 }) });
+}
+
+TEST(EffectPassPlanTests, ReadWriteSameTexture) {
+	ExpectFail({ MakePass({ 0, 1 }, { 1 }), MakePass({ 1 }, {}) });
+}
+
+TEST(EffectPassPlanTests, TextureOutOfRange) {
+	// 读取 OUTPUT
+	ExpectFail({ MakePass({ 2 }, {}) });
+	// 写入 INPUT
+	ExpectFail({ MakePass({ 1 }, { 0 }), MakePass({ 0 }, {}) });
+	// 中间通道写入 OUTPUT
+	ExpectFail({ MakePass({ 0 }, { 2 }), MakePass({ 0 }, {}) });
+	ExpectFail({ MakePass({ 0 }, { 3 }), MakePass({ 0 }, {}) });
+}
+
+TEST(EffectPassPlanTests, TooManySamplers) {
+	ExpectFail({ MakePass({ 0 }, {}) }, EffectPassPlan::MAX_SAMPLERS + 1);
+
+	EffectPassPlan plan;
+	EXPECT_TRUE(plan.Build({ MakePass({ 0 }, {}) }, { { 16, 16 }, { 16, 16 } }, { 16, 16 }, EffectPassPlan::MAX_SAMPLERS));
+}
+
+TEST(EffectPassPlanTests, TooManyOutputs) {
+	std::vector<uint32_t> outputs(EffectPassPlan::MAX_OUTPUTS + 1, 1);
+	ExpectFail({ MakePass({ 0 }, outputs), MakePass({ 1 }, {}) });
+}
+
+TEST(EffectPassPlanTests, InvalidThreads) {
+	ExpectFail({ MakePass({ 0 }, {}, { 0, 1, 1 }) });
+	ExpectFail({ MakePass({ 0 }, {}, { 1024, 2, 1 }) });
+	ExpectFail({ MakePass({ 0 }, {}, { 1, 1, EffectPassPlan::MAX_THREADS_Z + 1 }) });
+
+	EffectPassPlan plan;
+	EXPECT_TRUE(plan.Build({ MakePass({ 0 }, {}, { 32, 32, 1 }) }, { { 16, 16 }, { 16, 16 } }, { 16, 16 }, 0));
+}
+
+TEST(EffectPassPlanTests, InvalidBlockSize) {
+	ExpectFail({ MakePass({ 0 }, {}, { 64, 1, 1 }, { 0, 16 }) });
+}
+
+TEST(EffectPassPlanTests, TooManyGroups) {
+	const std::vector<Size> textureSizes{ { 16, 16 }, { 16384, 16 } };
+	const std::vector<PassDesc> passes{ MakePass({ 0 }, {}, { 1, 1, 1 }, { 1, 1 }) };
+
+	EffectPassPlan plan;
+	ASSERT_TRUE(plan.Build(passes, textureSizes, { 16384, 16 }, 0)) << plan.GetError();
+	EXPECT_FALSE(plan.Build(passes, { { 16, 16 }, { 65536, 16 } }, { 65536, 16 }, 0));
+}
+
+TEST(EffectPassPlanTests, EmptyTextureFails) {
+	const std::vector<Size> textureSizes{ { 16, 16 }, { 0, 16 } };
+
+	EffectPassPlan plan;
+	EXPECT_FALSE(plan.Build({ MakePass({ 0 }, {}) }, textureSizes, { 16, 16 }, 0));
+}
@@ -0,0 +1,96 @@
+// 测量 FrameChangeDetector 在 CPU 上计算块哈希的吞吐量
+// 用法：FrameChangeDetectorBenchmark [迭代次数]
+// 同时测量 memcmp 整帧比较作为参照，它需要保存上一帧的副本
+#include "FrameChangeDetector.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+struct Resolution {
+	const char* name;
+	uint32_t width;
+	uint32_t height;
+};
+
+template<typename Fn>
+static double MeasureMs(const Fn& func) {
+	using namespace std::chrono;
+	auto t = steady_clock::now();
+	func();
+	return duration<double, std::milli>(steady_clock::now() - t).count();
+}
+
+static std::vector<uint8_t> MakeFrame(uint32_t rowPitch, uint32_t height) {
+	std::vector<uint8_t> frame(size_t(rowPitch) * height);
+	uint32_t seed = 12345;
+	for (uint8_t& b : frame) {
+		seed = seed * 1103515245 + 12345;
+		b = uint8_t(seed >> 16);
+	}
+	return frame;
+}
+
+int main(int argc, char* argv[]) {
+	const int iterations = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 100;
+
+	static constexpr Resolution RESOLUTIONS[] = {
+		{ "1080p", 1920, 1080 },
+		{ "1440p", 2560, 1440 },
+		{ "4K", 3840, 2160 }
+	};
+
+	std::printf("迭代 %d 次，块尺寸 %u\n", iterations, FrameChangeDetector::TILE_SIZE);
+
+	for (const Resolution& res : RESOLUTIONS) {
+		// 和映射的纹理相同，行宽对齐到 256 字节
+		const uint32_t rowPitch = (res.width * 4 + 255) / 256 * 256;
+		std::vector<uint8_t> frame = MakeFrame(rowPitch, res.height);
+		const std::vector<uint8_t> prevFrame = frame;
+		const double frameMB = double(res.width) * res.height * 4 / (1024 * 1024);
+
+		FrameChangeDetector detector(res.width, res.height);
+		detector.Update(frame.data(), rowPitch);
+
+		// 画面不变，只有哈希和比较的开销
+		size_t dirtyRects = 0;
+		const double unchangedMs = MeasureMs([&]() {
+			for (int i = 0; i < iterations; ++i) {
+				dirtyRects += detector.Update(frame.data(), rowPitch).GetRects().size();
+			}
+		}) / iterations;
+
+		// 每帧改变一个像素，额外包括生成变化区域的开销
+		const double changedMs = MeasureMs([&]() {
+			for (int i = 0; i < iterations; ++i) {
+				frame[size_t(i % res.height) * rowPitch] ^= 1;
+				dirtyRects += detector.Update(frame.data(), rowPitch).GetRects().size();
+			}
+		}) / iterations;
+
+		// 只有最后一个字节不同，因此总是比较整帧
+		frame = prevFrame;
+		int differences = 0;
+		const double memcmpMs = MeasureMs([&]() {
+			for (int i = 0; i < iterations; ++i) {
+				frame.back() ^= 1;
+				differences += std::memcmp(frame.data(), prevFrame.data(), frame.size()) != 0;
+			}
+		}) / iterations;
+
+		std::printf("%-6s %ux%u  不变 %7.3f ms（%6.2f GB/s）  变化 %7.3f ms  memcmp %7.3f ms（%6.2f GB/s）\n",
+			res.name, res.width, res.height,
+			unchangedMs, frameMB / 1024 / (unchangedMs / 1000),
+			changedMs,
+			memcmpMs, frameMB / 1024 / (memcmpMs / 1000));
+
+		// 防止被优化掉
+		if (dirtyRects == size_t(-1) || differences < 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "FrameChangeDetector.h"
+
+
+using Rect = DirtyRegion::Rect;
+
+static constexpr uint32_t TILE = FrameChangeDetector::TILE_SIZE;
+
+TEST(FrameChangeDetectorTests, TileCount) {
+	FrameChangeDetector detector(TILE * 3 + 1, TILE * 2);
+	EXPECT_EQ(detector.GetTileCountX(), 4u);
+	EXPECT_EQ(detector.GetTileCountY(), 2u);
+}
+
+TEST(FrameChangeDetectorTests, Update) {
+	const uint32_t width = TILE * 3 + 10;
+	const uint32_t height = TILE * 2 + 5;
+	// 行末有填充
+	const uint32_t rowPitch = width * 4 + 64;
+	std::vector<uint8_t> frame(size_t(rowPitch) * height);
+
+	FrameChangeDetector detector(width, height);
+	EXPECT_TRUE(detector.Update(frame.data(), rowPitch).IsFull());
+	EXPECT_TRUE(detector.Update(frame.data(), rowPitch).IsEmpty());
+
+	// 填充的变化被忽略
+	frame[width * 4] = 1;
+	EXPECT_TRUE(detector.Update(frame.data(), rowPitch).IsEmpty());
+
+	// 最后一列和最后一行的块只有部分位于帧内
+	frame[size_t(height - 1) * rowPitch + size_t(width - 1) * 4] = 1;
+	DirtyRegion region = detector.Update(frame.data(), rowPitch);
+	ASSERT_EQ(region.GetRects().size(), 1u);
+	EXPECT_EQ(region.GetRects()[0], (Rect{ int32_t(TILE * 3), int32_t(TILE * 2), int32_t(width), int32_t(height) }));
+
+	detector.Reset();
+	EXPECT_TRUE(detector.Update(frame.data(), rowPitch).IsFull());
+}
+
+TEST(FrameChangeDetectorTests, TilesToRegionMergesTiles) {
+	FrameChangeDetector detector(TILE * 4, TILE * 3);
+
+	// 0 1 1 0
+	// 0 1 1 0
+	// 1 0 0 0
+	const uint8_t flags[] = {
+		0, 1, 1, 0,
+		0, 1, 1, 0,
+		1, 0, 0, 0
+	};
+	DirtyRegion region = detector.TilesToRegion(flags);
+
+	ASSERT_EQ(region.GetRects().size(), 2u);
+	EXPECT_EQ(region.GetRects()[0], (Rect{ int32_t(TILE), 0, int32_t(TILE * 3), int32_t(TILE * 2) }));
+	EXPECT_EQ(region.GetRects()[1], (Rect{ 0, int32_t(TILE * 2), int32_t(TILE), int32_t(TILE * 3) }));
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "FrameMailbox.h"
+#include <thread>
+
+
+TEST(FrameMailboxTests, LatestFrameWins) {
+	FrameMailbox<int> mailbox;
+	EXPECT_FALSE(mailbox.Acquire());
+	EXPECT_EQ(mailbox.GetFrontSequence(), 0u);
+
+	mailbox.GetBackBuffer() = 1;
+	EXPECT_EQ(mailbox.Publish(), 1u);
+	mailbox.GetBackBuffer() = 2;
+	EXPECT_EQ(mailbox.Publish(), 2u);
+	EXPECT_EQ(mailbox.GetDroppedCount(), 1u);
+
+	ASSERT_TRUE(mailbox.Acquire());
+	EXPECT_EQ(mailbox.GetFrontBuffer(), 2);
+	EXPECT_EQ(mailbox.GetFrontSequence(), 2u);
+	EXPECT_EQ(mailbox.GetConsumedSequence(), 2u);
+
+	// 没有新帧时保留前缓冲区
+	EXPECT_FALSE(mailbox.Acquire());
+	EXPECT_EQ(mailbox.GetFrontBuffer(), 2);
+	EXPECT_EQ(mailbox.GetPublishedCount(), 2u);
+}
+
+TEST(FrameMailboxTests, BuffersAreDistinct) {
+	FrameMailbox<int> mailbox;
+
+	for (int i = 0; i < 10; ++i) {
+		mailbox.Publish();
+		if (i % 3 == 0) {
+			mailbox.Acquire();
+		}
+
+		EXPECT_NE(mailbox.GetBackIndex(), mailbox.GetFrontIndex());
+		EXPECT_LT(mailbox.GetBackIndex(), FrameMailbox<int>::SLOT_COUNT);
+		EXPECT_LT(mailbox.GetFrontIndex(), FrameMailbox<int>::SLOT_COUNT);
+	}
+}
+
+// 应在 ThreadSanitizer 下运行
+// 生产者把帧的序号写满整个缓冲区后发布，消费者检查取得的帧完整（没有撕裂）且序号递增
+TEST(FrameMailboxTests, StressNoTearing) {
+	static constexpr uint64_t FRAME_COUNT = 1'000'000;
+
+	struct Frame {
+		std::array<uint64_t, 32> words{};
+	};
+	FrameMailbox<Frame> mailbox;
+
+	std::thread producer([&]() {
+		for (uint64_t sequence = 1; sequence <= FRAME_COUNT; ++sequence) {
+			mailbox.GetBackBuffer().words.fill(sequence);
+			mailbox.Publish();
+		}
+	});
+
+	uint64_t lastSequence = 0;
+	uint64_t acquiredCount = 0;
+	uint64_t tornFrames = 0;
+	uint64_t outOfOrder = 0;
+
+	while (lastSequence < FRAME_COUNT) {
+		if (!mailbox.Acquire()) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		++acquiredCount;
+
+		const uint64_t sequence = mailbox.GetFrontSequence();
+		for (uint64_t word : mailbox.GetFrontBuffer().words) {
+			tornFrames += word != sequence;
+		}
+		outOfOrder += sequence <= lastSequence;
+		lastSequence = sequence;
+	}
+
+	producer.join();
+
+	EXPECT_EQ(tornFrames, 0u);
+	EXPECT_EQ(outOfOrder, 0u);
+	// 最后一帧总能被取得，每一帧要么被取得要么被丢弃
+	EXPECT_EQ(lastSequence, FRAME_COUNT);
+	EXPECT_EQ(acquiredCount + mailbox.GetDroppedCount(), FRAME_COUNT);
+	EXPECT_FALSE(mailbox.Acquire());
+}
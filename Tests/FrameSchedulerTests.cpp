@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "FrameScheduler.h"
+
+
+using namespace std::chrono_literals;
+using TimePoint = FrameScheduler::TimePoint;
+
+// 模拟的时钟，从任意非零时间开始
+static const TimePoint T0 = TimePoint{} + 100s;
+
+static double ToMs(FrameScheduler::Duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+TEST(FrameSchedulerTests, SourceIntervalAverage) {
+	FrameScheduler scheduler;
+	EXPECT_EQ(scheduler.GetSourceFrameInterval(), 0ms);
+
+	scheduler.OnSourceFrame(T0);
+	EXPECT_EQ(scheduler.GetSourceFrameInterval(), 0ms);
+
+	// 第一个间隔直接采用
+	scheduler.OnSourceFrame(T0 + 16ms);
+	EXPECT_EQ(scheduler.GetSourceFrameInterval(), 16ms);
+
+	// 之后以 1/8 的权重平滑
+	scheduler.OnSourceFrame(T0 + 16ms + 24ms);
+	EXPECT_EQ(scheduler.GetSourceFrameInterval(), 17ms);
+
+	// 稳定的间隔最终收敛
+	TimePoint time = T0 + 40ms;
+	for (int i = 0; i < 200; ++i) {
+		time += 33ms;
+		scheduler.OnSourceFrame(time);
+	}
+	EXPECT_NEAR(ToMs(scheduler.GetSourceFrameInterval()), 33.0, 0.01);
+}
+
+TEST(FrameSchedulerTests, IgnoresPausesAndReordering) {
+	FrameScheduler scheduler;
+	scheduler.OnSourceFrame(T0);
+	scheduler.OnSourceFrame(T0 + 20ms);
+
+	// 源暂停后恢复
+	scheduler.OnSourceFrame(T0 + 20ms + 5s);
+	EXPECT_EQ(scheduler.GetSourceFrameInterval(), 20ms);
+
+	// 时间相同或倒退
+	scheduler.OnSourceFrame(T0 + 20ms + 5s);
+	scheduler.OnSourceFrame(T0 + 5s);
+	EXPECT_EQ(scheduler.GetSourceFrameInterval(), 20ms);
+}
+
+TEST(FrameSchedulerTests, MatchSourceFrameRate) {
+	FrameScheduler scheduler;
+	scheduler.OnSourceFrame(T0);
+	scheduler.OnSourceFrame(T0 + 20ms);
+
+	// 不限制帧率
+	EXPECT_EQ(scheduler.GetMinFrameInterval(), 0ms);
+
+	scheduler.SetMatchSourceFrameRate(true);
+	// 留出 10% 的余量
+	EXPECT_EQ(scheduler.GetMinFrameInterval(), 18ms);
+
+	// 尚未呈现过时可以立即呈现
+	EXPECT_EQ(scheduler.GetEarliestFrameTime(), TimePoint{});
+
+	scheduler.OnFramePresented(T0 + 30ms);
+	EXPECT_EQ(scheduler.GetEarliestFrameTime(), T0 + 48ms);
+}
+
+TEST(FrameSchedulerTests, WakeTime) {
+	FrameScheduler scheduler;
+	scheduler.SetIdleInterval(10ms);
+	scheduler.SetMatchSourceFrameRate(true);
+	scheduler.OnSourceFrame(T0);
+	scheduler.OnSourceFrame(T0 + 20ms);
+	scheduler.OnFramePresented(T0 + 100ms);
+
+	// 受帧率限制时在最早可以呈现的时间醒来
+	EXPECT_EQ(scheduler.GetWakeTime(T0 + 105ms, false), T0 + 118ms);
+	EXPECT_EQ(scheduler.GetWakeTime(T0 + 105ms, true), T0 + 118ms);
+
+	// 不受限制时，动画每帧都渲染，静止画面定期醒来
+	EXPECT_EQ(scheduler.GetWakeTime(T0 + 120ms, true), T0 + 120ms);
+	EXPECT_EQ(scheduler.GetWakeTime(T0 + 120ms, false), T0 + 130ms);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include "GPUMemoryEstimator.h"
+
+
+using Effect = GPUMemoryEstimator::Effect;
+using Size = GPUMemoryEstimator::Size;
+
+TEST(GPUMemoryEstimatorTests, BytesPerPixel) {
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_R8G8B8A8_UNORM, 1920, 1080), 1920ull * 1080 * 4);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_R16G16B16A16_FLOAT, 1920, 1080), 1920ull * 1080 * 8);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_R32G32B32A32_FLOAT, 1920, 1080), 1920ull * 1080 * 16);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_R16_FLOAT, 1920, 1080), 1920ull * 1080 * 2);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_R8_UNORM, 1920, 1080), 1920ull * 1080);
+	// 未列出的格式按 32 位计算
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(0, 10, 10), 400u);
+}
+
+TEST(GPUMemoryEstimatorTests, BlockCompressed) {
+	// 尺寸向上取整到 4 的倍数
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_BC1_UNORM, 4, 4), 8u);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_BC1_UNORM, 5, 5), 2 * 2 * 8u);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_BC1_UNORM, 1, 1), 8u);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_BC7_UNORM, 5, 5), 2 * 2 * 16u);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_BC7_UNORM, 1920, 1080), 480ull * 270 * 16);
+}
+
+TEST(GPUMemoryEstimatorTests, ZeroSize) {
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_R8G8B8A8_UNORM, 0, 1080), 0u);
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_BC1_UNORM, 0, 0), 0u);
+}
+
+TEST(GPUMemoryEstimatorTests, LargeTextureDoesNotOverflow) {
+	EXPECT_EQ(GPUMemoryEstimator::CalcTextureBytes(GPUMemoryEstimator::FORMAT_R32G32B32A32_FLOAT, 16384, 16384),
+		16384ull * 16384 * 16);
+}
+
+TEST(GPUMemoryEstimatorTests, EffectChain) {
+	std::vector<Effect> effects(3);
+
+	// 放大 2 倍，一个中间纹理
+	effects[0].textures = { { GPUMemoryEstimator::FORMAT_R16G16B16A16_FLOAT, { 800, 600 } } };
+	effects[0].outputSize = { 1600, 1200 };
+
+	// 尺寸未知的纹理不计算在内
+	effects[1].textures = {
+		{ GPUMemoryEstimator::FORMAT_R8_UNORM, { 1600, 1200 } },
+		{ GPUMemoryEstimator::FORMAT_BC1_UNORM, { 0, 0 } }
+	};
+	effects[1].outputSize = { 1600, 1200 };
+
+	// 输出纹理和主窗口尺寸相同，而不是效果的输出尺寸
+	effects[2].outputSize = { 1600, 1200 };
+	effects[2].isLastEffect = true;
+
+	const std::vector<uint64_t> bytes = GPUMemoryEstimator::EstimateEffectChain(effects, { 1920, 1080 });
+	ASSERT_EQ(bytes.size(), 3u);
+	EXPECT_EQ(bytes[0], 800ull * 600 * 8 + 1600ull * 1200 * 4);
+	EXPECT_EQ(bytes[1], 1600ull * 1200 + 1600ull * 1200 * 4);
+	EXPECT_EQ(bytes[2], 1920ull * 1080 * 4);
+}
+
+TEST(GPUMemoryEstimatorTests, EmptyChain) {
+	EXPECT_TRUE(GPUMemoryEstimator::EstimateEffectChain({}, { 1920, 1080 }).empty());
+}
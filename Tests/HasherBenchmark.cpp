@@ -0,0 +1,151 @@
+// 测量 Hasher（XXH3-128）计算缓存键的吞吐量，并和原先使用的 SHA-1 比较
+// 用法：HasherBenchmark [迭代次数]
+// Windows 上 SHA-1 使用 BCrypt，和原先的 Utils::Hasher 相同，多个线程共用一个哈希对象并加锁；
+// 其他平台使用 OpenSSL，找不到时只测量 Hasher
+#include "Hasher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <Windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+#define HAS_SHA1
+#elif defined(HAS_OPENSSL)
+#include <openssl/sha.h>
+#define HAS_SHA1
+#endif
+
+
+template<typename Fn>
+static double MeasureMs(const Fn& func) {
+	using namespace std::chrono;
+	auto t = steady_clock::now();
+	func();
+	return duration<double, std::milli>(steady_clock::now() - t).count();
+}
+
+static std::vector<uint8_t> MakeData(size_t size) {
+	std::vector<uint8_t> data(size);
+	uint32_t seed = 12345;
+	for (uint8_t& b : data) {
+		seed = seed * 1103515245 + 12345;
+		b = uint8_t(seed >> 16);
+	}
+	return data;
+}
+
+#ifdef HAS_SHA1
+// 原先的实现：BCrypt 的哈希对象内部保存状态，所有线程共用一个并加锁
+class Sha1Hasher {
+public:
+#ifdef _WIN32
+	Sha1Hasher() {
+		BCryptOpenAlgorithmProvider(&_hAlg, BCRYPT_SHA1_ALGORITHM, nullptr, 0);
+		BCryptCreateHash(_hAlg, &_hHash, nullptr, 0, nullptr, 0, BCRYPT_HASH_REUSABLE_FLAG);
+	}
+
+	~Sha1Hasher() {
+		BCryptDestroyHash(_hHash);
+		BCryptCloseAlgorithmProvider(_hAlg, 0);
+	}
+
+	void Hash(std::span<const uint8_t> data, uint8_t (&result)[20]) {
+		std::scoped_lock lk(_mutex);
+		BCryptHashData(_hHash, (PUCHAR)data.data(), (ULONG)data.size(), 0);
+		BCryptFinishHash(_hHash, result, sizeof(result), 0);
+	}
+
+private:
+	BCRYPT_ALG_HANDLE _hAlg = nullptr;
+	BCRYPT_HASH_HANDLE _hHash = nullptr;
+#else
+	void Hash(std::span<const uint8_t> data, uint8_t (&result)[20]) {
+		std::scoped_lock lk(_mutex);
+		SHA1(data.data(), data.size(), result);
+	}
+
+private:
+#endif
+	std::mutex _mutex;
+};
+#endif
+
+// 防止被优化掉
+static std::atomic<uint32_t> sink = 0;
+
+// threadCount 个线程同时计算，返回总吞吐量，单位为 MB/s。hashOnce 返回哈希的第一个字节
+template<typename Fn>
+static double MeasureThroughput(size_t dataSize, int iterations, uint32_t threadCount, const Fn& hashOnce) {
+	const double ms = MeasureMs([&]() {
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < threadCount; ++t) {
+			threads.emplace_back([&]() {
+				uint32_t result = 0;
+				for (int i = 0; i < iterations; ++i) {
+					result += hashOnce();
+				}
+				sink.fetch_add(result, std::memory_order_relaxed);
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	});
+
+	return double(dataSize) * iterations * threadCount / (1024 * 1024) / (ms / 1000);
+}
+
+int main(int argc, char* argv[]) {
+	const int iterations = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 200;
+	const uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	// 效果源码通常为几 KB 到几十 KB，包含大量内联常量时更大
+	static constexpr size_t SIZES[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+
+	std::printf("迭代 %d 次，多线程测试使用 %u 个线程\n", iterations, threadCount);
+#ifndef HAS_SHA1
+	std::printf("未找到 SHA-1 实现，只测量 Hasher\n");
+#endif
+
+	for (size_t size : SIZES) {
+		const std::vector<uint8_t> data = MakeData(size);
+
+		auto xxh3Once = [&]() {
+			Hasher hasher;
+			hasher.Update(data);
+			return hasher.Digest()[0];
+		};
+		// 预热
+		MeasureThroughput(size, iterations, 1, xxh3Once);
+		const double xxh3Single = MeasureThroughput(size, iterations, 1, xxh3Once);
+		const double xxh3Multi = MeasureThroughput(size, iterations, threadCount, xxh3Once);
+
+		std::printf("%7zu KB  XXH3-128 单线程 %9.1f MB/s  多线程 %9.1f MB/s\n",
+			size / 1024, xxh3Single, xxh3Multi);
+
+#ifdef HAS_SHA1
+		Sha1Hasher sha1;
+		auto sha1Once = [&]() {
+			uint8_t result[20];
+			sha1.Hash(data, result);
+			return result[0];
+		};
+		MeasureThroughput(size, iterations, 1, sha1Once);
+		const double sha1Single = MeasureThroughput(size, iterations, 1, sha1Once);
+		const double sha1Multi = MeasureThroughput(size, iterations, threadCount, sha1Once);
+
+		std::printf("%7zu KB  SHA-1    单线程 %9.1f MB/s  多线程 %9.1f MB/s  XXH3 加速 %.1fx / %.1fx\n",
+			size / 1024, sha1Single, sha1Multi, xxh3Single / sha1Single, xxh3Multi / sha1Multi);
+#endif
+	}
+
+	return sink == uint32_t(-1) ? 2 : 0;
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "Hasher.h"
+#include <string>
+#include <vector>
+#include <xxhash.h>
+
+
+static std::vector<uint8_t> MakeData(size_t size) {
+	std::vector<uint8_t> data(size);
+	uint32_t seed = 12345;
+	for (uint8_t& b : data) {
+		seed = seed * 1103515245 + 12345;
+		b = uint8_t(seed >> 16);
+	}
+	return data;
+}
+
+static std::array<uint8_t, Hasher::HASH_LENGTH> OneShot(std::span<const uint8_t> data) {
+	XXH128_canonical_t canonical;
+	XXH128_canonicalFromHash(&canonical, XXH3_128bits(data.data(), data.size()));
+
+	std::array<uint8_t, Hasher::HASH_LENGTH> result;
+	std::copy(std::begin(canonical.digest), std::end(canonical.digest), result.begin());
+	return result;
+}
+
+TEST(HasherTests, EmptyMatchesOneShot) {
+	Hasher hasher;
+	EXPECT_EQ(hasher.Digest(), OneShot({}));
+}
+
+// 跨越 XXH3 内部缓冲区（256 字节）和条带的各种分块方式
+TEST(HasherTests, StreamingMatchesOneShot) {
+	const std::vector<uint8_t> data = MakeData(100000);
+
+	for (size_t size : { 1, 3, 16, 17, 128, 240, 241, 1024, 4096, 100000 }) {
+		const std::span<const uint8_t> part(data.data(), size);
+		const auto expected = OneShot(part);
+
+		for (size_t chunk : { 1, 7, 64, 255, 256, 257, 1000 }) {
+			Hasher hasher;
+			for (size_t offset = 0; offset < size; offset += chunk) {
+				hasher.Update(part.subspan(offset, std::min(chunk, size - offset)));
+			}
+			EXPECT_EQ(hasher.Digest(), expected) << "size=" << size << " chunk=" << chunk;
+		}
+	}
+}
+
+TEST(HasherTests, DigestDoesNotResetState) {
+	const std::vector<uint8_t> data = MakeData(5000);
+
+	Hasher hasher;
+	hasher.Update(std::span(data.data(), 2000));
+	EXPECT_EQ(hasher.Digest(), OneShot(std::span(data.data(), 2000)));
+
+	hasher.Update(std::span(data.data() + 2000, 3000));
+	EXPECT_EQ(hasher.Digest(), OneShot(data));
+}
+
+TEST(HasherTests, StringIncludesLength) {
+	// 不写入长度时两者的字节序列相同
+	Hasher hasher1;
+	hasher1.Update(std::string_view("ab"));
+	hasher1.Update(std::string_view("c"));
+
+	Hasher hasher2;
+	hasher2.Update(std::string_view("a"));
+	hasher2.Update(std::string_view("bc"));
+
+	EXPECT_NE(hasher1.Digest(), hasher2.Digest());
+
+	// 等同于先写入 uint64_t 的长度
+	Hasher hasher3;
+	hasher3.UpdateValue(uint64_t(2));
+	hasher3.Update(std::span((const uint8_t*)"ab", 2));
+	Hasher hasher4;
+	hasher4.Update(std::string_view("ab"));
+	EXPECT_EQ(hasher3.Digest(), hasher4.Digest());
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "QualityGovernor.h"
+
+
+// 不平滑，便于计算每次采样后的状态
+static QualityGovernor::Options MakeOptions() {
+	QualityGovernor::Options options;
+	options.budget = 10.0f;
+	// 高于 9 时降级
+	options.downThreshold = 0.9f;
+	// 预计低于 7 时升级
+	options.upThreshold = 0.7f;
+	options.downSamples = 3;
+	options.upSamples = 5;
+	options.warmupSamples = 2;
+	options.smoothing = 1.0f;
+	return options;
+}
+
+static uint32_t Feed(QualityGovernor& governor, float time, uint32_t count) {
+	uint32_t level = governor.GetLevel();
+	for (uint32_t i = 0; i < count; ++i) {
+		level = governor.OnSample(time);
+	}
+	return level;
+}
+
+// 降级到等级 1，等级 0 的用时为 12，等级 1 到达时的用时为 6，即两者的比例为 2
+static void StepDownToLevel1(QualityGovernor& governor) {
+	Feed(governor, 12.0f, 2 + 3);
+	ASSERT_EQ(governor.GetLevel(), 1u);
+	Feed(governor, 6.0f, 2 + 1);
+}
+
+TEST(QualityGovernorTests, SingleLevelNeverChanges) {
+	QualityGovernor governor(1, MakeOptions());
+	EXPECT_EQ(Feed(governor, 100.0f, 100), 0u);
+}
+
+TEST(QualityGovernorTests, StepsDownAfterSustainedOverBudget) {
+	QualityGovernor governor(3, MakeOptions());
+
+	// 预热期间的采样被丢弃
+	EXPECT_EQ(Feed(governor, 100.0f, 2), 0u);
+	EXPECT_EQ(governor.GetSmoothedTime(), 0.0f);
+
+	EXPECT_EQ(Feed(governor, 12.0f, 2), 0u);
+	EXPECT_EQ(Feed(governor, 12.0f, 1), 1u);
+	EXPECT_EQ(governor.GetLevelCost(0), 12.0f);
+
+	// 最轻量的等级不再降级
+	EXPECT_EQ(Feed(governor, 12.0f, 2 + 3), 2u);
+	EXPECT_EQ(Feed(governor, 12.0f, 100), 2u);
+}
+
+TEST(QualityGovernorTests, SpikeDoesNotStepDown) {
+	QualityGovernor governor(2, MakeOptions());
+	Feed(governor, 5.0f, 2);
+
+	// 连续的采样才计数，中间低于阈值时重新计数
+	for (int i = 0; i < 10; ++i) {
+		Feed(governor, 12.0f, 2);
+		Feed(governor, 5.0f, 1);
+	}
+	EXPECT_EQ(governor.GetLevel(), 0u);
+
+	// 默认的平滑使单帧的尖峰被平均
+	QualityGovernor smoothed(2, QualityGovernor::Options{});
+	for (int i = 0; i < 1000; ++i) {
+		smoothed.OnSample(i % 20 == 0 ? 40.0f : 10.0f);
+	}
+	EXPECT_EQ(smoothed.GetLevel(), 0u);
+
+	// 无效的采样被忽略
+	EXPECT_EQ(Feed(governor, 0.0f, 100), 0u);
+	EXPECT_EQ(Feed(governor, -1.0f, 100), 0u);
+}
+
+TEST(QualityGovernorTests, Hysteresis) {
+	QualityGovernor governor(2, MakeOptions());
+	StepDownToLevel1(governor);
+
+	// 预计升级后为 8，既不满足升级条件，也不会在升级后立即降级
+	EXPECT_EQ(Feed(governor, 4.0f, 1000), 1u);
+
+	// 预计升级后为 6，持续满足条件后升级
+	EXPECT_EQ(Feed(governor, 3.0f, 4), 1u);
+	EXPECT_EQ(Feed(governor, 3.0f, 1), 0u);
+}
+
+TEST(QualityGovernorTests, UpCountResetsWhenConditionBreaks) {
+	QualityGovernor governor(2, MakeOptions());
+	StepDownToLevel1(governor);
+
+	for (int i = 0; i < 10; ++i) {
+		Feed(governor, 3.0f, 4);
+		Feed(governor, 4.0f, 1);
+	}
+	EXPECT_EQ(governor.GetLevel(), 1u);
+}
+
+TEST(QualityGovernorTests, FailedUpBacksOff) {
+	QualityGovernor governor(2, MakeOptions());
+	StepDownToLevel1(governor);
+	EXPECT_EQ(Feed(governor, 3.0f, 5), 0u);
+
+	// 升级后很快又超出预算
+	EXPECT_EQ(Feed(governor, 12.0f, 2 + 3), 1u);
+
+	// 再次升级需要两倍的采样
+	Feed(governor, 6.0f, 2 + 1);
+	EXPECT_EQ(Feed(governor, 3.0f, 9), 1u);
+	EXPECT_EQ(Feed(governor, 3.0f, 1), 0u);
+
+	// 在等级 0 稳定足够长的时间后降级不算作升级失败
+	Feed(governor, 8.0f, 2 + 5);
+	EXPECT_EQ(Feed(governor, 12.0f, 3), 1u);
+	Feed(governor, 6.0f, 2 + 1);
+	EXPECT_EQ(Feed(governor, 3.0f, 9), 1u);
+	EXPECT_EQ(Feed(governor, 3.0f, 1), 0u);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "SPSCQueue.h"
+#include <memory>
+#include <thread>
+
+
+TEST(SPSCQueueTests, FullAndEmpty) {
+	SPSCQueue<int, 4> queue;
+	EXPECT_TRUE(queue.IsEmpty());
+
+	int value = 0;
+	EXPECT_FALSE(queue.TryPop(value));
+
+	for (int i = 0; i < 4; ++i) {
+		int item = i;
+		EXPECT_TRUE(queue.TryPush(std::move(item)));
+	}
+	int extra = 4;
+	EXPECT_FALSE(queue.TryPush(std::move(extra)));
+
+	for (int i = 0; i < 4; ++i) {
+		ASSERT_TRUE(queue.TryPop(value));
+		EXPECT_EQ(value, i);
+	}
+	EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(SPSCQueueTests, PushFailureKeepsValue) {
+	SPSCQueue<std::unique_ptr<int>, 2> queue;
+	EXPECT_TRUE(queue.TryPush(std::make_unique<int>(1)));
+	EXPECT_TRUE(queue.TryPush(std::make_unique<int>(2)));
+
+	auto value = std::make_unique<int>(3);
+	EXPECT_FALSE(queue.TryPush(std::move(value)));
+	ASSERT_TRUE(value);
+	EXPECT_EQ(*value, 3);
+}
+
+TEST(SPSCQueueTests, PopReleasesSlot) {
+	SPSCQueue<std::shared_ptr<int>, 2> queue;
+	auto item = std::make_shared<int>(1);
+	std::weak_ptr<int> weak = item;
+
+	EXPECT_TRUE(queue.TryPush(std::move(item)));
+
+	std::shared_ptr<int> value;
+	ASSERT_TRUE(queue.TryPop(value));
+	value.reset();
+	EXPECT_TRUE(weak.expired());
+}
+
+// 以下测试在另一个线程中生产，应在 ThreadSanitizer 下运行
+
+// 生产者和消费者同时运行，检查元素按顺序到达且没有丢失或重复
+TEST(SPSCQueueTests, StressOrdering) {
+	static constexpr uint64_t ITEM_COUNT = 4'000'000;
+
+	// 容量较小，生产者和消费者频繁地互相等待
+	SPSCQueue<uint64_t, 64> queue;
+
+	std::thread producer([&]() {
+		for (uint64_t i = 0; i < ITEM_COUNT;) {
+			uint64_t item = i;
+			if (queue.TryPush(std::move(item))) {
+				++i;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	uint64_t expected = 0;
+	uint64_t mismatches = 0;
+	while (expected < ITEM_COUNT) {
+		uint64_t value;
+		if (queue.TryPop(value)) {
+			mismatches += value != expected;
+			++expected;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	producer.join();
+
+	EXPECT_EQ(mismatches, 0u);
+	EXPECT_TRUE(queue.IsEmpty());
+}
+
+// 元素持有堆内存，检查移动进出槽位时不会竞争或泄漏
+TEST(SPSCQueueTests, StressOwnership) {
+	static constexpr uint64_t ITEM_COUNT = 1'000'000;
+
+	SPSCQueue<std::unique_ptr<uint64_t>, 256> queue;
+
+	std::thread producer([&]() {
+		for (uint64_t i = 0; i < ITEM_COUNT;) {
+			auto item = std::make_unique<uint64_t>(i);
+			while (!queue.TryPush(std::move(item))) {
+				std::this_thread::yield();
+			}
+			++i;
+		}
+	});
+
+	uint64_t expected = 0;
+	uint64_t mismatches = 0;
+	while (expected < ITEM_COUNT) {
+		std::unique_ptr<uint64_t> value;
+		if (queue.TryPop(value)) {
+			mismatches += !value || *value != expected;
+			++expected;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	producer.join();
+
+	EXPECT_EQ(mismatches, 0u);
+}
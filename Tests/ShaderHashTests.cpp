@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "ShaderHash.h"
+#include <string>
+
+
+// 模拟 D3DPreprocess 的输出，sourceName 为 EffectCompiler 传入的 {效果名}_Pass{序号}.hlsl
+static std::string Preprocessed(std::string_view sourceName, std::string_view body) {
+	std::string result = "#line 1 \"";
+	result.append(sourceName).append("\"\n");
+	result.append("cbuffer __CB1 : register(b0) { uint2 __inputSize; };\n");
+	result.append("#line 12 \"").append(sourceName).append("\"\n");
+	result.append(body);
+	return result;
+}
+
+static constexpr std::string_view PASS_BODY =
+	"Texture2D INPUT : register(t0);\n"
+	"float4 Pass1(float2 pos) { return INPUT.SampleLevel(sam, pos, 0); }\n";
+
+TEST(ShaderHashTests, SamePassInDifferentEffects) {
+	EXPECT_EQ(
+		ShaderHash::Compute(Preprocessed("Bicubic_Pass1.hlsl", PASS_BODY), 1, 0),
+		ShaderHash::Compute(Preprocessed("Lanczos_Pass1.hlsl", PASS_BODY), 1, 0)
+	);
+}
+
+TEST(ShaderHashTests, LineNumbersIgnored) {
+	std::string a = Preprocessed("A_Pass1.hlsl", PASS_BODY);
+	std::string b = Preprocessed("A_Pass1.hlsl", PASS_BODY);
+	b.replace(b.find("#line 12"), 8, "  #line 40");
+
+	EXPECT_EQ(ShaderHash::Compute(a, 1, 0), ShaderHash::Compute(b, 1, 0));
+}
+
+TEST(ShaderHashTests, IgnoresOnlyLineDirectives) {
+	const std::string source = Preprocessed("A_Pass1.hlsl", PASS_BODY);
+
+	// 和删除所有 #line 行的结果相同
+	std::string stripped = "cbuffer __CB1 : register(b0) { uint2 __inputSize; };\n";
+	stripped.append(PASS_BODY);
+	EXPECT_EQ(ShaderHash::Compute(source, 1, 0), ShaderHash::Compute(stripped, 1, 0));
+
+	std::string changed = source;
+	changed.replace(changed.find("Pass1("), 5, "Pass2");
+	EXPECT_NE(ShaderHash::Compute(source, 1, 0), ShaderHash::Compute(changed, 1, 0));
+
+	// 没有以换行结尾
+	EXPECT_NE(ShaderHash::Compute(stripped, 1, 0), ShaderHash::Compute(stripped.substr(0, stripped.size() - 1), 1, 0));
+}
+
+TEST(ShaderHashTests, VersionAndFlags) {
+	const std::string source = Preprocessed("A_Pass1.hlsl", PASS_BODY);
+	const auto hash = ShaderHash::Compute(source, 1, 0);
+
+	EXPECT_NE(hash, ShaderHash::Compute(source, 2, 0));
+	EXPECT_NE(hash, ShaderHash::Compute(source, 1, 1));
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "TilePlanner.h"
+
+
+using Rect = TilePlanner::Rect;
+using Size = TilePlanner::Size;
+using Stage = TilePlanner::Stage;
+
+static Stage MakeStage(Size inputSize, Size outputSize, uint32_t halo, std::vector<Size> textureSizes = {}) {
+	return Stage{ inputSize, outputSize, halo, std::move(textureSizes) };
+}
+
+// 检查所有图块共同满足的性质
+static void CheckTiles(const TilePlanner& planner, const std::vector<Stage>& stages, const Rect& roi) {
+	const Size inputSize = stages.front().inputSize;
+	const Size cropSize = planner.GetCropSize(0);
+
+	uint64_t outputArea = 0;
+	const std::vector<TilePlanner::Tile>& tiles = planner.GetTiles();
+	for (size_t i = 0; i < tiles.size(); ++i) {
+		const TilePlanner::Tile& tile = tiles[i];
+		SCOPED_TRACE(testing::Message() << "图块 " << i);
+
+		// 裁剪区域尺寸相同且位于输入内
+		EXPECT_EQ(uint32_t(tile.crop.right - tile.crop.left), cropSize.width);
+		EXPECT_EQ(uint32_t(tile.crop.bottom - tile.crop.top), cropSize.height);
+		EXPECT_GE(tile.crop.left, 0);
+		EXPECT_GE(tile.crop.top, 0);
+		EXPECT_LE(tile.crop.right, (int32_t)inputSize.width);
+		EXPECT_LE(tile.crop.bottom, (int32_t)inputSize.height);
+
+		// 负责的输出位于裁剪区域的输出和 roi 内
+		EXPECT_GE(tile.output.left, std::max(tile.cropOutput.left, roi.left));
+		EXPECT_GE(tile.output.top, std::max(tile.cropOutput.top, roi.top));
+		EXPECT_LE(tile.output.right, std::min(tile.cropOutput.right, roi.right));
+		EXPECT_LE(tile.output.bottom, std::min(tile.cropOutput.bottom, roi.bottom));
+		outputArea += tile.output.GetArea();
+
+		for (size_t j = i + 1; j < tiles.size(); ++j) {
+			EXPECT_FALSE(tile.output.IsOverlapped(tiles[j].output)) << "和图块 " << j << " 重叠";
+		}
+
+		// 裁剪区域的边界在所有纹理上都是整像素
+		const auto checkAligned = [&](Size size) {
+			EXPECT_EQ(uint64_t(tile.crop.left) * size.width % inputSize.width, 0u);
+			EXPECT_EQ(uint64_t(tile.crop.right) * size.width % inputSize.width, 0u);
+			EXPECT_EQ(uint64_t(tile.crop.top) * size.height % inputSize.height, 0u);
+			EXPECT_EQ(uint64_t(tile.crop.bottom) * size.height % inputSize.height, 0u);
+		};
+		for (const Stage& stage : stages) {
+			checkAligned(stage.inputSize);
+			checkAligned(stage.outputSize);
+			for (const Size& size : stage.textureSizes) {
+				checkAligned(size);
+			}
+		}
+
+		// 反向映射负责的输出，所需的输入（包括采样范围）都在裁剪区域内
+		int64_t left = tile.output.left;
+		int64_t top = tile.output.top;
+		int64_t right = tile.output.right;
+		int64_t bottom = tile.output.bottom;
+		for (size_t k = stages.size(); k-- > 0;) {
+			const Stage& stage = stages[k];
+			left = std::max<int64_t>(left * stage.inputSize.width / stage.outputSize.width - stage.halo, 0);
+			top = std::max<int64_t>(top * stage.inputSize.height / stage.outputSize.height - stage.halo, 0);
+			right = std::min<int64_t>((right * stage.inputSize.width + stage.outputSize.width - 1) / stage.outputSize.width + stage.halo, stage.inputSize.width);
+			bottom = std::min<int64_t>((bottom * stage.inputSize.height + stage.outputSize.height - 1) / stage.outputSize.height + stage.halo, stage.inputSize.height);
+		}
+		EXPECT_LE(tile.crop.left, left);
+		EXPECT_LE(tile.crop.top, top);
+		EXPECT_GE(tile.crop.right, right);
+		EXPECT_GE(tile.crop.bottom, bottom);
+	}
+
+	// 图块互不重叠且都在 roi 内，面积相等即完整覆盖 roi
+	EXPECT_EQ(outputArea, roi.GetArea());
+}
+
+TEST(TilePlannerTests, Upscale2x) {
+	const std::vector<Stage> stages{ MakeStage({ 1000, 1000 }, { 2000, 2000 }, 2) };
+
+	TilePlanner planner;
+	ASSERT_TRUE(planner.Plan(stages, { 500, 500 }));
+
+	// 每个方向 4 块，中间的图块需要 250 + 2 * (2 + 1) 个输入像素
+	EXPECT_EQ(planner.GetTiles().size(), 16u);
+	EXPECT_EQ(planner.GetCropSize(0), (Size{ 256, 256 }));
+	EXPECT_EQ(planner.GetCropSize(1), (Size{ 512, 512 }));
+	EXPECT_EQ(planner.GetCropSize(2), (Size{}));
+
+	// 靠近边缘的裁剪区域向内移动
+	EXPECT_EQ(planner.GetTiles()[0].crop, (Rect{ 0, 0, 256, 256 }));
+	EXPECT_EQ(planner.GetTiles()[15].crop, (Rect{ 744, 744, 1000, 1000 }));
+	EXPECT_EQ(planner.GetTiles()[15].output, (Rect{ 1500, 1500, 2000, 2000 }));
+
+	CheckTiles(planner, stages, Rect{ 0, 0, 2000, 2000 });
+}
+
+TEST(TilePlannerTests, MultipleStages) {
+	// 1.5 倍的缩放使裁剪区域的边界对齐到 2 的倍数，中间纹理为输入的一半，对齐到 2 的倍数
+	const std::vector<Stage> stages{
+		MakeStage({ 1000, 800 }, { 1500, 1200 }, 3, { { 500, 400 } }),
+		MakeStage({ 1500, 1200 }, { 3000, 2400 }, 1),
+		MakeStage({ 3000, 2400 }, { 3000, 2400 }, 4)
+	};
+
+	TilePlanner planner;
+	ASSERT_TRUE(planner.Plan(stages, { 700, 600 }));
+	EXPECT_EQ(planner.GetTiles().size(), 5u * 4u);
+
+	const Size cropSize = planner.GetCropSize(0);
+	EXPECT_EQ(cropSize.width % 2, 0u);
+	EXPECT_EQ(planner.GetCropSize(1), (Size{ cropSize.width * 3 / 2, cropSize.height * 3 / 2 }));
+	EXPECT_EQ(planner.GetCropSize(3), (Size{ cropSize.width * 3, cropSize.height * 3 }));
+
+	CheckTiles(planner, stages, Rect{ 0, 0, 3000, 2400 });
+}
+
+TEST(TilePlannerTests, Roi) {
+	const std::vector<Stage> stages{ MakeStage({ 1000, 1000 }, { 2000, 2000 }, 2) };
+	const Rect roi{ 300, 100, 1300, 700 };
+
+	TilePlanner planner;
+	ASSERT_TRUE(planner.Plan(stages, { 512, 512 }, roi));
+	EXPECT_EQ(planner.GetTiles().size(), 2u * 2u);
+	CheckTiles(planner, stages, roi);
+
+	// 一个方向不分块
+	ASSERT_TRUE(planner.Plan(stages, { 2000, 256 }));
+	EXPECT_EQ(planner.GetCropSize(0).width, 1000u);
+	EXPECT_EQ(planner.GetTiles().size(), 8u);
+	CheckTiles(planner, stages, Rect{ 0, 0, 2000, 2000 });
+}
+
+TEST(TilePlannerTests, RejectsInvalidOrPointless) {
+	TilePlanner planner;
+	EXPECT_FALSE(planner.Plan({}, { 256, 256 }));
+
+	// 尺寸不衔接
+	EXPECT_FALSE(planner.Plan({
+		MakeStage({ 100, 100 }, { 200, 200 }, 0),
+		MakeStage({ 300, 300 }, { 600, 600 }, 0)
+	}, { 64, 64 }));
+
+	const std::vector<Stage> stages{ MakeStage({ 1000, 1000 }, { 2000, 2000 }, 2) };
+
+	// roi 超出输出
+	EXPECT_FALSE(planner.Plan(stages, { 256, 256 }, Rect{ -1, 0, 100, 100 }));
+	EXPECT_FALSE(planner.Plan(stages, { 256, 256 }, Rect{ 0, 0, 2001, 100 }));
+	EXPECT_FALSE(planner.Plan(stages, { 256, 256 }, Rect{ 10, 10, 10, 100 }));
+
+	// 图块不比输出小
+	EXPECT_FALSE(planner.Plan(stages, { 2000, 2000 }));
+	// 采样范围过大，裁剪区域和输入一样大
+	EXPECT_FALSE(planner.Plan({ MakeStage({ 100, 100 }, { 200, 200 }, 60) }, { 100, 100 }));
+	EXPECT_TRUE(planner.GetTiles().empty());
+}
@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+#include "VulkanComputeDevice.h"
+#include "EffectChainRunner.h"
+#include "EffectSpirvCompiler.h"
+#include <cmath>
+#include <cstring>
+
+
+using Handle = ComputeDevice::Handle;
+
+static constexpr uint32_t FORMAT_R16G16B16A16_FLOAT = 10;
+static constexpr uint32_t FORMAT_R8G8B8A8_UNORM = 28;
+
+// 和 EffectCompiler 生成的源码相同的常量缓冲区和入口点
+static constexpr const char* COMMON_HLSL = R"(
+cbuffer __CB1 : register(b0) {
+	uint2 __cursorPos;
+	uint __frameCount;
+};
+cbuffer __CB2 : register(b1) {
+	uint2 __inputSize;
+	uint2 __outputSize;
+	float2 __inputPt;
+	float2 __outputPt;
+	float2 __scale;
+	int2 __viewport;
+	float scale;
+};
+cbuffer __CB3 : register(b2) {
+	uint2 __blockOffset;
+};
+SamplerState sam : register(s0);
+)";
+
+// 将 INPUT 乘以参数
+static constexpr const char* PASS1_HLSL = R"(
+Texture2D INPUT : register(t0);
+RWTexture2D<float4> tex1 : register(u0);
+
+[numthreads(8, 8, 1)]
+void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
+	uint2 pos = (gid.xy + __blockOffset) * 8 + tid.xy;
+	tex1[pos] = INPUT[pos] * scale;
+}
+)";
+
+// 用点采样放大到 OUTPUT，alpha 通道为 __frameCount
+static constexpr const char* PASS2_HLSL = R"(
+Texture2D tex1 : register(t0);
+RWTexture2D<unorm float4> OUTPUT : register(u0);
+
+[numthreads(8, 8, 1)]
+void __M(uint3 tid : SV_GroupThreadID, uint3 gid : SV_GroupID) {
+	uint2 pos = (gid.xy + __blockOffset) * 8 + tid.xy;
+	if (pos.x >= __outputSize.x || pos.y >= __outputSize.y) {
+		return;
+	}
+
+	float4 color = tex1.SampleLevel(sam, (pos + 0.5f) * __outputPt, 0);
+	OUTPUT[pos] = float4(color.rgb, __frameCount / 255.0f);
+}
+)";
+
+TEST(EffectSpirvCompilerTests, RegisterShifts) {
+	const EffectSpirvCompiler::RegisterShifts shifts = EffectSpirvCompiler::GetRegisterShifts(2, 3);
+
+	// 和 EffectPassPlan 的 binding 一致
+	EffectPassPlan::PassDesc passDesc;
+	passDesc.inputs = { 0, 1, 2 };
+	passDesc.outputs = { 3, 4 };
+	passDesc.numThreads = { 8, 8, 1 };
+	passDesc.blockSize = { 8, 8 };
+
+	EffectPassPlan plan;
+	ASSERT_TRUE(plan.Build({ passDesc }, std::vector<EffectPassPlan::Size>(6, { 8, 8 }), { 8, 8 }, 2)) << plan.GetError();
+	for (const EffectPassPlan::Binding& binding : plan.GetPasses()[0].bindings) {
+		switch (binding.type) {
+		case EffectPassPlan::BindingType::ConstantBuffer:
+			EXPECT_EQ(binding.binding, binding.slot);
+			break;
+		case EffectPassPlan::BindingType::Sampler:
+			EXPECT_EQ(binding.binding, shifts.sampler + binding.slot);
+			break;
+		case EffectPassPlan::BindingType::SampledTexture:
+			EXPECT_EQ(binding.binding, shifts.texture + binding.slot);
+			break;
+		case EffectPassPlan::BindingType::StorageTexture:
+			EXPECT_EQ(binding.binding, shifts.uav + binding.slot);
+			break;
+		}
+	}
+}
+
+TEST(EffectSpirvCompilerTests, CompileError) {
+	std::vector<uint32_t> spirv;
+	std::string messages;
+	EXPECT_FALSE(EffectSpirvCompiler::Compile("[numthreads(8, 8, 1)] void __M() { undefined = 1; }", 0, 0, spirv, messages));
+	EXPECT_TRUE(spirv.empty());
+	EXPECT_FALSE(messages.empty());
+}
+
+// 没有 Vulkan 驱动时跳过，Linux 上可以使用 Mesa 的 lavapipe
+// INPUT 为 8x8，OUTPUT 为 16x16，和 EffectChainRunnerTests 相同
+class VulkanComputeDeviceTests : public testing::Test {
+protected:
+	void SetUp() override {
+		if (!_device.Initialize()) {
+			GTEST_SKIP() << "初始化 Vulkan 失败：" << _device.GetError();
+		}
+
+		EffectPassPlan::PassDesc pass1;
+		pass1.inputs = { 0 };
+		pass1.outputs = { 1 };
+		pass1.numThreads = { 8, 8, 1 };
+		pass1.blockSize = { 8, 8 };
+
+		EffectPassPlan::PassDesc pass2 = pass1;
+		pass2.inputs = { 1 };
+		pass2.outputs = {};
+
+		_desc.textures = {
+			{ { 8, 8 }, FORMAT_R8G8B8A8_UNORM },
+			{ { 8, 8 }, FORMAT_R16G16B16A16_FLOAT },
+			{ { 16, 16 }, FORMAT_R8G8B8A8_UNORM }
+		};
+		_desc.samplers = { { ComputeDevice::SamplerFilter::Point, ComputeDevice::SamplerAddress::Clamp } };
+		_desc.passes = { pass1, pass2 };
+
+		for (const char* passHlsl : { PASS1_HLSL, PASS2_HLSL }) {
+			std::vector<uint32_t> spirv;
+			std::string messages;
+			ASSERT_TRUE(EffectSpirvCompiler::Compile(std::string(COMMON_HLSL) + passHlsl, 1, 1, spirv, messages)) << messages;
+
+			const Handle kernel = _device.RegisterKernel(spirv);
+			ASSERT_NE(kernel, ComputeDevice::INVALID_HANDLE) << _device.GetError();
+			_desc.kernels.push_back(kernel);
+		}
+
+		const float scale = 0.5f;
+		_desc.constants.resize(1);
+		std::memcpy(_desc.constants.data(), &scale, sizeof(scale));
+
+		ASSERT_TRUE(_runner.Initialize(_device, _desc)) << _runner.GetError();
+
+		std::vector<uint8_t> input(8 * 8 * 4);
+		for (uint32_t y = 0; y < 8; ++y) {
+			for (uint32_t x = 0; x < 8; ++x) {
+				uint8_t* pixel = &input[(y * 8 + x) * 4];
+				pixel[0] = uint8_t(x * 32);
+				pixel[1] = uint8_t(y * 32);
+				pixel[2] = 255;
+				pixel[3] = 255;
+			}
+		}
+		ASSERT_TRUE(_device.WriteTexture(_runner.GetTexture(0), input)) << _device.GetError();
+	}
+
+	// OUTPUT 中 (x, y) 处的期望值
+	static std::array<uint8_t, 4> _Expected(uint32_t x, uint32_t y, uint32_t frameCount) {
+		return {
+			uint8_t(std::lround((x / 2) * 32 * 0.5f)),
+			uint8_t(std::lround((y / 2) * 32 * 0.5f)),
+			uint8_t(std::lround(255 * 0.5f)),
+			uint8_t(frameCount)
+		};
+	}
+
+	static void _CheckPixel(const std::vector<uint8_t>& output, uint32_t x, uint32_t y, std::array<uint8_t, 4> expected) {
+		for (uint32_t c = 0; c < 4; ++c) {
+			// 中间纹理为 FP16，允许舍入误差
+			EXPECT_NEAR(output[(y * 16 + x) * 4 + c], expected[c], 1) << x << ", " << y << ", " << c;
+		}
+	}
+
+	VulkanComputeDevice _device;
+	EffectChainRunner::Desc _desc;
+	EffectChainRunner _runner;
+};
+
+TEST_F(VulkanComputeDeviceTests, RunChain) {
+	ASSERT_TRUE(_runner.Run()) << _runner.GetError();
+
+	std::vector<uint8_t> output;
+	ASSERT_TRUE(_device.ReadTexture(_runner.GetTexture(2), output)) << _device.GetError();
+	ASSERT_EQ(output.size(), 16u * 16 * 4);
+	for (uint32_t y = 0; y < 16; ++y) {
+		for (uint32_t x = 0; x < 16; ++x) {
+			_CheckPixel(output, x, y, _Expected(x, y, 1));
+		}
+	}
+
+	// 更新 __CB1 前提交上一次执行
+	ASSERT_TRUE(_runner.Run());
+	ASSERT_TRUE(_runner.Run());
+	ASSERT_TRUE(_device.ReadTexture(_runner.GetTexture(2), output));
+	_CheckPixel(output, 5, 7, _Expected(5, 7, 3));
+}
+
+TEST_F(VulkanComputeDeviceTests, DispatchBlocks) {
+	ASSERT_TRUE(_runner.Run()) << _runner.GetError();
+
+	const std::vector<uint8_t> zeros(16 * 16 * 4);
+	ASSERT_TRUE(_device.WriteTexture(_runner.GetTexture(2), zeros));
+
+	// 只调度右下角的线程组，起始线程组由 __CB3 传入
+	const EffectPassPlan::Pass& pass = _runner.GetPassPlan().GetPasses()[1];
+	const Handle cb1 = _device.CreateConstantBuffer(16);
+	const Handle cb2 = _device.CreateConstantBuffer(16 * 4);
+	const Handle cb3 = _device.CreateConstantBuffer(16);
+	const uint32_t cb1Data[4] = { 0, 0, 9, 0 };
+	ASSERT_TRUE(_device.UpdateConstantBuffer(cb1, cb1Data, sizeof(cb1Data)));
+	// __inputSize、__outputSize 和 __outputPt
+	std::vector<uint32_t> cb2Data(16);
+	cb2Data[0] = cb2Data[1] = 8;
+	cb2Data[2] = cb2Data[3] = 16;
+	const float outputPt[2] = { 1.0f / 16, 1.0f / 16 };
+	std::memcpy(&cb2Data[6], outputPt, sizeof(outputPt));
+	ASSERT_TRUE(_device.UpdateConstantBuffer(cb2, cb2Data.data(), uint32_t(cb2Data.size() * 4)));
+
+	const Handle sampler = _device.CreateSampler(ComputeDevice::SamplerFilter::Point, ComputeDevice::SamplerAddress::Clamp);
+	const Handle srv = _device.CreateView(_runner.GetTexture(1), ComputeDevice::ViewType::ShaderResource);
+	const Handle uav = _device.CreateView(_runner.GetTexture(2), ComputeDevice::ViewType::UnorderedAccess);
+	const Handle bindings[] = { cb1, cb2, cb3, sampler, srv, uav };
+
+	const DirtyRegion::Rect blockRects[] = { { 1, 1, 2, 2 } };
+	ASSERT_TRUE(_device.DispatchBlocks(_desc.kernels[1], pass, bindings, blockRects)) << _device.GetError();
+
+	std::vector<uint8_t> output;
+	ASSERT_TRUE(_device.ReadTexture(_runner.GetTexture(2), output));
+	for (uint32_t y = 0; y < 16; ++y) {
+		for (uint32_t x = 0; x < 16; ++x) {
+			if (x >= 8 && y >= 8) {
+				_CheckPixel(output, x, y, _Expected(x, y, 9));
+			} else {
+				_CheckPixel(output, x, y, {});
+			}
+		}
+	}
+
+	// 类型不符的视图
+	const Handle wrongBindings[] = { cb1, cb2, cb3, sampler, uav, uav };
+	EXPECT_FALSE(_device.Dispatch(_desc.kernels[1], pass, wrongBindings, {}, pass.groups));
+}
+
+TEST_F(VulkanComputeDeviceTests, PassTimes) {
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_TRUE(_runner.Run(true)) << _runner.GetError();
+	}
+
+	std::vector<double> passTimes;
+	ASSERT_TRUE(_runner.GetPassTimes(passTimes)) << _runner.GetError();
+	ASSERT_EQ(passTimes.size(), 2u);
+	for (double time : passTimes) {
+		EXPECT_GE(time, 0.0);
+	}
+
+	// 查询池在取回后复用
+	ASSERT_TRUE(_runner.Run(true));
+	ASSERT_TRUE(_runner.GetPassTimes(passTimes)) << _runner.GetError();
+}
+
+TEST_F(VulkanComputeDeviceTests, InvalidResources) {
+	EXPECT_EQ(_device.CreateTexture(0, 8, FORMAT_R8G8B8A8_UNORM), ComputeDevice::INVALID_HANDLE);
+	// BC7 不能作为存储图像
+	EXPECT_EQ(_device.CreateTexture(8, 8, 98), ComputeDevice::INVALID_HANDLE);
+	EXPECT_EQ(_device.CreateConstantBuffer(12), ComputeDevice::INVALID_HANDLE);
+
+	const Handle texture = _runner.GetTexture(0);
+	std::vector<uint8_t> texels(7);
+	EXPECT_FALSE(_device.WriteTexture(texture, texels));
+}